@@ -1,8 +1,12 @@
 #include "Actor.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 FActor::FActor()
 {
     bValid = false;
+    Location = glm::vec3(0);
+    Rotation = glm::vec3(0);
+    Scale = glm::vec3(1);
     World = nullptr;
 }
 
@@ -21,6 +25,15 @@ void FActor::SetScale(glm::vec3 NewScale)
     Scale = NewScale;
 }
 
+glm::mat4 FActor::GetTransform() const
+{
+    glm::mat4 Transform = glm::translate(glm::mat4(1.0f), Location);
+    Transform = glm::rotate(Transform, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    Transform = glm::rotate(Transform, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    Transform = glm::rotate(Transform, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    return glm::scale(Transform, Scale);
+}
+
 FWorld* FActor::GetWorld() const
 {
     return World;
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 class FWorld;
@@ -16,6 +17,8 @@ public:
     glm::vec3 GetLocation() const { return Location; }
     glm::vec3 GetRotation() const { return Rotation; }
     glm::vec3 GetScale() const { return Scale;}
+    // Scale, then rotation in degrees around X, Y and Z, then translation
+    glm::mat4 GetTransform() const;
 
     FWorld* GetWorld() const;
     
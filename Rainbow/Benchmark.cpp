@@ -0,0 +1,534 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <glm/glm.hpp>
+#include "CommandList.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+#include "Paths.h"
+#include "Renderer.h"
+
+// Differences below this are timer and scheduling noise, whatever the relative change
+static constexpr double BENCHMARK_NOISE_FLOOR_MS = 0.05;
+
+FBenchmarkSettings::FBenchmarkSettings()
+{
+    WarmupFrames = 60;
+    MeasuredFrames = 500;
+    RegressionThreshold = 0.05;
+    bWindowed = false;
+    bCullingOnly = false;
+    bThreadSweep = false;
+}
+
+static const char* GetOptionValue(const char* Argument, const char* Option)
+{
+    const size_t Length = strlen(Option);
+    return strncmp(Argument, Option, Length) == 0 ? Argument + Length : nullptr;
+}
+
+FBenchmarkSettings FBenchmarkSettings::FromCommandLine(int Argc, char* Argv[])
+{
+    FBenchmarkSettings Settings;
+    for(int i = 1; i < Argc; i++)
+    {
+        if(const char* Value = GetOptionValue(Argv[i], "-warmup="))
+        {
+            Settings.WarmupFrames = static_cast<uint32_t>(std::max(atoi(Value), 0));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-benchframes="))
+        {
+            Settings.MeasuredFrames = static_cast<uint32_t>(std::max(atoi(Value), 1));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-report="))
+        {
+            Settings.ReportPath = Value;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-baseline="))
+        {
+            Settings.BaselinePath = Value;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-threshold="))
+        {
+            Settings.RegressionThreshold = std::max(atof(Value), 0.0) / 100.0;
+        }
+        else if(strcmp(Argv[i], "-windowed") == 0)
+        {
+            Settings.bWindowed = true;
+        }
+        else if(strcmp(Argv[i], "-cullbench") == 0)
+        {
+            Settings.bCullingOnly = true;
+        }
+        else if(strcmp(Argv[i], "-threadsweep") == 0)
+        {
+            Settings.bThreadSweep = true;
+        }
+    }
+
+    if(Settings.ReportPath.empty())
+    {
+        Settings.ReportPath = FPaths::GetSavedDirectory() + "/Benchmark.json";
+    }
+    return Settings;
+}
+
+void FBenchmarkSettings::ConfigureRenderer(FRendererSettings& RendererSettings) const
+{
+    RendererSettings.bHeadless = !bWindowed;
+    // The benchmark decides when to stop, and the frame limiter would only measure itself
+    RendererSettings.MaxFrames = 0;
+    RendererSettings.MaxFrameRate = 0.0f;
+    if(RendererSettings.Scene.Type == EBenchmarkScene::None)
+    {
+        FBenchmarkScene::Parse("instances", RendererSettings.Scene);
+    }
+}
+
+FBenchmark::FBenchmark(const FBenchmarkSettings& InSettings)
+    : Settings(InSettings)
+{
+}
+
+bool FBenchmark::Run(FRenderer& Renderer)
+{
+    SCOPED_ZONE("FBenchmark::Run");
+    const FRendererSettings& RendererSettings = Renderer.GetSettings();
+    LOG_Info("Benchmark: %u warmup and %u measured frames of %s:%u", Settings.WarmupFrames, Settings.MeasuredFrames,
+        FBenchmarkScene::GetName(RendererSettings.Scene.Type), RendererSettings.Scene.Count);
+
+    for(uint32_t i = 0; i < Settings.WarmupFrames; i++)
+    {
+        if(!Renderer.RenderFrame()) return false;
+    }
+
+    std::vector<double> FrameTimes;
+    std::vector<double> CpuTimes;
+    std::vector<double> GpuTimes;
+    std::vector<double> LightCullingTimes;
+    std::vector<double> InstanceCullingTimes;
+    std::vector<double> DepthPyramidTimes;
+    std::vector<double> RecordTimes;
+    FrameTimes.reserve(Settings.MeasuredFrames);
+    CpuTimes.reserve(Settings.MeasuredFrames);
+    GpuTimes.reserve(Settings.MeasuredFrames);
+
+    // GPU results of a frame come back when its resources are reused, FramesInFlight frames later.
+    // The first results seen belong to warmup frames, so as many extra frames are rendered at the end.
+    FGpuProfiler& GpuProfiler = Renderer.GetGpuProfiler();
+    const uint32_t Latency = RendererSettings.FramesInFlight;
+    uint64_t ResolvedFrames = GpuProfiler.GetResolvedFrameCount();
+    FFrameCounters Counters;
+    double Instances = 0.0;
+    double FrustumCulled = 0.0;
+    double OcclusionCulled = 0.0;
+    double ShadowCascadesRendered = 0.0;
+    double ShadowCascadesScrolled = 0.0;
+    double ShadowDraws = 0.0;
+    for(uint32_t i = 0; i < Settings.MeasuredFrames + Latency; i++)
+    {
+        if(!Renderer.RenderFrame()) return false;
+
+        if(i < Settings.MeasuredFrames)
+        {
+            const FFrameTiming& Timing = Renderer.GetLastFrameTiming();
+            FrameTimes.push_back(Timing.FrameMs);
+            // What the frame cost the CPU, without blocking on the GPU
+            CpuTimes.push_back(std::max(Timing.FrameMs - Timing.FenceWaitMs, 0.0));
+            RecordTimes.push_back(Timing.RecordMs);
+            Counters = Renderer.GetLastFrameCounters();
+            Instances += Counters.Instances;
+            FrustumCulled += Counters.FrustumCulled;
+            OcclusionCulled += Counters.OcclusionCulled;
+            ShadowCascadesRendered += Counters.ShadowCascadesRendered;
+            ShadowCascadesScrolled += Counters.ShadowCascadesScrolled;
+            ShadowDraws += Counters.ShadowDraws;
+        }
+        if(GpuProfiler.GetResolvedFrameCount() != ResolvedFrames)
+        {
+            ResolvedFrames = GpuProfiler.GetResolvedFrameCount();
+            if(i >= Latency)
+            {
+                GpuTimes.push_back(GpuProfiler.GetLastMs("Frame"));
+                if(RendererSettings.bClusteredLighting && Counters.Lights > 0)
+                {
+                    LightCullingTimes.push_back(GpuProfiler.GetLastMs("LightCulling"));
+                }
+                if(Renderer.HasOcclusionCulling())
+                {
+                    InstanceCullingTimes.push_back(GpuProfiler.GetLastMs("InstanceCullingEarly") + GpuProfiler.GetLastMs("InstanceCullingLate"));
+                    DepthPyramidTimes.push_back(GpuProfiler.GetLastMs("DepthPyramid"));
+                }
+                else if(Renderer.HasGpuDrivenDraws())
+                {
+                    InstanceCullingTimes.push_back(GpuProfiler.GetLastMs("InstanceCulling"));
+                }
+            }
+        }
+    }
+
+    VkPhysicalDeviceProperties DeviceProperties;
+    vkGetPhysicalDeviceProperties(Renderer.GetPhysicalDevice(), &DeviceProperties);
+    const VkExtent2D& Extent = Renderer.GetViewportSize();
+    // The properties after the mode are features, each but the GBuffer layout has a -no switch (-cachedcascades=0 for
+    // shadow caching) and is measured by comparing the reports of a run with and without it. Instancing and draw order
+    // only apply to CPU recorded draws, compare them under -nogpuculling. Compare draw order on -scene=mixed with
+    // -noinstancing too, instanced batches hide most of the state changes the sort removes.
+    Properties.clear();
+    Properties.emplace_back("scene", FBenchmarkScene::GetName(RendererSettings.Scene.Type));
+    Properties.emplace_back("device", DeviceProperties.deviceName);
+    Properties.emplace_back("resolution", std::to_string(Extent.width) + "x" + std::to_string(Extent.height));
+    Properties.emplace_back("mode", RendererSettings.bHeadless ? "headless" : FRendererSettings::GetPresentModeName(RendererSettings.PresentMode));
+    Properties.emplace_back("deferred", RendererSettings.bSubpassDeferred ? "subpass" : "sampled");
+    const FGBuffer& GBuffer = Renderer.GetGBuffer();
+    Properties.emplace_back("gbuffer", GBuffer.Layout ? GBuffer.Layout->Name : "none");
+    Properties.emplace_back("lighting", RendererSettings.bClusteredLighting ? "clustered" : "naive");
+    Properties.emplace_back("async_compute", Counters.AsyncComputePasses > 0 ? "on" : "off");
+    Properties.emplace_back("culling", Renderer.HasGpuDrivenDraws() ? "gpu" : "cpu");
+    Properties.emplace_back("occlusion", Renderer.HasOcclusionCulling() ? "on" : "off");
+    Properties.emplace_back("instancing", Renderer.HasInstancing() ? "on" : "off");
+    Properties.emplace_back("draw_order", RendererSettings.bSortDraws ? "sorted" : "world");
+    Properties.emplace_back("shadows", !RendererSettings.bShadows ? "off" : RendererSettings.ShadowCachedCascades > 0 ? "cached" : "uncached");
+
+    Metrics.clear();
+    Metrics.emplace_back("actors", RendererSettings.Scene.Count);
+    Metrics.emplace_back("seed", RendererSettings.Scene.Seed);
+    Metrics.emplace_back("frames_in_flight", RendererSettings.FramesInFlight);
+    Metrics.emplace_back("frames", static_cast<double>(FrameTimes.size()));
+    AddSummary("frame", FrameTimes);
+    AddSummary("cpu", CpuTimes);
+    // Building and recording the geometry pass's draws
+    AddSummary("record", RecordTimes);
+    // Missing when the GPU profiler is off or the queue has no timestamps
+    AddSummary("gpu", GpuTimes);
+    AddSummary("gpu_light_culling", LightCullingTimes);
+    AddSummary("gpu_instance_culling", InstanceCullingTimes);
+    AddSummary("gpu_depth_pyramid", DepthPyramidTimes);
+    Metrics.emplace_back("draws", Counters.Draws);
+    Metrics.emplace_back("triangles", static_cast<double>(Counters.Triangles));
+    Metrics.emplace_back("lights", Counters.Lights);
+    Metrics.emplace_back("async_compute_passes", Counters.AsyncComputePasses);
+    Metrics.emplace_back("pipeline_binds", Counters.PipelineBinds);
+    Metrics.emplace_back("index_buffer_binds", Counters.IndexBufferBinds);
+    Metrics.emplace_back("material_changes", Counters.MaterialChanges);
+    // Share of the instances each test rejected, GPU culling statistics lag FramesInFlight frames behind
+    if(Instances > 0.0)
+    {
+        Metrics.emplace_back("frustum_culled_ratio", FrustumCulled / Instances);
+        Metrics.emplace_back("occlusion_culled_ratio", OcclusionCulled / Instances);
+    }
+    // Averages over the measured frames, a cached cascade only renders when the view scrolls it or the world changes
+    if(RendererSettings.bShadows && !FrameTimes.empty())
+    {
+        const double Frames = static_cast<double>(FrameTimes.size());
+        Metrics.emplace_back("shadow_cascades", RendererSettings.ShadowCascadeCount);
+        Metrics.emplace_back("shadow_cascades_rendered_per_frame", ShadowCascadesRendered / Frames);
+        Metrics.emplace_back("shadow_cascades_scrolled_per_frame", ShadowCascadesScrolled / Frames);
+        Metrics.emplace_back("shadow_draws_per_frame", ShadowDraws / Frames);
+    }
+    Metrics.emplace_back("transient_bytes", static_cast<double>(Counters.TransientBytes));
+    Metrics.emplace_back("transient_texture_bytes", static_cast<double>(Counters.TransientTextureBytes));
+    if(GBuffer.Layout)
+    {
+        const uint32_t DepthBytes = FGBufferLayout::GetFormatSize(GBuffer.DepthFormat);
+        Metrics.emplace_back("gbuffer_bytes_per_pixel", GBuffer.Layout->GetColorBytesPerPixel() + DepthBytes);
+    }
+    Metrics.emplace_back("lazy_committed_bytes", static_cast<double>(Counters.LazyCommittedBytes));
+    Metrics.emplace_back("uploaded_bytes", static_cast<double>(FRenderer::GetCommandList().GetUploadedBytes()));
+    return Settings.bThreadSweep ? RunThreadSweep(Renderer) : true;
+}
+
+// Frames rendered after changing the thread count before measuring again, the pools of the new slices fill up meanwhile
+#define BENCHMARK_SWEEP_WARMUP_FRAMES 30
+
+bool FBenchmark::RunThreadSweep(FRenderer& Renderer)
+{
+    SCOPED_ZONE("FBenchmark::RunThreadSweep");
+    const uint32_t MaxThreads = Renderer.GetMaxRecordThreads();
+    const uint32_t InitialThreads = Renderer.GetRecordThreads();
+    Metrics.emplace_back("max_record_threads", MaxThreads);
+    for(uint32_t Threads = 1; Threads <= MaxThreads; Threads++)
+    {
+        Renderer.SetRecordThreads(Threads);
+        for(uint32_t i = 0; i < BENCHMARK_SWEEP_WARMUP_FRAMES; i++)
+        {
+            if(!Renderer.RenderFrame()) return false;
+        }
+
+        std::vector<double> CpuTimes;
+        std::vector<double> RecordTimes;
+        CpuTimes.reserve(Settings.MeasuredFrames);
+        RecordTimes.reserve(Settings.MeasuredFrames);
+        for(uint32_t i = 0; i < Settings.MeasuredFrames; i++)
+        {
+            if(!Renderer.RenderFrame()) return false;
+            const FFrameTiming& Timing = Renderer.GetLastFrameTiming();
+            CpuTimes.push_back(std::max(Timing.FrameMs - Timing.FenceWaitMs, 0.0));
+            RecordTimes.push_back(Timing.RecordMs);
+        }
+        const std::string Suffix = "_threads" + std::to_string(Threads);
+        AddSummary(("cpu" + Suffix).c_str(), CpuTimes);
+        AddSummary(("record" + Suffix).c_str(), RecordTimes);
+    }
+    Renderer.SetRecordThreads(InitialThreads);
+    return true;
+}
+
+// Runs of each culling variant, after as many unmeasured ones
+#define BENCHMARK_CULLING_RUNS 100
+#define BENCHMARK_CULLING_WARMUP_RUNS 5
+// Cascades culled in the same pass as the main view
+#define BENCHMARK_CULLING_CASCADES 3
+
+bool FBenchmark::RunCulling()
+{
+    SCOPED_ZONE("FBenchmark::RunCulling");
+    Properties.clear();
+    Properties.emplace_back("scene", "culling");
+    Properties.emplace_back("simd", FRUSTUM_CULLING_WIDTH == 8 ? "avx2" : "sse2");
+    Metrics.clear();
+    Metrics.emplace_back("workers", FJobSystem::Get().GetNumWorkers());
+
+    // The main view is the clip volume, cascades are boxes of growing size along depth like a directional light's
+    FCullingView Views[1 + BENCHMARK_CULLING_CASCADES];
+    Views[0].Frustum = FFrustum::FromViewProjection(glm::mat4(1.0f));
+    for(uint32_t i = 0; i < BENCHMARK_CULLING_CASCADES; i++)
+    {
+        const float Size = static_cast<float>(1u << i);
+        glm::mat4 Cascade(1.0f);
+        Cascade[0][0] = 1.0f / Size;
+        Cascade[1][1] = 1.0f / Size;
+        Cascade[2][2] = 1.0f / (2.0f * Size);
+        Cascade[3][2] = 0.5f;
+        Views[1 + i].Frustum = FFrustum::FromViewProjection(Cascade);
+    }
+
+    for(uint32_t Count : {100000u, 1000000u})
+    {
+        // Spread over 4 times the clip volume, about a quarter of the objects are visible to the main view
+        std::mt19937 Random(1);
+        std::uniform_real_distribution<float> Position(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> Size(0.001f, 0.05f);
+        FCullingBounds Bounds;
+        Bounds.Reserve(Count);
+        for(uint32_t i = 0; i < Count; i++)
+        {
+            const glm::vec3 Center(Position(Random), Position(Random), Position(Random) * 0.5f + 0.5f);
+            const glm::vec3 Extent(Size(Random), Size(Random), Size(Random));
+            Bounds.Add(glm::vec4(Center, glm::length(Extent)), Center, Extent);
+        }
+
+        FCullingView Reference[1 + BENCHMARK_CULLING_CASCADES];
+        for(uint32_t i = 0; i < 1 + BENCHMARK_CULLING_CASCADES; i++)
+        {
+            Reference[i].Frustum = Views[i].Frustum;
+        }
+        CullFrustumsScalar(Bounds, Reference, 1 + BENCHMARK_CULLING_CASCADES);
+
+        const std::string Prefix = std::string("cull_") + (Count == 100000u ? "100k" : "1m");
+        struct FCullingVariant
+        {
+            const char* Name;
+            uint32_t ViewCount;
+            bool bSimd;
+            bool bParallel;
+        };
+        const FCullingVariant Variants[] =
+        {
+            {"scalar", 1, false, false},
+            {"simd", 1, true, false},
+            {"simd_jobs", 1, true, true},
+            {"scalar_cascades", 1 + BENCHMARK_CULLING_CASCADES, false, false},
+            {"simd_jobs_cascades", 1 + BENCHMARK_CULLING_CASCADES, true, true},
+        };
+        for(const FCullingVariant& Variant : Variants)
+        {
+            std::vector<double> Times;
+            Times.reserve(BENCHMARK_CULLING_RUNS);
+            for(uint32_t Run = 0; Run < BENCHMARK_CULLING_WARMUP_RUNS + BENCHMARK_CULLING_RUNS; Run++)
+            {
+                const auto Start = std::chrono::steady_clock::now();
+                if(Variant.bSimd)
+                {
+                    CullFrustums(Bounds, Views, Variant.ViewCount, Variant.bParallel);
+                }
+                else
+                {
+                    CullFrustumsScalar(Bounds, Views, Variant.ViewCount);
+                }
+                if(Run >= BENCHMARK_CULLING_WARMUP_RUNS)
+                {
+                    Times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count());
+                }
+            }
+
+            for(uint32_t i = 0; i < Variant.ViewCount; i++)
+            {
+                if(Views[i].Visible != Reference[i].Visible)
+                {
+                    LOG_Warning("Benchmark %s_%s: view %u has %u visible objects instead of %u", Prefix.c_str(), Variant.Name, i,
+                        static_cast<uint32_t>(Views[i].Visible.size()), static_cast<uint32_t>(Reference[i].Visible.size()));
+                    return false;
+                }
+            }
+            AddSummary((Prefix + "_" + Variant.Name).c_str(), Times);
+        }
+        Metrics.emplace_back(Prefix + "_objects", Count);
+        Metrics.emplace_back(Prefix + "_visible", static_cast<double>(Reference[0].Visible.size()));
+    }
+    return true;
+}
+
+void FBenchmark::AddSummary(const char* Prefix, std::vector<double>& Samples)
+{
+    if(Samples.empty()) return;
+
+    const FFrameStats::FSummary Summary = FFrameStats::Summarize(Samples);
+    const std::string Name(Prefix);
+    Metrics.emplace_back(Name + "_ms_mean", Summary.Mean);
+    Metrics.emplace_back(Name + "_ms_p50", Summary.P50);
+    Metrics.emplace_back(Name + "_ms_p95", Summary.P95);
+    Metrics.emplace_back(Name + "_ms_p99", Summary.P99);
+    Metrics.emplace_back(Name + "_ms_max", Summary.Max);
+    LOG_Info("Benchmark %s: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms", Prefix, Summary.Mean, Summary.P50, Summary.P95, Summary.P99, Summary.Max);
+}
+
+// Counters are whole numbers, timings, ratios and per frame averages keep four decimals
+static std::string FormatMetric(double Value)
+{
+    char Text[64];
+    snprintf(Text, sizeof(Text), Value == std::floor(Value) ? "%.0f" : "%.4f", Value);
+    return Text;
+}
+
+bool FBenchmark::WriteReport(const std::string& Path) const
+{
+    std::error_code ErrorCode;
+    const std::filesystem::path ParentPath = std::filesystem::path(Path).parent_path();
+    if(!ParentPath.empty())
+    {
+        std::filesystem::create_directories(ParentPath, ErrorCode);
+    }
+
+    std::ofstream Stream(Path, std::ios::trunc);
+    if(!Stream) return false;
+
+    // Device names come from the driver and never contain quotes or backslashes
+    Stream << "{";
+    const char* Separator = "\n";
+    for(const auto& Property : Properties)
+    {
+        Stream << Separator << "  \"" << Property.first << "\": \"" << Property.second << "\"";
+        Separator = ",\n";
+    }
+    for(const auto& Metric : Metrics)
+    {
+        Stream << Separator << "  \"" << Metric.first << "\": " << FormatMetric(Metric.second);
+        Separator = ",\n";
+    }
+    Stream << "\n}\n";
+    return static_cast<bool>(Stream);
+}
+
+bool FBenchmark::ReadReport(const std::string& Path, std::vector<std::pair<std::string, double>>& OutMetrics)
+{
+    std::ifstream Stream(Path);
+    if(!Stream) return false;
+
+    std::stringstream Buffer;
+    Buffer << Stream.rdbuf();
+    const std::string Text = Buffer.str();
+
+    // Only the flat objects WriteReport produces, "key": number pairs, string values are skipped
+    OutMetrics.clear();
+    size_t Position = 0;
+    while((Position = Text.find('"', Position)) != std::string::npos)
+    {
+        const size_t KeyEnd = Text.find('"', Position + 1);
+        if(KeyEnd == std::string::npos) break;
+        const std::string Key = Text.substr(Position + 1, KeyEnd - Position - 1);
+
+        size_t ValueStart = Text.find_first_not_of(" \t\r\n", KeyEnd + 1);
+        if(ValueStart == std::string::npos || Text[ValueStart] != ':')
+        {
+            Position = KeyEnd + 1;
+            continue;
+        }
+        ValueStart = Text.find_first_not_of(" \t\r\n", ValueStart + 1);
+        if(ValueStart == std::string::npos) break;
+        if(Text[ValueStart] == '"')
+        {
+            const size_t ValueEnd = Text.find('"', ValueStart + 1);
+            if(ValueEnd == std::string::npos) break;
+            Position = ValueEnd + 1;
+            continue;
+        }
+
+        char* NumberEnd = nullptr;
+        const double Value = strtod(Text.c_str() + ValueStart, &NumberEnd);
+        OutMetrics.emplace_back(Key, Value);
+        Position = static_cast<size_t>(NumberEnd - Text.c_str());
+    }
+    return true;
+}
+
+uint32_t FBenchmark::CompareToBaseline(const std::string& Path) const
+{
+    std::vector<std::pair<std::string, double>> Baseline;
+    if(!ReadReport(Path, Baseline))
+    {
+        LOG_Warning("Benchmark baseline %s could not be read", Path.c_str());
+        return 0;
+    }
+
+    uint32_t Regressions = 0;
+    for(const auto& Metric : Metrics)
+    {
+        const auto Found = std::find_if(Baseline.begin(), Baseline.end(), [&Metric](const std::pair<std::string, double>& Entry) { return Entry.first == Metric.first; });
+        if(Found == Baseline.end()) continue;
+
+        // Compared as written, the baseline only kept the rounded value
+        const std::string CurrentText = FormatMetric(Metric.second);
+        const double Previous = Found->second;
+        const double Current = strtod(CurrentText.c_str(), nullptr);
+        if(Metric.first.find("_ms") == std::string::npos)
+        {
+            // Different counters mean a different workload, the timings can't be compared fairly
+            if(Previous != Current)
+            {
+                LOG_Warning("Benchmark %s differs from the baseline: %s, was %s", Metric.first.c_str(), CurrentText.c_str(), FormatMetric(Previous).c_str());
+            }
+            continue;
+        }
+
+        const double Change = Previous > 0.0 ? (Current - Previous) / Previous : 0.0;
+        const bool bRegressed = Current > Previous * (1.0 + Settings.RegressionThreshold) && Current - Previous > BENCHMARK_NOISE_FLOOR_MS;
+        if(bRegressed)
+        {
+            Regressions++;
+            LOG_Warning("Benchmark %s regressed: %.3f ms, was %.3f ms (%+.1f%%)", Metric.first.c_str(), Current, Previous, Change * 100.0);
+        }
+        else
+        {
+            LOG_Info("Benchmark %s: %.3f ms, was %.3f ms (%+.1f%%)", Metric.first.c_str(), Current, Previous, Change * 100.0);
+        }
+    }
+
+    if(Regressions > 0)
+    {
+        LOG_Warning("Benchmark: %u timings regressed by more than %.1f%% against %s", Regressions, Settings.RegressionThreshold * 100.0, Path.c_str());
+    }
+    else
+    {
+        LOG_Info("Benchmark: no regression against %s", Path.c_str());
+    }
+    return Regressions;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RendererSettings.h"
+
+class FRenderer;
+
+struct FBenchmarkSettings
+{
+    // Frames rendered before measuring, pipelines compile and caches warm up meanwhile
+    uint32_t WarmupFrames;
+    uint32_t MeasuredFrames;
+    // Defaults to Saved/Benchmark.json
+    std::string ReportPath;
+    // Report of an earlier run to compare against, empty to skip the comparison
+    std::string BaselinePath;
+    // Relative slowdown of a timing that counts as a regression
+    double RegressionThreshold;
+    // Presents to a window instead of rendering headless, timings then include the present mode's pacing
+    bool bWindowed;
+    // Times CPU frustum culling of generated bounds instead of rendering, no device is created
+    bool bCullingOnly;
+    // After the main run, measures the CPU frame and record times again with 1 to N threads recording the draw list
+    bool bThreadSweep;
+
+    FBenchmarkSettings();
+
+    // -warmup=N, -benchframes=N, -report=Path, -baseline=Path, -threshold=Percent, -windowed, -cullbench, -threadsweep
+    static FBenchmarkSettings FromCommandLine(int Argc, char* Argv[]);
+    // Renderer settings every run uses, a scene included when the command line has none
+    void ConfigureRenderer(FRendererSettings& RendererSettings) const;
+};
+
+// Renders a fixed number of frames of a generated scene and reports frame time percentiles and counters as JSON.
+// Reports are flat key/value objects so a baseline can be read back without a JSON library.
+class FBenchmark
+{
+public:
+    explicit FBenchmark(const FBenchmarkSettings& InSettings);
+
+    // False when the window was closed before the end
+    bool Run(FRenderer& Renderer);
+    // Scalar, SIMD and SIMD over the job system culling of 100k and 1M objects, against one view and a main view with
+    // shadow cascades. False when the SIMD results differ from the scalar ones.
+    bool RunCulling();
+    bool WriteReport(const std::string& Path) const;
+    // Logs every metric against the baseline, returns how many timings regressed
+    uint32_t CompareToBaseline(const std::string& Path) const;
+
+private:
+    // CPU recorded draws only, the GPU driven path records a handful of indirect draws
+    bool RunThreadSweep(FRenderer& Renderer);
+    void AddSummary(const char* Prefix, std::vector<double>& Samples);
+    static bool ReadReport(const std::string& Path, std::vector<std::pair<std::string, double>>& OutMetrics);
+
+private:
+    FBenchmarkSettings Settings;
+    // Written as strings, only compared to warn when two reports aren't from the same setup
+    std::vector<std::pair<std::string, std::string>> Properties;
+    // In report order, timings have "_ms" in their name, everything else is a counter
+    std::vector<std::pair<std::string, double>> Metrics;
+};
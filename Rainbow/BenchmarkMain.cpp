@@ -0,0 +1,57 @@
+#define SDL_MAIN_HANDLED
+#include <memory>
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "RenderWindow.h"
+#include "Renderer.h"
+
+// Exit code 0 when the run passed, 1 when timings regressed against the baseline, 2 when it couldn't complete
+static int FinishRun(const FBenchmark& Benchmark, const FBenchmarkSettings& BenchmarkSettings)
+{
+    if(!Benchmark.WriteReport(BenchmarkSettings.ReportPath))
+    {
+        LOG_Warning("Benchmark report %s could not be written", BenchmarkSettings.ReportPath.c_str());
+        return 2;
+    }
+    LOG_Info("Benchmark report written to %s", BenchmarkSettings.ReportPath.c_str());
+    if(!BenchmarkSettings.BaselinePath.empty() && Benchmark.CompareToBaseline(BenchmarkSettings.BaselinePath) > 0)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const FBenchmarkSettings BenchmarkSettings = FBenchmarkSettings::FromCommandLine(argc, argv);
+    if(BenchmarkSettings.bCullingOnly)
+    {
+        FJobSystem::Get().Init();
+        FBenchmark Benchmark(BenchmarkSettings);
+        const int ExitCode = Benchmark.RunCulling() ? FinishRun(Benchmark, BenchmarkSettings) : 2;
+        FJobSystem::Get().Shutdown();
+        return ExitCode;
+    }
+
+    FRendererSettings Settings = FRendererSettings::FromCommandLine(argc, argv);
+    BenchmarkSettings.ConfigureRenderer(Settings);
+
+    std::unique_ptr<FRenderWindow> RenderWindow;
+    if(!Settings.bHeadless)
+    {
+        RenderWindow.reset(new FRenderWindow("Rainbow Benchmark", 1920, 1080));
+    }
+
+    FRenderer Renderer;
+    Renderer.Init(RenderWindow.get(), Settings);
+
+    FBenchmark Benchmark(BenchmarkSettings);
+    const int ExitCode = Benchmark.Run(Renderer) ? FinishRun(Benchmark, BenchmarkSettings) : 2;
+
+    Renderer.Shutdown();
+    if(RenderWindow)
+    {
+        RenderWindow->Shutdown();
+    }
+    return ExitCode;
+}
@@ -0,0 +1,224 @@
+#include "BenchmarkScene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <glm/gtc/constants.hpp>
+#include "CommandList.h"
+#include "Material.h"
+#include "MeshActor.h"
+#include "Renderer.h"
+#include "World.h"
+
+static const struct
+{
+    const char* Name;
+    EBenchmarkScene Type;
+    uint32_t DefaultCount;
+} SceneNames[] = {
+    { "instances", EBenchmarkScene::Instances, 1000 },
+    { "unique", EBenchmarkScene::UniqueMeshes, 256 },
+    { "materials", EBenchmarkScene::Materials, 256 },
+    { "lights", EBenchmarkScene::Lights, 10000 },
+    { "mixed", EBenchmarkScene::Mixed, 4096 }
+};
+
+// Actors the lights scene shades, few enough that geometry stays cheap next to lighting
+#define BENCHMARK_LIGHTS_ACTORS 256
+// Lights expected to reach a pixel of the lights scene
+#define BENCHMARK_LIGHTS_PER_PIXEL 16.0f
+// Meshes and materials the actors of the mixed scene pick from
+#define BENCHMARK_MIXED_MESHES 8
+#define BENCHMARK_MIXED_MATERIALS 16
+
+bool FBenchmarkScene::Parse(const char* Value, FBenchmarkSceneDesc& OutDesc)
+{
+    const char* Separator = strchr(Value, ':');
+    const size_t NameLength = Separator ? static_cast<size_t>(Separator - Value) : strlen(Value);
+    for(const auto& Entry : SceneNames)
+    {
+        if(strlen(Entry.Name) != NameLength || strncmp(Value, Entry.Name, NameLength) != 0) continue;
+
+        OutDesc.Type = Entry.Type;
+        OutDesc.Count = Separator ? static_cast<uint32_t>(std::max(atoi(Separator + 1), 1)) : Entry.DefaultCount;
+        return true;
+    }
+    return false;
+}
+
+const char* FBenchmarkScene::GetName(EBenchmarkScene Type)
+{
+    for(const auto& Entry : SceneNames)
+    {
+        if(Entry.Type == Type) return Entry.Name;
+    }
+    return "none";
+}
+
+float FBenchmarkScene::RandomFloat(std::mt19937& Random)
+{
+    return static_cast<float>(Random() >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 FBenchmarkScene::RandomColor(std::mt19937& Random)
+{
+    // Kept away from black so every draw shows up in frame dumps
+    const float Red = 0.2f + 0.8f * RandomFloat(Random);
+    const float Green = 0.2f + 0.8f * RandomFloat(Random);
+    const float Blue = 0.2f + 0.8f * RandomFloat(Random);
+    return glm::vec3(Red, Green, Blue);
+}
+
+static uint32_t PackColor(glm::vec3 Color)
+{
+    const uint32_t Red = static_cast<uint32_t>(Color.r * 255.0f + 0.5f);
+    const uint32_t Green = static_cast<uint32_t>(Color.g * 255.0f + 0.5f);
+    const uint32_t Blue = static_cast<uint32_t>(Color.b * 255.0f + 0.5f);
+    return Red | (Green << 8) | (Blue << 16) | (255u << 24);
+}
+
+void FBenchmarkScene::GenerateSphere(uint32_t Rings, uint32_t Segments, glm::vec3 Color, std::vector<FStaticVertex>& OutVertices, std::vector<uint32_t>& OutIndices)
+{
+    OutVertices.clear();
+    OutIndices.clear();
+    OutVertices.reserve(static_cast<size_t>(Rings + 1) * (Segments + 1));
+    OutIndices.reserve(static_cast<size_t>(Rings) * Segments * 6);
+
+    for(uint32_t Ring = 0; Ring <= Rings; Ring++)
+    {
+        const float Theta = glm::pi<float>() * static_cast<float>(Ring) / static_cast<float>(Rings);
+        for(uint32_t Segment = 0; Segment <= Segments; Segment++)
+        {
+            const float Phi = glm::two_pi<float>() * static_cast<float>(Segment) / static_cast<float>(Segments);
+            FStaticVertex Vertex;
+            Vertex.Position = glm::vec3(std::sin(Theta) * std::cos(Phi), std::cos(Theta), std::sin(Theta) * std::sin(Phi));
+            Vertex.Normal = Vertex.Position;
+            Vertex.UV0 = glm::vec2(static_cast<float>(Segment) / static_cast<float>(Segments), static_cast<float>(Ring) / static_cast<float>(Rings));
+            Vertex.Color = Color;
+            OutVertices.push_back(Vertex);
+        }
+    }
+
+    for(uint32_t Ring = 0; Ring < Rings; Ring++)
+    {
+        for(uint32_t Segment = 0; Segment < Segments; Segment++)
+        {
+            const uint32_t Current = Ring * (Segments + 1) + Segment;
+            const uint32_t Below = Current + Segments + 1;
+            OutIndices.insert(OutIndices.end(), { Current, Below, Current + 1, Current + 1, Below, Below + 1 });
+        }
+    }
+}
+
+void FBenchmarkScene::Populate(FWorld& World, const FBenchmarkSceneDesc& Desc)
+{
+    SCOPED_ZONE("FBenchmarkScene::Populate");
+    std::mt19937 Random(Desc.Seed);
+    const uint32_t Count = Desc.Type == EBenchmarkScene::Lights ? BENCHMARK_LIGHTS_ACTORS : std::max(Desc.Count, 1u);
+    const uint32_t Columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(Count))));
+    const float CellSize = 2.0f / static_cast<float>(Columns);
+
+    std::vector<FStaticVertex> Vertices;
+    std::vector<uint32_t> Indices;
+    FVertexBuffer* SharedMesh = nullptr;
+    if(Desc.Type != EBenchmarkScene::UniqueMeshes && Desc.Type != EBenchmarkScene::Mixed)
+    {
+        GenerateSphere(32, 64, glm::vec3(1.0f), Vertices, Indices);
+        SharedMesh = FRenderer::GetCommandList().CreateVertexBuffer(Vertices, Indices);
+    }
+
+    std::vector<FVertexBuffer*> MixedMeshes;
+    std::vector<FMaterial*> MixedMaterials;
+    if(Desc.Type == EBenchmarkScene::Mixed)
+    {
+        for(uint32_t Mesh = 0; Mesh < BENCHMARK_MIXED_MESHES; Mesh++)
+        {
+            const uint32_t Rings = 8 + Mesh * 4;
+            GenerateSphere(Rings, Rings * 2, glm::vec3(1.0f), Vertices, Indices);
+            MixedMeshes.push_back(FRenderer::GetCommandList().CreateVertexBuffer(Vertices, Indices));
+        }
+        for(uint32_t Material = 0; Material < BENCHMARK_MIXED_MATERIALS; Material++)
+        {
+            std::vector<uint32_t> Texels(8 * 8, PackColor(RandomColor(Random)));
+            MixedMaterials.push_back(World.CreateMaterial());
+            MixedMaterials.back()->CreateFromTexels(8, 8, Texels);
+        }
+    }
+
+    for(uint32_t i = 0; i < Count; i++)
+    {
+        std::shared_ptr<FMeshActor> Actor = std::make_shared<FMeshActor>();
+        const uint32_t Column = i % Columns;
+        const uint32_t Row = i / Columns;
+        Actor->SetLocation(glm::vec3(-1.0f + CellSize * (static_cast<float>(Column) + 0.5f), -1.0f + CellSize * (static_cast<float>(Row) + 0.5f), 0.5f));
+        const float Pitch = RandomFloat(Random) * 360.0f;
+        const float Yaw = RandomFloat(Random) * 360.0f;
+        const float Roll = RandomFloat(Random) * 360.0f;
+        Actor->SetRotation(glm::vec3(Pitch, Yaw, Roll));
+        // Leaves a gap between neighbours and keeps depth inside [0, 1]
+        Actor->SetScale(glm::vec3(CellSize * 0.45f));
+
+        switch(Desc.Type)
+        {
+        case EBenchmarkScene::UniqueMeshes:
+        {
+            const uint32_t Rings = 8 + Random() % 25;
+            GenerateSphere(Rings, Rings * 2, RandomColor(Random), Vertices, Indices);
+            Actor->SetVertexBuffer(FRenderer::GetCommandList().CreateVertexBuffer(Vertices, Indices));
+            break;
+        }
+        case EBenchmarkScene::Materials:
+        {
+            // 8x8 checker of two colors, small enough that the upload isn't what gets measured
+            const uint32_t ColorA = PackColor(RandomColor(Random));
+            const uint32_t ColorB = PackColor(RandomColor(Random));
+            std::vector<uint32_t> Texels(8 * 8);
+            for(uint32_t Texel = 0; Texel < Texels.size(); Texel++)
+            {
+                Texels[Texel] = ((Texel % 8 + Texel / 8) & 1) ? ColorA : ColorB;
+            }
+            FMaterial* Material = World.CreateMaterial();
+            Material->CreateFromTexels(8, 8, Texels);
+            Actor->SetMaterial(Material);
+            Actor->SetVertexBuffer(SharedMesh);
+            break;
+        }
+        case EBenchmarkScene::Mixed:
+            Actor->SetVertexBuffer(MixedMeshes[Random() % BENCHMARK_MIXED_MESHES]);
+            Actor->SetMaterial(MixedMaterials[Random() % BENCHMARK_MIXED_MATERIALS]);
+            break;
+        default:
+            Actor->SetVertexBuffer(SharedMesh);
+            break;
+        }
+        World.AddActor(Actor);
+    }
+
+    if(Desc.Type == EBenchmarkScene::Lights)
+    {
+        AddLights(World, std::max(Desc.Count, 1u), Random);
+    }
+
+    LOG_Info("Benchmark scene %s: %u actors, %u lights, seed %u", GetName(Desc.Type), Count, static_cast<uint32_t>(World.GetLights().size()), Desc.Seed);
+}
+
+void FBenchmarkScene::AddLights(FWorld& World, uint32_t Count, std::mt19937& Random)
+{
+    // Spheres projected over the 2x2 viewport, Count * pi * Radius^2 / 4 of them cover a pixel on average
+    const float Radius = std::min(std::sqrt(4.0f * BENCHMARK_LIGHTS_PER_PIXEL / (glm::pi<float>() * static_cast<float>(Count))), 0.5f);
+    for(uint32_t i = 0; i < Count; i++)
+    {
+        FLight Light;
+        // Every fourth light is a spot aimed into the screen
+        Light.Type = i % 4 == 3 ? ELightType::Spot : ELightType::Point;
+        Light.Position = glm::vec3(RandomFloat(Random) * 2.0f - 1.0f, RandomFloat(Random) * 2.0f - 1.0f, 0.3f + 0.3f * RandomFloat(Random));
+        Light.Radius = Radius;
+        Light.Color = RandomColor(Random);
+        // Sums to about the strength of the directional light where the expected number of lights overlap
+        Light.Intensity = 2.0f / BENCHMARK_LIGHTS_PER_PIXEL;
+        Light.Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+        World.AddLight(Light);
+    }
+    LOG_Info("Benchmark lights: %u lights of radius %.3f, %.0f per pixel on average", Count, Radius, BENCHMARK_LIGHTS_PER_PIXEL);
+}
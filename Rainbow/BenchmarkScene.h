@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <glm/vec3.hpp>
+#include "RenderResource.h"
+
+class FWorld;
+
+enum class EBenchmarkScene : uint8_t
+{
+    // The regular world, LoadWorld decides what's in it
+    None,
+    // Count actors sharing one mesh, measures per-draw overhead
+    Instances,
+    // Count actors with their own mesh of varying density, measures buffer binding and vertex throughput
+    UniqueMeshes,
+    // Count actors sharing one mesh, each with its own base color texture
+    Materials,
+    // Count lights over a fixed grid of actors, sized so every pixel is reached by about the same number of lights
+    // whatever the count, measures light culling
+    Lights,
+    // Count actors each picking one of a few meshes and materials at random, in world order every draw changes state,
+    // measures draw sorting
+    Mixed
+};
+
+struct FBenchmarkSceneDesc
+{
+    EBenchmarkScene Type;
+    uint32_t Count;
+    // Same seed, same scene, on every platform
+    uint32_t Seed;
+
+    FBenchmarkSceneDesc() : Type(EBenchmarkScene::None), Count(0), Seed(1) {}
+};
+
+// Deterministic scenes generated without any content, for benchmarks and regression tracking.
+// Actors are laid out on a grid covering the viewport, in clip space since the renderer has no camera yet.
+class FBenchmarkScene
+{
+public:
+    static void Populate(FWorld& World, const FBenchmarkSceneDesc& Desc);
+
+    // "instances", "unique", "materials", "lights" or "mixed", with an optional ":Count"
+    static bool Parse(const char* Value, FBenchmarkSceneDesc& OutDesc);
+    static const char* GetName(EBenchmarkScene Type);
+
+    // Unit sphere, Rings * Segments * 2 triangles
+    static void GenerateSphere(uint32_t Rings, uint32_t Segments, glm::vec3 Color, std::vector<FStaticVertex>& OutVertices, std::vector<uint32_t>& OutIndices);
+
+private:
+    static void AddLights(FWorld& World, uint32_t Count, std::mt19937& Random);
+
+    // mt19937 is specified bit for bit, the standard distributions are not
+    static float RandomFloat(std::mt19937& Random);
+    static glm::vec3 RandomColor(std::mt19937& Random);
+};
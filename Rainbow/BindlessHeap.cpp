@@ -0,0 +1,231 @@
+#include "BindlessHeap.h"
+#include <algorithm>
+#include <array>
+
+static constexpr uint32_t MaxBindlessSampledImages = 16384;
+static constexpr uint32_t MaxBindlessSamplers = 1024;
+static constexpr uint32_t MaxBindlessStorageBuffers = 16384;
+
+static const VkDescriptorType BindlessDescriptorTypes[BINDLESS_BindingCount] = {
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+};
+
+uint32_t FBindlessHeap::FSlotAllocator::Allocate()
+{
+    if(!FreeSlots.empty())
+    {
+        const uint32_t Index = FreeSlots.back();
+        FreeSlots.pop_back();
+        return Index;
+    }
+    checkf(Next < Capacity, "FBindlessHeap: descriptor array is full");
+    return Next++;
+}
+
+void FBindlessHeap::FSlotAllocator::Free(uint32_t Index)
+{
+    FreeSlots.push_back(Index);
+}
+
+FBindlessHeap::FBindlessHeap()
+{
+    Device = VK_NULL_HANDLE;
+    DescriptorPool = VK_NULL_HANDLE;
+    DescriptorSetLayout = VK_NULL_HANDLE;
+    DescriptorSet = VK_NULL_HANDLE;
+}
+
+void FBindlessHeap::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice)
+{
+    Device = InDevice;
+
+    VkPhysicalDeviceDescriptorIndexingProperties IndexingProperties = {};
+    IndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 Properties = {};
+    Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    Properties.pNext = &IndexingProperties;
+    vkGetPhysicalDeviceProperties2(PhysicalDevice, &Properties);
+
+    Slots[BINDLESS_SampledImages].Capacity = std::min(MaxBindlessSampledImages, IndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+    Slots[BINDLESS_Samplers].Capacity = std::min(MaxBindlessSamplers, IndexingProperties.maxDescriptorSetUpdateAfterBindSamplers);
+    Slots[BINDLESS_StorageBuffers].Capacity = std::min(MaxBindlessStorageBuffers, IndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+    std::array<VkDescriptorSetLayoutBinding, BINDLESS_BindingCount> Bindings = {};
+    std::array<VkDescriptorBindingFlags, BINDLESS_BindingCount> BindingFlags = {};
+    std::array<VkDescriptorPoolSize, BINDLESS_BindingCount> PoolSizes = {};
+    for(uint32_t i = 0; i < BINDLESS_BindingCount; i++)
+    {
+        Bindings[i].binding = i;
+        Bindings[i].descriptorType = BindlessDescriptorTypes[i];
+        Bindings[i].descriptorCount = Slots[i].Capacity;
+        Bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+        // Registering writes slots no pending command buffer uses while others of the set are in flight
+        BindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+            | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        PoolSizes[i].type = BindlessDescriptorTypes[i];
+        PoolSizes[i].descriptorCount = Slots[i].Capacity;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo BindingFlagsCreateInfo = {};
+    BindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    BindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(BindingFlags.size());
+    BindingFlagsCreateInfo.pBindingFlags = BindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo LayoutCreateInfo = {};
+    LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    LayoutCreateInfo.pNext = &BindingFlagsCreateInfo;
+    LayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    LayoutCreateInfo.bindingCount = static_cast<uint32_t>(Bindings.size());
+    LayoutCreateInfo.pBindings = Bindings.data();
+    if(vkCreateDescriptorSetLayout(Device, &LayoutCreateInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS)
+    {
+        checkf(0, "FBindlessHeap: unable to create descriptor set layout");
+    }
+
+    VkDescriptorPoolCreateInfo PoolCreateInfo = {};
+    PoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    PoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    PoolCreateInfo.maxSets = 1;
+    PoolCreateInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+    PoolCreateInfo.pPoolSizes = PoolSizes.data();
+    if(vkCreateDescriptorPool(Device, &PoolCreateInfo, nullptr, &DescriptorPool) != VK_SUCCESS)
+    {
+        checkf(0, "FBindlessHeap: unable to create descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    AllocateInfo.descriptorPool = DescriptorPool;
+    AllocateInfo.descriptorSetCount = 1;
+    AllocateInfo.pSetLayouts = &DescriptorSetLayout;
+    if(vkAllocateDescriptorSets(Device, &AllocateInfo, &DescriptorSet) != VK_SUCCESS)
+    {
+        checkf(0, "FBindlessHeap: unable to allocate global descriptor set");
+    }
+
+    LOG_Info("Bindless heap: %u images, %u samplers, %u storage buffers",
+        Slots[BINDLESS_SampledImages].Capacity, Slots[BINDLESS_Samplers].Capacity, Slots[BINDLESS_StorageBuffers].Capacity);
+}
+
+void FBindlessHeap::Shutdown()
+{
+    if(Device == VK_NULL_HANDLE) return;
+
+    vkDestroyDescriptorPool(Device, DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(Device, DescriptorSetLayout, nullptr);
+    DescriptorPool = VK_NULL_HANDLE;
+    DescriptorSetLayout = VK_NULL_HANDLE;
+    DescriptorSet = VK_NULL_HANDLE;
+    Device = VK_NULL_HANDLE;
+    UnsubmittedReleases.clear();
+    PendingReleases.clear();
+}
+
+uint32_t FBindlessHeap::RegisterSampledImage(VkImageView ImageView, VkImageLayout ImageLayout)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const uint32_t Index = Slots[BINDLESS_SampledImages].Allocate();
+
+    VkDescriptorImageInfo ImageInfo = {};
+    ImageInfo.imageView = ImageView;
+    ImageInfo.imageLayout = ImageLayout;
+    WriteDescriptor(BINDLESS_SampledImages, Index, &ImageInfo, nullptr);
+    return Index;
+}
+
+uint32_t FBindlessHeap::RegisterSampler(VkSampler Sampler)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const uint32_t Index = Slots[BINDLESS_Samplers].Allocate();
+
+    VkDescriptorImageInfo ImageInfo = {};
+    ImageInfo.sampler = Sampler;
+    WriteDescriptor(BINDLESS_Samplers, Index, &ImageInfo, nullptr);
+    return Index;
+}
+
+uint32_t FBindlessHeap::RegisterStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const uint32_t Index = Slots[BINDLESS_StorageBuffers].Allocate();
+
+    VkDescriptorBufferInfo BufferInfo = {};
+    BufferInfo.buffer = Buffer;
+    BufferInfo.offset = Offset;
+    BufferInfo.range = Range;
+    WriteDescriptor(BINDLESS_StorageBuffers, Index, nullptr, &BufferInfo);
+    return Index;
+}
+
+void FBindlessHeap::Release(EBindlessBinding Binding, uint32_t Index)
+{
+    if(Index == BINDLESS_INVALID_INDEX) return;
+
+    // The descriptor is left as is, partially bound arrays allow stale slots no shader reads. It is only rewritten once
+    // the work that could read it completed.
+    std::lock_guard<std::mutex> Lock(Mutex);
+    UnsubmittedReleases.push_back({ Binding, Index, FGpuTicket() });
+}
+
+void FBindlessHeap::SubmitReleases(FGpuTicket Ticket)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for(FPendingRelease& Release : UnsubmittedReleases)
+    {
+        Release.Ticket = Ticket;
+        PendingReleases.push_back(Release);
+    }
+    UnsubmittedReleases.clear();
+}
+
+void FBindlessHeap::RecycleReleases(FGpuTimeline& Timeline)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    size_t Completed = 0;
+    while(Completed < PendingReleases.size() && Timeline.IsComplete(PendingReleases[Completed].Ticket))
+    {
+        Slots[PendingReleases[Completed].Binding].Free(PendingReleases[Completed].Index);
+        Completed++;
+    }
+    PendingReleases.erase(PendingReleases.begin(), PendingReleases.begin() + Completed);
+}
+
+void FBindlessHeap::Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout PipelineLayout) const
+{
+    vkCmdBindDescriptorSets(CommandBuffer, BindPoint, PipelineLayout, 0, 1, &DescriptorSet, 0, nullptr);
+}
+
+VkDescriptorSetLayout FBindlessHeap::GetDescriptorSetLayout() const
+{
+    return DescriptorSetLayout;
+}
+
+VkDescriptorSet FBindlessHeap::GetDescriptorSet() const
+{
+    return DescriptorSet;
+}
+
+VkPushConstantRange FBindlessHeap::GetPushConstantRange()
+{
+    VkPushConstantRange PushConstantRange = {};
+    PushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+    PushConstantRange.offset = 0;
+    PushConstantRange.size = sizeof(FDrawConstants);
+    return PushConstantRange;
+}
+
+void FBindlessHeap::WriteDescriptor(EBindlessBinding Binding, uint32_t Index, const VkDescriptorImageInfo* ImageInfo, const VkDescriptorBufferInfo* BufferInfo)
+{
+    VkWriteDescriptorSet Write = {};
+    Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    Write.dstSet = DescriptorSet;
+    Write.dstBinding = Binding;
+    Write.dstArrayElement = Index;
+    Write.descriptorCount = 1;
+    Write.descriptorType = BindlessDescriptorTypes[Binding];
+    Write.pImageInfo = ImageInfo;
+    Write.pBufferInfo = BufferInfo;
+    vkUpdateDescriptorSets(Device, 1, &Write, 0, nullptr);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <vulkan/vulkan_core.h>
+#include "GpuTimeline.h"
+#include "MinimalCore.h"
+
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFFu
+
+// Binding slots of the global bindless set, must match Shaders/Bindless.glsl
+enum EBindlessBinding : uint32_t
+{
+    BINDLESS_SampledImages = 0,
+    BINDLESS_Samplers = 1,
+    BINDLESS_StorageBuffers = 2,
+    BINDLESS_BindingCount = 3
+};
+
+// Pushed before every draw, shaders fetch everything else from the global set through these indices
+struct FDrawConstants
+{
+    glm::mat4 Transform;
+    uint32_t VertexBufferIndex;
+    uint32_t IndexBufferIndex;
+    uint32_t TextureIndex;
+    uint32_t SamplerIndex;
+
+    FDrawConstants()
+    {
+        Transform = glm::mat4(1.0f);
+        VertexBufferIndex = BINDLESS_INVALID_INDEX;
+        IndexBufferIndex = BINDLESS_INVALID_INDEX;
+        TextureIndex = BINDLESS_INVALID_INDEX;
+        SamplerIndex = BINDLESS_INVALID_INDEX;
+    }
+};
+
+class FBindlessHeap
+{
+public:
+    FBindlessHeap();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice);
+    void Shutdown();
+
+    uint32_t RegisterSampledImage(VkImageView ImageView, VkImageLayout ImageLayout);
+    uint32_t RegisterSampler(VkSampler Sampler);
+    uint32_t RegisterStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset = 0, VkDeviceSize Range = VK_WHOLE_SIZE);
+    // The slot is only reused once the frame being recorded and every earlier one completed, see SubmitReleases
+    void Release(EBindlessBinding Binding, uint32_t Index);
+    // Tags the slots released since the last call with the ticket of the frame just submitted
+    void SubmitReleases(FGpuTicket Ticket);
+    // Returns the slots whose ticket completed to their free lists, never blocks
+    void RecycleReleases(FGpuTimeline& Timeline);
+
+    // Binds the global set once, every pipeline created from GetDescriptorSetLayout() stays compatible with it
+    void Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout PipelineLayout) const;
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const;
+    VkDescriptorSet GetDescriptorSet() const;
+    static VkPushConstantRange GetPushConstantRange();
+
+private:
+    struct FSlotAllocator
+    {
+        uint32_t Capacity = 0;
+        uint32_t Next = 0;
+        std::vector<uint32_t> FreeSlots;
+
+        uint32_t Allocate();
+        void Free(uint32_t Index);
+    };
+
+    struct FPendingRelease
+    {
+        EBindlessBinding Binding;
+        uint32_t Index;
+        FGpuTicket Ticket;
+    };
+
+    void WriteDescriptor(EBindlessBinding Binding, uint32_t Index, const VkDescriptorImageInfo* ImageInfo, const VkDescriptorBufferInfo* BufferInfo);
+
+private:
+    VkDevice Device;
+    VkDescriptorPool DescriptorPool;
+    VkDescriptorSetLayout DescriptorSetLayout;
+    VkDescriptorSet DescriptorSet;
+    FSlotAllocator Slots[BINDLESS_BindingCount];
+    // Released while recording, no ticket yet
+    std::vector<FPendingRelease> UnsubmittedReleases;
+    // In ticket order, pending work may still read these slots
+    std::vector<FPendingRelease> PendingReleases;
+    std::mutex Mutex;
+};
@@ -0,0 +1,59 @@
+#include "ChromeTrace.h"
+#include <fstream>
+
+static std::chrono::steady_clock::time_point GetEpoch()
+{
+    static const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+    return Epoch;
+}
+
+double FChromeTrace::GetTimeUs(std::chrono::steady_clock::time_point Time)
+{
+    return std::chrono::duration<double, std::micro>(Time - GetEpoch()).count();
+}
+
+double FChromeTrace::GetTimeUs()
+{
+    return GetTimeUs(std::chrono::steady_clock::now());
+}
+
+static void WriteEscaped(std::ofstream& Stream, const std::string& Text)
+{
+    for(const char Character : Text)
+    {
+        if(Character == '"' || Character == '\\')
+        {
+            Stream << '\\';
+        }
+        Stream << Character;
+    }
+}
+
+bool FChromeTrace::Write(const std::string& FilePath, const std::vector<FTraceEvent>& Events, const std::vector<FTraceThread>& Threads)
+{
+    std::ofstream Stream(FilePath, std::ios::trunc);
+    if(!Stream) return false;
+
+    Stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    Stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TRACE_PID_CPU << ",\"args\":{\"name\":\"CPU\"}},\n";
+    Stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TRACE_PID_GPU << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for(const FTraceThread& Thread : Threads)
+    {
+        Stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << Thread.ProcessId << ",\"tid\":" << Thread.ThreadId << ",\"args\":{\"name\":\"";
+        WriteEscaped(Stream, Thread.Name);
+        Stream << "\"}}";
+    }
+
+    Stream.setf(std::ios::fixed);
+    Stream.precision(3);
+    for(const FTraceEvent& Event : Events)
+    {
+        Stream << ",\n{\"name\":\"";
+        WriteEscaped(Stream, Event.Name);
+        Stream << "\",\"cat\":\"" << Event.Category << "\",\"ph\":\"X\",\"pid\":" << Event.ProcessId << ",\"tid\":" << Event.ThreadId
+            << ",\"ts\":" << Event.StartUs << ",\"dur\":" << Event.DurationUs << "}";
+    }
+    Stream << "\n]}\n";
+    return static_cast<bool>(Stream);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Process ids used in traces, each one shows up as its own group of tracks
+#define TRACE_PID_CPU 1
+#define TRACE_PID_GPU 2
+
+// Complete event ("ph":"X") of the Chrome trace event format, times in microseconds since FChromeTrace::GetTimeUs's epoch
+struct FTraceEvent
+{
+    std::string Name;
+    const char* Category;
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    double StartUs;
+    double DurationUs;
+};
+
+// Named track, emitted as "thread_name" metadata
+struct FTraceThread
+{
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    std::string Name;
+};
+
+// Writes events as JSON loadable in chrome://tracing and ui.perfetto.dev
+class FChromeTrace
+{
+public:
+    // Microseconds since the first call, shared by every profiler so their events line up
+    static double GetTimeUs(std::chrono::steady_clock::time_point Time);
+    static double GetTimeUs();
+
+    static bool Write(const std::string& FilePath, const std::vector<FTraceEvent>& Events, const std::vector<FTraceThread>& Threads = std::vector<FTraceThread>());
+};
@@ -1,45 +1,60 @@
 ﻿#include "CommandList.h"
+#include <algorithm>
+#include <glm/glm.hpp>
 #include "Renderer.h"
 #include "RenderResource.h"
 
 FCommandList::FCommandList()
 {
+    UploadedBytes = 0;
+    bAsyncComputeFrame = false;
 }
 
 FCommandList::FCommandList(FRenderer* InRenderer)
 {
     Renderer = InRenderer;
     FrameIndex = 0;
+    UploadedBytes = 0;
+    bAsyncComputeFrame = false;
     LOG_Info("Creating command list");
 }
 
-void FCommandList::AcquireNextImage()
+bool FCommandList::AcquireNextImage()
 {
     check(Renderer);
-    vkAcquireNextImageKHR(Renderer->GetDevice(),
-        Renderer->GetSwapChain(),
-        UINT64_MAX,
-        Renderer->GetImageAvailableSemaphore(),
-        VK_NULL_HANDLE,
-        &FrameIndex);
-
-    vkWaitForFences(Renderer->GetDevice(), 1, &Renderer->GetFences()[FrameIndex], VK_FALSE, UINT64_MAX);
-    vkResetFences(Renderer->GetDevice(), 1, &Renderer->GetFences()[FrameIndex]);  
+    if(Renderer->IsHeadless())
+    {
+        // Offscreen targets are owned per frame in flight, nothing to wait for
+        FrameIndex = Renderer->GetCurrentFrameIndex();
+    }
+    else
+    {
+        const VkResult result = vkAcquireNextImageKHR(Renderer->GetDevice(),
+            Renderer->GetSwapChain(),
+            UINT64_MAX,
+            Renderer->GetCurrentFrame().ImageAvailableSemaphore,
+            VK_NULL_HANDLE,
+            &FrameIndex);
+        // Out of date leaves the semaphore unsignaled, suboptimal still acquired an image that can be rendered and presented
+        if(result == VK_ERROR_OUT_OF_DATE_KHR) return false;
+        if(result == VK_SUBOPTIMAL_KHR)
+        {
+            Renderer->InvalidateSwapChain();
+        }
+        checkf(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR, "Failed acquiring the next swapchain image");
+    }
 
-    CommandBuffer = Renderer->GetCommandBuffers()[FrameIndex];
+    // The frame's pool was reset by FRenderer::BeginFrame once its ticket completed
+    CommandBuffer = Renderer->GetCurrentFrame().CommandBuffer;
     Image = Renderer->GetSwapChainImages()[FrameIndex];
-}
-
-void FCommandList::ResetCommandBuffer()
-{
-    vkResetCommandBuffer(CommandBuffer, 0);
+    return true;
 }
 
 void FCommandList::BeginCommandBuffer()
 {
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vkBeginCommandBuffer(CommandBuffer, &beginInfo);
 }
 
@@ -73,38 +88,144 @@ void FCommandList::BeginRenderPass(VkClearColorValue ClearColorValue, VkClearDep
     vkCmdBeginRenderPass(CommandBuffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void FCommandList::BeginRenderPass(const FRenderPassDesc& Desc, const FFramebufferDesc& Targets, const VkClearValue* ClearValues)
+{
+    FRenderPassCache& RenderPassCache = Renderer->GetRenderPassCache();
+
+    VkRenderPassBeginInfo render_pass_info = {};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass        = RenderPassCache.GetRenderPass(Desc);
+    render_pass_info.framebuffer       = RenderPassCache.GetFramebuffer(Desc, Targets);
+    render_pass_info.renderArea.offset = {0, 0};
+    render_pass_info.renderArea.extent = {Targets.Width, Targets.Height};
+    render_pass_info.clearValueCount   = Desc.GetAttachmentCount();
+    render_pass_info.pClearValues      = ClearValues;
+
+    vkCmdBeginRenderPass(CommandBuffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+}
+
 void FCommandList::EndRenderPass()
 {
     vkCmdEndRenderPass(CommandBuffer);
 }
 
-VkPipelineStageFlags waitDestStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+uint32_t FCommandList::BeginGpuMarker(const char* Name, bool bStatistics)
+{
+    return Renderer->GetGpuProfiler().BeginScope(CommandBuffer, Name, bStatistics);
+}
+
+void FCommandList::EndGpuMarker(uint32_t Marker)
+{
+    Renderer->GetGpuProfiler().EndScope(CommandBuffer, Marker);
+}
+
+FScopedGpuMarker::FScopedGpuMarker(FCommandList& InCommandList, const char* Name, bool bStatistics)
+    : CommandList(InCommandList)
+{
+    Marker = CommandList.BeginGpuMarker(Name, bStatistics);
+}
+
+FScopedGpuMarker::~FScopedGpuMarker()
+{
+    CommandList.EndGpuMarker(Marker);
+}
+
+FRenderGraphCommandBuffers FCommandList::BeginRenderGraphCommandBuffers(bool bAsyncCompute)
+{
+    bAsyncComputeFrame = bAsyncCompute;
+    GraphCommandBuffers = FRenderGraphCommandBuffers(CommandBuffer);
+    if(!bAsyncCompute) return GraphCommandBuffers;
+
+    FFrameResources& Frame = Renderer->GetCurrentFrame();
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    for(uint32_t Batch = 1; Batch < RENDER_GRAPH_GRAPHICS_BATCHES; Batch++)
+    {
+        GraphCommandBuffers.Graphics[Batch] = Frame.BatchCommandBuffers[Batch - 1];
+        vkBeginCommandBuffer(GraphCommandBuffers.Graphics[Batch], &beginInfo);
+    }
+    GraphCommandBuffers.AsyncCompute = Frame.ComputeCommandBuffer;
+    vkBeginCommandBuffer(GraphCommandBuffers.AsyncCompute, &beginInfo);
+    return GraphCommandBuffers;
+}
+
+void FCommandList::EndRenderGraphCommandBuffers()
+{
+    if(!bAsyncComputeFrame) return;
+
+    for(uint32_t Batch = 0; Batch < RENDER_GRAPH_GRAPHICS_BATCHES - 1; Batch++)
+    {
+        vkEndCommandBuffer(GraphCommandBuffers.Graphics[Batch]);
+    }
+    vkEndCommandBuffer(GraphCommandBuffers.AsyncCompute);
+    CommandBuffer = GraphCommandBuffers.Graphics[RENDER_GRAPH_GRAPHICS_BATCHES - 1];
+}
+
 void FCommandList::QueueSubmit()
 {
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &Renderer->GetImageAvailableSemaphore();
-    submitInfo.pWaitDstStageMask = &waitDestStageMask;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &CommandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &Renderer->GetRenderingFinishedSemaphore();
-    vkQueueSubmit(Renderer->GetGraphicsQueue(), 1, &submitInfo, Renderer->GetFences()[FrameIndex]);
+    FFrameResources& Frame = Renderer->GetCurrentFrame();
+    FGpuTimeline& Timeline = Renderer->GetGpuTimeline();
+    // Headless has no acquire to wait on and no present to signal, the frame's ticket is enough
+    const bool bPresent = !Renderer->IsHeadless();
+
+    FGpuSubmission lastBatch;
+    lastBatch.AddCommandBuffer(CommandBuffer);
+    if(bPresent)
+    {
+        lastBatch.SignalBinary(Renderer->GetRenderingFinishedSemaphore(FrameIndex));
+    }
+    if(!bAsyncComputeFrame)
+    {
+        if(bPresent)
+        {
+            lastBatch.WaitBinary(Frame.ImageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+        Frame.Ticket = Timeline.Submit(EGpuQueue::Graphics, lastBatch);
+        return;
+    }
+
+    // First batch, then the compute work once it's done, the last batch waits for the compute results.
+    // The acquire is waited on by the first batch, the present by the last one. Cross queue waits cover every stage,
+    // the acquire barriers after them start at the top of the pipe.
+    FGpuSubmission firstBatch;
+    firstBatch.AddCommandBuffer(GraphCommandBuffers.Graphics[0]);
+    if(bPresent)
+    {
+        firstBatch.WaitBinary(Frame.ImageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+    const FGpuTicket firstBatchTicket = Timeline.Submit(EGpuQueue::Graphics, firstBatch);
+
+    FGpuSubmission compute;
+    compute.AddCommandBuffer(GraphCommandBuffers.AsyncCompute);
+    compute.Wait(firstBatchTicket, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    const FGpuTicket computeTicket = Timeline.Submit(EGpuQueue::Compute, compute);
+
+    FGpuSubmission overlapBatch;
+    overlapBatch.AddCommandBuffer(GraphCommandBuffers.Graphics[1]);
+    Timeline.Submit(EGpuQueue::Graphics, overlapBatch);
+
+    lastBatch.Wait(computeTicket, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    Frame.Ticket = Timeline.Submit(EGpuQueue::Graphics, lastBatch);
+    bAsyncComputeFrame = false;
 }
 
 void FCommandList::QueuePresent()
 {
+    if(Renderer->IsHeadless()) return;
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &Renderer->GetRenderingFinishedSemaphore();
+    presentInfo.pWaitSemaphores = &Renderer->GetRenderingFinishedSemaphore(FrameIndex);
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &Renderer->GetSwapChain();
     presentInfo.pImageIndices = &FrameIndex;
-    vkQueuePresentKHR(Renderer->GetPresentQueue(), &presentInfo);
-
-    vkQueueWaitIdle(Renderer->GetPresentQueue());
+    const VkResult result = vkQueuePresentKHR(Renderer->GetPresentQueue(), &presentInfo);
+    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        Renderer->InvalidateSwapChain();
+    }
 }
 
 void FCommandList::SetViewport(int width, int height)
@@ -129,8 +250,19 @@ void FCommandList::SetScissor(int width, int height)
     vkCmdSetScissor(CommandBuffer, 0, 1, &scissor);
 }
 
+void FCommandList::BindBindlessHeap(VkPipelineLayout PipelineLayout)
+{
+    Renderer->GetBindlessHeap().Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout);
+}
+
+void FCommandList::PushDrawConstants(VkPipelineLayout PipelineLayout, const FDrawConstants& DrawConstants)
+{
+    vkCmdPushConstants(CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FDrawConstants), &DrawConstants);
+}
+
 FVertexBuffer* FCommandList::CreateVertexBuffer(std::vector<FStaticVertex> VertexData, std::vector<uint32_t> IndicesData)
 {
+    SCOPED_ZONE("UploadVertexBuffer");
     FVertexBuffer* VertexBuffer = new FVertexBuffer();
     VertexBuffer->VertexBufferSize = VertexData.size();
     const size_t VertexBufferSize = sizeof(FStaticVertex) * VertexData.size();
@@ -148,14 +280,11 @@ FVertexBuffer* FCommandList::CreateVertexBuffer(std::vector<FStaticVertex> Verte
     memcpy(data, VertexData.data(), static_cast<size_t>(VertexBufferSize));
     vkUnmapMemory(Renderer->GetDevice(), stagingBufferMemory);
 
-    CreateBuffer(VertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    CreateBuffer(VertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VertexBuffer->VertexBuffer, VertexBuffer->VertexMemory);
 
-    // Copy data from staging buffer to vertex buffer
-    CopyBuffer(Renderer->GetCommandPool(), Renderer->GetGraphicsQueue(), StagingBuffer, VertexBuffer->VertexBuffer, VertexBufferSize);
-
-    vkDestroyBuffer(Renderer->GetDevice(), StagingBuffer, nullptr);
-    vkFreeMemory(Renderer->GetDevice(), stagingBufferMemory, nullptr);
+    // Copy data from staging buffer to vertex buffer, the staging buffer is freed once the copy is done
+    CopyBuffer(StagingBuffer, stagingBufferMemory, VertexBuffer->VertexBuffer, VertexBufferSize, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
 
     // Create Index Buffer
     VertexBuffer->IndexBufferSize = IndicesData.size();
@@ -169,19 +298,59 @@ FVertexBuffer* FCommandList::CreateVertexBuffer(std::vector<FStaticVertex> Verte
     memcpy(indexData, IndicesData.data(), (size_t)IndexBufferSize);
     vkUnmapMemory(Renderer->GetDevice(), stagingBufferMemory);
 
-    CreateBuffer(IndexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    CreateBuffer(IndexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VertexBuffer->IndexBuffer, VertexBuffer->IndexMemory);
 
     // Copy data from staging buffer to index buffer
-    CopyBuffer(Renderer->GetCommandPool(), Renderer->GetGraphicsQueue(), StagingBuffer, VertexBuffer->IndexBuffer, IndexBufferSize);
+    CopyBuffer(StagingBuffer, stagingBufferMemory, VertexBuffer->IndexBuffer, IndexBufferSize, VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+
+    // Centered on the box around the vertices, not the tightest sphere but cheap and never smaller than the mesh
+    if(!VertexData.empty())
+    {
+        glm::vec3 BoundsMin = VertexData[0].Position;
+        glm::vec3 BoundsMax = VertexData[0].Position;
+        for(const FStaticVertex& Vertex : VertexData)
+        {
+            BoundsMin = glm::min(BoundsMin, Vertex.Position);
+            BoundsMax = glm::max(BoundsMax, Vertex.Position);
+        }
+        VertexBuffer->BoundsCenter = (BoundsMin + BoundsMax) * 0.5f;
+        VertexBuffer->BoundsExtent = (BoundsMax - BoundsMin) * 0.5f;
+        for(const FStaticVertex& Vertex : VertexData)
+        {
+            VertexBuffer->BoundsRadius = std::max(VertexBuffer->BoundsRadius, glm::length(Vertex.Position - VertexBuffer->BoundsCenter));
+        }
+    }
 
-    vkDestroyBuffer(Renderer->GetDevice(), StagingBuffer, nullptr);
-    vkFreeMemory(Renderer->GetDevice(), stagingBufferMemory, nullptr);
+    UploadedBytes += VertexBufferSize + IndexBufferSize;
+    VertexBuffer->VertexBindlessIndex = Renderer->GetBindlessHeap().RegisterStorageBuffer(VertexBuffer->VertexBuffer);
+    VertexBuffer->IndexBindlessIndex = Renderer->GetBindlessHeap().RegisterStorageBuffer(VertexBuffer->IndexBuffer);
 
     LOG_Info("Generating vertex and index buffer...");
     return VertexBuffer;
 }
 
+void FCommandList::UploadBuffer(const void* Data, VkDeviceSize Size, VkBufferUsageFlags Usage, VkAccessFlags DstAccess, VkPipelineStageFlags DstStages,
+    VkBuffer& OutBuffer, VkDeviceMemory& OutMemory)
+{
+    SCOPED_ZONE("UploadBuffer");
+    VkBuffer StagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 StagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(Renderer->GetDevice(), stagingBufferMemory, 0, Size, 0, &data);
+    memcpy(data, Data, static_cast<size_t>(Size));
+    vkUnmapMemory(Renderer->GetDevice(), stagingBufferMemory);
+
+    CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | Usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, OutBuffer, OutMemory);
+    CopyBuffer(StagingBuffer, stagingBufferMemory, OutBuffer, Size, DstAccess, DstStages);
+    UploadedBytes += Size;
+}
+
 FTexture FCommandList::CreateTexture(uint32_t Witdh, uint32_t Height, VkFormat Format, VkImageUsageFlagBits Usage)
 {
 	FTexture NewTexture;
@@ -256,10 +425,72 @@ FTexture FCommandList::CreateTexture(uint32_t Witdh, uint32_t Height, VkFormat F
 	{
 		checkf(0, "Unable to create image view for VkImage");
 	}
+
+	// Every texture is sampled at some point, give it its slot in the global array right away
+	const VkImageLayout SampledLayout = (aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	NewTexture.BindlessIndex = Renderer->GetBindlessHeap().RegisterSampledImage(NewTexture.ImageView, SampledLayout);
 	
 	return NewTexture;
 }
 
+FTexture FCommandList::UploadTexture(uint32_t Width, uint32_t Height, VkFormat Format, const void* Texels, size_t TexelsSize)
+{
+    SCOPED_ZONE("UploadTexture");
+    FTexture NewTexture;
+    NewTexture.Format = Format;
+    NewTexture.SizeX = Width;
+    NewTexture.SizeY = Height;
+    NewTexture.MipMaps = 1;
+
+    VkBuffer StagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(TexelsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 StagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(Renderer->GetDevice(), stagingBufferMemory, 0, TexelsSize, 0, &data);
+    memcpy(data, Texels, TexelsSize);
+    vkUnmapMemory(Renderer->GetDevice(), stagingBufferMemory);
+
+    Renderer->CreateImage(Width, Height, Format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, NewTexture.Image, NewTexture.ImageMemory);
+
+    VkCommandBuffer commandBuffer = BeginUpload();
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = NewTexture.Image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { Width, Height, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, StagingBuffer, NewTexture.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    SubmitUpload(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, nullptr, 1, &barrier, StagingBuffer, stagingBufferMemory);
+    UploadedBytes += TexelsSize;
+
+    NewTexture.ImageView = Renderer->CreateImageView(NewTexture.Image, Format, VK_IMAGE_ASPECT_COLOR_BIT);
+    NewTexture.ImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    NewTexture.BindlessIndex = Renderer->GetBindlessHeap().RegisterSampledImage(NewTexture.ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return NewTexture;
+}
+
 bool FCommandList::GetSupportedDepthFormat(VkFormat* depthFormat)
 {
 	std::vector<VkFormat> formatList = {
@@ -347,12 +578,34 @@ void FCommandList::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
     vkBindBufferMemory(Renderer->GetDevice(), buffer, bufferMemory, 0);
 }
 
-void FCommandList::CopyBuffer(VkCommandPool commandPool, VkQueue queue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void FCommandList::CopyBuffer(VkBuffer srcBuffer, VkDeviceMemory srcMemory, VkBuffer dstBuffer, VkDeviceSize size, VkAccessFlags dstAccess, VkPipelineStageFlags dstStages)
+{
+    VkCommandBuffer commandBuffer = BeginUpload();
+
+    VkBufferCopy copyRegion = {};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = size;
+
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = dstBuffer;
+    barrier.size = VK_WHOLE_SIZE;
+    SubmitUpload(commandBuffer, dstStages, 1, &barrier, 0, nullptr, srcBuffer, srcMemory);
+}
+
+VkCommandBuffer FCommandList::BeginUpload()
 {
     VkCommandBufferAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
+    allocInfo.commandPool = Renderer->HasTransferQueue() ? Renderer->GetTransferCommandPool() : Renderer->GetCommandPool();
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
@@ -361,25 +614,94 @@ void FCommandList::CopyBuffer(VkCommandPool commandPool, VkQueue queue, VkBuffer
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    return commandBuffer;
+}
 
-    VkBufferCopy copyRegion = {};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    vkEndCommandBuffer(commandBuffer);
+void FCommandList::SubmitUpload(VkCommandBuffer UploadCommandBuffer, VkPipelineStageFlags DstStages, uint32_t BufferBarrierCount, VkBufferMemoryBarrier* BufferBarriers,
+    uint32_t ImageBarrierCount, VkImageMemoryBarrier* ImageBarriers, VkBuffer StagingBuffer, VkDeviceMemory StagingMemory)
+{
+    // Bounds the staging memory alive when many uploads happen between frames, at load time
+    ReleaseCompletedUploads();
+
+    FGpuTimeline& timeline = Renderer->GetGpuTimeline();
+    FPendingUpload upload;
+    upload.StagingBuffer = StagingBuffer;
+    upload.StagingMemory = StagingMemory;
+    upload.UploadCommandBuffer = UploadCommandBuffer;
+    upload.AcquireCommandBuffer = VK_NULL_HANDLE;
+
+    // Frames are submitted to the graphics queue after the upload, the barrier orders their reads after the copy
+    if(!Renderer->HasTransferQueue())
+    {
+        vkCmdPipelineBarrier(UploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, DstStages, 0, 0, nullptr, BufferBarrierCount, BufferBarriers, ImageBarrierCount, ImageBarriers);
+        vkEndCommandBuffer(UploadCommandBuffer);
+        upload.Ticket = timeline.Submit(EGpuQueue::Graphics, FGpuSubmission().AddCommandBuffer(UploadCommandBuffer));
+        LastUploadTicket = upload.Ticket;
+        PendingUploads.push_back(upload);
+        return;
+    }
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    // Release: same layouts as the acquire, which makes the writes visible to their consumers
+    std::vector<VkAccessFlags> dstAccess(BufferBarrierCount + ImageBarrierCount);
+    for(uint32_t i = 0; i < BufferBarrierCount; i++)
+    {
+        BufferBarriers[i].srcQueueFamilyIndex = Renderer->GetTransferQueueFamily();
+        BufferBarriers[i].dstQueueFamilyIndex = Renderer->GetGraphicsQueueFamily();
+        dstAccess[i] = BufferBarriers[i].dstAccessMask;
+        BufferBarriers[i].dstAccessMask = 0;
+    }
+    for(uint32_t i = 0; i < ImageBarrierCount; i++)
+    {
+        ImageBarriers[i].srcQueueFamilyIndex = Renderer->GetTransferQueueFamily();
+        ImageBarriers[i].dstQueueFamilyIndex = Renderer->GetGraphicsQueueFamily();
+        dstAccess[BufferBarrierCount + i] = ImageBarriers[i].dstAccessMask;
+        ImageBarriers[i].dstAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(UploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, BufferBarrierCount, BufferBarriers, ImageBarrierCount, ImageBarriers);
+    vkEndCommandBuffer(UploadCommandBuffer);
 
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
+    for(uint32_t i = 0; i < BufferBarrierCount; i++)
+    {
+        BufferBarriers[i].srcAccessMask = 0;
+        BufferBarriers[i].dstAccessMask = dstAccess[i];
+    }
+    for(uint32_t i = 0; i < ImageBarrierCount; i++)
+    {
+        ImageBarriers[i].srcAccessMask = 0;
+        ImageBarriers[i].dstAccessMask = dstAccess[BufferBarrierCount + i];
+    }
+    upload.AcquireCommandBuffer = CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    vkCmdPipelineBarrier(upload.AcquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, DstStages, 0, 0, nullptr, BufferBarrierCount, BufferBarriers, ImageBarrierCount, ImageBarriers);
+    vkEndCommandBuffer(upload.AcquireCommandBuffer);
+
+    // The acquire lands on the graphics queue ahead of any frame using the resource, nothing else has to wait for the copy
+    const FGpuTicket copyTicket = timeline.Submit(EGpuQueue::Transfer, FGpuSubmission().AddCommandBuffer(UploadCommandBuffer));
+    upload.Ticket = timeline.Submit(EGpuQueue::Graphics, FGpuSubmission().AddCommandBuffer(upload.AcquireCommandBuffer).Wait(copyTicket, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    LastUploadTicket = upload.Ticket;
+    PendingUploads.push_back(upload);
+}
 
-    vkFreeCommandBuffers(Renderer->GetDevice(), commandPool, 1, &commandBuffer);
+void FCommandList::ReleaseCompletedUploads()
+{
+    FGpuTimeline& timeline = Renderer->GetGpuTimeline();
+    VkDevice device = Renderer->GetDevice();
+    // Tickets are on the graphics timeline in submission order, the first incomplete one ends the scan
+    size_t completed = 0;
+    for(; completed < PendingUploads.size() && timeline.IsComplete(PendingUploads[completed].Ticket); completed++)
+    {
+        FPendingUpload& upload = PendingUploads[completed];
+        vkDestroyBuffer(device, upload.StagingBuffer, nullptr);
+        vkFreeMemory(device, upload.StagingMemory, nullptr);
+        if(upload.AcquireCommandBuffer != VK_NULL_HANDLE)
+        {
+            vkFreeCommandBuffers(device, Renderer->GetTransferCommandPool(), 1, &upload.UploadCommandBuffer);
+            vkFreeCommandBuffers(device, Renderer->GetCommandPool(), 1, &upload.AcquireCommandBuffer);
+        }
+        else
+        {
+            vkFreeCommandBuffers(device, Renderer->GetCommandPool(), 1, &upload.UploadCommandBuffer);
+        }
+    }
+    PendingUploads.erase(PendingUploads.begin(), PendingUploads.begin() + completed);
 }
@@ -2,34 +2,80 @@
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+#include "GpuTimeline.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
 #include "RenderResource.h"
 #include "MinimalCore.h"
 
 class FRenderer;
 
+class FCommandList;
+
+class FScopedGpuMarker
+{
+public:
+    FScopedGpuMarker(FCommandList& InCommandList, const char* Name, bool bStatistics = true);
+    ~FScopedGpuMarker();
+
+private:
+    FCommandList& CommandList;
+    uint32_t Marker;
+};
+
 class FCommandList
 {
 public:
     FCommandList();
     FCommandList(FRenderer* InRenderer);
     
-    void AcquireNextImage();
-    void ResetCommandBuffer();
+    // False when the swapchain is out of date and has to be recreated before anything can be acquired
+    bool AcquireNextImage();
     void BeginCommandBuffer();
     void EndCommandBuffer();
+    VkCommandBuffer GetCommandBuffer() const { return CommandBuffer; }
+    // Swapchain image acquired for the current frame
+    uint32_t GetSwapChainImageIndex() const { return FrameIndex; }
     void FreeCommandBuffers();
 
     void BeginRenderPass(VkClearColorValue ClearColorValue, VkClearDepthStencilValue ClearDepthStencilValue);
+    // Render pass and framebuffer come from the renderer's cache, one clear value per attachment
+    void BeginRenderPass(const FRenderPassDesc& Desc, const FFramebufferDesc& Targets, const VkClearValue* ClearValues);
     void EndRenderPass();
 
+    // GPU timing scope through the renderer's profiler, outside of render passes
+    uint32_t BeginGpuMarker(const char* Name, bool bStatistics = true);
+    void EndGpuMarker(uint32_t Marker);
+
+    // Without async compute every batch is the frame's command buffer. With it the extra graphics batches and the
+    // compute command buffer are begun here, and QueueSubmit splits the frame in three submits around the compute one.
+    FRenderGraphCommandBuffers BeginRenderGraphCommandBuffers(bool bAsyncCompute);
+    // Ends every command buffer but the last graphics batch, which becomes the one recorded into
+    void EndRenderGraphCommandBuffers();
+
     void QueueSubmit();
     void QueuePresent();
 
     void SetViewport(int width,int height);
     void SetScissor(int width,int height);
+
+    // Bindless: the global set is bound once per pipeline layout change, draws only push their indices
+    void BindBindlessHeap(VkPipelineLayout PipelineLayout);
+    void PushDrawConstants(VkPipelineLayout PipelineLayout, const FDrawConstants& DrawConstants);
     
     FVertexBuffer* CreateVertexBuffer(std::vector<FStaticVertex> VertexData, std::vector<uint32_t> IndicesData);
+    // Device local buffer filled through a staging buffer, usable by any frame submitted afterwards
+    void UploadBuffer(const void* Data, VkDeviceSize Size, VkBufferUsageFlags Usage, VkAccessFlags DstAccess, VkPipelineStageFlags DstStages,
+        VkBuffer& OutBuffer, VkDeviceMemory& OutMemory);
     FTexture CreateTexture(uint32_t Witdh, uint32_t Height, VkFormat Format, VkImageUsageFlagBits Usage);
+    // Sampled texture filled with tightly packed texels through a staging buffer, usable by any frame submitted afterwards
+    FTexture UploadTexture(uint32_t Width, uint32_t Height, VkFormat Format, const void* Texels, size_t TexelsSize);
+    // Bytes sent through staging buffers since startup
+    uint64_t GetUploadedBytes() const { return UploadedBytes; }
+    // Complete once every upload so far is visible to the graphics queue, for CPU side waits (readbacks of uploaded data)
+    FGpuTicket GetLastUploadTicket() const { return LastUploadTicket; }
+    // Frees the staging buffers and command buffers of uploads whose ticket is complete, never blocks
+    void ReleaseCompletedUploads();
 
     // library
     bool GetSupportedDepthFormat(VkFormat * depthFormat);
@@ -38,11 +84,35 @@ public:
 
 private:
     void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-    void CopyBuffer(VkCommandPool commandPool, VkQueue queue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    // Takes ownership of the staging buffer
+    void CopyBuffer(VkBuffer srcBuffer, VkDeviceMemory srcMemory, VkBuffer dstBuffer, VkDeviceSize size, VkAccessFlags dstAccess, VkPipelineStageFlags dstStages);
+    // Records into the transfer queue's pool when there is a dedicated one, the graphics queue's otherwise
+    VkCommandBuffer BeginUpload();
+    // Barriers go from the copy's transfer writes to the first use in DstStages. On a dedicated transfer queue they release
+    // ownership there and the graphics queue acquires it once the copy's ticket is complete.
+    // Doesn't block, the staging buffer is freed by ReleaseCompletedUploads.
+    void SubmitUpload(VkCommandBuffer UploadCommandBuffer, VkPipelineStageFlags DstStages, uint32_t BufferBarrierCount, VkBufferMemoryBarrier* BufferBarriers,
+        uint32_t ImageBarrierCount, VkImageMemoryBarrier* ImageBarriers, VkBuffer StagingBuffer, VkDeviceMemory StagingMemory);
+
+private:
+    struct FPendingUpload
+    {
+        // Graphics timeline, the acquire when the copy ran on the transfer queue
+        FGpuTicket Ticket;
+        VkBuffer StagingBuffer;
+        VkDeviceMemory StagingMemory;
+        VkCommandBuffer UploadCommandBuffer;
+        VkCommandBuffer AcquireCommandBuffer;
+    };
 
 private:
     FRenderer* Renderer;
     uint32_t FrameIndex;
     VkCommandBuffer CommandBuffer;
     VkImage Image;
+    uint64_t UploadedBytes;
+    FRenderGraphCommandBuffers GraphCommandBuffers;
+    bool bAsyncComputeFrame;
+    std::vector<FPendingUpload> PendingUploads;
+    FGpuTicket LastUploadTicket;
 };
@@ -0,0 +1,226 @@
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cstdio>
+#include "MinimalCore.h"
+
+// Zones to list in the periodic report, the rest only show up in captures
+static const size_t ReportedZoneCount = 12;
+
+thread_local FCpuProfiler::FThreadBuffer* FCpuProfiler::LocalBuffer = nullptr;
+
+FCpuProfiler& FCpuProfiler::Get()
+{
+    static FCpuProfiler Profiler;
+    return Profiler;
+}
+
+FCpuProfiler::FCpuProfiler()
+{
+    CalibrationTicks = GetTicks();
+    CalibrationUs = FChromeTrace::GetTimeUs();
+#if defined(_M_X64) || defined(__x86_64__)
+    // Rough guess until the first EndFrame measures the TSC rate
+    TicksPerUs = 1000.0;
+#else
+    TicksPerUs = static_cast<double>(std::chrono::steady_clock::period::den) / (static_cast<double>(std::chrono::steady_clock::period::num) * 1000000.0);
+#endif
+    ReportFrames = 0;
+    ReportInterval = 0.0f;
+    LastReport = std::chrono::steady_clock::now();
+    CaptureFramesLeft = 0;
+}
+
+FCpuProfiler::FThreadBuffer* FCpuProfiler::RegisterThread()
+{
+    std::lock_guard<std::mutex> Lock(ThreadsMutex);
+    Threads.emplace_back(new FThreadBuffer());
+    FThreadBuffer* Buffer = Threads.back().get();
+    Buffer->Head = 0;
+    Buffer->Tail = 0;
+    Buffer->Dropped = 0;
+    Buffer->ThreadId = static_cast<uint32_t>(Threads.size());
+    return Buffer;
+}
+
+void FCpuProfiler::RecordZone(const char* Name, uint64_t BeginTicks, uint64_t EndTicks)
+{
+    FThreadBuffer* Buffer = LocalBuffer;
+    if(!Buffer)
+    {
+        Buffer = LocalBuffer = Get().RegisterThread();
+    }
+
+    const uint32_t Head = Buffer->Head.load(std::memory_order_relaxed);
+    if(Head - Buffer->Tail.load(std::memory_order_acquire) >= CPU_PROFILER_BUFFER_SIZE)
+    {
+        Buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    FZoneEvent& Event = Buffer->Events[Head % CPU_PROFILER_BUFFER_SIZE];
+    Event.Name = Name;
+    Event.BeginTicks = BeginTicks;
+    Event.EndTicks = EndTicks;
+    Buffer->Head.store(Head + 1, std::memory_order_release);
+}
+
+void FCpuProfiler::SetThreadName(const char* Name)
+{
+    FCpuProfiler& Profiler = Get();
+    if(!LocalBuffer)
+    {
+        LocalBuffer = Profiler.RegisterThread();
+    }
+    std::lock_guard<std::mutex> Lock(Profiler.ThreadsMutex);
+    LocalBuffer->Name = Name;
+}
+
+void FCpuProfiler::SetReportInterval(float InReportInterval)
+{
+    ReportInterval = InReportInterval;
+    LastReport = std::chrono::steady_clock::now();
+}
+
+void FCpuProfiler::Calibrate()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    const double ElapsedUs = FChromeTrace::GetTimeUs() - CalibrationUs;
+    if(ElapsedUs > 1000.0)
+    {
+        TicksPerUs = static_cast<double>(GetTicks() - CalibrationTicks) / ElapsedUs;
+    }
+#endif
+}
+
+double FCpuProfiler::TicksToUs(uint64_t Ticks) const
+{
+    return CalibrationUs + static_cast<double>(static_cast<int64_t>(Ticks - CalibrationTicks)) / TicksPerUs;
+}
+
+const char* FCpuProfiler::InternName(const char* Name)
+{
+    const auto Found = InternedPointers.find(Name);
+    if(Found != InternedPointers.end()) return Found->second;
+
+    const char* Interned = InternedNames.emplace(Name, Name).first->second;
+    InternedPointers.emplace(Name, Interned);
+    return Interned;
+}
+
+void FCpuProfiler::EndFrame()
+{
+    Calibrate();
+    FrameZones.clear();
+
+    const bool bCapture = CaptureFramesLeft > 0;
+    {
+        // Only keeps threads from registering meanwhile, recording never takes it
+        std::lock_guard<std::mutex> Lock(ThreadsMutex);
+        for(const std::unique_ptr<FThreadBuffer>& Buffer : Threads)
+        {
+            const uint32_t Tail = Buffer->Tail.load(std::memory_order_relaxed);
+            const uint32_t Head = Buffer->Head.load(std::memory_order_acquire);
+            for(uint32_t i = Tail; i != Head; i++)
+            {
+                const FZoneEvent& Event = Buffer->Events[i % CPU_PROFILER_BUFFER_SIZE];
+                const double DurationUs = static_cast<double>(Event.EndTicks - Event.BeginTicks) / TicksPerUs;
+
+                const char* Name = InternName(Event.Name);
+                FZoneTotal& Total = FrameZones[Name];
+                Total.Name = Name;
+                Total.TotalMs += DurationUs / 1000.0;
+                Total.Count++;
+
+                if(bCapture)
+                {
+                    FTraceEvent TraceEvent;
+                    TraceEvent.Name = Name;
+                    TraceEvent.Category = "cpu";
+                    TraceEvent.ProcessId = TRACE_PID_CPU;
+                    TraceEvent.ThreadId = Buffer->ThreadId;
+                    TraceEvent.StartUs = TicksToUs(Event.BeginTicks);
+                    TraceEvent.DurationUs = DurationUs;
+                    CapturedEvents.push_back(TraceEvent);
+                }
+            }
+            Buffer->Tail.store(Head, std::memory_order_release);
+
+            const uint32_t Dropped = Buffer->Dropped.exchange(0, std::memory_order_relaxed);
+            if(Dropped > 0)
+            {
+                LOG_Warning("CPU profiler: %u zones dropped on thread %u, its buffer is full", Dropped, Buffer->ThreadId);
+            }
+        }
+    }
+
+    LastFrameZones.clear();
+    for(const auto& Entry : FrameZones)
+    {
+        LastFrameZones.push_back(Entry.second);
+
+        FZoneTotal& ReportTotal = ReportZones[Entry.first];
+        ReportTotal.Name = Entry.first;
+        ReportTotal.TotalMs += Entry.second.TotalMs;
+        ReportTotal.Count += Entry.second.Count;
+    }
+    std::sort(LastFrameZones.begin(), LastFrameZones.end(), [](const FZoneTotal& A, const FZoneTotal& B) { return A.TotalMs > B.TotalMs; });
+
+    if(bCapture)
+    {
+        CaptureFramesLeft--;
+    }
+
+    ReportFrames++;
+    const auto Now = std::chrono::steady_clock::now();
+    if(ReportInterval > 0.0f && std::chrono::duration<float>(Now - LastReport).count() >= ReportInterval)
+    {
+        Report();
+        LastReport = Now;
+    }
+}
+
+void FCpuProfiler::Report()
+{
+    std::vector<FZoneTotal> Sorted;
+    for(const auto& Entry : ReportZones)
+    {
+        Sorted.push_back(Entry.second);
+    }
+    std::sort(Sorted.begin(), Sorted.end(), [](const FZoneTotal& A, const FZoneTotal& B) { return A.TotalMs > B.TotalMs; });
+    Sorted.resize(std::min(Sorted.size(), ReportedZoneCount));
+
+    std::string Line;
+    char Buffer[256];
+    for(const FZoneTotal& Zone : Sorted)
+    {
+        snprintf(Buffer, sizeof(Buffer), "%s%s %.3f ms (%.1fx)", Line.empty() ? "" : ", ", Zone.Name,
+            Zone.TotalMs / ReportFrames, static_cast<double>(Zone.Count) / ReportFrames);
+        Line += Buffer;
+    }
+    LOG_Info("CPU zones (%u frames, per frame): %s", ReportFrames, Line.c_str());
+
+    ReportZones.clear();
+    ReportFrames = 0;
+}
+
+void FCpuProfiler::StartCapture(uint32_t NumFrames)
+{
+    CapturedEvents.clear();
+    CaptureFramesLeft = NumFrames;
+}
+
+void FCpuProfiler::TakeCapturedEvents(std::vector<FTraceEvent>& OutEvents, std::vector<FTraceThread>& OutThreads)
+{
+    OutEvents.insert(OutEvents.end(), CapturedEvents.begin(), CapturedEvents.end());
+    CapturedEvents.clear();
+
+    std::lock_guard<std::mutex> Lock(ThreadsMutex);
+    for(const std::unique_ptr<FThreadBuffer>& Buffer : Threads)
+    {
+        FTraceThread Thread;
+        Thread.ProcessId = TRACE_PID_CPU;
+        Thread.ThreadId = Buffer->ThreadId;
+        Thread.Name = Buffer->Name.empty() ? "Thread " + std::to_string(Buffer->ThreadId) : Buffer->Name;
+        OutThreads.push_back(Thread);
+    }
+}
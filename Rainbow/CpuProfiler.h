@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ChromeTrace.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Set to 0 to compile every SCOPED_ZONE out
+#ifndef RAINBOW_PROFILER
+#define RAINBOW_PROFILER 1
+#endif
+
+// Zones a thread can hold between two EndFrame, later ones are dropped and counted
+#define CPU_PROFILER_BUFFER_SIZE 16384
+
+// CPU zone timings. Each thread records into its own ring buffer with no lock or allocation on the hot path,
+// the render thread drains every buffer once per frame to aggregate the zones and feed captures.
+class FCpuProfiler
+{
+public:
+    struct FZoneTotal
+    {
+        const char* Name;
+        double TotalMs;
+        uint32_t Count;
+    };
+
+    static FCpuProfiler& Get();
+
+    // Raw timestamp, the TSC where there is one, a handful of cycles to read
+    static uint64_t GetTicks()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Name must outlive the profiler (string literals). Recorded by pointer, zones with the same name are merged when drained
+    static void RecordZone(const char* Name, uint64_t BeginTicks, uint64_t EndTicks);
+    // Names the calling thread's track in traces
+    static void SetThreadName(const char* Name);
+
+    void SetReportInterval(float InReportInterval);
+    // Drains every thread's buffer, call once per frame from the render thread
+    void EndFrame();
+
+    // Zones of the last frame drained, sorted by total time
+    const std::vector<FZoneTotal>& GetLastFrameZones() const { return LastFrameZones; }
+
+    // Keeps trace events for the next NumFrames EndFrame calls, zones recorded before the first one included
+    void StartCapture(uint32_t NumFrames);
+    bool IsCapturing() const { return CaptureFramesLeft > 0; }
+    bool IsCaptureComplete() const { return CaptureFramesLeft == 0 && !CapturedEvents.empty(); }
+    void TakeCapturedEvents(std::vector<FTraceEvent>& OutEvents, std::vector<FTraceThread>& OutThreads);
+
+private:
+    struct FZoneEvent
+    {
+        const char* Name;
+        uint64_t BeginTicks;
+        uint64_t EndTicks;
+    };
+
+    // Single producer (the owning thread), single consumer (EndFrame)
+    struct FThreadBuffer
+    {
+        FZoneEvent Events[CPU_PROFILER_BUFFER_SIZE];
+        std::atomic<uint32_t> Head;
+        std::atomic<uint32_t> Tail;
+        std::atomic<uint32_t> Dropped;
+        uint32_t ThreadId;
+        std::string Name;
+    };
+
+    FCpuProfiler();
+    FThreadBuffer* RegisterThread();
+    double TicksToUs(uint64_t Ticks) const;
+    // Identical literals of different translation units can have different addresses, returns the first one seen
+    const char* InternName(const char* Name);
+    void Calibrate();
+    void Report();
+
+private:
+    static thread_local FThreadBuffer* LocalBuffer;
+
+    std::mutex ThreadsMutex;
+    std::vector<std::unique_ptr<FThreadBuffer>> Threads;
+
+    // Ticks to trace time, refreshed every frame so the TSC rate gets more precise as time passes
+    uint64_t CalibrationTicks;
+    double CalibrationUs;
+    double TicksPerUs;
+
+    // Only used by EndFrame, the pointer lookup saves hashing the name of every zone
+    std::unordered_map<const char*, const char*> InternedPointers;
+    std::unordered_map<std::string, const char*> InternedNames;
+    std::unordered_map<const char*, FZoneTotal> FrameZones;
+    std::vector<FZoneTotal> LastFrameZones;
+    std::unordered_map<const char*, FZoneTotal> ReportZones;
+    uint32_t ReportFrames;
+    float ReportInterval;
+    std::chrono::steady_clock::time_point LastReport;
+
+    uint32_t CaptureFramesLeft;
+    std::vector<FTraceEvent> CapturedEvents;
+};
+
+class FScopedZone
+{
+public:
+    explicit FScopedZone(const char* InName) : Name(InName), BeginTicks(FCpuProfiler::GetTicks()) {}
+    ~FScopedZone() { FCpuProfiler::RecordZone(Name, BeginTicks, FCpuProfiler::GetTicks()); }
+
+private:
+    const char* Name;
+    uint64_t BeginTicks;
+};
+
+#if RAINBOW_PROFILER
+#define ZONE_CONCAT_INNER(A, B) A##B
+#define ZONE_CONCAT(A, B) ZONE_CONCAT_INNER(A, B)
+#define SCOPED_ZONE(Name) FScopedZone ZONE_CONCAT(ScopedZone, __LINE__)(Name)
+#define ZONE_THREAD_NAME(Name) FCpuProfiler::SetThreadName(Name)
+#else
+#define SCOPED_ZONE(Name)
+#define ZONE_THREAD_NAME(Name)
+#endif
@@ -0,0 +1,172 @@
+#include "DepthPyramid.h"
+#include "BindlessHeap.h"
+#include "Paths.h"
+#include "PipelineStateCache.h"
+#include "Renderer.h"
+
+// Must match FDepthPyramidBuildConstants in Shaders/DepthPyramid.comp
+struct FDepthPyramidBuildConstants
+{
+    uint32_t DepthTextureIndex;
+    uint32_t SamplerIndex;
+    uint32_t PyramidBufferIndex;
+    uint32_t Level;
+    uint32_t DepthWidth;
+    uint32_t DepthHeight;
+    uint32_t PyramidWidth;
+    uint32_t PyramidHeight;
+};
+
+// Texels per workgroup side, must match local_size_x/y in Shaders/DepthPyramid.comp
+#define DEPTH_PYRAMID_GROUP_SIZE 8
+
+static uint32_t GetLevelSize(uint32_t Size, uint32_t Level)
+{
+    return (Size + (1u << Level) - 1) >> Level;
+}
+
+FDepthPyramid::FDepthPyramid()
+{
+    Device = VK_NULL_HANDLE;
+    PhysicalDevice = VK_NULL_HANDLE;
+    BindlessHeap = nullptr;
+    PipelineLayout = VK_NULL_HANDLE;
+    Pipeline = VK_NULL_HANDLE;
+    for(FFramePyramid& Frame : Frames)
+    {
+        Frame.Buffer = VK_NULL_HANDLE;
+        Frame.Memory = VK_NULL_HANDLE;
+    }
+}
+
+void FDepthPyramid::Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+    VkPipelineLayout InPipelineLayout)
+{
+    SCOPED_ZONE("FDepthPyramid::Init");
+    Device = InDevice;
+    PhysicalDevice = InPhysicalDevice;
+    BindlessHeap = InBindlessHeap;
+    PipelineLayout = InPipelineLayout;
+
+    FComputePipelineDesc Desc;
+    Desc.ComputeShader = FPaths::GetShaderDirectory() + "/DepthPyramid.comp.spv";
+    Desc.PipelineLayout = PipelineLayout;
+    Pipeline = PipelineStateCache.GetComputePipelineBlocking(Desc);
+    checkf(Pipeline != VK_NULL_HANDLE, "FDepthPyramid::Init Unable to create depth pyramid pipeline");
+}
+
+void FDepthPyramid::Shutdown()
+{
+    for(FFramePyramid& Frame : Frames)
+    {
+        Release(Frame);
+    }
+}
+
+void FDepthPyramid::Allocate(FFramePyramid& Pyramid, uint32_t DepthWidth, uint32_t DepthHeight)
+{
+    FDepthPyramidDesc& Desc = Pyramid.Desc;
+    Desc.DepthWidth = DepthWidth;
+    Desc.DepthHeight = DepthHeight;
+    Desc.Width = GetLevelSize(DepthWidth, 1);
+    Desc.Height = GetLevelSize(DepthHeight, 1);
+    Desc.LevelCount = 1;
+    VkDeviceSize TexelCount = static_cast<VkDeviceSize>(Desc.Width) * Desc.Height;
+    while(GetLevelSize(Desc.Width, Desc.LevelCount - 1) > 1 || GetLevelSize(Desc.Height, Desc.LevelCount - 1) > 1)
+    {
+        TexelCount += static_cast<VkDeviceSize>(GetLevelSize(Desc.Width, Desc.LevelCount)) * GetLevelSize(Desc.Height, Desc.LevelCount);
+        Desc.LevelCount++;
+    }
+
+    // Min and max depth per texel
+    VkBufferCreateInfo BufferInfo = {};
+    BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    BufferInfo.size = TexelCount * 2 * sizeof(float);
+    BufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(Device, &BufferInfo, nullptr, &Pyramid.Buffer) != VK_SUCCESS)
+    {
+        checkf(0, "FDepthPyramid: unable to create pyramid buffer");
+    }
+
+    VkMemoryRequirements MemoryRequirements;
+    vkGetBufferMemoryRequirements(Device, Pyramid.Buffer, &MemoryRequirements);
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = MemoryRequirements.size;
+    AllocateInfo.memoryTypeIndex = FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &Pyramid.Memory) != VK_SUCCESS)
+    {
+        checkf(0, "FDepthPyramid: unable to allocate pyramid memory");
+    }
+    vkBindBufferMemory(Device, Pyramid.Buffer, Pyramid.Memory, 0);
+    Desc.BufferIndex = BindlessHeap->RegisterStorageBuffer(Pyramid.Buffer);
+}
+
+void FDepthPyramid::Release(FFramePyramid& Pyramid)
+{
+    if(Pyramid.Buffer == VK_NULL_HANDLE) return;
+
+    BindlessHeap->Release(BINDLESS_StorageBuffers, Pyramid.Desc.BufferIndex);
+    vkDestroyBuffer(Device, Pyramid.Buffer, nullptr);
+    vkFreeMemory(Device, Pyramid.Memory, nullptr);
+    Pyramid.Buffer = VK_NULL_HANDLE;
+    Pyramid.Memory = VK_NULL_HANDLE;
+    Pyramid.Desc = FDepthPyramidDesc();
+}
+
+FDepthPyramidDesc FDepthPyramid::AddBuildPass(FRenderGraph& RenderGraph, FRenderGraphTexture Depth, uint32_t DepthWidth, uint32_t DepthHeight,
+    uint32_t FrameIndex, uint32_t SamplerIndex)
+{
+    FFramePyramid& Pyramid = Frames[FrameIndex];
+    if(Pyramid.Desc.DepthWidth != DepthWidth || Pyramid.Desc.DepthHeight != DepthHeight)
+    {
+        Release(Pyramid);
+        Allocate(Pyramid, DepthWidth, DepthHeight);
+    }
+
+    FDepthPyramidDesc Desc = Pyramid.Desc;
+    Desc.Buffer = RenderGraph.ImportBuffer("DepthPyramid", Pyramid.Buffer);
+    const VkBuffer Buffer = Pyramid.Buffer;
+    FRenderGraph* Graph = &RenderGraph;
+    RenderGraph.AddPass("DepthPyramid")
+        .ReadTexture(Depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+        .WriteBuffer(Desc.Buffer)
+        .SetExecute([this, Graph, Depth, Desc, Buffer, SamplerIndex](const FRenderGraphPassContext& Context)
+        {
+            FDepthPyramidBuildConstants Constants;
+            Constants.DepthTextureIndex = Graph->GetTexture(Depth).BindlessIndex;
+            Constants.SamplerIndex = SamplerIndex;
+            Constants.PyramidBufferIndex = Desc.BufferIndex;
+            Constants.DepthWidth = Desc.DepthWidth;
+            Constants.DepthHeight = Desc.DepthHeight;
+            Constants.PyramidWidth = Desc.Width;
+            Constants.PyramidHeight = Desc.Height;
+
+            vkCmdBindPipeline(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+            BindlessHeap->Bind(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout);
+            for(uint32_t Level = 0; Level < Desc.LevelCount; Level++)
+            {
+                // Each level reduces the one before it
+                if(Level > 0)
+                {
+                    VkBufferMemoryBarrier LevelBarrier = {};
+                    LevelBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                    LevelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                    LevelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                    LevelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    LevelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    LevelBarrier.buffer = Buffer;
+                    LevelBarrier.size = VK_WHOLE_SIZE;
+                    vkCmdPipelineBarrier(Context.CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+                        1, &LevelBarrier, 0, nullptr);
+                }
+
+                Constants.Level = Level;
+                vkCmdPushConstants(Context.CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FDepthPyramidBuildConstants), &Constants);
+                vkCmdDispatch(Context.CommandBuffer, (GetLevelSize(Desc.Width, Level) + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+                    (GetLevelSize(Desc.Height, Level) + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+            }
+        });
+    return Desc;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+#include "RenderGraph.h"
+#include "RendererSettings.h"
+
+class FBindlessHeap;
+class FPipelineStateCache;
+
+// A frame's pyramid as the culling passes see it
+struct FDepthPyramidDesc
+{
+    FRenderGraphBuffer Buffer;
+    uint32_t BufferIndex;
+    // Size of level 0, half the depth buffer rounded up
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t LevelCount;
+    uint32_t DepthWidth;
+    uint32_t DepthHeight;
+
+    FDepthPyramidDesc() : BufferIndex(BINDLESS_INVALID_INDEX), Width(0), Height(0), LevelCount(0), DepthWidth(0), DepthHeight(0) {}
+};
+
+// Min/max depth mip chain for occlusion culling, see Shaders/DepthPyramid.glsl. Levels are packed one after the other in
+// a storage buffer rather than the mips of an image, the graph only tracks single level textures. Every texel of level L
+// covers exactly 2^(L+1) depth pixels on each axis, so a rectangle of pixels maps to at most 2x2 texels of some level.
+// Each frame in flight builds its own pyramid, reallocated on its next use after a resize.
+class FDepthPyramid
+{
+public:
+    FDepthPyramid();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+        VkPipelineLayout InPipelineLayout);
+    void Shutdown();
+
+    // Adds the compute pass reducing Depth into the frame's pyramid, one dispatch per level. The frame's previous
+    // work must be complete.
+    FDepthPyramidDesc AddBuildPass(FRenderGraph& RenderGraph, FRenderGraphTexture Depth, uint32_t DepthWidth, uint32_t DepthHeight,
+        uint32_t FrameIndex, uint32_t SamplerIndex);
+
+private:
+    struct FFramePyramid
+    {
+        VkBuffer Buffer;
+        VkDeviceMemory Memory;
+        FDepthPyramidDesc Desc;
+    };
+
+    void Allocate(FFramePyramid& Pyramid, uint32_t DepthWidth, uint32_t DepthHeight);
+    void Release(FFramePyramid& Pyramid);
+
+private:
+    VkDevice Device;
+    VkPhysicalDevice PhysicalDevice;
+    FBindlessHeap* BindlessHeap;
+    VkPipelineLayout PipelineLayout;
+    VkPipeline Pipeline;
+    FFramePyramid Frames[MAX_FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,144 @@
+#include "DrawSort.h"
+#include <algorithm>
+#include <functional>
+#include "JobSystem.h"
+
+#define DRAW_SORT_RADIX_BITS 8
+#define DRAW_SORT_BUCKETS (1u << DRAW_SORT_RADIX_BITS)
+#define DRAW_SORT_DIGITS (64 / DRAW_SORT_RADIX_BITS)
+// Keys per job, a smaller list is sorted on the calling thread
+#define DRAW_SORT_CHUNK_SIZE 16384
+
+static_assert(DRAW_SORT_MATERIAL_BITS + DRAW_SORT_MESH_BITS + DRAW_SORT_DEPTH_BITS == 64, "Draw sort key fields must fill 64 bits");
+
+static inline uint64_t GetFieldBits(uint32_t Value, uint32_t Bits)
+{
+    return static_cast<uint64_t>(Value) & ((1ull << Bits) - 1);
+}
+
+uint64_t MakeDrawSortKey(uint32_t Material, uint32_t Mesh, float Depth)
+{
+    const float MaxDepth = static_cast<float>((1u << DRAW_SORT_DEPTH_BITS) - 1);
+    const uint32_t QuantizedDepth = static_cast<uint32_t>(std::clamp(Depth, 0.0f, 1.0f) * MaxDepth + 0.5f);
+    uint64_t Key = GetFieldBits(Material, DRAW_SORT_MATERIAL_BITS);
+    Key = (Key << DRAW_SORT_MESH_BITS) | GetFieldBits(Mesh, DRAW_SORT_MESH_BITS);
+    Key = (Key << DRAW_SORT_DEPTH_BITS) | GetFieldBits(QuantizedDepth, DRAW_SORT_DEPTH_BITS);
+    return Key;
+}
+
+static inline uint32_t GetDigit(uint64_t Key, uint32_t Digit)
+{
+    return static_cast<uint32_t>(Key >> (Digit * DRAW_SORT_RADIX_BITS)) & (DRAW_SORT_BUCKETS - 1);
+}
+
+static void RunChunks(uint32_t ChunkCount, const std::function<void(uint32_t)>& Body)
+{
+    if(ChunkCount > 1)
+    {
+        FJobSystem::Get().ParallelFor(ChunkCount, Body);
+        return;
+    }
+    Body(0);
+}
+
+void RadixSortDrawKeys(std::vector<uint64_t>& Keys, std::vector<uint32_t>& Values, std::vector<uint64_t>& ScratchKeys,
+    std::vector<uint32_t>& ScratchValues, bool bParallel)
+{
+    SCOPED_ZONE("RadixSortDrawKeys");
+    check(Keys.size() == Values.size());
+    const uint32_t Count = static_cast<uint32_t>(Keys.size());
+    if(Count < 2) return;
+    ScratchKeys.resize(Count);
+    ScratchValues.resize(Count);
+
+    const uint32_t ChunkCount = bParallel ? (Count + DRAW_SORT_CHUNK_SIZE - 1) / DRAW_SORT_CHUNK_SIZE : 1;
+    const uint32_t ChunkSize = (Count + ChunkCount - 1) / ChunkCount;
+
+    // Every digit counted in one read of the keys, a digit whose keys all fall in one bucket wouldn't move anything
+    std::vector<uint32_t> DigitCounts(static_cast<size_t>(ChunkCount) * DRAW_SORT_DIGITS * DRAW_SORT_BUCKETS, 0);
+    RunChunks(ChunkCount, [&Keys, &DigitCounts, ChunkSize, Count](uint32_t Chunk)
+    {
+        uint32_t* ChunkCounts = &DigitCounts[static_cast<size_t>(Chunk) * DRAW_SORT_DIGITS * DRAW_SORT_BUCKETS];
+        const uint32_t End = std::min((Chunk + 1) * ChunkSize, Count);
+        for(uint32_t i = Chunk * ChunkSize; i < End; i++)
+        {
+            for(uint32_t Digit = 0; Digit < DRAW_SORT_DIGITS; Digit++)
+            {
+                ChunkCounts[Digit * DRAW_SORT_BUCKETS + GetDigit(Keys[i], Digit)]++;
+            }
+        }
+    });
+    bool bDigitSorts[DRAW_SORT_DIGITS];
+    for(uint32_t Digit = 0; Digit < DRAW_SORT_DIGITS; Digit++)
+    {
+        bDigitSorts[Digit] = true;
+        for(uint32_t Bucket = 0; Bucket < DRAW_SORT_BUCKETS && bDigitSorts[Digit]; Bucket++)
+        {
+            uint32_t Total = 0;
+            for(uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+            {
+                Total += DigitCounts[(static_cast<size_t>(Chunk) * DRAW_SORT_DIGITS + Digit) * DRAW_SORT_BUCKETS + Bucket];
+            }
+            bDigitSorts[Digit] = Total != Count;
+        }
+    }
+
+    // [chunk][bucket] counts of the digit being sorted, then where the chunk writes each bucket
+    std::vector<uint32_t> Offsets(static_cast<size_t>(ChunkCount) * DRAW_SORT_BUCKETS);
+    bool bFirstPass = true;
+    for(uint32_t Digit = 0; Digit < DRAW_SORT_DIGITS; Digit++)
+    {
+        if(!bDigitSorts[Digit]) continue;
+
+        // The first pass reads the keys in their original order, the counts of the first read still hold
+        if(bFirstPass)
+        {
+            for(uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+            {
+                std::copy_n(&DigitCounts[(static_cast<size_t>(Chunk) * DRAW_SORT_DIGITS + Digit) * DRAW_SORT_BUCKETS], DRAW_SORT_BUCKETS,
+                    &Offsets[static_cast<size_t>(Chunk) * DRAW_SORT_BUCKETS]);
+            }
+            bFirstPass = false;
+        }
+        else
+        {
+            RunChunks(ChunkCount, [&Keys, &Offsets, Digit, ChunkSize, Count](uint32_t Chunk)
+            {
+                uint32_t* ChunkCounts = &Offsets[static_cast<size_t>(Chunk) * DRAW_SORT_BUCKETS];
+                std::fill_n(ChunkCounts, DRAW_SORT_BUCKETS, 0u);
+                const uint32_t End = std::min((Chunk + 1) * ChunkSize, Count);
+                for(uint32_t i = Chunk * ChunkSize; i < End; i++)
+                {
+                    ChunkCounts[GetDigit(Keys[i], Digit)]++;
+                }
+            });
+        }
+
+        // Bucket by bucket, chunks in order within a bucket: equal digits keep their relative order
+        uint32_t Offset = 0;
+        for(uint32_t Bucket = 0; Bucket < DRAW_SORT_BUCKETS; Bucket++)
+        {
+            for(uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+            {
+                uint32_t& ChunkOffset = Offsets[static_cast<size_t>(Chunk) * DRAW_SORT_BUCKETS + Bucket];
+                const uint32_t BucketCount = ChunkOffset;
+                ChunkOffset = Offset;
+                Offset += BucketCount;
+            }
+        }
+
+        RunChunks(ChunkCount, [&Keys, &Values, &ScratchKeys, &ScratchValues, &Offsets, Digit, ChunkSize, Count](uint32_t Chunk)
+        {
+            uint32_t* ChunkOffsets = &Offsets[static_cast<size_t>(Chunk) * DRAW_SORT_BUCKETS];
+            const uint32_t End = std::min((Chunk + 1) * ChunkSize, Count);
+            for(uint32_t i = Chunk * ChunkSize; i < End; i++)
+            {
+                const uint32_t Destination = ChunkOffsets[GetDigit(Keys[i], Digit)]++;
+                ScratchKeys[Destination] = Keys[i];
+                ScratchValues[Destination] = Values[i];
+            }
+        });
+        Keys.swap(ScratchKeys);
+        Values.swap(ScratchValues);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MinimalCore.h"
+
+// Bits of each field of a draw sort key, from the most significant: material, mesh, then depth. Sorting the keys groups
+// draws by the state that is the most expensive to change and orders each group front to back. Sorted draws all go
+// through one pass and pipeline, a key field for either would never vary.
+#define DRAW_SORT_MATERIAL_BITS 20
+#define DRAW_SORT_MESH_BITS 20
+#define DRAW_SORT_DEPTH_BITS 24
+
+// Identifiers wider than their field wrap around, draws still come out grouped, only less tightly
+uint64_t MakeDrawSortKey(uint32_t Material, uint32_t Mesh, float Depth);
+
+// Reorders Keys in increasing order and Values with them. Least significant digit first, 8 bits per pass, passes where
+// every key has the same digit are skipped, so fields that don't vary cost a single histogram. Large counts build their
+// histograms and scatter over the job system, each chunk keeps its range of every bucket so the sort stays stable.
+// Scratch arrays are resized as needed, kept by the caller so a frame's sort doesn't allocate.
+void RadixSortDrawKeys(std::vector<uint64_t>& Keys, std::vector<uint32_t>& Values, std::vector<uint64_t>& ScratchKeys,
+    std::vector<uint32_t>& ScratchValues, bool bParallel = true);
@@ -9,6 +9,7 @@ bool FFbxImport::GetStaticMeshData(
     std::vector<FStaticVertex>& Vertices,
     std::vector<uint32_t>& Indices)
 {
+    SCOPED_ZONE("FFbxImport::GetStaticMeshData");
     Vertices.clear();
     Indices.clear();
     
@@ -0,0 +1,95 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <numeric>
+#include "MinimalCore.h"
+
+FFrameStats::FFrameStats()
+{
+    ReportInterval = 0.0f;
+    ModeName = "";
+}
+
+void FFrameStats::Init(float InReportInterval, const char* InModeName)
+{
+    ReportInterval = InReportInterval;
+    ModeName = InModeName;
+    FrameTimes.clear();
+    FenceWaits.clear();
+    PresentLatencies.clear();
+    GpuLatencies.clear();
+    RecordTimes.clear();
+    RecreateTimes.clear();
+    RecreateFrameTimes.clear();
+    LastReport = std::chrono::steady_clock::now();
+}
+
+void FFrameStats::AddFrame(const FFrameTiming& Timing)
+{
+    if(ReportInterval <= 0.0f) return;
+
+    FrameTimes.push_back(Timing.FrameMs);
+    FenceWaits.push_back(Timing.FenceWaitMs);
+    PresentLatencies.push_back(Timing.InputToPresentMs);
+    GpuLatencies.push_back(Timing.InputToGpuDoneMs);
+    RecordTimes.push_back(Timing.RecordMs);
+    if(Timing.SwapChainRecreateMs > 0.0)
+    {
+        RecreateTimes.push_back(Timing.SwapChainRecreateMs);
+        RecreateFrameTimes.push_back(Timing.FrameMs);
+    }
+
+    const auto Now = std::chrono::steady_clock::now();
+    if(std::chrono::duration<float>(Now - LastReport).count() >= ReportInterval)
+    {
+        Report();
+        LastReport = Now;
+    }
+}
+
+FFrameStats::FSummary FFrameStats::Summarize(std::vector<double>& Samples)
+{
+    FSummary Summary = {};
+    Summary.Count = static_cast<uint32_t>(Samples.size());
+    if(Samples.empty()) return Summary;
+
+    std::sort(Samples.begin(), Samples.end());
+    auto Percentile = [&Samples](double P)
+    {
+        const size_t Index = static_cast<size_t>(P * static_cast<double>(Samples.size() - 1) + 0.5);
+        return Samples[std::min(Index, Samples.size() - 1)];
+    };
+
+    Summary.Mean = std::accumulate(Samples.begin(), Samples.end(), 0.0) / static_cast<double>(Samples.size());
+    Summary.P50 = Percentile(0.50);
+    Summary.P95 = Percentile(0.95);
+    Summary.P99 = Percentile(0.99);
+    Summary.Max = Samples.back();
+    return Summary;
+}
+
+void FFrameStats::Report()
+{
+    const FSummary Frame = Summarize(FrameTimes);
+    const FSummary Wait = Summarize(FenceWaits);
+    const FSummary Present = Summarize(PresentLatencies);
+    const FSummary Gpu = Summarize(GpuLatencies);
+    const FSummary Record = Summarize(RecordTimes);
+    LOG_Info("Frame time (%s, %u frames): mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, fence wait mean %.2f ms, record mean %.2f ms, %.1f fps",
+        ModeName, Frame.Count, Frame.Mean, Frame.P50, Frame.P95, Frame.P99, Frame.Max, Wait.Mean, Record.Mean, Frame.Mean > 0.0 ? 1000.0 / Frame.Mean : 0.0);
+    LOG_Info("Input latency (%s): to present mean %.2f ms p95 %.2f ms, to GPU done mean %.2f ms p95 %.2f ms",
+        ModeName, Present.Mean, Present.P95, Gpu.Mean, Gpu.P95);
+    if(!RecreateTimes.empty())
+    {
+        const FSummary Recreate = Summarize(RecreateTimes);
+        const FSummary Hitch = Summarize(RecreateFrameTimes);
+        LOG_Info("Swapchain recreated %u times: mean %.2f ms, max %.2f ms, resize frame time mean %.2f ms, max %.2f ms",
+            Recreate.Count, Recreate.Mean, Recreate.Max, Hitch.Mean, Hitch.Max);
+    }
+    FrameTimes.clear();
+    FenceWaits.clear();
+    PresentLatencies.clear();
+    GpuLatencies.clear();
+    RecordTimes.clear();
+    RecreateTimes.clear();
+    RecreateFrameTimes.clear();
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// CPU side timings of one frame, in milliseconds
+struct FFrameTiming
+{
+    // Time since the previous frame ended
+    double FrameMs;
+    // Blocked on the frame fence before recording
+    double FenceWaitMs;
+    // Input sampling to vkQueuePresentKHR returning
+    double InputToPresentMs;
+    // Input sampling to the frame fence being seen signaled, exact with one frame in flight, an upper bound otherwise
+    double InputToGpuDoneMs;
+    // Recording the scene's draws, parallel when more than one record thread is used
+    double RecordMs;
+    // Recreating the swapchain and its size dependent targets, 0 unless the window was resized
+    double SwapChainRecreateMs;
+
+    FFrameTiming() : FrameMs(0.0), FenceWaitMs(0.0), InputToPresentMs(0.0), InputToGpuDoneMs(0.0), RecordMs(0.0), SwapChainRecreateMs(0.0) {}
+};
+
+// What a frame submitted, for benchmarks
+struct FFrameCounters
+{
+    uint32_t Draws;
+    uint64_t Triangles;
+    // Transient buffer memory the frame allocated
+    uint64_t TransientBytes;
+    // Render graph texture memory after aliasing, and what the driver committed of its lazily allocated part
+    uint64_t TransientTextureBytes;
+    uint64_t LazyCommittedBytes;
+    // Render graph passes that ran on the async compute queue
+    uint32_t AsyncComputePasses;
+    uint32_t Lights;
+    // Mesh instances and how many culling rejected. GPU culling reports the frame that last used the frame in flight's resources.
+    uint32_t Instances;
+    uint32_t FrustumCulled;
+    uint32_t OcclusionCulled;
+    // State changes of CPU recorded draws, each secondary command buffer binds its pipeline and first mesh again. Every
+    // CPU recorded draw shares one pipeline, the draw order only changes the index buffer binds and material changes.
+    uint32_t PipelineBinds;
+    uint32_t IndexBufferBinds;
+    uint32_t MaterialChanges;
+    // Shadow cascades rendered whole, cached ones scrolled by the texels the view uncovered, and caster draws of both
+    uint32_t ShadowCascadesRendered;
+    uint32_t ShadowCascadesScrolled;
+    uint32_t ShadowDraws;
+
+    FFrameCounters() : Draws(0), Triangles(0), TransientBytes(0), TransientTextureBytes(0), LazyCommittedBytes(0), AsyncComputePasses(0),
+        Lights(0), Instances(0), FrustumCulled(0), OcclusionCulled(0), PipelineBinds(0), IndexBufferBinds(0), MaterialChanges(0),
+        ShadowCascadesRendered(0), ShadowCascadesScrolled(0), ShadowDraws(0) {}
+};
+
+// Frame time and latency statistics reported to the log at a fixed interval.
+// With enough frames in flight the fence wait drops to ~0 and the frame time to max(CPU, GPU) instead of their sum,
+// at the cost of input latency.
+class FFrameStats
+{
+public:
+    struct FSummary
+    {
+        uint32_t Count;
+        double Mean;
+        double P50;
+        double P95;
+        double P99;
+        double Max;
+    };
+
+    FFrameStats();
+
+    void Init(float InReportInterval, const char* InModeName);
+    void AddFrame(const FFrameTiming& Timing);
+
+    // Sorts Samples in place
+    static FSummary Summarize(std::vector<double>& Samples);
+
+private:
+    void Report();
+
+private:
+    float ReportInterval;
+    const char* ModeName;
+    std::vector<double> FrameTimes;
+    std::vector<double> FenceWaits;
+    std::vector<double> PresentLatencies;
+    std::vector<double> GpuLatencies;
+    std::vector<double> RecordTimes;
+    // Only frames that recreated the swapchain, their frame time is the hitch a resize causes
+    std::vector<double> RecreateTimes;
+    std::vector<double> RecreateFrameTimes;
+    std::chrono::steady_clock::time_point LastReport;
+};
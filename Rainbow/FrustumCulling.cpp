@@ -0,0 +1,267 @@
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <immintrin.h>
+#include <glm/glm.hpp>
+#include "JobSystem.h"
+
+// Objects per job, a multiple of every FRUSTUM_CULLING_WIDTH. Small enough to spread 100k objects over the workers,
+// large enough that a job is not dominated by its scheduling.
+#define FRUSTUM_CULLING_CHUNK_SIZE 4096
+
+#if FRUSTUM_CULLING_WIDTH == 8
+typedef __m256 FCullingVector;
+static inline FCullingVector VectorLoad(const float* Data) { return _mm256_loadu_ps(Data); }
+static inline FCullingVector VectorSet(float Value) { return _mm256_set1_ps(Value); }
+static inline FCullingVector VectorAdd(FCullingVector A, FCullingVector B) { return _mm256_add_ps(A, B); }
+static inline FCullingVector VectorMul(FCullingVector A, FCullingVector B) { return _mm256_mul_ps(A, B); }
+static inline FCullingVector VectorAnd(FCullingVector A, FCullingVector B) { return _mm256_and_ps(A, B); }
+static inline FCullingVector VectorGreaterEqual(FCullingVector A, FCullingVector B) { return _mm256_cmp_ps(A, B, _CMP_GE_OQ); }
+static inline uint32_t VectorMask(FCullingVector A) { return static_cast<uint32_t>(_mm256_movemask_ps(A)); }
+static inline FCullingVector VectorAllOnes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+#else
+typedef __m128 FCullingVector;
+static inline FCullingVector VectorLoad(const float* Data) { return _mm_loadu_ps(Data); }
+static inline FCullingVector VectorSet(float Value) { return _mm_set1_ps(Value); }
+static inline FCullingVector VectorAdd(FCullingVector A, FCullingVector B) { return _mm_add_ps(A, B); }
+static inline FCullingVector VectorMul(FCullingVector A, FCullingVector B) { return _mm_mul_ps(A, B); }
+static inline FCullingVector VectorAnd(FCullingVector A, FCullingVector B) { return _mm_and_ps(A, B); }
+static inline FCullingVector VectorGreaterEqual(FCullingVector A, FCullingVector B) { return _mm_cmpge_ps(A, B); }
+static inline uint32_t VectorMask(FCullingVector A) { return static_cast<uint32_t>(_mm_movemask_ps(A)); }
+static inline FCullingVector VectorAllOnes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+#endif
+
+// One plane's components broadcast to every lane, with the absolute normal the box extent is projected on
+struct FCullingPlane
+{
+    FCullingVector X;
+    FCullingVector Y;
+    FCullingVector Z;
+    FCullingVector W;
+    FCullingVector AbsX;
+    FCullingVector AbsY;
+    FCullingVector AbsZ;
+};
+
+static glm::vec4 NormalizePlane(const glm::vec4& Plane)
+{
+    return Plane / glm::length(glm::vec3(Plane));
+}
+
+FFrustum FFrustum::FromViewProjection(const glm::mat4& ViewProjection)
+{
+    // glm is column major, row i of the matrix is (M[0][i], M[1][i], M[2][i], M[3][i])
+    const glm::mat4 Rows = glm::transpose(ViewProjection);
+    FFrustum Frustum;
+    Frustum.Planes[0] = NormalizePlane(Rows[3] + Rows[0]);
+    Frustum.Planes[1] = NormalizePlane(Rows[3] - Rows[0]);
+    Frustum.Planes[2] = NormalizePlane(Rows[3] + Rows[1]);
+    Frustum.Planes[3] = NormalizePlane(Rows[3] - Rows[1]);
+    // Depth starts at 0 in Vulkan, not at -w
+    Frustum.Planes[4] = NormalizePlane(Rows[2]);
+    Frustum.Planes[5] = NormalizePlane(Rows[3] - Rows[2]);
+    return Frustum;
+}
+
+FCullingBounds::FCullingBounds()
+{
+    Count = 0;
+}
+
+void FCullingBounds::Reserve(uint32_t InCount)
+{
+    const uint32_t PaddedCount = (InCount + FRUSTUM_CULLING_WIDTH - 1) / FRUSTUM_CULLING_WIDTH * FRUSTUM_CULLING_WIDTH;
+    for(std::vector<float>* Component : {&SphereX, &SphereY, &SphereZ, &SphereRadius, &BoxX, &BoxY, &BoxZ, &ExtentX, &ExtentY, &ExtentZ})
+    {
+        Component->reserve(PaddedCount);
+    }
+}
+
+void FCullingBounds::Clear()
+{
+    for(std::vector<float>* Component : {&SphereX, &SphereY, &SphereZ, &SphereRadius, &BoxX, &BoxY, &BoxZ, &ExtentX, &ExtentY, &ExtentZ})
+    {
+        Component->clear();
+    }
+    Count = 0;
+}
+
+uint32_t FCullingBounds::Add(const glm::vec4& Sphere, const glm::vec3& BoxCenter, const glm::vec3& BoxExtent)
+{
+    // Grows by a whole padded group at once. Padding has an infinitely negative radius, the sphere test always fails.
+    if(Count == GetPaddedCount())
+    {
+        for(uint32_t i = 0; i < FRUSTUM_CULLING_WIDTH; i++)
+        {
+            for(std::vector<float>* Component : {&SphereX, &SphereY, &SphereZ, &BoxX, &BoxY, &BoxZ, &ExtentX, &ExtentY, &ExtentZ})
+            {
+                Component->push_back(0.0f);
+            }
+            SphereRadius.push_back(-std::numeric_limits<float>::infinity());
+        }
+    }
+
+    SphereX[Count] = Sphere.x;
+    SphereY[Count] = Sphere.y;
+    SphereZ[Count] = Sphere.z;
+    SphereRadius[Count] = Sphere.w;
+    BoxX[Count] = BoxCenter.x;
+    BoxY[Count] = BoxCenter.y;
+    BoxZ[Count] = BoxCenter.z;
+    ExtentX[Count] = BoxExtent.x;
+    ExtentY[Count] = BoxExtent.y;
+    ExtentZ[Count] = BoxExtent.z;
+    return Count++;
+}
+
+// Culls [Begin, End) against every view, writing each view's visible indices from OutVisible[View] on.
+// Indices are stored unconditionally and the cursor only advances for visible ones, there is no branch per object.
+static void CullRange(const FCullingBounds& Bounds, const FCullingPlane (*Planes)[6], uint32_t ViewCount, uint32_t Begin, uint32_t End,
+    uint32_t** OutVisible, uint32_t* OutCounts)
+{
+    for(uint32_t View = 0; View < ViewCount; View++)
+    {
+        OutCounts[View] = 0;
+    }
+
+    const FCullingVector Zero = VectorSet(0.0f);
+    for(uint32_t Base = Begin; Base < End; Base += FRUSTUM_CULLING_WIDTH)
+    {
+        const FCullingVector SphereX = VectorLoad(&Bounds.SphereX[Base]);
+        const FCullingVector SphereY = VectorLoad(&Bounds.SphereY[Base]);
+        const FCullingVector SphereZ = VectorLoad(&Bounds.SphereZ[Base]);
+        const FCullingVector SphereRadius = VectorLoad(&Bounds.SphereRadius[Base]);
+        const FCullingVector BoxX = VectorLoad(&Bounds.BoxX[Base]);
+        const FCullingVector BoxY = VectorLoad(&Bounds.BoxY[Base]);
+        const FCullingVector BoxZ = VectorLoad(&Bounds.BoxZ[Base]);
+        const FCullingVector ExtentX = VectorLoad(&Bounds.ExtentX[Base]);
+        const FCullingVector ExtentY = VectorLoad(&Bounds.ExtentY[Base]);
+        const FCullingVector ExtentZ = VectorLoad(&Bounds.ExtentZ[Base]);
+
+        for(uint32_t View = 0; View < ViewCount; View++)
+        {
+            FCullingVector Inside = VectorAllOnes();
+            for(uint32_t p = 0; p < 6; p++)
+            {
+                const FCullingPlane& Plane = Planes[View][p];
+                // Sphere: signed distance of the center no further out than the radius
+                const FCullingVector SphereDistance = VectorAdd(VectorAdd(VectorMul(Plane.X, SphereX), VectorMul(Plane.Y, SphereY)),
+                    VectorAdd(VectorMul(Plane.Z, SphereZ), Plane.W));
+                // Box: distance of the center plus the extent projected on the normal, the distance of its most inside corner
+                const FCullingVector BoxDistance = VectorAdd(VectorAdd(VectorMul(Plane.X, BoxX), VectorMul(Plane.Y, BoxY)),
+                    VectorAdd(VectorMul(Plane.Z, BoxZ), Plane.W));
+                const FCullingVector BoxRadius = VectorAdd(VectorAdd(VectorMul(Plane.AbsX, ExtentX), VectorMul(Plane.AbsY, ExtentY)),
+                    VectorMul(Plane.AbsZ, ExtentZ));
+                Inside = VectorAnd(Inside, VectorGreaterEqual(VectorAdd(SphereDistance, SphereRadius), Zero));
+                Inside = VectorAnd(Inside, VectorGreaterEqual(VectorAdd(BoxDistance, BoxRadius), Zero));
+            }
+
+            const uint32_t Mask = VectorMask(Inside);
+            uint32_t* Visible = OutVisible[View];
+            uint32_t VisibleCount = OutCounts[View];
+            for(uint32_t Lane = 0; Lane < FRUSTUM_CULLING_WIDTH; Lane++)
+            {
+                Visible[VisibleCount] = Base + Lane;
+                VisibleCount += (Mask >> Lane) & 1;
+            }
+            OutCounts[View] = VisibleCount;
+        }
+    }
+}
+
+void CullFrustums(const FCullingBounds& Bounds, FCullingView* Views, uint32_t ViewCount, bool bParallel)
+{
+    checkf(ViewCount <= FRUSTUM_CULLING_MAX_VIEWS, "Too many views culled at once");
+
+    FCullingPlane Planes[FRUSTUM_CULLING_MAX_VIEWS][6];
+    for(uint32_t View = 0; View < ViewCount; View++)
+    {
+        for(uint32_t p = 0; p < 6; p++)
+        {
+            const glm::vec4& Plane = Views[View].Frustum.Planes[p];
+            Planes[View][p].X = VectorSet(Plane.x);
+            Planes[View][p].Y = VectorSet(Plane.y);
+            Planes[View][p].Z = VectorSet(Plane.z);
+            Planes[View][p].W = VectorSet(Plane.w);
+            Planes[View][p].AbsX = VectorSet(std::abs(Plane.x));
+            Planes[View][p].AbsY = VectorSet(std::abs(Plane.y));
+            Planes[View][p].AbsZ = VectorSet(std::abs(Plane.z));
+        }
+        // Padded so a chunk can store its indices at its own offset before they are moved together
+        Views[View].Visible.resize(Bounds.GetPaddedCount());
+    }
+
+    const uint32_t PaddedCount = Bounds.GetPaddedCount();
+    const uint32_t ChunkCount = (PaddedCount + FRUSTUM_CULLING_CHUNK_SIZE - 1) / FRUSTUM_CULLING_CHUNK_SIZE;
+    std::vector<uint32_t> ChunkCounts(static_cast<size_t>(ChunkCount) * FRUSTUM_CULLING_MAX_VIEWS);
+    auto CullChunk = [&Bounds, &Planes, Views, ViewCount, PaddedCount, &ChunkCounts](uint32_t Chunk)
+    {
+        const uint32_t Begin = Chunk * FRUSTUM_CULLING_CHUNK_SIZE;
+        const uint32_t End = std::min(Begin + FRUSTUM_CULLING_CHUNK_SIZE, PaddedCount);
+        uint32_t* Visible[FRUSTUM_CULLING_MAX_VIEWS];
+        for(uint32_t View = 0; View < ViewCount; View++)
+        {
+            Visible[View] = Views[View].Visible.data() + Begin;
+        }
+        CullRange(Bounds, Planes, ViewCount, Begin, End, Visible, &ChunkCounts[Chunk * FRUSTUM_CULLING_MAX_VIEWS]);
+    };
+
+    if(bParallel)
+    {
+        FJobSystem::Get().ParallelFor(ChunkCount, CullChunk);
+    }
+    else
+    {
+        for(uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+        {
+            CullChunk(Chunk);
+        }
+    }
+
+    for(uint32_t View = 0; View < ViewCount; View++)
+    {
+        uint32_t* Visible = Views[View].Visible.data();
+        uint32_t VisibleCount = 0;
+        for(uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+        {
+            const uint32_t ChunkVisible = ChunkCounts[Chunk * FRUSTUM_CULLING_MAX_VIEWS + View];
+            if(VisibleCount != Chunk * FRUSTUM_CULLING_CHUNK_SIZE)
+            {
+                std::memmove(Visible + VisibleCount, Visible + Chunk * FRUSTUM_CULLING_CHUNK_SIZE, ChunkVisible * sizeof(uint32_t));
+            }
+            VisibleCount += ChunkVisible;
+        }
+        Views[View].Visible.resize(VisibleCount);
+    }
+}
+
+void CullFrustumsScalar(const FCullingBounds& Bounds, FCullingView* Views, uint32_t ViewCount)
+{
+    for(uint32_t View = 0; View < ViewCount; View++)
+    {
+        Views[View].Visible.clear();
+    }
+
+    for(uint32_t i = 0; i < Bounds.Count; i++)
+    {
+        for(uint32_t View = 0; View < ViewCount; View++)
+        {
+            bool bInside = true;
+            for(uint32_t p = 0; p < 6 && bInside; p++)
+            {
+                const glm::vec4& Plane = Views[View].Frustum.Planes[p];
+                // Same association as CullRange, the benchmark compares the visible lists exactly
+                const float SphereDistance = (Plane.x * Bounds.SphereX[i] + Plane.y * Bounds.SphereY[i]) + (Plane.z * Bounds.SphereZ[i] + Plane.w);
+                const float BoxDistance = (Plane.x * Bounds.BoxX[i] + Plane.y * Bounds.BoxY[i]) + (Plane.z * Bounds.BoxZ[i] + Plane.w);
+                const float BoxRadius = (std::abs(Plane.x) * Bounds.ExtentX[i] + std::abs(Plane.y) * Bounds.ExtentY[i]) + std::abs(Plane.z) * Bounds.ExtentZ[i];
+                bInside = SphereDistance + Bounds.SphereRadius[i] >= 0.0f && BoxDistance + BoxRadius >= 0.0f;
+            }
+            if(bInside)
+            {
+                Views[View].Visible.push_back(i);
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "MinimalCore.h"
+
+// Objects tested per iteration: 8 when built with AVX2, otherwise 4 with the SSE2 every x64 CPU has
+#if defined(__AVX2__)
+#define FRUSTUM_CULLING_WIDTH 8
+#else
+#define FRUSTUM_CULLING_WIDTH 4
+#endif
+
+// Views culled in one pass over the bounds, the main view and its shadow cascades
+#define FRUSTUM_CULLING_MAX_VIEWS 8
+
+// Six planes with inward facing normalized normals, a point is inside when dot(Plane.xyz, Point) + Plane.w >= 0
+struct FFrustum
+{
+    glm::vec4 Planes[6];
+
+    // Clip volume of a Vulkan projection: x and y in [-w, w], z in [0, w]. The identity is the clip space actors are placed in.
+    static FFrustum FromViewProjection(const glm::mat4& ViewProjection);
+};
+
+// World space bounds of every object in structure of arrays form, the culling loop loads one component of
+// FRUSTUM_CULLING_WIDTH objects per instruction. Boxes are axis aligned and kept as center and half size, what the plane
+// test needs. Arrays are padded to a multiple of FRUSTUM_CULLING_WIDTH with entries that are never visible.
+struct FCullingBounds
+{
+    std::vector<float> SphereX;
+    std::vector<float> SphereY;
+    std::vector<float> SphereZ;
+    std::vector<float> SphereRadius;
+    std::vector<float> BoxX;
+    std::vector<float> BoxY;
+    std::vector<float> BoxZ;
+    std::vector<float> ExtentX;
+    std::vector<float> ExtentY;
+    std::vector<float> ExtentZ;
+    uint32_t Count;
+
+    FCullingBounds();
+
+    void Reserve(uint32_t InCount);
+    void Clear();
+    // Returns the object's index, the one visible lists refer to
+    uint32_t Add(const glm::vec4& Sphere, const glm::vec3& BoxCenter, const glm::vec3& BoxExtent);
+    uint32_t GetPaddedCount() const { return static_cast<uint32_t>(SphereRadius.size()); }
+};
+
+struct FCullingView
+{
+    FFrustum Frustum;
+    // Indices of the objects whose sphere and box both intersect the frustum, in increasing order
+    std::vector<uint32_t> Visible;
+};
+
+// Tests every object against up to FRUSTUM_CULLING_MAX_VIEWS views in a single pass over the bounds, so each object is
+// loaded once whatever the number of views. Large counts are split into chunks run over the job system, each chunk
+// compacts its visible indices in place and the chunks are then moved together.
+void CullFrustums(const FCullingBounds& Bounds, FCullingView* Views, uint32_t ViewCount, bool bParallel = true);
+// One object at a time without SIMD, same result, the reference the culling microbenchmark compares against
+void CullFrustumsScalar(const FCullingBounds& Bounds, FCullingView* Views, uint32_t ViewCount);
@@ -0,0 +1,125 @@
+#include "GBufferLayout.h"
+#include <cstring>
+#include "MinimalCore.h"
+
+// Auto only picks the small layout from this many pixels on, below it normal precision is worth the bandwidth
+#define GBUFFER_SMALL_LAYOUT_MIN_PIXELS (3840u * 2160u)
+
+static const FGBufferLayout Layouts[] = {
+    { EGBufferLayout::Wide, "wide", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM,
+        EGBufferNormalEncoding::Float3, { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT } },
+    { EGBufferLayout::Compact, "compact", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+        EGBufferNormalEncoding::Octahedral, { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT } },
+    { EGBufferLayout::CompactPairs, "pairs", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+        EGBufferNormalEncoding::OctahedralPairs, { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT } },
+    { EGBufferLayout::Small, "small", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+        EGBufferNormalEncoding::Octahedral, { VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT } }
+};
+
+const FGBufferLayout& FGBufferLayout::Get(EGBufferLayout Type)
+{
+    for(const FGBufferLayout& Layout : Layouts)
+    {
+        if(Layout.Type == Type) return Layout;
+    }
+    return Layouts[0];
+}
+
+bool FGBufferLayout::Parse(const char* Value, EGBufferLayout& OutType)
+{
+    if(strcmp(Value, "auto") == 0)
+    {
+        OutType = EGBufferLayout::Auto;
+        return true;
+    }
+    for(const FGBufferLayout& Layout : Layouts)
+    {
+        if(strcmp(Value, Layout.Name) != 0) continue;
+
+        OutType = Layout.Type;
+        return true;
+    }
+    return false;
+}
+
+const FGBufferLayout& FGBufferLayout::Select(EGBufferLayout Requested, VkPhysicalDevice PhysicalDevice, uint32_t Width, uint32_t Height)
+{
+    if(Requested != EGBufferLayout::Auto)
+    {
+        const FGBufferLayout& Layout = Get(Requested);
+        if(Layout.IsSupported(PhysicalDevice)) return Layout;
+        LOG_Warning("GBuffer layout %s isn't supported by the device, picking one instead", Layout.Name);
+    }
+
+    VkPhysicalDeviceProperties Properties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+    // Integrated and mobile GPUs share memory bandwidth with the CPU, at 4K they can't afford more than 8 bytes of color
+    const bool bDiscrete = Properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+    const FGBufferLayout& Small = Get(EGBufferLayout::Small);
+    if(!bDiscrete && Width * Height >= GBUFFER_SMALL_LAYOUT_MIN_PIXELS && Small.IsSupported(PhysicalDevice)) return Small;
+
+    const FGBufferLayout& Compact = Get(EGBufferLayout::Compact);
+    if(Compact.IsSupported(PhysicalDevice)) return Compact;
+    // Only needs formats every device has to support as color attachments
+    return Get(EGBufferLayout::CompactPairs);
+}
+
+static bool IsColorAttachmentFormat(VkPhysicalDevice PhysicalDevice, VkFormat Format)
+{
+    VkFormatProperties FormatProperties;
+    vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &FormatProperties);
+    const VkFormatFeatureFlags Required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    return (FormatProperties.optimalTilingFeatures & Required) == Required;
+}
+
+bool FGBufferLayout::IsSupported(VkPhysicalDevice PhysicalDevice) const
+{
+    return IsColorAttachmentFormat(PhysicalDevice, BufferAFormat)
+        && IsColorAttachmentFormat(PhysicalDevice, BufferBFormat)
+        && IsColorAttachmentFormat(PhysicalDevice, BufferCFormat);
+}
+
+VkFormat FGBufferLayout::FindDepthFormat(VkPhysicalDevice PhysicalDevice) const
+{
+    // D16 is the only depth format every device supports
+    const VkFormat Fallbacks[] = { DepthFormats[0], DepthFormats[1], DepthFormats[2], VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM };
+    for(const VkFormat Format : Fallbacks)
+    {
+        VkFormatProperties FormatProperties;
+        vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &FormatProperties);
+        if(FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) return Format;
+    }
+    return VK_FORMAT_D16_UNORM;
+}
+
+uint32_t FGBufferLayout::GetColorBytesPerPixel() const
+{
+    return GetFormatSize(BufferAFormat) + GetFormatSize(BufferBFormat) + GetFormatSize(BufferCFormat);
+}
+
+uint32_t FGBufferLayout::GetFormatSize(VkFormat Format)
+{
+    switch(Format)
+    {
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_D16_UNORM:
+        return 2;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+        return 3;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+        return 4;
+    // Depth and stencil are separate planes on most devices
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return 5;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    default:
+        return 4;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+enum class EGBufferLayout : uint8_t
+{
+    // Picked from the device and the target resolution by FGBufferLayout::Select
+    Auto,
+    // RGBA8 albedo, RGBA16F normal, RGBA8 material, the original layout kept to compare against
+    Wide,
+    // RGBA8 albedo, RG16 octahedral normal, RGB10A2 material
+    Compact,
+    // Compact with the 16 bit octahedral normal split in RG8 pairs of an RGBA8 target, for devices without RG16 UNORM
+    // color attachments
+    CompactPairs,
+    // RGBA8 albedo, RG8 octahedral normal, RGB10A2 material, for high resolutions on bandwidth bound devices
+    Small
+};
+
+// Must match GBUFFER_NORMAL_* in Shaders/GBufferEncoding.glsl, passed to the shaders as specialization constant 0
+enum class EGBufferNormalEncoding : uint32_t
+{
+    Float3,
+    Octahedral,
+    OctahedralPairs
+};
+
+// Formats of the GBuffer targets and how the normal is stored in them. Shaders read the encoding from a specialization
+// constant, adding a layout is one more entry in the table and, for a new encoding, one more case in GBufferEncoding.glsl.
+struct FGBufferLayout
+{
+    EGBufferLayout Type;
+    const char* Name;
+    VkFormat BufferAFormat;
+    VkFormat BufferBFormat;
+    VkFormat BufferCFormat;
+    EGBufferNormalEncoding NormalEncoding;
+    // In order of preference, FindDepthFormat falls back to whatever the device has when none is supported
+    VkFormat DepthFormats[3];
+
+    static const FGBufferLayout& Get(EGBufferLayout Type);
+    // "auto", "wide", "compact", "pairs" or "small"
+    static bool Parse(const char* Value, EGBufferLayout& OutType);
+    // Resolves Auto, and requested layouts the device can't render to, for a Width x Height target
+    static const FGBufferLayout& Select(EGBufferLayout Requested, VkPhysicalDevice PhysicalDevice, uint32_t Width, uint32_t Height);
+
+    bool IsSupported(VkPhysicalDevice PhysicalDevice) const;
+    VkFormat FindDepthFormat(VkPhysicalDevice PhysicalDevice) const;
+    uint32_t GetColorBytesPerPixel() const;
+    static uint32_t GetFormatSize(VkFormat Format);
+};
@@ -0,0 +1,323 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cstdio>
+
+// Counters in FGpuPipelineStats order, results come back sorted by bit
+static const VkQueryPipelineStatisticFlags PipelineStatisticFlags =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+static const uint32_t PipelineStatisticCount = 5;
+
+FGpuProfiler::FGpuProfiler()
+{
+    Device = VK_NULL_HANDLE;
+    bEnabled = false;
+    bPipelineStatistics = false;
+    TimestampPeriod = 1.0;
+    TimestampMask = ~0ull;
+    FrameIndex = 0;
+    ResolvedFrames = 0;
+    Depth = 0;
+    bStatisticsActive = false;
+    ReportInterval = 0.0f;
+    FramesSinceReport = 0;
+    GpuToCpuOffsetUs = 0.0;
+    bHasGpuToCpuOffset = false;
+    CaptureFramesLeft = 0;
+    bCaptureStarted = false;
+}
+
+void FGpuProfiler::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, uint32_t QueueFamilyIndex, uint32_t FramesInFlight, bool bInPipelineStatistics, float InReportInterval)
+{
+    Device = InDevice;
+    ReportInterval = InReportInterval;
+    LastReport = std::chrono::steady_clock::now();
+
+    VkPhysicalDeviceProperties Properties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+    uint32_t QueueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> QueueFamilies(QueueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, QueueFamilies.data());
+
+    const uint32_t ValidBits = QueueFamilyIndex < QueueFamilyCount ? QueueFamilies[QueueFamilyIndex].timestampValidBits : 0;
+    if(ValidBits == 0 || Properties.limits.timestampPeriod <= 0.0f)
+    {
+        LOG_Warning("GPU profiler disabled, the graphics queue doesn't support timestamps");
+        return;
+    }
+
+    // Never assume nanosecond ticks, the period is what converts them
+    TimestampPeriod = Properties.limits.timestampPeriod;
+    TimestampMask = ValidBits >= 64 ? ~0ull : (1ull << ValidBits) - 1;
+    bPipelineStatistics = bInPipelineStatistics;
+
+    Frames.resize(FramesInFlight);
+    for(FFrameQueries& Frame : Frames)
+    {
+        VkQueryPoolCreateInfo PoolInfo = {};
+        PoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        PoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        PoolInfo.queryCount = GPU_PROFILER_MAX_SCOPES * 2;
+        if(vkCreateQueryPool(Device, &PoolInfo, nullptr, &Frame.TimestampPool) != VK_SUCCESS)
+        {
+            checkf(0, "FGpuProfiler: unable to create timestamp query pool");
+        }
+
+        Frame.StatisticsPool = VK_NULL_HANDLE;
+        if(bPipelineStatistics)
+        {
+            PoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            PoolInfo.queryCount = GPU_PROFILER_MAX_SCOPES;
+            PoolInfo.pipelineStatistics = PipelineStatisticFlags;
+            if(vkCreateQueryPool(Device, &PoolInfo, nullptr, &Frame.StatisticsPool) != VK_SUCCESS)
+            {
+                checkf(0, "FGpuProfiler: unable to create pipeline statistics query pool");
+            }
+        }
+        Frame.NumStatistics = 0;
+        Frame.CpuStartUs = 0.0;
+        Frame.bBegun = false;
+    }
+
+    bEnabled = true;
+    LOG_Info("GPU profiler: %u timestamp bits, %.3f ns per tick%s", ValidBits, TimestampPeriod, bPipelineStatistics ? ", pipeline statistics" : "");
+}
+
+void FGpuProfiler::Shutdown()
+{
+    for(FFrameQueries& Frame : Frames)
+    {
+        vkDestroyQueryPool(Device, Frame.TimestampPool, nullptr);
+        if(Frame.StatisticsPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(Device, Frame.StatisticsPool, nullptr);
+        }
+    }
+    Frames.clear();
+    bEnabled = false;
+}
+
+void FGpuProfiler::BeginFrame(VkCommandBuffer CommandBuffer, uint32_t InFrameIndex)
+{
+    if(!bEnabled) return;
+
+    FrameIndex = InFrameIndex;
+    FFrameQueries& Frame = Frames[FrameIndex];
+    if(!Frame.Scopes.empty())
+    {
+        ReadBack(Frame);
+    }
+    else if(Frame.bBegun && CaptureFramesLeft > 0)
+    {
+        CaptureFramesLeft--;
+    }
+    Frame.bBegun = true;
+
+    Frame.Scopes.clear();
+    Frame.NumStatistics = 0;
+    Frame.CpuStartUs = FChromeTrace::GetTimeUs();
+    Depth = 0;
+    bStatisticsActive = false;
+
+    vkCmdResetQueryPool(CommandBuffer, Frame.TimestampPool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+    if(Frame.StatisticsPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(CommandBuffer, Frame.StatisticsPool, 0, GPU_PROFILER_MAX_SCOPES);
+    }
+}
+
+uint32_t FGpuProfiler::BeginScope(VkCommandBuffer CommandBuffer, const char* Name, bool bStatistics)
+{
+    if(!bEnabled) return GPU_PROFILER_INVALID_SCOPE;
+
+    FFrameQueries& Frame = Frames[FrameIndex];
+    if(Frame.Scopes.size() >= GPU_PROFILER_MAX_SCOPES) return GPU_PROFILER_INVALID_SCOPE;
+
+    const uint32_t Scope = static_cast<uint32_t>(Frame.Scopes.size());
+    FScope NewScope;
+    NewScope.Name = Name;
+    NewScope.Depth = Depth++;
+    NewScope.StatisticsQuery = GPU_PROFILER_INVALID_SCOPE;
+
+    // Only one statistics query of a pool may be active at a time
+    if(bPipelineStatistics && bStatistics && !bStatisticsActive)
+    {
+        NewScope.StatisticsQuery = Frame.NumStatistics++;
+        vkCmdBeginQuery(CommandBuffer, Frame.StatisticsPool, NewScope.StatisticsQuery, 0);
+        bStatisticsActive = true;
+    }
+    Frame.Scopes.push_back(NewScope);
+
+    vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Frame.TimestampPool, Scope * 2);
+    return Scope;
+}
+
+void FGpuProfiler::EndScope(VkCommandBuffer CommandBuffer, uint32_t Scope)
+{
+    if(!bEnabled || Scope == GPU_PROFILER_INVALID_SCOPE) return;
+
+    FFrameQueries& Frame = Frames[FrameIndex];
+    vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, Frame.TimestampPool, Scope * 2 + 1);
+
+    const FScope& EndedScope = Frame.Scopes[Scope];
+    if(EndedScope.StatisticsQuery != GPU_PROFILER_INVALID_SCOPE)
+    {
+        vkCmdEndQuery(CommandBuffer, Frame.StatisticsPool, EndedScope.StatisticsQuery);
+        bStatisticsActive = false;
+    }
+    Depth--;
+}
+
+void FGpuProfiler::ReadBack(FFrameQueries& Frame)
+{
+    // No WAIT bit: the frame's ticket is complete so results are there, anything still unavailable is skipped
+    const uint32_t NumScopes = static_cast<uint32_t>(Frame.Scopes.size());
+    std::vector<uint64_t> Timestamps(NumScopes * 4);
+    vkGetQueryPoolResults(Device, Frame.TimestampPool, 0, NumScopes * 2, Timestamps.size() * sizeof(uint64_t), Timestamps.data(),
+        2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    const uint32_t StatisticsStride = PipelineStatisticCount + 1;
+    std::vector<uint64_t> Statistics(Frame.NumStatistics * StatisticsStride);
+    if(Frame.NumStatistics > 0)
+    {
+        vkGetQueryPoolResults(Device, Frame.StatisticsPool, 0, Frame.NumStatistics, Statistics.size() * sizeof(uint64_t), Statistics.data(),
+            StatisticsStride * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    }
+
+    const bool bCapture = CaptureFramesLeft > 0;
+    for(uint32_t i = 0; i < NumScopes; i++)
+    {
+        const FScope& Scope = Frame.Scopes[i];
+        const uint64_t* Result = &Timestamps[i * 4];
+        if(Result[1] == 0 || Result[3] == 0) continue;
+
+        const double DurationMs = static_cast<double>((Result[2] - Result[0]) & TimestampMask) * TimestampPeriod / 1000000.0;
+        FRollingAverage& Average = Averages[Scope.Name];
+        if(Average.Count == 0 && Average.Next == 0)
+        {
+            Average.Order = static_cast<uint32_t>(Averages.size());
+        }
+        Average.Samples[Average.Next] = DurationMs;
+        Average.Next = (Average.Next + 1) % GPU_PROFILER_AVERAGE_WINDOW;
+        Average.Count = std::min(Average.Count + 1, static_cast<uint32_t>(GPU_PROFILER_AVERAGE_WINDOW));
+
+        if(Scope.StatisticsQuery != GPU_PROFILER_INVALID_SCOPE)
+        {
+            const uint64_t* Counters = &Statistics[Scope.StatisticsQuery * StatisticsStride];
+            if(Counters[PipelineStatisticCount] != 0)
+            {
+                Average.LastStats.InputAssemblyPrimitives = Counters[0];
+                Average.LastStats.VertexShaderInvocations = Counters[1];
+                Average.LastStats.ClippingPrimitives = Counters[2];
+                Average.LastStats.FragmentShaderInvocations = Counters[3];
+                Average.LastStats.ComputeShaderInvocations = Counters[4];
+                Average.bHasStats = true;
+            }
+        }
+
+        if(bCapture)
+        {
+            const double StartUs = static_cast<double>(Result[0] & TimestampMask) * TimestampPeriod / 1000.0;
+            // The GPU can't have started before the CPU recorded the frame, push the mapping forward when it would
+            if(!bHasGpuToCpuOffset || StartUs + GpuToCpuOffsetUs < Frame.CpuStartUs)
+            {
+                GpuToCpuOffsetUs = Frame.CpuStartUs - StartUs;
+                bHasGpuToCpuOffset = true;
+            }
+
+            FTraceEvent Event;
+            Event.Name = Scope.Name;
+            Event.Category = "gpu";
+            Event.ProcessId = TRACE_PID_GPU;
+            Event.ThreadId = 0;
+            Event.StartUs = StartUs + GpuToCpuOffsetUs;
+            Event.DurationUs = DurationMs * 1000.0;
+            CapturedEvents.push_back(Event);
+        }
+    }
+
+    if(bCapture)
+    {
+        CaptureFramesLeft--;
+    }
+
+    ResolvedFrames++;
+    FramesSinceReport++;
+    const auto Now = std::chrono::steady_clock::now();
+    if(ReportInterval > 0.0f && std::chrono::duration<float>(Now - LastReport).count() >= ReportInterval)
+    {
+        Report();
+        FramesSinceReport = 0;
+        LastReport = Now;
+    }
+}
+
+double FGpuProfiler::GetAverageMs(const std::string& Name) const
+{
+    const auto Found = Averages.find(Name);
+    if(Found == Averages.end() || Found->second.Count == 0) return 0.0;
+
+    double Sum = 0.0;
+    for(uint32_t i = 0; i < Found->second.Count; i++)
+    {
+        Sum += Found->second.Samples[i];
+    }
+    return Sum / static_cast<double>(Found->second.Count);
+}
+
+double FGpuProfiler::GetLastMs(const std::string& Name) const
+{
+    const auto Found = Averages.find(Name);
+    if(Found == Averages.end() || Found->second.Count == 0) return 0.0;
+    return Found->second.Samples[(Found->second.Next + GPU_PROFILER_AVERAGE_WINDOW - 1) % GPU_PROFILER_AVERAGE_WINDOW];
+}
+
+void FGpuProfiler::StartCapture(uint32_t NumFrames)
+{
+    CapturedEvents.clear();
+    CaptureFramesLeft = NumFrames;
+    bCaptureStarted = true;
+}
+
+void FGpuProfiler::TakeCapturedEvents(std::vector<FTraceEvent>& OutEvents)
+{
+    OutEvents.insert(OutEvents.end(), CapturedEvents.begin(), CapturedEvents.end());
+    CapturedEvents.clear();
+    bCaptureStarted = false;
+}
+
+void FGpuProfiler::Report()
+{
+    std::vector<std::pair<uint32_t, const std::string*>> Ordered;
+    for(const auto& Entry : Averages)
+    {
+        Ordered.emplace_back(Entry.second.Order, &Entry.first);
+    }
+    std::sort(Ordered.begin(), Ordered.end());
+
+    std::string Line;
+    char Buffer[256];
+    for(const auto& Entry : Ordered)
+    {
+        snprintf(Buffer, sizeof(Buffer), "%s%s %.3f ms", Line.empty() ? "" : ", ", Entry.second->c_str(), GetAverageMs(*Entry.second));
+        Line += Buffer;
+    }
+    LOG_Info("GPU time (%u frames, last %u averaged): %s", FramesSinceReport, static_cast<uint32_t>(GPU_PROFILER_AVERAGE_WINDOW), Line.c_str());
+
+    for(const auto& Entry : Ordered)
+    {
+        const FRollingAverage& Average = Averages.at(*Entry.second);
+        if(!Average.bHasStats) continue;
+        LOG_Info("GPU stats %s: %llu primitives in, %llu clipped, %llu vertex invocations, %llu fragment invocations, %llu compute invocations",
+            Entry.second->c_str(),
+            static_cast<unsigned long long>(Average.LastStats.InputAssemblyPrimitives),
+            static_cast<unsigned long long>(Average.LastStats.ClippingPrimitives),
+            static_cast<unsigned long long>(Average.LastStats.VertexShaderInvocations),
+            static_cast<unsigned long long>(Average.LastStats.FragmentShaderInvocations),
+            static_cast<unsigned long long>(Average.LastStats.ComputeShaderInvocations));
+    }
+}
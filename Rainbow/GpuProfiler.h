@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "ChromeTrace.h"
+#include "MinimalCore.h"
+
+#define GPU_PROFILER_MAX_SCOPES 128
+#define GPU_PROFILER_INVALID_SCOPE 0xFFFFFFFFu
+// Frames each rolling average covers
+#define GPU_PROFILER_AVERAGE_WINDOW 64
+
+// Counters of one scope, only collected when pipeline statistics are enabled
+struct FGpuPipelineStats
+{
+    uint64_t InputAssemblyPrimitives;
+    uint64_t VertexShaderInvocations;
+    uint64_t ClippingPrimitives;
+    uint64_t FragmentShaderInvocations;
+    uint64_t ComputeShaderInvocations;
+};
+
+// GPU timings from timestamp queries written around scopes of a frame's command buffer.
+// Every frame in flight owns its query pools: they are read back when the frame's ticket is complete, FramesInFlight
+// frames after being recorded, and never waited on.
+class FGpuProfiler
+{
+public:
+    FGpuProfiler();
+
+    // Disables itself when the queue family has no valid timestamp bits
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, uint32_t QueueFamilyIndex, uint32_t FramesInFlight, bool bInPipelineStatistics, float InReportInterval);
+    void Shutdown();
+
+    // Collects the results the frame's previous use left behind and resets its queries, outside of any render pass
+    void BeginFrame(VkCommandBuffer CommandBuffer, uint32_t InFrameIndex);
+
+    // Scopes nest but can't straddle a render pass begin or end. Pipeline statistics only cover the outermost scope
+    // asking for them, and must stay off around secondary command buffers (no inherited queries).
+    uint32_t BeginScope(VkCommandBuffer CommandBuffer, const char* Name, bool bStatistics = true);
+    void EndScope(VkCommandBuffer CommandBuffer, uint32_t Scope);
+
+    bool IsEnabled() const { return bEnabled; }
+    // Rolling average of a scope by name, 0 until its first result came back
+    double GetAverageMs(const std::string& Name) const;
+    // Latest result of a scope, from the frame that was read back last
+    double GetLastMs(const std::string& Name) const;
+    // Frames read back so far, goes up by at most one per BeginFrame
+    uint64_t GetResolvedFrameCount() const { return ResolvedFrames; }
+
+    // Keeps trace events of the next NumFrames frames read back
+    void StartCapture(uint32_t NumFrames);
+    // Also when the captured frames recorded no scope, the trace then only has CPU zones
+    bool IsCaptureComplete() const { return bCaptureStarted && CaptureFramesLeft == 0; }
+    // Moves the captured events out, so they can be written along with the CPU's
+    void TakeCapturedEvents(std::vector<FTraceEvent>& OutEvents);
+
+private:
+    struct FScope
+    {
+        // Copied, names of render graph passes are gone by the time results come back
+        std::string Name;
+        uint32_t Depth;
+        uint32_t StatisticsQuery;
+    };
+
+    struct FFrameQueries
+    {
+        VkQueryPool TimestampPool;
+        VkQueryPool StatisticsPool;
+        std::vector<FScope> Scopes;
+        uint32_t NumStatistics;
+        // CPU time the frame started recording, GPU events of a capture are never placed before it
+        double CpuStartUs;
+        // Began at least once, a frame that recorded no scope still counts as resolved for captures
+        bool bBegun;
+    };
+
+    struct FRollingAverage
+    {
+        double Samples[GPU_PROFILER_AVERAGE_WINDOW];
+        uint32_t Count;
+        uint32_t Next;
+        // First appearance, keeps the report in pass order
+        uint32_t Order;
+        FGpuPipelineStats LastStats;
+        bool bHasStats;
+    };
+
+    void ReadBack(FFrameQueries& Frame);
+    void Report();
+
+private:
+    VkDevice Device;
+    bool bEnabled;
+    bool bPipelineStatistics;
+    // Nanoseconds per tick, anything from 1 on software implementations to tens on some mobile GPUs
+    double TimestampPeriod;
+    uint64_t TimestampMask;
+
+    std::vector<FFrameQueries> Frames;
+    uint32_t FrameIndex;
+    uint64_t ResolvedFrames;
+    uint32_t Depth;
+    bool bStatisticsActive;
+
+    std::unordered_map<std::string, FRollingAverage> Averages;
+    float ReportInterval;
+    uint32_t FramesSinceReport;
+    std::chrono::steady_clock::time_point LastReport;
+
+    // GPU ticks have no common clock with the CPU, traces map them with an offset that only ever grows
+    double GpuToCpuOffsetUs;
+    bool bHasGpuToCpuOffset;
+    uint32_t CaptureFramesLeft;
+    bool bCaptureStarted;
+    std::vector<FTraceEvent> CapturedEvents;
+};
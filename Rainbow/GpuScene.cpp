@@ -0,0 +1,427 @@
+#include "GpuScene.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "BindlessHeap.h"
+#include "CommandList.h"
+#include "GpuTimeline.h"
+#include "Material.h"
+#include "MeshActor.h"
+#include "Paths.h"
+#include "PipelineStateCache.h"
+#include "Renderer.h"
+#include "World.h"
+
+// Must match FGpuInstance in Shaders/Instances.glsl
+struct FGpuInstance
+{
+    glm::mat4 Transform;
+    // Center and radius in clip space
+    glm::vec4 BoundingSphere;
+    uint32_t VertexBufferIndex;
+    uint32_t TextureIndex;
+    uint32_t BatchIndex;
+    uint32_t Padding;
+};
+static_assert(sizeof(FGpuInstance) == 24 * sizeof(uint32_t), "FGpuInstance must be 24 tightly packed words");
+
+// Must match FGpuBatch in Shaders/Instances.glsl
+struct FGpuBatch
+{
+    uint32_t FirstCommand;
+    uint32_t IndexCount;
+};
+
+// Threads per culling workgroup, must match local_size_x in Shaders/CullInstances.comp
+#define GPU_SCENE_CULLING_GROUP_SIZE 64
+// Words after the counts of both phases, must match CULLING_STATS_* in Shaders/Instances.glsl
+#define GPU_SCENE_STATS_COUNT 4
+
+FGpuScene::FGpuScene()
+{
+    Device = VK_NULL_HANDLE;
+    PhysicalDevice = VK_NULL_HANDLE;
+    BindlessHeap = nullptr;
+    PipelineLayout = VK_NULL_HANDLE;
+    CullingPipeline = VK_NULL_HANDLE;
+    FramesInFlight = 0;
+    bBuilt = false;
+    BuiltRevision = 0;
+    Constants = FGpuSceneConstants();
+    Constants.InstanceBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.BatchBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.CommandBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.CountBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.SamplerIndex = BINDLESS_INVALID_INDEX;
+    Constants.VisibilityBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.PyramidBufferIndex = BINDLESS_INVALID_INDEX;
+    TriangleCount = 0;
+    InstanceBuffer = VK_NULL_HANDLE;
+    InstanceMemory = VK_NULL_HANDLE;
+    BatchBuffer = VK_NULL_HANDLE;
+    BatchMemory = VK_NULL_HANDLE;
+    VisibilityBuffer = VK_NULL_HANDLE;
+    VisibilityMemory = VK_NULL_HANDLE;
+    for(FFrameBuffers& Frame : Frames)
+    {
+        Frame.Commands = VK_NULL_HANDLE;
+        Frame.CommandMemory = VK_NULL_HANDLE;
+        Frame.CommandIndex = BINDLESS_INVALID_INDEX;
+        Frame.Counts = VK_NULL_HANDLE;
+        Frame.CountMemory = VK_NULL_HANDLE;
+        Frame.CountIndex = BINDLESS_INVALID_INDEX;
+        Frame.Stats = VK_NULL_HANDLE;
+        Frame.StatsMemory = VK_NULL_HANDLE;
+        Frame.MappedStats = nullptr;
+    }
+}
+
+void FGpuScene::Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+    VkPipelineLayout InPipelineLayout, uint32_t InFramesInFlight)
+{
+    SCOPED_ZONE("FGpuScene::Init");
+    Device = InDevice;
+    PhysicalDevice = InPhysicalDevice;
+    BindlessHeap = InBindlessHeap;
+    PipelineLayout = InPipelineLayout;
+    FramesInFlight = InFramesInFlight;
+
+    FComputePipelineDesc Desc;
+    Desc.ComputeShader = FPaths::GetShaderDirectory() + "/CullInstances.comp.spv";
+    Desc.PipelineLayout = PipelineLayout;
+    CullingPipeline = PipelineStateCache.GetComputePipelineBlocking(Desc);
+    checkf(CullingPipeline != VK_NULL_HANDLE, "FGpuScene::Init Unable to create instance culling pipeline");
+}
+
+void FGpuScene::Shutdown()
+{
+    ReleaseBuffers();
+    bBuilt = false;
+}
+
+void FGpuScene::Update(FWorld& World, FGpuTimeline& GpuTimeline, uint32_t SamplerIndex)
+{
+    Constants.SamplerIndex = SamplerIndex;
+    if(bBuilt && BuiltRevision == World.GetRevision()) return;
+
+    if(bBuilt)
+    {
+        GpuTimeline.WaitIdle();
+    }
+    ReleaseBuffers();
+    Build(World);
+    bBuilt = true;
+    BuiltRevision = World.GetRevision();
+}
+
+void FGpuScene::Build(FWorld& World)
+{
+    SCOPED_ZONE("FGpuScene::Build");
+    std::vector<const FMeshActor*> MeshActors;
+    std::unordered_map<const FVertexBuffer*, uint32_t> BatchIndices;
+    Batches.clear();
+    TriangleCount = 0;
+    for(const auto& Actor : World.GetActors())
+    {
+        const FMeshActor* MeshActor = dynamic_cast<const FMeshActor*>(Actor.get());
+        if(!MeshActor || !MeshActor->IsValid()) continue;
+
+        const FVertexBuffer* VertexBuffer = MeshActor->GetVertexBuffer();
+        const auto Found = BatchIndices.emplace(VertexBuffer, static_cast<uint32_t>(Batches.size()));
+        if(Found.second)
+        {
+            FBatch Batch;
+            Batch.IndexBuffer = VertexBuffer->IndexBuffer;
+            Batch.IndexCount = static_cast<uint32_t>(VertexBuffer->IndexBufferSize);
+            Batch.FirstCommand = 0;
+            Batch.InstanceCount = 0;
+            Batches.push_back(Batch);
+        }
+        Batches[Found.first->second].InstanceCount++;
+        MeshActors.push_back(MeshActor);
+        TriangleCount += VertexBuffer->IndexBufferSize / 3;
+    }
+
+    // Every instance can be visible, each batch gets a command slot per instance
+    std::vector<FGpuBatch> GpuBatches(Batches.size());
+    uint32_t CommandCount = 0;
+    for(size_t i = 0; i < Batches.size(); i++)
+    {
+        Batches[i].FirstCommand = CommandCount;
+        GpuBatches[i].FirstCommand = CommandCount;
+        GpuBatches[i].IndexCount = Batches[i].IndexCount;
+        CommandCount += Batches[i].InstanceCount;
+    }
+
+    std::vector<FGpuInstance> Instances(MeshActors.size());
+    for(size_t i = 0; i < MeshActors.size(); i++)
+    {
+        const FMeshActor* MeshActor = MeshActors[i];
+        const FVertexBuffer* VertexBuffer = MeshActor->GetVertexBuffer();
+        FGpuInstance& Instance = Instances[i];
+        Instance.Transform = MeshActor->GetTransform();
+        glm::vec3 BoxCenter;
+        glm::vec3 BoxExtent;
+        MeshActor->GetWorldBounds(Instance.BoundingSphere, BoxCenter, BoxExtent);
+        Instance.VertexBufferIndex = VertexBuffer->VertexBindlessIndex;
+        Instance.TextureIndex = MeshActor->GetMaterial() ? MeshActor->GetMaterial()->GetTextureIndex() : BINDLESS_INVALID_INDEX;
+        Instance.BatchIndex = BatchIndices[VertexBuffer];
+        Instance.Padding = 0;
+    }
+
+    Constants.InstanceCount = static_cast<uint32_t>(Instances.size());
+    Constants.BatchCount = GetBatchCount();
+    if(Instances.empty())
+    {
+        LOG_Info("GPU scene: no mesh instances");
+        return;
+    }
+
+    FCommandList& CommandList = FRenderer::GetCommandList();
+    CommandList.UploadBuffer(Instances.data(), Instances.size() * sizeof(FGpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, InstanceBuffer, InstanceMemory);
+    CommandList.UploadBuffer(GpuBatches.data(), GpuBatches.size() * sizeof(FGpuBatch), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, BatchBuffer, BatchMemory);
+    // Everything starts visible, the first frame's early phase draws it all and nothing pops in
+    const std::vector<uint32_t> Visibility(Instances.size(), 1u);
+    CommandList.UploadBuffer(Visibility.data(), Visibility.size() * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VisibilityBuffer, VisibilityMemory);
+    Constants.InstanceBufferIndex = BindlessHeap->RegisterStorageBuffer(InstanceBuffer);
+    Constants.BatchBufferIndex = BindlessHeap->RegisterStorageBuffer(BatchBuffer);
+    Constants.VisibilityBufferIndex = BindlessHeap->RegisterStorageBuffer(VisibilityBuffer);
+
+    // Commands and counts of the early phase, then of the late phase, then the statistics
+    for(uint32_t i = 0; i < FramesInFlight; i++)
+    {
+        FFrameBuffers& Frame = Frames[i];
+        CreateBuffer(2 * CommandCount * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            Frame.Commands, Frame.CommandMemory);
+        CreateBuffer((2 * Batches.size() + GPU_SCENE_STATS_COUNT) * sizeof(uint32_t),
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            Frame.Counts, Frame.CountMemory);
+        CreateBuffer(GPU_SCENE_STATS_COUNT * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, Frame.Stats, Frame.StatsMemory,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        void* MappedStats = nullptr;
+        vkMapMemory(Device, Frame.StatsMemory, 0, VK_WHOLE_SIZE, 0, &MappedStats);
+        memset(MappedStats, 0, GPU_SCENE_STATS_COUNT * sizeof(uint32_t));
+        Frame.MappedStats = static_cast<const uint32_t*>(MappedStats);
+        Frame.CommandIndex = BindlessHeap->RegisterStorageBuffer(Frame.Commands);
+        Frame.CountIndex = BindlessHeap->RegisterStorageBuffer(Frame.Counts);
+    }
+
+    LOG_Info("GPU scene: %u instances in %u batches, %.2f KB of instance data", Constants.InstanceCount, GetBatchCount(),
+        Instances.size() * sizeof(FGpuInstance) / 1024.0);
+}
+
+void FGpuScene::ReleaseBuffers()
+{
+    for(FFrameBuffers& Frame : Frames)
+    {
+        if(Frame.Commands == VK_NULL_HANDLE) continue;
+
+        BindlessHeap->Release(BINDLESS_StorageBuffers, Frame.CommandIndex);
+        BindlessHeap->Release(BINDLESS_StorageBuffers, Frame.CountIndex);
+        vkDestroyBuffer(Device, Frame.Commands, nullptr);
+        vkFreeMemory(Device, Frame.CommandMemory, nullptr);
+        vkDestroyBuffer(Device, Frame.Counts, nullptr);
+        vkFreeMemory(Device, Frame.CountMemory, nullptr);
+        Frame.Commands = VK_NULL_HANDLE;
+        Frame.Counts = VK_NULL_HANDLE;
+        Frame.CommandIndex = BINDLESS_INVALID_INDEX;
+        Frame.CountIndex = BINDLESS_INVALID_INDEX;
+
+        vkUnmapMemory(Device, Frame.StatsMemory);
+        vkDestroyBuffer(Device, Frame.Stats, nullptr);
+        vkFreeMemory(Device, Frame.StatsMemory, nullptr);
+        Frame.Stats = VK_NULL_HANDLE;
+        Frame.StatsMemory = VK_NULL_HANDLE;
+        Frame.MappedStats = nullptr;
+    }
+
+    if(InstanceBuffer != VK_NULL_HANDLE)
+    {
+        BindlessHeap->Release(BINDLESS_StorageBuffers, Constants.InstanceBufferIndex);
+        BindlessHeap->Release(BINDLESS_StorageBuffers, Constants.BatchBufferIndex);
+        BindlessHeap->Release(BINDLESS_StorageBuffers, Constants.VisibilityBufferIndex);
+        vkDestroyBuffer(Device, InstanceBuffer, nullptr);
+        vkFreeMemory(Device, InstanceMemory, nullptr);
+        vkDestroyBuffer(Device, BatchBuffer, nullptr);
+        vkFreeMemory(Device, BatchMemory, nullptr);
+        vkDestroyBuffer(Device, VisibilityBuffer, nullptr);
+        vkFreeMemory(Device, VisibilityMemory, nullptr);
+        InstanceBuffer = VK_NULL_HANDLE;
+        BatchBuffer = VK_NULL_HANDLE;
+        VisibilityBuffer = VK_NULL_HANDLE;
+        Constants.InstanceBufferIndex = BINDLESS_INVALID_INDEX;
+        Constants.BatchBufferIndex = BINDLESS_INVALID_INDEX;
+        Constants.VisibilityBufferIndex = BINDLESS_INVALID_INDEX;
+    }
+    Constants.InstanceCount = 0;
+    Constants.BatchCount = 0;
+    Batches.clear();
+}
+
+void FGpuScene::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkBuffer& OutBuffer, VkDeviceMemory& OutMemory,
+    VkMemoryPropertyFlags MemoryProperties) const
+{
+    VkBufferCreateInfo BufferInfo = {};
+    BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    BufferInfo.size = Size;
+    BufferInfo.usage = Usage;
+    BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(Device, &BufferInfo, nullptr, &OutBuffer) != VK_SUCCESS)
+    {
+        checkf(0, "FGpuScene: unable to create buffer");
+    }
+
+    VkMemoryRequirements MemoryRequirements;
+    vkGetBufferMemoryRequirements(Device, OutBuffer, &MemoryRequirements);
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = MemoryRequirements.size;
+    AllocateInfo.memoryTypeIndex = FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits, MemoryProperties);
+    if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &OutMemory) != VK_SUCCESS)
+    {
+        checkf(0, "FGpuScene: unable to allocate buffer memory");
+    }
+    vkBindBufferMemory(Device, OutBuffer, OutMemory, 0);
+}
+
+FGpuSceneDrawBuffers FGpuScene::ImportDrawBuffers(FRenderGraph& RenderGraph, uint32_t FrameIndex)
+{
+    FGpuSceneDrawBuffers DrawBuffers;
+    if(Constants.InstanceCount == 0) return DrawBuffers;
+
+    check(FrameIndex < FramesInFlight);
+    DrawBuffers.Commands = RenderGraph.ImportBuffer("IndirectCommands", Frames[FrameIndex].Commands);
+    DrawBuffers.Counts = RenderGraph.ImportBuffer("IndirectCounts", Frames[FrameIndex].Counts);
+    return DrawBuffers;
+}
+
+void FGpuScene::AddCullingPass(FRenderGraph& RenderGraph, const FGpuSceneDrawBuffers& DrawBuffers, uint32_t FrameIndex, EGpuCullingPhase Phase,
+    const FDepthPyramidDesc* Pyramid)
+{
+    check(Phase != EGpuCullingPhase::Late || Pyramid);
+    const FFrameBuffers& Frame = Frames[FrameIndex];
+    FGpuSceneConstants PassConstants = Constants;
+    PassConstants.CommandBufferIndex = Frame.CommandIndex;
+    PassConstants.CountBufferIndex = Frame.CountIndex;
+    PassConstants.Phase = static_cast<uint32_t>(Phase);
+    if(Pyramid)
+    {
+        PassConstants.PyramidBufferIndex = Pyramid->BufferIndex;
+        PassConstants.PyramidWidth = Pyramid->Width;
+        PassConstants.PyramidHeight = Pyramid->Height;
+        PassConstants.PyramidLevelCount = Pyramid->LevelCount;
+        PassConstants.DepthWidth = Pyramid->DepthWidth;
+        PassConstants.DepthHeight = Pyramid->DepthHeight;
+    }
+
+    FRenderGraphPass& Pass = RenderGraph.AddPass(Phase == EGpuCullingPhase::Late ? "InstanceCullingLate" :
+        Phase == EGpuCullingPhase::Early ? "InstanceCullingEarly" : "InstanceCulling");
+    if(Pyramid)
+    {
+        Pass.ReadBuffer(Pyramid->Buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    const VkBuffer Counts = Frame.Counts;
+    const VkBuffer Stats = Frame.Stats;
+    const VkDeviceSize StatsOffset = 2 * Batches.size() * sizeof(uint32_t);
+    Pass.WriteBuffer(DrawBuffers.Commands)
+        .WriteBuffer(DrawBuffers.Counts)
+        .SetExecute([this, PassConstants, Phase, Counts, Stats, StatsOffset](const FRenderGraphPassContext& Context)
+        {
+            // Instances append to their batch, every count and statistic starts from zero. The late phase adds to them.
+            if(Phase != EGpuCullingPhase::Late)
+            {
+                vkCmdFillBuffer(Context.CommandBuffer, Counts, 0, VK_WHOLE_SIZE, 0);
+                VkBufferMemoryBarrier ClearBarrier = {};
+                ClearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                ClearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                ClearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                ClearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                ClearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                ClearBarrier.buffer = Counts;
+                ClearBarrier.size = VK_WHOLE_SIZE;
+                // The visibility the previous frame's late phase wrote is outside the graph, ordered by submission only
+                VkMemoryBarrier VisibilityBarrier = {};
+                VisibilityBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                VisibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                VisibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                vkCmdPipelineBarrier(Context.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &VisibilityBarrier, 1, &ClearBarrier, 0, nullptr);
+            }
+
+            vkCmdBindPipeline(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, CullingPipeline);
+            BindlessHeap->Bind(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout);
+            vkCmdPushConstants(Context.CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FGpuSceneConstants), &PassConstants);
+            vkCmdDispatch(Context.CommandBuffer, (PassConstants.InstanceCount + GPU_SCENE_CULLING_GROUP_SIZE - 1) / GPU_SCENE_CULLING_GROUP_SIZE, 1, 1);
+
+            // The last phase of the frame copies the statistics out, read back once the frame completed
+            if(Phase != EGpuCullingPhase::Early)
+            {
+                VkBufferMemoryBarrier StatsBarrier = {};
+                StatsBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                StatsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                StatsBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                StatsBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                StatsBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                StatsBarrier.buffer = Counts;
+                StatsBarrier.offset = StatsOffset;
+                StatsBarrier.size = GPU_SCENE_STATS_COUNT * sizeof(uint32_t);
+                vkCmdPipelineBarrier(Context.CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                    1, &StatsBarrier, 0, nullptr);
+                VkBufferCopy Region = {};
+                Region.srcOffset = StatsOffset;
+                Region.size = GPU_SCENE_STATS_COUNT * sizeof(uint32_t);
+                vkCmdCopyBuffer(Context.CommandBuffer, Counts, Stats, 1, &Region);
+
+                // Waiting on the frame's ticket alone doesn't make the copy visible to ReadStats
+                VkBufferMemoryBarrier HostBarrier = {};
+                HostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                HostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                HostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                HostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                HostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                HostBarrier.buffer = Stats;
+                HostBarrier.size = VK_WHOLE_SIZE;
+                vkCmdPipelineBarrier(Context.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr,
+                    1, &HostBarrier, 0, nullptr);
+            }
+        });
+}
+
+void FGpuScene::Draw(VkCommandBuffer CommandBuffer, uint32_t FrameIndex, EGpuCullingPhase Phase, uint32_t FirstBatch, uint32_t EndBatch) const
+{
+    const FFrameBuffers& Frame = Frames[FrameIndex];
+    FGpuSceneConstants DrawConstants = Constants;
+    DrawConstants.CommandBufferIndex = Frame.CommandIndex;
+    DrawConstants.CountBufferIndex = Frame.CountIndex;
+    vkCmdPushConstants(CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FGpuSceneConstants), &DrawConstants);
+
+    // The late phase's commands and counts follow the early ones
+    const uint32_t PhaseCommand = Phase == EGpuCullingPhase::Late ? Constants.InstanceCount : 0;
+    const uint32_t PhaseCount = Phase == EGpuCullingPhase::Late ? Constants.BatchCount : 0;
+    for(uint32_t i = FirstBatch; i < EndBatch; i++)
+    {
+        const FBatch& Batch = Batches[i];
+        vkCmdBindIndexBuffer(CommandBuffer, Batch.IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexedIndirectCount(CommandBuffer, Frame.Commands, (PhaseCommand + Batch.FirstCommand) * sizeof(VkDrawIndexedIndirectCommand),
+            Frame.Counts, (PhaseCount + i) * sizeof(uint32_t), Batch.InstanceCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+FGpuCullingStats FGpuScene::ReadStats(uint32_t FrameIndex) const
+{
+    FGpuCullingStats Stats;
+    const FFrameBuffers& Frame = Frames[FrameIndex];
+    if(!Frame.MappedStats) return Stats;
+
+    Stats.Instances = Constants.InstanceCount;
+    Stats.FrustumVisible = Frame.MappedStats[0];
+    Stats.Occluded = Frame.MappedStats[1];
+    Stats.DrawnEarly = Frame.MappedStats[2];
+    Stats.DrawnLate = Frame.MappedStats[3];
+    return Stats;
+}
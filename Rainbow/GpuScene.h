@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+#include "BindlessHeap.h"
+#include "DepthPyramid.h"
+#include "RenderGraph.h"
+#include "RendererSettings.h"
+
+class FBindlessHeap;
+class FGpuTimeline;
+class FPipelineStateCache;
+class FWorld;
+
+// Must match FGpuSceneConstants in Shaders/Instances.glsl, pushed to the culling pass and to the indirect geometry draws
+struct FGpuSceneConstants
+{
+    uint32_t InstanceBufferIndex;
+    uint32_t BatchBufferIndex;
+    uint32_t InstanceCount;
+    // The frame's indirect commands and per batch counts, written by the culling pass
+    uint32_t CommandBufferIndex;
+    uint32_t CountBufferIndex;
+    uint32_t SamplerIndex;
+    uint32_t BatchCount;
+    // EGpuCullingPhase
+    uint32_t Phase;
+    // One word per instance, whether the last late phase found it visible
+    uint32_t VisibilityBufferIndex;
+    // The frame's depth pyramid, late phase only
+    uint32_t PyramidBufferIndex;
+    uint32_t PyramidWidth;
+    uint32_t PyramidHeight;
+    uint32_t PyramidLevelCount;
+    uint32_t DepthWidth;
+    uint32_t DepthHeight;
+};
+static_assert(sizeof(FGpuSceneConstants) <= sizeof(FDrawConstants), "GPU scene constants must fit the shared push constant range");
+
+// Which instances a culling pass draws, must match CULLING_PHASE_* in Shaders/Instances.glsl. Early and late each write
+// their own half of the frame's commands and counts.
+enum class EGpuCullingPhase : uint32_t
+{
+    // Frustum culling only, every instance in the view is drawn
+    All,
+    // Instances the previous frame found visible, the depth pyramid is built from what they draw
+    Early,
+    // Every instance tested against the pyramid, draws those the early phase missed and records visibility for the next frame
+    Late
+};
+
+// Instances culled by the frame that last used a frame in flight's resources, read back once its work completed
+struct FGpuCullingStats
+{
+    uint32_t Instances;
+    uint32_t FrustumVisible;
+    uint32_t Occluded;
+    uint32_t DrawnEarly;
+    uint32_t DrawnLate;
+
+    FGpuCullingStats() : Instances(0), FrustumVisible(0), Occluded(0), DrawnEarly(0), DrawnLate(0) {}
+};
+
+// Written by the culling pass, read by the geometry pass as indirect arguments
+struct FGpuSceneDrawBuffers
+{
+    FRenderGraphBuffer Commands;
+    FRenderGraphBuffer Counts;
+};
+
+// The world's mesh actors copied into GPU buffers for GPU driven rendering. A compute pass frustum culls every instance
+// and appends a VkDrawIndexedIndirectCommand to its batch, the geometry pass then issues one vkCmdDrawIndexedIndirectCount
+// per batch, so the CPU cost of a frame depends on the number of batches and not on the number of actors.
+// Materials are bindless and one pipeline draws every mesh, batches are only split by index buffer, one per mesh.
+class FGpuScene
+{
+public:
+    FGpuScene();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+        VkPipelineLayout InPipelineLayout, uint32_t InFramesInFlight);
+    void Shutdown();
+
+    // Rebuilds the buffers when the world's actors changed since the last call. Actors are only added while loading,
+    // the previous buffers are released after waiting for the GPU to be idle.
+    void Update(FWorld& World, FGpuTimeline& GpuTimeline, uint32_t SamplerIndex);
+    // The frame's indirect commands and counts, shared by both phases. Invalid buffers when there is nothing to draw.
+    FGpuSceneDrawBuffers ImportDrawBuffers(FRenderGraph& RenderGraph, uint32_t FrameIndex);
+    // The late phase tests against Pyramid, built from the depth the early phase drew
+    void AddCullingPass(FRenderGraph& RenderGraph, const FGpuSceneDrawBuffers& DrawBuffers, uint32_t FrameIndex, EGpuCullingPhase Phase,
+        const FDepthPyramidDesc* Pyramid = nullptr);
+    // Batches [FirstBatch, EndBatch) of the phase inside the geometry render pass, the pipeline and the global set already bound
+    void Draw(VkCommandBuffer CommandBuffer, uint32_t FrameIndex, EGpuCullingPhase Phase, uint32_t FirstBatch, uint32_t EndBatch) const;
+    // Call once the frame's previous work completed
+    FGpuCullingStats ReadStats(uint32_t FrameIndex) const;
+
+    uint32_t GetInstanceCount() const { return Constants.InstanceCount; }
+    uint32_t GetBatchCount() const { return static_cast<uint32_t>(Batches.size()); }
+    // Of every instance, before culling
+    uint64_t GetTriangleCount() const { return TriangleCount; }
+
+private:
+    struct FBatch
+    {
+        VkBuffer IndexBuffer;
+        uint32_t IndexCount;
+        // Commands of the batch start here in the frame's command buffer, one slot per instance
+        uint32_t FirstCommand;
+        uint32_t InstanceCount;
+    };
+
+    struct FFrameBuffers
+    {
+        VkBuffer Commands;
+        VkDeviceMemory CommandMemory;
+        uint32_t CommandIndex;
+        VkBuffer Counts;
+        VkDeviceMemory CountMemory;
+        uint32_t CountIndex;
+        // Host visible copy of the statistics the culling passes accumulate after the counts
+        VkBuffer Stats;
+        VkDeviceMemory StatsMemory;
+        const uint32_t* MappedStats;
+    };
+
+    void Build(FWorld& World);
+    void ReleaseBuffers();
+    void CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkBuffer& OutBuffer, VkDeviceMemory& OutMemory,
+        VkMemoryPropertyFlags MemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) const;
+
+private:
+    VkDevice Device;
+    VkPhysicalDevice PhysicalDevice;
+    FBindlessHeap* BindlessHeap;
+    VkPipelineLayout PipelineLayout;
+    VkPipeline CullingPipeline;
+    uint32_t FramesInFlight;
+
+    bool bBuilt;
+    uint32_t BuiltRevision;
+    FGpuSceneConstants Constants;
+    std::vector<FBatch> Batches;
+    uint64_t TriangleCount;
+    VkBuffer InstanceBuffer;
+    VkDeviceMemory InstanceMemory;
+    VkBuffer BatchBuffer;
+    VkDeviceMemory BatchMemory;
+    // Persistent across frames, frames in flight run in order on the graphics queue
+    VkBuffer VisibilityBuffer;
+    VkDeviceMemory VisibilityMemory;
+    FFrameBuffers Frames[MAX_FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,192 @@
+#include "GpuTimeline.h"
+
+FGpuSubmission::FGpuSubmission()
+{
+    CommandBufferCount = 0;
+    WaitCount = 0;
+    SignalCount = 0;
+}
+
+FGpuSubmission& FGpuSubmission::AddCommandBuffer(VkCommandBuffer CommandBuffer)
+{
+    checkf(CommandBufferCount < GPU_SUBMISSION_MAX_COMMAND_BUFFERS, "FGpuSubmission: too many command buffers");
+    CommandBuffers[CommandBufferCount++] = CommandBuffer;
+    return *this;
+}
+
+FGpuSubmission& FGpuSubmission::Wait(FGpuTicket Ticket, VkPipelineStageFlags Stages)
+{
+    if(!Ticket.IsValid()) return *this;
+
+    checkf(WaitCount < GPU_SUBMISSION_MAX_WAITS, "FGpuSubmission: too many waits");
+    WaitTickets[WaitCount] = Ticket;
+    // Filled with the ticket queue's timeline by FGpuTimeline::Submit
+    WaitSemaphores[WaitCount] = VK_NULL_HANDLE;
+    WaitStages[WaitCount] = Stages;
+    WaitCount++;
+    return *this;
+}
+
+FGpuSubmission& FGpuSubmission::WaitBinary(VkSemaphore Semaphore, VkPipelineStageFlags Stages)
+{
+    checkf(WaitCount < GPU_SUBMISSION_MAX_WAITS, "FGpuSubmission: too many waits");
+    WaitTickets[WaitCount] = FGpuTicket();
+    WaitSemaphores[WaitCount] = Semaphore;
+    WaitStages[WaitCount] = Stages;
+    WaitCount++;
+    return *this;
+}
+
+FGpuSubmission& FGpuSubmission::SignalBinary(VkSemaphore Semaphore)
+{
+    checkf(SignalCount < GPU_SUBMISSION_MAX_SIGNALS, "FGpuSubmission: too many signals");
+    SignalSemaphores[SignalCount++] = Semaphore;
+    return *this;
+}
+
+FGpuTimeline::FGpuTimeline()
+{
+    Device = VK_NULL_HANDLE;
+    for(FQueueTimeline& Timeline : Timelines)
+    {
+        Timeline.Queue = VK_NULL_HANDLE;
+        Timeline.Semaphore = VK_NULL_HANDLE;
+        Timeline.LastSubmitted = 0;
+        Timeline.LastCompleted = 0;
+    }
+}
+
+void FGpuTimeline::Init(VkDevice InDevice, VkQueue GraphicsQueue, VkQueue ComputeQueue, VkQueue TransferQueue)
+{
+    Device = InDevice;
+    Timelines[static_cast<uint32_t>(EGpuQueue::Graphics)].Queue = GraphicsQueue;
+    Timelines[static_cast<uint32_t>(EGpuQueue::Compute)].Queue = ComputeQueue;
+    Timelines[static_cast<uint32_t>(EGpuQueue::Transfer)].Queue = TransferQueue;
+
+    VkSemaphoreTypeCreateInfo TypeInfo = {};
+    TypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    TypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    TypeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo CreateInfo = {};
+    CreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    CreateInfo.pNext = &TypeInfo;
+    for(FQueueTimeline& Timeline : Timelines)
+    {
+        Timeline.LastSubmitted = 0;
+        Timeline.LastCompleted = 0;
+        if(Timeline.Queue == VK_NULL_HANDLE) continue;
+
+        if(vkCreateSemaphore(Device, &CreateInfo, nullptr, &Timeline.Semaphore) != VK_SUCCESS)
+        {
+            checkf(0, "FGpuTimeline: unable to create timeline semaphore");
+        }
+    }
+}
+
+void FGpuTimeline::Shutdown()
+{
+    for(FQueueTimeline& Timeline : Timelines)
+    {
+        if(Timeline.Semaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(Device, Timeline.Semaphore, nullptr);
+            Timeline.Semaphore = VK_NULL_HANDLE;
+        }
+        Timeline.Queue = VK_NULL_HANDLE;
+    }
+}
+
+EGpuQueue FGpuTimeline::Resolve(EGpuQueue Queue) const
+{
+    return Timelines[static_cast<uint32_t>(Queue)].Queue != VK_NULL_HANDLE ? Queue : EGpuQueue::Graphics;
+}
+
+FGpuTicket FGpuTimeline::Submit(EGpuQueue Queue, const FGpuSubmission& Submission)
+{
+    const EGpuQueue SubmitQueue = Resolve(Queue);
+    FQueueTimeline& Timeline = Timelines[static_cast<uint32_t>(SubmitQueue)];
+    const uint64_t SignalValue = Timeline.LastSubmitted + 1;
+
+    // Binary semaphores take a value too, it's ignored
+    VkSemaphore WaitSemaphores[GPU_SUBMISSION_MAX_WAITS];
+    uint64_t WaitValues[GPU_SUBMISSION_MAX_WAITS];
+    for(uint32_t i = 0; i < Submission.WaitCount; i++)
+    {
+        const FGpuTicket& Ticket = Submission.WaitTickets[i];
+        WaitSemaphores[i] = Ticket.IsValid() ? Timelines[static_cast<uint32_t>(Ticket.Queue)].Semaphore : Submission.WaitSemaphores[i];
+        WaitValues[i] = Ticket.Value;
+    }
+
+    VkSemaphore SignalSemaphores[GPU_SUBMISSION_MAX_SIGNALS + 1];
+    uint64_t SignalValues[GPU_SUBMISSION_MAX_SIGNALS + 1] = {};
+    for(uint32_t i = 0; i < Submission.SignalCount; i++)
+    {
+        SignalSemaphores[i] = Submission.SignalSemaphores[i];
+    }
+    SignalSemaphores[Submission.SignalCount] = Timeline.Semaphore;
+    SignalValues[Submission.SignalCount] = SignalValue;
+
+    VkTimelineSemaphoreSubmitInfo TimelineInfo = {};
+    TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineInfo.waitSemaphoreValueCount = Submission.WaitCount;
+    TimelineInfo.pWaitSemaphoreValues = WaitValues;
+    TimelineInfo.signalSemaphoreValueCount = Submission.SignalCount + 1;
+    TimelineInfo.pSignalSemaphoreValues = SignalValues;
+
+    VkSubmitInfo SubmitInfo = {};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.pNext = &TimelineInfo;
+    SubmitInfo.waitSemaphoreCount = Submission.WaitCount;
+    SubmitInfo.pWaitSemaphores = WaitSemaphores;
+    SubmitInfo.pWaitDstStageMask = Submission.WaitStages;
+    SubmitInfo.commandBufferCount = Submission.CommandBufferCount;
+    SubmitInfo.pCommandBuffers = Submission.CommandBuffers;
+    SubmitInfo.signalSemaphoreCount = Submission.SignalCount + 1;
+    SubmitInfo.pSignalSemaphores = SignalSemaphores;
+    if(vkQueueSubmit(Timeline.Queue, 1, &SubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        checkf(0, "FGpuTimeline: queue submit failed");
+    }
+
+    Timeline.LastSubmitted = SignalValue;
+    return FGpuTicket(SubmitQueue, SignalValue);
+}
+
+FGpuTicket FGpuTimeline::GetLastSubmitted(EGpuQueue Queue) const
+{
+    const EGpuQueue SubmitQueue = Resolve(Queue);
+    return FGpuTicket(SubmitQueue, Timelines[static_cast<uint32_t>(SubmitQueue)].LastSubmitted);
+}
+
+bool FGpuTimeline::IsComplete(FGpuTicket Ticket)
+{
+    FQueueTimeline& Timeline = Timelines[static_cast<uint32_t>(Ticket.Queue)];
+    if(Ticket.Value <= Timeline.LastCompleted) return true;
+
+    vkGetSemaphoreCounterValue(Device, Timeline.Semaphore, &Timeline.LastCompleted);
+    return Ticket.Value <= Timeline.LastCompleted;
+}
+
+void FGpuTimeline::Wait(FGpuTicket Ticket)
+{
+    if(IsComplete(Ticket)) return;
+
+    FQueueTimeline& Timeline = Timelines[static_cast<uint32_t>(Ticket.Queue)];
+    VkSemaphoreWaitInfo WaitInfo = {};
+    WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    WaitInfo.semaphoreCount = 1;
+    WaitInfo.pSemaphores = &Timeline.Semaphore;
+    WaitInfo.pValues = &Ticket.Value;
+    vkWaitSemaphores(Device, &WaitInfo, UINT64_MAX);
+    Timeline.LastCompleted = Ticket.Value;
+}
+
+void FGpuTimeline::WaitIdle()
+{
+    for(uint32_t Queue = 0; Queue < static_cast<uint32_t>(EGpuQueue::Count); Queue++)
+    {
+        if(Timelines[Queue].Semaphore == VK_NULL_HANDLE) continue;
+        Wait(FGpuTicket(static_cast<EGpuQueue>(Queue), Timelines[Queue].LastSubmitted));
+    }
+}
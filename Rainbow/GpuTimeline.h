@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+
+#define GPU_SUBMISSION_MAX_COMMAND_BUFFERS 4
+#define GPU_SUBMISSION_MAX_WAITS 4
+#define GPU_SUBMISSION_MAX_SIGNALS 2
+
+enum class EGpuQueue : uint8_t
+{
+    Graphics,
+    Compute,
+    Transfer,
+    Count
+};
+
+// Point on a queue's timeline, reached once every submission to that queue up to it finished executing
+struct FGpuTicket
+{
+    EGpuQueue Queue;
+    uint64_t Value;
+
+    FGpuTicket() : Queue(EGpuQueue::Graphics), Value(0) {}
+    FGpuTicket(EGpuQueue InQueue, uint64_t InValue) : Queue(InQueue), Value(InValue) {}
+    // Timelines start at 0, a default ticket is always complete
+    bool IsValid() const { return Value != 0; }
+};
+
+// Command buffers and dependencies of one vkQueueSubmit, the queue's timeline signal is added by FGpuTimeline::Submit
+class FGpuSubmission
+{
+public:
+    FGpuSubmission();
+
+    FGpuSubmission& AddCommandBuffer(VkCommandBuffer CommandBuffer);
+    // Commands in Stages wait for the ticket, invalid tickets are skipped
+    FGpuSubmission& Wait(FGpuTicket Ticket, VkPipelineStageFlags Stages);
+    // Swapchain acquire and present only take binary semaphores
+    FGpuSubmission& WaitBinary(VkSemaphore Semaphore, VkPipelineStageFlags Stages);
+    FGpuSubmission& SignalBinary(VkSemaphore Semaphore);
+
+private:
+    friend class FGpuTimeline;
+
+    VkCommandBuffer CommandBuffers[GPU_SUBMISSION_MAX_COMMAND_BUFFERS];
+    uint32_t CommandBufferCount;
+    FGpuTicket WaitTickets[GPU_SUBMISSION_MAX_WAITS];
+    VkSemaphore WaitSemaphores[GPU_SUBMISSION_MAX_WAITS];
+    VkPipelineStageFlags WaitStages[GPU_SUBMISSION_MAX_WAITS];
+    uint32_t WaitCount;
+    VkSemaphore SignalSemaphores[GPU_SUBMISSION_MAX_SIGNALS];
+    uint32_t SignalCount;
+};
+
+// One timeline semaphore per queue, every submission signals the next value of its queue's timeline and returns it as a
+// ticket. Tickets order work across queues (FGpuSubmission::Wait) and tell the CPU when resources can be reused or
+// freed, polled without blocking or waited on.
+// Queues the device doesn't have share the graphics queue and its timeline.
+class FGpuTimeline
+{
+public:
+    FGpuTimeline();
+
+    void Init(VkDevice InDevice, VkQueue GraphicsQueue, VkQueue ComputeQueue, VkQueue TransferQueue);
+    void Shutdown();
+
+    FGpuTicket Submit(EGpuQueue Queue, const FGpuSubmission& Submission);
+    // Ticket of the latest submission to the queue
+    FGpuTicket GetLastSubmitted(EGpuQueue Queue) const;
+
+    // Never blocks, only reads the semaphore's counter when the cached value isn't enough
+    bool IsComplete(FGpuTicket Ticket);
+    void Wait(FGpuTicket Ticket);
+    // Everything submitted so far on every queue
+    void WaitIdle();
+
+private:
+    struct FQueueTimeline
+    {
+        VkQueue Queue;
+        VkSemaphore Semaphore;
+        uint64_t LastSubmitted;
+        uint64_t LastCompleted;
+    };
+
+    // Queue whose timeline work submitted to Queue ends up on
+    EGpuQueue Resolve(EGpuQueue Queue) const;
+
+private:
+    VkDevice Device;
+    FQueueTimeline Timelines[static_cast<uint32_t>(EGpuQueue::Count)];
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, fast enough for cache keys and stable across runs so keys can be persisted
+inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 0xcbf29ce484222325ull)
+{
+    const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+    uint64_t Hash = Seed;
+    for(size_t i = 0; i < Size; i++)
+    {
+        Hash ^= Bytes[i];
+        Hash *= 0x100000001b3ull;
+    }
+    return Hash;
+}
+
+inline uint64_t HashCombine(uint64_t Hash, uint64_t Value)
+{
+    return Hash ^ (Value + 0x9e3779b97f4a7c15ull + (Hash << 6) + (Hash >> 2));
+}
+
+template<class T>
+uint64_t HashValue(const T& Value, uint64_t Seed = 0xcbf29ce484222325ull)
+{
+    return HashBytes(&Value, sizeof(T), Seed);
+}
@@ -0,0 +1,141 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+FJobSystem& FJobSystem::Get()
+{
+    static FJobSystem JobSystem;
+    return JobSystem;
+}
+
+FJobSystem::FJobSystem()
+{
+    ActiveJobs = 0;
+    bStopping = false;
+}
+
+void FJobSystem::Init(uint32_t NumWorkers)
+{
+    if(!Workers.empty()) return;
+
+    if(NumWorkers == 0)
+    {
+        // Keep one core for the render thread, the count is 0 when the platform can't tell
+        const uint32_t Cores = std::thread::hardware_concurrency();
+        NumWorkers = Cores > 1 ? Cores - 1 : 1;
+    }
+
+    bStopping = false;
+    for(uint32_t i = 0; i < NumWorkers; i++)
+    {
+        Workers.emplace_back(&FJobSystem::WorkerLoop, this, i);
+    }
+    LOG_Info("Job system started with %u workers", NumWorkers);
+}
+
+void FJobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        bStopping = true;
+    }
+    JobAvailable.notify_all();
+    for(std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+    Workers.clear();
+}
+
+void FJobSystem::Enqueue(std::function<void()> Job)
+{
+    check(!Workers.empty());
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Jobs.push_back(std::move(Job));
+    }
+    JobAvailable.notify_one();
+}
+
+void FJobSystem::WaitIdle()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    JobsDone.wait(Lock, [this]() { return Jobs.empty() && ActiveJobs == 0; });
+}
+
+void FJobSystem::ParallelFor(uint32_t Count, const std::function<void(uint32_t)>& Body)
+{
+    if(Count <= 1 || Workers.empty())
+    {
+        for(uint32_t i = 0; i < Count; i++)
+        {
+            Body(i);
+        }
+        return;
+    }
+
+    struct FParallelForState
+    {
+        std::atomic<uint32_t> NextIndex{0};
+        std::atomic<uint32_t> NumDone{0};
+        std::mutex Mutex;
+        std::condition_variable Finished;
+    };
+
+    // Helpers can start after the caller already finished every index, they only touch the shared state then
+    const std::shared_ptr<FParallelForState> State = std::make_shared<FParallelForState>();
+    auto RunIndices = [State, Count, &Body]()
+    {
+        for(uint32_t Index = State->NextIndex++; Index < Count; Index = State->NextIndex++)
+        {
+            Body(Index);
+            if(++State->NumDone == Count)
+            {
+                std::lock_guard<std::mutex> Lock(State->Mutex);
+                State->Finished.notify_all();
+            }
+        }
+    };
+
+    const uint32_t NumHelpers = std::min(Count - 1, GetNumWorkers());
+    for(uint32_t i = 0; i < NumHelpers; i++)
+    {
+        Enqueue(RunIndices);
+    }
+    RunIndices();
+
+    std::unique_lock<std::mutex> Lock(State->Mutex);
+    State->Finished.wait(Lock, [&State, Count]() { return State->NumDone.load() == Count; });
+}
+
+void FJobSystem::WorkerLoop(uint32_t WorkerIndex)
+{
+    const std::string ThreadName = "Job worker " + std::to_string(WorkerIndex);
+    ZONE_THREAD_NAME(ThreadName.c_str());
+
+    for(;;)
+    {
+        std::function<void()> Job;
+        {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            JobAvailable.wait(Lock, [this]() { return bStopping || !Jobs.empty(); });
+            if(Jobs.empty())
+            {
+                return;
+            }
+            Job = std::move(Jobs.front());
+            Jobs.pop_front();
+            ActiveJobs++;
+        }
+
+        Job();
+
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            ActiveJobs--;
+        }
+        JobsDone.notify_all();
+    }
+}
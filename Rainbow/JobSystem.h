@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MinimalCore.h"
+
+// Fixed pool of worker threads shared by the renderer, jobs run in FIFO order
+class FJobSystem
+{
+public:
+    static FJobSystem& Get();
+
+    void Init(uint32_t NumWorkers = 0);
+    void Shutdown();
+
+    void Enqueue(std::function<void()> Job);
+    // Blocks until every job enqueued so far has finished
+    void WaitIdle();
+    // Runs Body(0..Count-1) on the workers and the calling thread, returns once every index is done.
+    // Only waits for its own indices, unrelated jobs (pipeline compiles) keep running.
+    void ParallelFor(uint32_t Count, const std::function<void(uint32_t)>& Body);
+
+    uint32_t GetNumWorkers() const { return static_cast<uint32_t>(Workers.size()); }
+
+private:
+    FJobSystem();
+    void WorkerLoop(uint32_t WorkerIndex);
+
+private:
+    std::vector<std::thread> Workers;
+    std::deque<std::function<void()>> Jobs;
+    std::mutex Mutex;
+    std::condition_variable JobAvailable;
+    std::condition_variable JobsDone;
+    uint32_t ActiveJobs;
+    bool bStopping;
+};
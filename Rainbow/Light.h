@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+enum class ELightType : uint32_t
+{
+    Point,
+    Spot
+};
+
+// Positions, directions and radii are in the clip space actors are placed in, the renderer has no camera yet.
+// Lights have no effect beyond their radius, that bound is what the cluster culling tests.
+struct FLight
+{
+    ELightType Type;
+    glm::vec3 Position;
+    float Radius;
+    glm::vec3 Color;
+    float Intensity;
+    // Spot lights only, the cone fades out between the inner and outer half angle, in radians
+    glm::vec3 Direction;
+    float InnerAngle;
+    float OuterAngle;
+
+    FLight()
+        : Type(ELightType::Point), Position(0.0f), Radius(1.0f), Color(1.0f), Intensity(1.0f), Direction(0.0f, 0.0f, 1.0f),
+          InnerAngle(0.5f), OuterAngle(0.7f) {}
+};
@@ -0,0 +1,163 @@
+#include "LightCulling.h"
+#include <cmath>
+#include <cstring>
+#include "BindlessHeap.h"
+#include "Paths.h"
+#include "PipelineStateCache.h"
+#include "Renderer.h"
+#include "TransientBuffer.h"
+
+// Must match LIGHT_STRIDE and LoadLight in Shaders/Lights.glsl
+struct FGpuLight
+{
+    float PositionRadius[4];
+    float ColorIntensity[4];
+    // Type in w
+    float DirectionType[4];
+    // Cosines of the inner and outer spot angles in xy
+    float SpotAngles[4];
+};
+static_assert(sizeof(FGpuLight) == 16 * sizeof(float), "FGpuLight must be 16 tightly packed floats");
+
+// Threads per culling workgroup, must match local_size_x in Shaders/ClusterLights.comp
+#define LIGHT_CULLING_GROUP_SIZE 64
+
+FLightCulling::FLightCulling()
+{
+    Device = VK_NULL_HANDLE;
+    BindlessHeap = nullptr;
+    PipelineLayout = VK_NULL_HANDLE;
+    Pipeline = VK_NULL_HANDLE;
+    bAsyncCompute = false;
+    ClusterBufferSize = 0;
+    for(uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        ClusterBuffers[i] = VK_NULL_HANDLE;
+        ClusterMemory[i] = VK_NULL_HANDLE;
+        ClusterBufferIndices[i] = BINDLESS_INVALID_INDEX;
+    }
+}
+
+void FLightCulling::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+    VkPipelineLayout InPipelineLayout, uint32_t FramesInFlight, uint32_t GraphicsQueueFamily, uint32_t AsyncComputeQueueFamily)
+{
+    SCOPED_ZONE("FLightCulling::Init");
+    Device = InDevice;
+    BindlessHeap = InBindlessHeap;
+    PipelineLayout = InPipelineLayout;
+    bAsyncCompute = AsyncComputeQueueFamily != VK_QUEUE_FAMILY_IGNORED;
+    const uint32_t QueueFamilies[] = { GraphicsQueueFamily, AsyncComputeQueueFamily };
+
+    FComputePipelineDesc Desc;
+    Desc.ComputeShader = FPaths::GetShaderDirectory() + "/ClusterLights.comp.spv";
+    Desc.PipelineLayout = PipelineLayout;
+    Pipeline = PipelineStateCache.GetComputePipelineBlocking(Desc);
+    checkf(Pipeline != VK_NULL_HANDLE, "FLightCulling::Init Unable to create light culling pipeline");
+
+    // Every cluster has its light count followed by room for the maximum number of light indices
+    const uint32_t ClusterCount = LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z;
+    ClusterBufferSize = static_cast<VkDeviceSize>(ClusterCount) * (LIGHT_GRID_MAX_LIGHTS_PER_CLUSTER + 1) * sizeof(uint32_t);
+    for(uint32_t i = 0; i < FramesInFlight; i++)
+    {
+        VkBufferCreateInfo BufferInfo = {};
+        BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        BufferInfo.size = ClusterBufferSize;
+        BufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        // Written on the compute queue and read by lighting on the graphics queue, the graph has no buffer ownership transfers
+        BufferInfo.sharingMode = bAsyncCompute ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        BufferInfo.queueFamilyIndexCount = bAsyncCompute ? 2 : 0;
+        BufferInfo.pQueueFamilyIndices = bAsyncCompute ? QueueFamilies : nullptr;
+        if(vkCreateBuffer(Device, &BufferInfo, nullptr, &ClusterBuffers[i]) != VK_SUCCESS)
+        {
+            checkf(0, "FLightCulling: unable to create cluster buffer");
+        }
+
+        VkMemoryRequirements MemoryRequirements;
+        vkGetBufferMemoryRequirements(Device, ClusterBuffers[i], &MemoryRequirements);
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = MemoryRequirements.size;
+        AllocateInfo.memoryTypeIndex = FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &ClusterMemory[i]) != VK_SUCCESS)
+        {
+            checkf(0, "FLightCulling: unable to allocate cluster memory");
+        }
+        vkBindBufferMemory(Device, ClusterBuffers[i], ClusterMemory[i], 0);
+        ClusterBufferIndices[i] = BindlessHeap->RegisterStorageBuffer(ClusterBuffers[i]);
+    }
+
+    LOG_Info("Light culling: %ux%ux%u clusters of up to %u lights, %.2f MB per frame in flight", LIGHT_GRID_X, LIGHT_GRID_Y, LIGHT_GRID_Z,
+        LIGHT_GRID_MAX_LIGHTS_PER_CLUSTER, ClusterBufferSize / (1024.0 * 1024.0));
+}
+
+void FLightCulling::Shutdown()
+{
+    for(uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if(ClusterBuffers[i] == VK_NULL_HANDLE) continue;
+
+        BindlessHeap->Release(BINDLESS_StorageBuffers, ClusterBufferIndices[i]);
+        vkDestroyBuffer(Device, ClusterBuffers[i], nullptr);
+        vkFreeMemory(Device, ClusterMemory[i], nullptr);
+        ClusterBuffers[i] = VK_NULL_HANDLE;
+        ClusterMemory[i] = VK_NULL_HANDLE;
+        ClusterBufferIndices[i] = BINDLESS_INVALID_INDEX;
+    }
+}
+
+FLightGridConstants FLightCulling::UploadLights(const std::vector<FLight>& Lights, FTransientBuffer& TransientBuffer, uint32_t TransientBindlessIndex) const
+{
+    SCOPED_ZONE("FLightCulling::UploadLights");
+    FLightGridConstants Constants;
+    Constants.LightBufferIndex = TransientBindlessIndex;
+    Constants.LightOffset = 0;
+    Constants.LightCount = static_cast<uint32_t>(Lights.size());
+    Constants.ClusterBufferIndex = BINDLESS_INVALID_INDEX;
+    Constants.MaxLightsPerCluster = LIGHT_GRID_MAX_LIGHTS_PER_CLUSTER;
+    Constants.NearDepth = 0.05f;
+    Constants.FarDepth = 1.0f;
+    if(Lights.empty()) return Constants;
+
+    const FTransientAllocation Allocation = TransientBuffer.Allocate(Lights.size() * sizeof(FGpuLight), sizeof(FGpuLight));
+    Constants.LightOffset = static_cast<uint32_t>(Allocation.Offset / sizeof(float));
+    FGpuLight* GpuLights = static_cast<FGpuLight*>(Allocation.Data);
+    for(size_t i = 0; i < Lights.size(); i++)
+    {
+        const FLight& Light = Lights[i];
+        const FGpuLight GpuLight = {
+            { Light.Position.x, Light.Position.y, Light.Position.z, Light.Radius },
+            { Light.Color.r, Light.Color.g, Light.Color.b, Light.Intensity },
+            { Light.Direction.x, Light.Direction.y, Light.Direction.z, static_cast<float>(Light.Type) },
+            { std::cos(Light.InnerAngle), std::cos(Light.OuterAngle), 0.0f, 0.0f }
+        };
+        // Mapped memory is only ever written, one copy per light
+        memcpy(&GpuLights[i], &GpuLight, sizeof(FGpuLight));
+    }
+    return Constants;
+}
+
+FRenderGraphBuffer FLightCulling::AddCullingPass(FRenderGraph& RenderGraph, FLightGridConstants& Constants, uint32_t FrameIndex)
+{
+    check(FrameIndex < MAX_FRAMES_IN_FLIGHT && ClusterBuffers[FrameIndex] != VK_NULL_HANDLE);
+    Constants.ClusterBufferIndex = ClusterBufferIndices[FrameIndex];
+    const FRenderGraphBuffer Clusters = RenderGraph.ImportBuffer("LightClusters", ClusterBuffers[FrameIndex], ClusterBufferSize);
+
+    // Only the lights are read, uploaded before the frame is submitted. On the async queue it overlaps the shadow and
+    // culling passes, lighting and the geometry render pass it's merged into wait for it.
+    const FLightGridConstants PassConstants = Constants;
+    FRenderGraphPass& Pass = RenderGraph.AddPass("LightCulling");
+    if(bAsyncCompute)
+    {
+        Pass.UseAsyncCompute();
+    }
+    Pass.WriteBuffer(Clusters)
+        .SetExecute([this, PassConstants](const FRenderGraphPassContext& Context)
+        {
+            vkCmdBindPipeline(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+            BindlessHeap->Bind(Context.CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout);
+            vkCmdPushConstants(Context.CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FLightGridConstants), &PassConstants);
+            const uint32_t ClusterCount = LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z;
+            vkCmdDispatch(Context.CommandBuffer, (ClusterCount + LIGHT_CULLING_GROUP_SIZE - 1) / LIGHT_CULLING_GROUP_SIZE, 1, 1);
+        });
+    return Clusters;
+}
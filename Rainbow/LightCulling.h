@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "Light.h"
+#include "MinimalCore.h"
+#include "RenderGraph.h"
+#include "RendererSettings.h"
+
+class FBindlessHeap;
+class FPipelineStateCache;
+class FTransientBuffer;
+
+// Cluster grid dimensions, must match LIGHT_GRID_* in Shaders/Lights.glsl. The grid is the same at every resolution,
+// tiles get larger with the viewport and the cluster buffers never have to be reallocated.
+#define LIGHT_GRID_X 16
+#define LIGHT_GRID_Y 9
+#define LIGHT_GRID_Z 24
+// Lights past this many in one cluster are dropped
+#define LIGHT_GRID_MAX_LIGHTS_PER_CLUSTER 128
+
+// Must match FLightGrid in Shaders/Lights.glsl, pushed to the culling pass and as part of the lighting pass's constants
+struct FLightGridConstants
+{
+    uint32_t LightBufferIndex;
+    // In floats from the start of the light buffer
+    uint32_t LightOffset;
+    uint32_t LightCount;
+    // BINDLESS_INVALID_INDEX without culling, lighting then loops over every light
+    uint32_t ClusterBufferIndex;
+    uint32_t MaxLightsPerCluster;
+    // Depth slices are spaced logarithmically between these, everything closer than NearDepth is in the first slice
+    float NearDepth;
+    float FarDepth;
+};
+
+// Bins the world's lights into a 3D grid of screen tiles by depth slices on the GPU, so lighting only evaluates the
+// lights of the pixel's cluster. Lights are uploaded every frame into the frame's transient buffer, each frame in flight
+// writes its own cluster buffer.
+class FLightCulling
+{
+public:
+    FLightCulling();
+
+    // With an async compute family the culling pass runs on that queue, overlapping the graphics passes before lighting,
+    // and the cluster buffers are shared between both families
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+        VkPipelineLayout InPipelineLayout, uint32_t FramesInFlight, uint32_t GraphicsQueueFamily, uint32_t AsyncComputeQueueFamily);
+    void Shutdown();
+
+    // Lights packed into the frame's transient buffer, registered in the global set as TransientBindlessIndex
+    FLightGridConstants UploadLights(const std::vector<FLight>& Lights, FTransientBuffer& TransientBuffer, uint32_t TransientBindlessIndex) const;
+    // Adds the compute pass filling the frame's cluster grid, lighting passes read the returned buffer
+    FRenderGraphBuffer AddCullingPass(FRenderGraph& RenderGraph, FLightGridConstants& Constants, uint32_t FrameIndex);
+
+private:
+    VkDevice Device;
+    FBindlessHeap* BindlessHeap;
+    VkPipelineLayout PipelineLayout;
+    VkPipeline Pipeline;
+    bool bAsyncCompute;
+    VkDeviceSize ClusterBufferSize;
+    VkBuffer ClusterBuffers[MAX_FRAMES_IN_FLIGHT];
+    VkDeviceMemory ClusterMemory[MAX_FRAMES_IN_FLIGHT];
+    uint32_t ClusterBufferIndices[MAX_FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FMappedFile::FMappedFile()
+{
+    Data = nullptr;
+    Size = 0;
+#ifdef _WIN32
+    FileHandle = INVALID_HANDLE_VALUE;
+    MappingHandle = nullptr;
+#else
+    FileDescriptor = -1;
+#endif
+}
+
+FMappedFile::~FMappedFile()
+{
+    Close();
+}
+
+bool FMappedFile::Open(const std::string& FilePath)
+{
+    Close();
+
+#ifdef _WIN32
+    FileHandle = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(FileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize;
+    if(!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(MappingHandle == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    Data = static_cast<const uint8_t*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+    Size = static_cast<size_t>(FileSize.QuadPart);
+#else
+    FileDescriptor = open(FilePath.c_str(), O_RDONLY);
+    if(FileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat FileStat;
+    if(fstat(FileDescriptor, &FileStat) != 0 || FileStat.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* View = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+    if(View != MAP_FAILED)
+    {
+        Data = static_cast<const uint8_t*>(View);
+        Size = static_cast<size_t>(FileStat.st_size);
+    }
+#endif
+
+    if(Data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void FMappedFile::Close()
+{
+#ifdef _WIN32
+    if(Data)
+    {
+        UnmapViewOfFile(Data);
+    }
+    if(MappingHandle)
+    {
+        CloseHandle(MappingHandle);
+    }
+    if(FileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(FileHandle);
+    }
+    FileHandle = INVALID_HANDLE_VALUE;
+    MappingHandle = nullptr;
+#else
+    if(Data)
+    {
+        munmap(const_cast<uint8_t*>(Data), Size);
+    }
+    if(FileDescriptor >= 0)
+    {
+        close(FileDescriptor);
+    }
+    FileDescriptor = -1;
+#endif
+    Data = nullptr;
+    Size = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file, the view stays valid until Close() or destruction
+class FMappedFile
+{
+public:
+    FMappedFile();
+    ~FMappedFile();
+    FMappedFile(const FMappedFile&) = delete;
+    FMappedFile& operator=(const FMappedFile&) = delete;
+
+    bool Open(const std::string& FilePath);
+    void Close();
+
+    bool IsOpen() const { return Data != nullptr; }
+    const uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+private:
+    const uint8_t* Data;
+    size_t Size;
+#ifdef _WIN32
+    void* FileHandle;
+    void* MappingHandle;
+#else
+    int FileDescriptor;
+#endif
+};
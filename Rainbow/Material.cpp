@@ -1,6 +1,14 @@
 #include "Material.h"
+#include "CommandList.h"
+#include "Renderer.h"
 
 void FMaterial::LoadFromFile(std::string FilePath)
 {
     
 }
+
+void FMaterial::CreateFromTexels(uint32_t Width, uint32_t Height, const std::vector<uint32_t>& Texels)
+{
+    check(Texels.size() == static_cast<size_t>(Width) * Height);
+    BaseColor = FRenderer::GetCommandList().UploadTexture(Width, Height, VK_FORMAT_R8G8B8A8_UNORM, Texels.data(), Texels.size() * sizeof(uint32_t));
+}
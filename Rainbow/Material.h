@@ -1,12 +1,19 @@
 #pragma once
 #include "MinimalCore.h"
+#include "RenderResource.h"
 #include <string>
+#include <vector>
 
 class FMaterial
 {
 public:
     void LoadFromFile(std::string FilePath);
-    
+    // Base color from RGBA8 texels, uploaded right away
+    void CreateFromTexels(uint32_t Width, uint32_t Height, const std::vector<uint32_t>& Texels);
+
+    // Bindless slot of the base color, BINDLESS_INVALID_INDEX when the material has none
+    uint32_t GetTextureIndex() const { return BaseColor.BindlessIndex; }
+
 private:
-    
+    FTexture BaseColor;
 };
@@ -1,29 +1,65 @@
-#include "MeshActor.h"
+﻿#include "MeshActor.h"
+#include <algorithm>
 #include <vector>
+#include <glm/glm.hpp>
 #include "FbxImport.h"
 #include "CommandList.h"
 #include "RenderResource.h"
 #include "Renderer.h"
+#include "World.h"
 
 FMeshActor::FMeshActor()
 {
     VertexBuffer = nullptr;
+    Material = nullptr;
 }
 
 void FMeshActor::LoadActor(std::string FilePath)
 {
+    SCOPED_ZONE("FMeshActor::LoadActor");
     FActor::LoadActor(FilePath);
+    // Another actor of the world already loaded this file
+    FWorld* World = GetWorld();
+    if(FVertexBuffer* SharedMesh = World ? World->FindMesh(FilePath) : nullptr)
+    {
+        VertexBuffer = SharedMesh;
+        return;
+    }
+
     std::vector<uint32_t> IndicesData;
     std::vector<FStaticVertex> VertexData;
     if(FFbxImport::GetStaticMeshData(FilePath, VertexData, IndicesData))
     {
         LOG_Info("Loading static mesh, VertexData:%i, IndicesData:%i", VertexData.size(), IndicesData.size());
         VertexBuffer = FRenderer::GetCommandList().CreateVertexBuffer(VertexData, IndicesData);
+        if(World)
+        {
+            World->AddMesh(FilePath, VertexBuffer);
+        }
 
         return;
     }
 }
 
+bool FMeshActor::GetWorldBounds(glm::vec4& OutSphere, glm::vec3& OutBoxCenter, glm::vec3& OutBoxExtent) const
+{
+    if(!VertexBuffer)
+    {
+        return false;
+    }
+
+    const glm::mat4 Transform = GetTransform();
+    OutBoxCenter = glm::vec3(Transform * glm::vec4(VertexBuffer->BoundsCenter, 1.0f));
+    // The rotated box is bounded by the absolute value of the rotation and scale applied to the extent
+    const glm::mat3 Basis(Transform);
+    const glm::mat3 AbsBasis(glm::abs(Basis[0]), glm::abs(Basis[1]), glm::abs(Basis[2]));
+    OutBoxExtent = AbsBasis * VertexBuffer->BoundsExtent;
+    // Scaled by the largest axis so rotated and non uniformly scaled meshes stay inside
+    const float Scale = std::max(glm::length(Basis[0]), std::max(glm::length(Basis[1]), glm::length(Basis[2])));
+    OutSphere = glm::vec4(OutBoxCenter, VertexBuffer->BoundsRadius * Scale);
+    return true;
+}
+
 bool FMeshActor::IsValid() const
 {
     return VertexBuffer && VertexBuffer->VertexBuffer != VK_NULL_HANDLE;
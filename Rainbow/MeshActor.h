@@ -2,6 +2,8 @@
 #include "Actor.h"
 #include "RenderResource.h"
 
+class FMaterial;
+
 class FMeshActor : public FActor
 {
 public:
@@ -10,7 +12,17 @@ public:
     virtual void LoadActor(std::string FilePath) override;
     virtual bool IsValid() const override;
 
-    
+    const FVertexBuffer* GetVertexBuffer() const { return VertexBuffer; }
+    // Meshes can be shared between actors, the actor doesn't own them
+    void SetVertexBuffer(FVertexBuffer* InVertexBuffer) { VertexBuffer = InVertexBuffer; }
+
+    // World space bounds of the mesh under the actor's transform, false without a mesh
+    bool GetWorldBounds(glm::vec4& OutSphere, glm::vec3& OutBoxCenter, glm::vec3& OutBoxExtent) const;
+
+    const FMaterial* GetMaterial() const { return Material; }
+    void SetMaterial(const FMaterial* InMaterial) { Material = InMaterial; }
+
 private:
     FVertexBuffer* VertexBuffer;
+    const FMaterial* Material;
 };
@@ -1,3 +1,4 @@
 ﻿#pragma once
 #include "Assertions.h"
+#include "CpuProfiler.h"
 #include "Logs.h"
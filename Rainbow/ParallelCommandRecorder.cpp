@@ -0,0 +1,126 @@
+#include "ParallelCommandRecorder.h"
+#include <algorithm>
+#include "JobSystem.h"
+
+FParallelCommandRecorder::FParallelCommandRecorder()
+{
+    Device = VK_NULL_HANDLE;
+    MaxSlices = 1;
+    SliceLimit = 1;
+    MinItemsPerSlice = 1;
+    CurrentFrame = 0;
+    NumSlicesLastRecord = 0;
+}
+
+void FParallelCommandRecorder::Init(VkDevice InDevice, uint32_t QueueFamilyIndex, uint32_t FramesInFlight, uint32_t InMaxSlices, uint32_t InMinItemsPerSlice)
+{
+    Device = InDevice;
+    MaxSlices = std::max(InMaxSlices, 1u);
+    SliceLimit = MaxSlices;
+    MinItemsPerSlice = std::max(InMinItemsPerSlice, 1u);
+    CurrentFrame = 0;
+
+    Contexts.resize(FramesInFlight);
+    for(std::vector<FSliceContext>& FrameContexts : Contexts)
+    {
+        FrameContexts.resize(MaxSlices);
+        for(FSliceContext& Context : FrameContexts)
+        {
+            VkCommandPoolCreateInfo PoolInfo = {};
+            PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            PoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            PoolInfo.queueFamilyIndex = QueueFamilyIndex;
+            if(vkCreateCommandPool(Device, &PoolInfo, nullptr, &Context.CommandPool) != VK_SUCCESS)
+            {
+                checkf(0, "FParallelCommandRecorder: unable to create command pool");
+            }
+            Context.NumUsed = 0;
+        }
+    }
+    LOG_Info("Parallel command recording: up to %u slices, at least %u items per slice", MaxSlices, MinItemsPerSlice);
+}
+
+void FParallelCommandRecorder::Shutdown()
+{
+    for(std::vector<FSliceContext>& FrameContexts : Contexts)
+    {
+        for(FSliceContext& Context : FrameContexts)
+        {
+            vkDestroyCommandPool(Device, Context.CommandPool, nullptr);
+        }
+    }
+    Contexts.clear();
+}
+
+void FParallelCommandRecorder::BeginFrame(uint32_t FrameIndex)
+{
+    CurrentFrame = FrameIndex;
+    for(FSliceContext& Context : Contexts[CurrentFrame])
+    {
+        // Buffers stay allocated, resetting the pool puts them all back in the initial state
+        vkResetCommandPool(Device, Context.CommandPool, 0);
+        Context.NumUsed = 0;
+    }
+}
+
+VkCommandBuffer FParallelCommandRecorder::AcquireSecondary(FSliceContext& Context)
+{
+    if(Context.NumUsed == Context.CommandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        AllocateInfo.commandPool = Context.CommandPool;
+        AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        AllocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+        vkAllocateCommandBuffers(Device, &AllocateInfo, &CommandBuffer);
+        Context.CommandBuffers.push_back(CommandBuffer);
+    }
+    return Context.CommandBuffers[Context.NumUsed++];
+}
+
+void FParallelCommandRecorder::SetSliceLimit(uint32_t InSliceLimit)
+{
+    SliceLimit = std::clamp(InSliceLimit, 1u, MaxSlices);
+}
+
+void FParallelCommandRecorder::Record(VkCommandBuffer Primary, VkRenderPass RenderPass, uint32_t Subpass, VkFramebuffer Framebuffer, uint32_t NumItems, const FRecordSlice& RecordSlice)
+{
+    const uint32_t NumSlices = std::clamp((NumItems + MinItemsPerSlice - 1) / MinItemsPerSlice, 1u, SliceLimit);
+    const uint32_t ItemsPerSlice = (NumItems + NumSlices - 1) / NumSlices;
+    NumSlicesLastRecord = NumSlices;
+
+    // Buffers are picked on this thread, workers only record
+    std::vector<VkCommandBuffer> Secondaries(NumSlices);
+    for(uint32_t Slice = 0; Slice < NumSlices; Slice++)
+    {
+        Secondaries[Slice] = AcquireSecondary(Contexts[CurrentFrame][Slice]);
+    }
+
+    VkCommandBufferInheritanceInfo InheritanceInfo = {};
+    InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    InheritanceInfo.renderPass = RenderPass;
+    InheritanceInfo.subpass = Subpass;
+    InheritanceInfo.framebuffer = Framebuffer;
+
+    FJobSystem::Get().ParallelFor(NumSlices, [&](uint32_t Slice)
+    {
+        SCOPED_ZONE("RecordSlice");
+        const VkCommandBuffer CommandBuffer = Secondaries[Slice];
+
+        VkCommandBufferBeginInfo BeginInfo = {};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        BeginInfo.pInheritanceInfo = &InheritanceInfo;
+        vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
+
+        const uint32_t FirstItem = std::min(Slice * ItemsPerSlice, NumItems);
+        const uint32_t EndItem = std::min(FirstItem + ItemsPerSlice, NumItems);
+        RecordSlice(CommandBuffer, FirstItem, EndItem);
+
+        vkEndCommandBuffer(CommandBuffer);
+    });
+
+    vkCmdExecuteCommands(Primary, NumSlices, Secondaries.data());
+}
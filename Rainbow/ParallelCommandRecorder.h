@@ -0,0 +1,53 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+
+// Records a draw list in parallel on the job system. The list is cut into contiguous slices, each slice is recorded
+// into a secondary command buffer from its own pool (one pool per slice per frame in flight, so no pool is ever shared
+// between threads) and the secondaries are executed from the primary in slice order, the result does not depend on
+// which worker recorded what.
+class FParallelCommandRecorder
+{
+public:
+    typedef std::function<void(VkCommandBuffer CommandBuffer, uint32_t FirstItem, uint32_t EndItem)> FRecordSlice;
+
+    FParallelCommandRecorder();
+
+    void Init(VkDevice InDevice, uint32_t QueueFamilyIndex, uint32_t FramesInFlight, uint32_t InMaxSlices, uint32_t InMinItemsPerSlice);
+    void Shutdown();
+
+    // Resets the frame's pools, its ticket must be complete
+    void BeginFrame(uint32_t FrameIndex);
+
+    // Primary must be inside RenderPass/Subpass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    // RecordSlice is called concurrently and must only record into the buffer it's given.
+    void Record(VkCommandBuffer Primary, VkRenderPass RenderPass, uint32_t Subpass, VkFramebuffer Framebuffer, uint32_t NumItems, const FRecordSlice& RecordSlice);
+
+    // Caps the slices of the following records, and with them the threads recording, between 1 and the slices Init made room for
+    void SetSliceLimit(uint32_t InSliceLimit);
+    uint32_t GetMaxSlices() const { return MaxSlices; }
+    uint32_t GetSliceLimit() const { return SliceLimit; }
+    uint32_t GetNumSlicesLastRecord() const { return NumSlicesLastRecord; }
+
+private:
+    struct FSliceContext
+    {
+        VkCommandPool CommandPool;
+        std::vector<VkCommandBuffer> CommandBuffers;
+        uint32_t NumUsed;
+    };
+
+    VkCommandBuffer AcquireSecondary(FSliceContext& Context);
+
+private:
+    VkDevice Device;
+    uint32_t MaxSlices;
+    uint32_t SliceLimit;
+    uint32_t MinItemsPerSlice;
+    uint32_t CurrentFrame;
+    uint32_t NumSlicesLastRecord;
+    // [frame in flight][slice]
+    std::vector<std::vector<FSliceContext>> Contexts;
+};
@@ -1,20 +1,42 @@
 #include "Paths.h"
 
+#ifdef _WIN32
 #include <codecvt>
 #include <locale>
 #include <windows.h>
+#else
+#include <climits>
+#include <unistd.h>
+#endif
 
 std::string FPaths::GetProjectDirectory()
 {
+#ifdef _WIN32
     wchar_t szPath[MAX_PATH];
     GetModuleFileNameW( NULL, szPath, MAX_PATH );
     std::wstring wideStr(szPath);
     std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
     std::string exePath = converter.to_bytes(wideStr);
-    return exePath.substr(0, exePath.find_last_of("\\/")); 
+#else
+    char szPath[PATH_MAX];
+    const ssize_t length = readlink("/proc/self/exe", szPath, sizeof(szPath) - 1);
+    std::string exePath(szPath, length > 0 ? static_cast<size_t>(length) : 0);
+#endif
+    return exePath.substr(0, exePath.find_last_of("\\/"));
 }
 
+// Forward slashes work on every platform, callers append with them too
 std::string FPaths::GetContentDirectory()
 {
-    return GetProjectDirectory() + "\\Content";
+    return GetProjectDirectory() + "/Content";
+}
+
+std::string FPaths::GetShaderDirectory()
+{
+    return GetContentDirectory() + "/Shaders";
+}
+
+std::string FPaths::GetSavedDirectory()
+{
+    return GetProjectDirectory() + "/Saved";
 }
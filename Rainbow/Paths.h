@@ -6,4 +6,6 @@ class FPaths
 public:
     static std::string GetProjectDirectory();
     static std::string GetContentDirectory();
+    static std::string GetShaderDirectory();
+    static std::string GetSavedDirectory();
 };
@@ -0,0 +1,157 @@
+#include "PipelineCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "Hash.h"
+#include "MappedFile.h"
+
+static constexpr uint32_t PipelineCacheMagic = 0x43504252; // "RBPC"
+static constexpr uint32_t PipelineCacheVersion = 1;
+
+FPipelineCache::FPipelineCache()
+{
+    Device = VK_NULL_HANDLE;
+    PipelineCache = VK_NULL_HANDLE;
+    DeviceProperties = {};
+    DeviceIDProperties = {};
+    bWarm = false;
+}
+
+void FPipelineCache::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, const std::string& InFilePath)
+{
+    Device = InDevice;
+    FilePath = InFilePath;
+
+    DeviceIDProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 Properties = {};
+    Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    Properties.pNext = &DeviceIDProperties;
+    vkGetPhysicalDeviceProperties2(PhysicalDevice, &Properties);
+    DeviceProperties = Properties.properties;
+    DeviceIDProperties.pNext = nullptr;
+
+    VkPipelineCacheCreateInfo CreateInfo = {};
+    CreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    // The mapping has to outlive vkCreatePipelineCache, the driver copies the data
+    FMappedFile File;
+    if(File.Open(FilePath) && File.GetSize() > sizeof(FFileHeader))
+    {
+        FFileHeader Header;
+        memcpy(&Header, File.GetData(), sizeof(FFileHeader));
+        const uint8_t* Data = File.GetData() + sizeof(FFileHeader);
+        const size_t Size = File.GetSize() - sizeof(FFileHeader);
+        if(IsCompatible(Header, Data, Size))
+        {
+            CreateInfo.initialDataSize = Size;
+            CreateInfo.pInitialData = Data;
+        }
+        else
+        {
+            LOG_Warning("Pipeline cache %s was written by another device or driver, starting cold", FilePath.c_str());
+        }
+    }
+
+    if(vkCreatePipelineCache(Device, &CreateInfo, nullptr, &PipelineCache) != VK_SUCCESS)
+    {
+        checkf(0, "FPipelineCache: unable to create pipeline cache");
+    }
+    bWarm = CreateInfo.initialDataSize > 0;
+    LOG_Info("Pipeline cache %s (%zu bytes)", bWarm ? "warm" : "cold", CreateInfo.initialDataSize);
+}
+
+void FPipelineCache::Save()
+{
+    if(PipelineCache == VK_NULL_HANDLE) return;
+
+    size_t Size = 0;
+    vkGetPipelineCacheData(Device, PipelineCache, &Size, nullptr);
+    std::vector<uint8_t> Data(Size);
+    if(Size == 0 || vkGetPipelineCacheData(Device, PipelineCache, &Size, Data.data()) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    FFileHeader Header = MakeHeader();
+    Header.DataSize = Size;
+    Header.DataHash = HashBytes(Data.data(), Size);
+
+    // Write next to the target and swap, a crash mid-write must never leave a truncated cache behind
+    std::error_code ErrorCode;
+    const std::filesystem::path TargetPath(FilePath);
+    if(TargetPath.has_parent_path())
+    {
+        std::filesystem::create_directories(TargetPath.parent_path(), ErrorCode);
+    }
+    const std::string TempPath = FilePath + ".tmp";
+    {
+        std::ofstream Stream(TempPath, std::ios::binary | std::ios::trunc);
+        if(!Stream)
+        {
+            LOG_Warning("Unable to write pipeline cache %s", TempPath.c_str());
+            return;
+        }
+        Stream.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        Stream.write(reinterpret_cast<const char*>(Data.data()), static_cast<std::streamsize>(Size));
+    }
+    std::filesystem::rename(TempPath, TargetPath, ErrorCode);
+    if(ErrorCode)
+    {
+        LOG_Warning("Unable to replace pipeline cache %s", FilePath.c_str());
+        return;
+    }
+    LOG_Info("Pipeline cache saved (%zu bytes)", Size);
+}
+
+void FPipelineCache::Shutdown()
+{
+    if(PipelineCache == VK_NULL_HANDLE) return;
+
+    Save();
+    vkDestroyPipelineCache(Device, PipelineCache, nullptr);
+    PipelineCache = VK_NULL_HANDLE;
+}
+
+FPipelineCache::FFileHeader FPipelineCache::MakeHeader() const
+{
+    FFileHeader Header = {};
+    Header.Magic = PipelineCacheMagic;
+    Header.Version = PipelineCacheVersion;
+    Header.VendorID = DeviceProperties.vendorID;
+    Header.DeviceID = DeviceProperties.deviceID;
+    Header.DriverVersion = DeviceProperties.driverVersion;
+    memcpy(Header.DriverUUID, DeviceIDProperties.driverUUID, VK_UUID_SIZE);
+    memcpy(Header.PipelineCacheUUID, DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+    return Header;
+}
+
+bool FPipelineCache::IsCompatible(const FFileHeader& Header, const uint8_t* Data, size_t Size) const
+{
+    const FFileHeader Expected = MakeHeader();
+    if(Header.Magic != Expected.Magic || Header.Version != Expected.Version
+        || Header.VendorID != Expected.VendorID || Header.DeviceID != Expected.DeviceID
+        || Header.DriverVersion != Expected.DriverVersion
+        || memcmp(Header.DriverUUID, Expected.DriverUUID, VK_UUID_SIZE) != 0
+        || memcmp(Header.PipelineCacheUUID, Expected.PipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        return false;
+    }
+
+    if(Header.DataSize != Size || Header.DataHash != HashBytes(Data, Size))
+    {
+        return false;
+    }
+
+    // The driver blob carries its own header, check it too so a corrupted file never reaches the driver
+    VkPipelineCacheHeaderVersionOne DriverHeader;
+    if(Size < sizeof(DriverHeader))
+    {
+        return false;
+    }
+    memcpy(&DriverHeader, Data, sizeof(DriverHeader));
+    return DriverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && DriverHeader.vendorID == Expected.VendorID
+        && DriverHeader.deviceID == Expected.DeviceID
+        && memcmp(DriverHeader.pipelineCacheUUID, Expected.PipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
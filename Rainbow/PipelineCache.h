@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+
+// VkPipelineCache persisted between runs. The blob is only reused when vendor, device, driver version,
+// driver UUID and pipeline cache UUID all match the current device, otherwise the cache starts cold.
+class FPipelineCache
+{
+public:
+    FPipelineCache();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, const std::string& InFilePath);
+    void Save();
+    void Shutdown();
+
+    VkPipelineCache GetHandle() const { return PipelineCache; }
+    bool IsWarm() const { return bWarm; }
+
+private:
+    struct FFileHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t VendorID;
+        uint32_t DeviceID;
+        uint32_t DriverVersion;
+        uint8_t DriverUUID[VK_UUID_SIZE];
+        uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t DataSize;
+        uint64_t DataHash;
+    };
+
+    FFileHeader MakeHeader() const;
+    bool IsCompatible(const FFileHeader& Header, const uint8_t* Data, size_t Size) const;
+
+private:
+    VkDevice Device;
+    VkPipelineCache PipelineCache;
+    VkPhysicalDeviceProperties DeviceProperties;
+    VkPhysicalDeviceIDProperties DeviceIDProperties;
+    std::string FilePath;
+    bool bWarm;
+};
@@ -0,0 +1,719 @@
+#include "PipelineStateCache.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Hash.h"
+#include "JobSystem.h"
+#include "PipelineCache.h"
+#include "RenderResource.h"
+#include "ShaderCache.h"
+
+FGraphicsPipelineDesc::FGraphicsPipelineDesc()
+{
+    VertexFormat = EVertexFormat::None;
+    Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    PolygonMode = VK_POLYGON_MODE_FILL;
+    CullMode = VK_CULL_MODE_BACK_BIT;
+    FrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    DepthBiasConstant = 0.0f;
+    DepthBiasSlope = 0.0f;
+    bDepthTest = true;
+    bDepthWrite = true;
+    DepthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    BlendMode = EBlendMode::Opaque;
+    ColorAttachmentCount = 0;
+    for(VkFormat& ColorFormat : ColorFormats)
+    {
+        ColorFormat = VK_FORMAT_UNDEFINED;
+    }
+    DepthFormat = VK_FORMAT_UNDEFINED;
+    Samples = VK_SAMPLE_COUNT_1_BIT;
+    RenderPass = VK_NULL_HANDLE;
+    Subpass = 0;
+    PipelineLayout = VK_NULL_HANDLE;
+    FragmentConstantCount = 0;
+    for(uint32_t& FragmentConstant : FragmentConstants)
+    {
+        FragmentConstant = 0;
+    }
+}
+
+// All fixed function state of a desc, shared by the monolithic and the library build paths
+struct FPipelineStateInfos
+{
+    std::vector<VkPipelineShaderStageCreateInfo> VertexStages;
+    std::vector<VkPipelineShaderStageCreateInfo> FragmentStages;
+    std::array<uint32_t, PSO_MAX_SPECIALIZATION_CONSTANTS> FragmentConstants;
+    std::array<VkSpecializationMapEntry, PSO_MAX_SPECIALIZATION_CONSTANTS> FragmentConstantEntries;
+    VkSpecializationInfo FragmentSpecialization;
+    VkVertexInputBindingDescription VertexBinding;
+    std::array<VkVertexInputAttributeDescription, 4> VertexAttributes;
+    VkPipelineVertexInputStateCreateInfo VertexInputState;
+    VkPipelineInputAssemblyStateCreateInfo InputAssemblyState;
+    VkPipelineRasterizationStateCreateInfo RasterizationState;
+    std::array<VkPipelineColorBlendAttachmentState, PSO_MAX_COLOR_ATTACHMENTS> BlendAttachmentStates;
+    VkPipelineColorBlendStateCreateInfo ColorBlendState;
+    VkPipelineDepthStencilStateCreateInfo DepthStencilState;
+    VkPipelineViewportStateCreateInfo ViewportState;
+    VkPipelineMultisampleStateCreateInfo MultisampleState;
+    std::array<VkDynamicState, 2> DynamicStateEnables;
+    VkPipelineDynamicStateCreateInfo DynamicState;
+
+    FPipelineStateInfos(const FGraphicsPipelineDesc& Desc, FShaderCache& ShaderCache);
+    FPipelineStateInfos(const FPipelineStateInfos&) = delete;
+    FPipelineStateInfos& operator=(const FPipelineStateInfos&) = delete;
+};
+
+FPipelineStateInfos::FPipelineStateInfos(const FGraphicsPipelineDesc& Desc, FShaderCache& ShaderCache)
+{
+    VertexStages.push_back(ShaderCache.LoadShaderStage(Desc.VertexShader, VK_SHADER_STAGE_VERTEX_BIT));
+    if(!Desc.FragmentShader.empty())
+    {
+        FragmentStages.push_back(ShaderCache.LoadShaderStage(Desc.FragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT));
+    }
+
+    FragmentSpecialization = {};
+    check(Desc.FragmentConstantCount <= PSO_MAX_SPECIALIZATION_CONSTANTS);
+    for(uint32_t i = 0; i < Desc.FragmentConstantCount; i++)
+    {
+        FragmentConstants[i] = Desc.FragmentConstants[i];
+        FragmentConstantEntries[i] = { i, static_cast<uint32_t>(i * sizeof(uint32_t)), sizeof(uint32_t) };
+    }
+    if(Desc.FragmentConstantCount > 0 && !FragmentStages.empty())
+    {
+        FragmentSpecialization.mapEntryCount = Desc.FragmentConstantCount;
+        FragmentSpecialization.pMapEntries = FragmentConstantEntries.data();
+        FragmentSpecialization.dataSize = Desc.FragmentConstantCount * sizeof(uint32_t);
+        FragmentSpecialization.pData = FragmentConstants.data();
+        FragmentStages[0].pSpecializationInfo = &FragmentSpecialization;
+    }
+
+    VertexBinding = {};
+    VertexAttributes = {};
+    VertexInputState = {};
+    VertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    if(Desc.VertexFormat == EVertexFormat::StaticVertex)
+    {
+        VertexBinding.binding = 0;
+        VertexBinding.stride = sizeof(FStaticVertex);
+        VertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        VertexAttributes[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FStaticVertex, Position)};
+        VertexAttributes[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FStaticVertex, Normal)};
+        VertexAttributes[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(FStaticVertex, UV0)};
+        VertexAttributes[3] = {3, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FStaticVertex, Color)};
+        VertexInputState.vertexBindingDescriptionCount = 1;
+        VertexInputState.pVertexBindingDescriptions = &VertexBinding;
+        VertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(VertexAttributes.size());
+        VertexInputState.pVertexAttributeDescriptions = VertexAttributes.data();
+    }
+
+    InputAssemblyState = {};
+    InputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    InputAssemblyState.topology = Desc.Topology;
+
+    RasterizationState = {};
+    RasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    RasterizationState.polygonMode = Desc.PolygonMode;
+    RasterizationState.cullMode = Desc.CullMode;
+    RasterizationState.frontFace = Desc.FrontFace;
+    RasterizationState.depthBiasEnable = Desc.DepthBiasConstant != 0.0f || Desc.DepthBiasSlope != 0.0f;
+    RasterizationState.depthBiasConstantFactor = Desc.DepthBiasConstant;
+    RasterizationState.depthBiasSlopeFactor = Desc.DepthBiasSlope;
+    RasterizationState.lineWidth = 1.0f;
+
+    BlendAttachmentStates = {};
+    for(uint32_t i = 0; i < Desc.ColorAttachmentCount; i++)
+    {
+        VkPipelineColorBlendAttachmentState& BlendAttachmentState = BlendAttachmentStates[i];
+        BlendAttachmentState.colorWriteMask = 0xf;
+        BlendAttachmentState.blendEnable = Desc.BlendMode != EBlendMode::Opaque;
+        BlendAttachmentState.srcColorBlendFactor = Desc.BlendMode == EBlendMode::AlphaBlend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+        BlendAttachmentState.dstColorBlendFactor = Desc.BlendMode == EBlendMode::AlphaBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+        BlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+        BlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        BlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        BlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+
+    ColorBlendState = {};
+    ColorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    ColorBlendState.attachmentCount = Desc.ColorAttachmentCount;
+    ColorBlendState.pAttachments = BlendAttachmentStates.data();
+
+    DepthStencilState = {};
+    DepthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    DepthStencilState.depthTestEnable = Desc.bDepthTest;
+    DepthStencilState.depthWriteEnable = Desc.bDepthWrite;
+    DepthStencilState.depthCompareOp = Desc.DepthCompareOp;
+
+    ViewportState = {};
+    ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    ViewportState.viewportCount = 1;
+    ViewportState.scissorCount = 1;
+
+    MultisampleState = {};
+    MultisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    MultisampleState.rasterizationSamples = Desc.Samples;
+
+    DynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    DynamicState = {};
+    DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    DynamicState.dynamicStateCount = static_cast<uint32_t>(DynamicStateEnables.size());
+    DynamicState.pDynamicStates = DynamicStateEnables.data();
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+FComputePipelineDesc::FComputePipelineDesc()
+{
+    PipelineLayout = VK_NULL_HANDLE;
+    ConstantCount = 0;
+    for(uint32_t& Constant : Constants)
+    {
+        Constant = 0;
+    }
+}
+
+uint64_t FComputePipelineDesc::GetHash() const
+{
+    // Seeded apart from graphics descs, both share the cache's entries
+    uint64_t Hash = HashValue(VK_PIPELINE_BIND_POINT_COMPUTE);
+    Hash = HashCombine(Hash, HashBytes(ComputeShader.data(), ComputeShader.size()));
+    Hash = HashCombine(Hash, HashValue(PipelineLayout));
+    Hash = HashCombine(Hash, HashValue(ConstantCount));
+    Hash = HashCombine(Hash, HashBytes(Constants, sizeof(uint32_t) * ConstantCount));
+    return Hash;
+}
+
+uint64_t FGraphicsPipelineDesc::GetHash() const
+{
+    // Field by field so struct padding never leaks into the key
+    uint64_t Hash = HashBytes(VertexShader.data(), VertexShader.size());
+    Hash = HashCombine(Hash, HashBytes(FragmentShader.data(), FragmentShader.size()));
+    Hash = HashCombine(Hash, HashValue(VertexFormat));
+    Hash = HashCombine(Hash, HashValue(Topology));
+    Hash = HashCombine(Hash, HashValue(PolygonMode));
+    Hash = HashCombine(Hash, HashValue(CullMode));
+    Hash = HashCombine(Hash, HashValue(FrontFace));
+    Hash = HashCombine(Hash, HashValue(DepthBiasConstant));
+    Hash = HashCombine(Hash, HashValue(DepthBiasSlope));
+    Hash = HashCombine(Hash, HashValue(bDepthTest));
+    Hash = HashCombine(Hash, HashValue(bDepthWrite));
+    Hash = HashCombine(Hash, HashValue(DepthCompareOp));
+    Hash = HashCombine(Hash, HashValue(BlendMode));
+    Hash = HashCombine(Hash, HashValue(ColorAttachmentCount));
+    Hash = HashCombine(Hash, HashBytes(ColorFormats, sizeof(VkFormat) * ColorAttachmentCount));
+    Hash = HashCombine(Hash, HashValue(DepthFormat));
+    Hash = HashCombine(Hash, HashValue(Samples));
+    Hash = HashCombine(Hash, HashValue(RenderPass));
+    Hash = HashCombine(Hash, HashValue(Subpass));
+    Hash = HashCombine(Hash, HashValue(PipelineLayout));
+    Hash = HashCombine(Hash, HashValue(FragmentConstantCount));
+    Hash = HashCombine(Hash, HashBytes(FragmentConstants, sizeof(uint32_t) * FragmentConstantCount));
+    return Hash;
+}
+
+FPipelineStateCache::FPipelineStateCache()
+{
+    Device = VK_NULL_HANDLE;
+    ShaderCache = nullptr;
+    PipelineCache = nullptr;
+    NumPending = 0;
+    bUsePipelineLibrary = false;
+    bFastLinking = false;
+}
+
+void FPipelineStateCache::Init(VkDevice InDevice, FShaderCache* InShaderCache, FPipelineCache* InPipelineCache, bool bInUsePipelineLibrary, bool bInFastLinking)
+{
+    Device = InDevice;
+    ShaderCache = InShaderCache;
+    PipelineCache = InPipelineCache;
+    bUsePipelineLibrary = bInUsePipelineLibrary;
+    bFastLinking = bInFastLinking;
+    LOG_Info("Pipeline state cache: %s%s", bUsePipelineLibrary ? "graphics pipeline library" : "monolithic pipelines",
+        !bUsePipelineLibrary ? "" : bFastLinking ? ", fast linking" : ", linking is not fast");
+}
+
+void FPipelineStateCache::Shutdown()
+{
+    // In flight compiles write into the entries, let them land first
+    while(NumPending.load() > 0)
+    {
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::shared_mutex> Lock(Mutex);
+    for(auto& Entry : Entries)
+    {
+        vkDestroyPipeline(Device, Entry.second->Pipeline.load(), nullptr);
+    }
+    Entries.clear();
+
+    std::lock_guard<std::mutex> LibraryLock(LibraryMutex);
+    for(VkPipeline Pipeline : UnsubmittedRetiredPipelines)
+    {
+        vkDestroyPipeline(Device, Pipeline, nullptr);
+    }
+    UnsubmittedRetiredPipelines.clear();
+    for(const FRetiredPipeline& Retired : RetiredPipelines)
+    {
+        vkDestroyPipeline(Device, Retired.Pipeline, nullptr);
+    }
+    RetiredPipelines.clear();
+    for(auto& LibraryMap : Libraries)
+    {
+        for(auto& Library : LibraryMap)
+        {
+            vkDestroyPipeline(Device, Library.second, nullptr);
+        }
+        LibraryMap.clear();
+    }
+}
+
+VkPipeline FPipelineStateCache::GetPipeline(const FGraphicsPipelineDesc& Desc, VkPipeline Fallback)
+{
+    bool bCreated = false;
+    FEntry* Entry = FindOrAddEntry(Desc.GetHash(), bCreated);
+    if(bCreated)
+    {
+        NumPending++;
+        FJobSystem::Get().Enqueue([this, Desc, Entry]() { Compile(Desc, Entry); });
+        return Fallback;
+    }
+
+    return Entry->State.load(std::memory_order_acquire) == EEntryState::Ready ? Entry->Pipeline.load() : Fallback;
+}
+
+VkPipeline FPipelineStateCache::GetPipelineBlocking(const FGraphicsPipelineDesc& Desc)
+{
+    bool bCreated = false;
+    FEntry* Entry = FindOrAddEntry(Desc.GetHash(), bCreated);
+    if(bCreated)
+    {
+        NumPending++;
+        Compile(Desc, Entry);
+    }
+
+    while(Entry->State.load(std::memory_order_acquire) == EEntryState::Compiling)
+    {
+        std::this_thread::yield();
+    }
+    return Entry->Pipeline.load();
+}
+
+void FPipelineStateCache::Precompile(const FGraphicsPipelineDesc& Desc)
+{
+    GetPipeline(Desc);
+}
+
+VkPipeline FPipelineStateCache::GetComputePipelineBlocking(const FComputePipelineDesc& Desc)
+{
+    bool bCreated = false;
+    FEntry* Entry = FindOrAddEntry(Desc.GetHash(), bCreated);
+    if(bCreated)
+    {
+        const auto Start = std::chrono::steady_clock::now();
+        std::array<VkSpecializationMapEntry, PSO_MAX_SPECIALIZATION_CONSTANTS> ConstantEntries;
+        check(Desc.ConstantCount <= PSO_MAX_SPECIALIZATION_CONSTANTS);
+        for(uint32_t i = 0; i < Desc.ConstantCount; i++)
+        {
+            ConstantEntries[i] = { i, static_cast<uint32_t>(i * sizeof(uint32_t)), sizeof(uint32_t) };
+        }
+        VkSpecializationInfo Specialization = {};
+        Specialization.mapEntryCount = Desc.ConstantCount;
+        Specialization.pMapEntries = ConstantEntries.data();
+        Specialization.dataSize = Desc.ConstantCount * sizeof(uint32_t);
+        Specialization.pData = Desc.Constants;
+
+        VkComputePipelineCreateInfo PipelineCreateInfo = {};
+        PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        PipelineCreateInfo.stage = ShaderCache->LoadShaderStage(Desc.ComputeShader, VK_SHADER_STAGE_COMPUTE_BIT);
+        PipelineCreateInfo.stage.pSpecializationInfo = Desc.ConstantCount > 0 ? &Specialization : nullptr;
+        PipelineCreateInfo.layout = Desc.PipelineLayout;
+
+        VkPipeline Pipeline = VK_NULL_HANDLE;
+        if(vkCreateComputePipelines(Device, PipelineCache->GetHandle(), 1, &PipelineCreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
+        {
+            LOG_Error("Failed compiling compute pipeline %016llx (%s)", static_cast<unsigned long long>(Desc.GetHash()), Desc.ComputeShader.c_str());
+            Entry->State.store(EEntryState::Failed, std::memory_order_release);
+            return VK_NULL_HANDLE;
+        }
+
+        LOG_Info("Compiled compute pipeline %016llx (%s) in %.2f ms", static_cast<unsigned long long>(Desc.GetHash()),
+            Desc.ComputeShader.c_str(), MillisecondsSince(Start));
+        Entry->Pipeline.store(Pipeline);
+        Entry->State.store(EEntryState::Ready, std::memory_order_release);
+    }
+
+    while(Entry->State.load(std::memory_order_acquire) == EEntryState::Compiling)
+    {
+        std::this_thread::yield();
+    }
+    return Entry->Pipeline.load();
+}
+
+void FPipelineStateCache::LogLinkTimings(const FGraphicsPipelineDesc& Desc)
+{
+    if(!bUsePipelineLibrary) return;
+
+    NumPending++;
+    FJobSystem::Get().Enqueue([this, Desc]()
+    {
+        // No pipeline cache for any of the builds, otherwise they'd measure cache hits
+        auto Start = std::chrono::steady_clock::now();
+        const VkPipeline Monolithic = CreatePipeline(Desc, VK_NULL_HANDLE);
+        const double MonolithicMs = MillisecondsSince(Start);
+
+        Start = std::chrono::steady_clock::now();
+        std::array<VkPipeline, LIBRARY_Count> LibraryPipelines;
+        for(uint32_t Type = 0; Type < LIBRARY_Count; Type++)
+        {
+            LibraryPipelines[Type] = CreateLibrary(static_cast<ELibraryType>(Type), Desc, VK_NULL_HANDLE);
+        }
+        const double LibrariesMs = MillisecondsSince(Start);
+        const bool bLibrariesCreated = std::find(LibraryPipelines.begin(), LibraryPipelines.end(), VK_NULL_HANDLE) == LibraryPipelines.end();
+
+        VkPipelineLibraryCreateInfoKHR LibraryInfo = {};
+        LibraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+        LibraryInfo.libraryCount = LIBRARY_Count;
+        LibraryInfo.pLibraries = LibraryPipelines.data();
+        VkGraphicsPipelineCreateInfo LinkInfo = {};
+        LinkInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        LinkInfo.pNext = &LibraryInfo;
+        LinkInfo.layout = Desc.PipelineLayout;
+
+        VkPipeline FastLinked = VK_NULL_HANDLE;
+        VkPipeline Optimized = VK_NULL_HANDLE;
+        VkResult FastLinkResult = VK_ERROR_UNKNOWN;
+        VkResult OptimizedLinkResult = VK_ERROR_UNKNOWN;
+        double FastLinkMs = 0.0;
+        double OptimizedLinkMs = 0.0;
+        if(bLibrariesCreated)
+        {
+            Start = std::chrono::steady_clock::now();
+            FastLinkResult = vkCreateGraphicsPipelines(Device, VK_NULL_HANDLE, 1, &LinkInfo, nullptr, &FastLinked);
+            FastLinkMs = MillisecondsSince(Start);
+
+            LinkInfo.flags = VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT;
+            Start = std::chrono::steady_clock::now();
+            OptimizedLinkResult = vkCreateGraphicsPipelines(Device, VK_NULL_HANDLE, 1, &LinkInfo, nullptr, &Optimized);
+            OptimizedLinkMs = MillisecondsSince(Start);
+        }
+
+        if(!bLibrariesCreated)
+        {
+            LOG_Error("Pipeline %s: creating the libraries failed, no timings", Desc.FragmentShader.c_str());
+        }
+        else if(FastLinkResult != VK_SUCCESS || OptimizedLinkResult != VK_SUCCESS)
+        {
+            LOG_Error("Pipeline %s: linking the libraries failed (%d, %d), no timings", Desc.FragmentShader.c_str(), FastLinkResult, OptimizedLinkResult);
+        }
+        else
+        {
+            LOG_Info("Pipeline %s: monolithic %.2f ms, libraries %.2f ms, %s %.2f ms, optimized link %.2f ms",
+                Desc.FragmentShader.c_str(), MonolithicMs, LibrariesMs, bFastLinking ? "fast link" : "link (no fast linking)", FastLinkMs, OptimizedLinkMs);
+        }
+
+        vkDestroyPipeline(Device, Monolithic, nullptr);
+        if(FastLinked != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(Device, FastLinked, nullptr);
+        }
+        if(Optimized != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(Device, Optimized, nullptr);
+        }
+        for(VkPipeline Library : LibraryPipelines)
+        {
+            vkDestroyPipeline(Device, Library, nullptr);
+        }
+        NumPending--;
+    });
+}
+
+void FPipelineStateCache::SubmitRetiredPipelines(FGpuTicket Ticket)
+{
+    std::lock_guard<std::mutex> Lock(LibraryMutex);
+    for(VkPipeline Pipeline : UnsubmittedRetiredPipelines)
+    {
+        RetiredPipelines.push_back({ Pipeline, Ticket });
+    }
+    UnsubmittedRetiredPipelines.clear();
+}
+
+void FPipelineStateCache::DestroyRetiredPipelines(FGpuTimeline& Timeline)
+{
+    std::lock_guard<std::mutex> Lock(LibraryMutex);
+    size_t Completed = 0;
+    while(Completed < RetiredPipelines.size() && Timeline.IsComplete(RetiredPipelines[Completed].Ticket))
+    {
+        vkDestroyPipeline(Device, RetiredPipelines[Completed].Pipeline, nullptr);
+        Completed++;
+    }
+    RetiredPipelines.erase(RetiredPipelines.begin(), RetiredPipelines.begin() + Completed);
+}
+
+FPipelineStateCache::FEntry* FPipelineStateCache::FindOrAddEntry(uint64_t Hash, bool& bOutCreated)
+{
+    bOutCreated = false;
+    {
+        std::shared_lock<std::shared_mutex> Lock(Mutex);
+        const auto Found = Entries.find(Hash);
+        if(Found != Entries.end())
+        {
+            return Found->second.get();
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> Lock(Mutex);
+    std::unique_ptr<FEntry>& Entry = Entries[Hash];
+    if(!Entry)
+    {
+        Entry = std::make_unique<FEntry>();
+        bOutCreated = true;
+    }
+    return Entry.get();
+}
+
+void FPipelineStateCache::Compile(const FGraphicsPipelineDesc& Desc, FEntry* Entry)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    const VkPipeline Pipeline = bUsePipelineLibrary ? LinkLibraries(Desc, false) : CreatePipeline(Desc, PipelineCache->GetHandle());
+    const double CompileMs = MillisecondsSince(Start);
+
+    if(Pipeline == VK_NULL_HANDLE)
+    {
+        LOG_Error("Failed compiling pipeline %016llx (%s)", static_cast<unsigned long long>(Desc.GetHash()), Desc.VertexShader.c_str());
+        Entry->State.store(EEntryState::Failed, std::memory_order_release);
+        NumPending--;
+        return;
+    }
+
+    LOG_Info("Compiled pipeline %016llx (%s) in %.2f ms%s", static_cast<unsigned long long>(Desc.GetHash()),
+        Desc.FragmentShader.c_str(), CompileMs, bUsePipelineLibrary ? " (fast link)" : "");
+    Entry->Pipeline.store(Pipeline);
+    Entry->State.store(EEntryState::Ready, std::memory_order_release);
+
+    if(bUsePipelineLibrary)
+    {
+        // The fast linked pipeline is usable right away, the optimized one replaces it when done
+        FJobSystem::Get().Enqueue([this, Desc, Entry]() { OptimizeLink(Desc, Entry); });
+        return;
+    }
+    NumPending--;
+}
+
+void FPipelineStateCache::OptimizeLink(const FGraphicsPipelineDesc& Desc, FEntry* Entry)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    const VkPipeline Optimized = LinkLibraries(Desc, true);
+    if(Optimized != VK_NULL_HANDLE)
+    {
+        const VkPipeline FastLinked = Entry->Pipeline.exchange(Optimized);
+        std::lock_guard<std::mutex> Lock(LibraryMutex);
+        UnsubmittedRetiredPipelines.push_back(FastLinked);
+        LOG_Info("Optimized pipeline %016llx (%s) in %.2f ms", static_cast<unsigned long long>(Desc.GetHash()),
+            Desc.FragmentShader.c_str(), MillisecondsSince(Start));
+    }
+    NumPending--;
+}
+
+VkPipeline FPipelineStateCache::CreatePipeline(const FGraphicsPipelineDesc& Desc, VkPipelineCache Cache) const
+{
+    FPipelineStateInfos States(Desc, *ShaderCache);
+    std::vector<VkPipelineShaderStageCreateInfo> ShaderStages = States.VertexStages;
+    ShaderStages.insert(ShaderStages.end(), States.FragmentStages.begin(), States.FragmentStages.end());
+
+    VkGraphicsPipelineCreateInfo PipelineCreateInfo = {};
+    PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    PipelineCreateInfo.layout = Desc.PipelineLayout;
+    PipelineCreateInfo.renderPass = Desc.RenderPass;
+    PipelineCreateInfo.subpass = Desc.Subpass;
+    PipelineCreateInfo.stageCount = static_cast<uint32_t>(ShaderStages.size());
+    PipelineCreateInfo.pStages = ShaderStages.data();
+    PipelineCreateInfo.pVertexInputState = &States.VertexInputState;
+    PipelineCreateInfo.pInputAssemblyState = &States.InputAssemblyState;
+    PipelineCreateInfo.pRasterizationState = &States.RasterizationState;
+    PipelineCreateInfo.pColorBlendState = &States.ColorBlendState;
+    PipelineCreateInfo.pMultisampleState = &States.MultisampleState;
+    PipelineCreateInfo.pViewportState = &States.ViewportState;
+    PipelineCreateInfo.pDepthStencilState = &States.DepthStencilState;
+    PipelineCreateInfo.pDynamicState = &States.DynamicState;
+
+    VkPipeline Pipeline = VK_NULL_HANDLE;
+    if(vkCreateGraphicsPipelines(Device, Cache, 1, &PipelineCreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    return Pipeline;
+}
+
+uint64_t FPipelineStateCache::GetLibraryHash(ELibraryType Type, const FGraphicsPipelineDesc& Desc)
+{
+    // Only the state that goes into each library, so permutations share as many libraries as possible
+    uint64_t Hash = HashValue(Type);
+    switch(Type)
+    {
+    case LIBRARY_VertexInput:
+        Hash = HashCombine(Hash, HashValue(Desc.VertexFormat));
+        Hash = HashCombine(Hash, HashValue(Desc.Topology));
+        break;
+    case LIBRARY_PreRasterization:
+        Hash = HashCombine(Hash, HashBytes(Desc.VertexShader.data(), Desc.VertexShader.size()));
+        Hash = HashCombine(Hash, HashValue(Desc.PolygonMode));
+        Hash = HashCombine(Hash, HashValue(Desc.CullMode));
+        Hash = HashCombine(Hash, HashValue(Desc.FrontFace));
+        Hash = HashCombine(Hash, HashValue(Desc.DepthBiasConstant));
+        Hash = HashCombine(Hash, HashValue(Desc.DepthBiasSlope));
+        break;
+    case LIBRARY_FragmentShader:
+        Hash = HashCombine(Hash, HashBytes(Desc.FragmentShader.data(), Desc.FragmentShader.size()));
+        Hash = HashCombine(Hash, HashValue(Desc.FragmentConstantCount));
+        Hash = HashCombine(Hash, HashBytes(Desc.FragmentConstants, sizeof(uint32_t) * Desc.FragmentConstantCount));
+        Hash = HashCombine(Hash, HashValue(Desc.bDepthTest));
+        Hash = HashCombine(Hash, HashValue(Desc.bDepthWrite));
+        Hash = HashCombine(Hash, HashValue(Desc.DepthCompareOp));
+        Hash = HashCombine(Hash, HashValue(Desc.Samples));
+        break;
+    case LIBRARY_FragmentOutput:
+        Hash = HashCombine(Hash, HashValue(Desc.BlendMode));
+        Hash = HashCombine(Hash, HashValue(Desc.ColorAttachmentCount));
+        Hash = HashCombine(Hash, HashBytes(Desc.ColorFormats, sizeof(VkFormat) * Desc.ColorAttachmentCount));
+        Hash = HashCombine(Hash, HashValue(Desc.DepthFormat));
+        Hash = HashCombine(Hash, HashValue(Desc.Samples));
+        break;
+    default:
+        break;
+    }
+
+    if(Type != LIBRARY_VertexInput)
+    {
+        Hash = HashCombine(Hash, HashValue(Desc.RenderPass));
+        Hash = HashCombine(Hash, HashValue(Desc.Subpass));
+        Hash = HashCombine(Hash, HashValue(Desc.PipelineLayout));
+    }
+    return Hash;
+}
+
+VkPipeline FPipelineStateCache::GetLibrary(ELibraryType Type, const FGraphicsPipelineDesc& Desc)
+{
+    const uint64_t Hash = GetLibraryHash(Type, Desc);
+    {
+        std::lock_guard<std::mutex> Lock(LibraryMutex);
+        const auto Found = Libraries[Type].find(Hash);
+        if(Found != Libraries[Type].end())
+        {
+            return Found->second;
+        }
+    }
+
+    // Built outside the lock, two workers racing on the same library keep the first one
+    const VkPipeline Library = CreateLibrary(Type, Desc, PipelineCache->GetHandle());
+    if(Library == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+    std::lock_guard<std::mutex> Lock(LibraryMutex);
+    const auto Inserted = Libraries[Type].emplace(Hash, Library);
+    if(!Inserted.second)
+    {
+        vkDestroyPipeline(Device, Library, nullptr);
+    }
+    return Inserted.first->second;
+}
+
+VkPipeline FPipelineStateCache::CreateLibrary(ELibraryType Type, const FGraphicsPipelineDesc& Desc, VkPipelineCache Cache) const
+{
+    static const VkGraphicsPipelineLibraryFlagsEXT LibraryFlags[LIBRARY_Count] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+    };
+
+    FPipelineStateInfos States(Desc, *ShaderCache);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT LibraryInfo = {};
+    LibraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    LibraryInfo.flags = LibraryFlags[Type];
+
+    VkGraphicsPipelineCreateInfo PipelineCreateInfo = {};
+    PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    PipelineCreateInfo.pNext = &LibraryInfo;
+    PipelineCreateInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+    switch(Type)
+    {
+    case LIBRARY_VertexInput:
+        PipelineCreateInfo.pVertexInputState = &States.VertexInputState;
+        PipelineCreateInfo.pInputAssemblyState = &States.InputAssemblyState;
+        break;
+    case LIBRARY_PreRasterization:
+        PipelineCreateInfo.stageCount = static_cast<uint32_t>(States.VertexStages.size());
+        PipelineCreateInfo.pStages = States.VertexStages.data();
+        PipelineCreateInfo.pViewportState = &States.ViewportState;
+        PipelineCreateInfo.pRasterizationState = &States.RasterizationState;
+        PipelineCreateInfo.pDynamicState = &States.DynamicState;
+        break;
+    case LIBRARY_FragmentShader:
+        PipelineCreateInfo.stageCount = static_cast<uint32_t>(States.FragmentStages.size());
+        PipelineCreateInfo.pStages = States.FragmentStages.data();
+        PipelineCreateInfo.pDepthStencilState = &States.DepthStencilState;
+        PipelineCreateInfo.pMultisampleState = &States.MultisampleState;
+        break;
+    case LIBRARY_FragmentOutput:
+        PipelineCreateInfo.pColorBlendState = &States.ColorBlendState;
+        PipelineCreateInfo.pMultisampleState = &States.MultisampleState;
+        break;
+    default:
+        break;
+    }
+
+    if(Type != LIBRARY_VertexInput)
+    {
+        PipelineCreateInfo.layout = Desc.PipelineLayout;
+        PipelineCreateInfo.renderPass = Desc.RenderPass;
+        PipelineCreateInfo.subpass = Desc.Subpass;
+    }
+
+    // Built on workers, a failure only fails the pipelines using the library
+    VkPipeline Library = VK_NULL_HANDLE;
+    if(vkCreateGraphicsPipelines(Device, Cache, 1, &PipelineCreateInfo, nullptr, &Library) != VK_SUCCESS)
+    {
+        LOG_Error("Failed creating pipeline library %u (%s, %s)", static_cast<uint32_t>(Type), Desc.VertexShader.c_str(), Desc.FragmentShader.c_str());
+        return VK_NULL_HANDLE;
+    }
+    return Library;
+}
+
+VkPipeline FPipelineStateCache::LinkLibraries(const FGraphicsPipelineDesc& Desc, bool bOptimize)
+{
+    std::array<VkPipeline, LIBRARY_Count> LibraryPipelines;
+    for(uint32_t Type = 0; Type < LIBRARY_Count; Type++)
+    {
+        LibraryPipelines[Type] = GetLibrary(static_cast<ELibraryType>(Type), Desc);
+        if(LibraryPipelines[Type] == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+    }
+
+    VkPipelineLibraryCreateInfoKHR LibraryInfo = {};
+    LibraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    LibraryInfo.libraryCount = LIBRARY_Count;
+    LibraryInfo.pLibraries = LibraryPipelines.data();
+
+    VkGraphicsPipelineCreateInfo PipelineCreateInfo = {};
+    PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    PipelineCreateInfo.pNext = &LibraryInfo;
+    PipelineCreateInfo.flags = bOptimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    PipelineCreateInfo.layout = Desc.PipelineLayout;
+
+    VkPipeline Pipeline = VK_NULL_HANDLE;
+    if(vkCreateGraphicsPipelines(Device, PipelineCache->GetHandle(), 1, &PipelineCreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    return Pipeline;
+}
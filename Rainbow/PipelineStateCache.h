@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "GpuTimeline.h"
+#include "MinimalCore.h"
+
+class FShaderCache;
+class FPipelineCache;
+
+#define PSO_MAX_COLOR_ATTACHMENTS 8
+#define PSO_MAX_SPECIALIZATION_CONSTANTS 4
+
+enum class EVertexFormat : uint8_t
+{
+    // Vertices are pulled from the bindless storage buffers, no vertex input state
+    None,
+    StaticVertex
+};
+
+enum class EBlendMode : uint8_t
+{
+    Opaque,
+    AlphaBlend,
+    Additive
+};
+
+// Everything that ends up in a VkGraphicsPipelineCreateInfo, two descs with the same hash build the same pipeline
+struct FGraphicsPipelineDesc
+{
+    std::string VertexShader;
+    std::string FragmentShader;
+    EVertexFormat VertexFormat;
+    VkPrimitiveTopology Topology;
+    VkPolygonMode PolygonMode;
+    VkCullModeFlags CullMode;
+    VkFrontFace FrontFace;
+    // Rasterization depth bias, enabled when either is non zero. Slope is in units of the polygon's depth slope.
+    float DepthBiasConstant;
+    float DepthBiasSlope;
+    bool bDepthTest;
+    bool bDepthWrite;
+    VkCompareOp DepthCompareOp;
+    EBlendMode BlendMode;
+    uint32_t ColorAttachmentCount;
+    VkFormat ColorFormats[PSO_MAX_COLOR_ATTACHMENTS];
+    VkFormat DepthFormat;
+    VkSampleCountFlagBits Samples;
+    VkRenderPass RenderPass;
+    uint32_t Subpass;
+    VkPipelineLayout PipelineLayout;
+    // Fragment shader specialization constants, constant_id i takes FragmentConstants[i]
+    uint32_t FragmentConstantCount;
+    uint32_t FragmentConstants[PSO_MAX_SPECIALIZATION_CONSTANTS];
+
+    FGraphicsPipelineDesc();
+    uint64_t GetHash() const;
+};
+
+struct FComputePipelineDesc
+{
+    std::string ComputeShader;
+    VkPipelineLayout PipelineLayout;
+    // Specialization constants, constant_id i takes Constants[i]
+    uint32_t ConstantCount;
+    uint32_t Constants[PSO_MAX_SPECIALIZATION_CONSTANTS];
+
+    FComputePipelineDesc();
+    uint64_t GetHash() const;
+};
+
+// Pipelines keyed by FGraphicsPipelineDesc::GetHash(). Missing pipelines are compiled on the job system,
+// GetPipeline never blocks the frame: it returns the fallback until the real pipeline is ready.
+// With VK_EXT_graphics_pipeline_library the four state libraries are cached separately, a new permutation
+// is fast linked from them and swapped for a link time optimized pipeline once that finishes in the background.
+class FPipelineStateCache
+{
+public:
+    FPipelineStateCache();
+
+    void Init(VkDevice InDevice, FShaderCache* InShaderCache, FPipelineCache* InPipelineCache, bool bInUsePipelineLibrary, bool bInFastLinking);
+    void Shutdown();
+
+    VkPipeline GetPipeline(const FGraphicsPipelineDesc& Desc, VkPipeline Fallback = VK_NULL_HANDLE);
+    // Compiles on the calling thread if needed, for pipelines the frame can't run without
+    VkPipeline GetPipelineBlocking(const FGraphicsPipelineDesc& Desc);
+    // Queues the compile without asking for the pipeline yet, e.g. while loading a level
+    void Precompile(const FGraphicsPipelineDesc& Desc);
+    // Compute pipelines are single stage, there is nothing to fast link and they're compiled on the calling thread
+    VkPipeline GetComputePipelineBlocking(const FComputePipelineDesc& Desc);
+
+    // Tags the pipelines retired since the last call with the ticket of the frame just submitted, the last that can use them
+    void SubmitRetiredPipelines(FGpuTicket Ticket);
+    // Destroys the retired pipelines whose ticket completed, never blocks
+    void DestroyRetiredPipelines(FGpuTimeline& Timeline);
+
+    uint32_t GetNumPending() const { return NumPending.load(); }
+    bool UsesPipelineLibrary() const { return bUsePipelineLibrary; }
+
+    // Builds Desc monolithically and through the libraries on a worker and logs both timings, the results are discarded
+    void LogLinkTimings(const FGraphicsPipelineDesc& Desc);
+
+private:
+    enum class EEntryState : uint8_t
+    {
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct FEntry
+    {
+        std::atomic<EEntryState> State;
+        std::atomic<VkPipeline> Pipeline;
+
+        FEntry() : State(EEntryState::Compiling), Pipeline(VK_NULL_HANDLE) {}
+    };
+
+    struct FRetiredPipeline
+    {
+        VkPipeline Pipeline;
+        FGpuTicket Ticket;
+    };
+
+    enum ELibraryType : uint32_t
+    {
+        LIBRARY_VertexInput,
+        LIBRARY_PreRasterization,
+        LIBRARY_FragmentShader,
+        LIBRARY_FragmentOutput,
+        LIBRARY_Count
+    };
+
+    // Returns the entry and whether this call created it, the creator is responsible for compiling
+    FEntry* FindOrAddEntry(uint64_t Hash, bool& bOutCreated);
+    void Compile(const FGraphicsPipelineDesc& Desc, FEntry* Entry);
+    void OptimizeLink(const FGraphicsPipelineDesc& Desc, FEntry* Entry);
+    VkPipeline CreatePipeline(const FGraphicsPipelineDesc& Desc, VkPipelineCache Cache) const;
+
+    VkPipeline GetLibrary(ELibraryType Type, const FGraphicsPipelineDesc& Desc);
+    VkPipeline CreateLibrary(ELibraryType Type, const FGraphicsPipelineDesc& Desc, VkPipelineCache Cache) const;
+    VkPipeline LinkLibraries(const FGraphicsPipelineDesc& Desc, bool bOptimize);
+    static uint64_t GetLibraryHash(ELibraryType Type, const FGraphicsPipelineDesc& Desc);
+
+private:
+    VkDevice Device;
+    FShaderCache* ShaderCache;
+    FPipelineCache* PipelineCache;
+    std::unordered_map<uint64_t, std::unique_ptr<FEntry>> Entries;
+    mutable std::shared_mutex Mutex;
+    std::atomic<uint32_t> NumPending;
+
+    bool bUsePipelineLibrary;
+    // graphicsPipelineLibraryFastLinking, whether linking without optimization is expected to be cheap
+    bool bFastLinking;
+    std::unordered_map<uint64_t, VkPipeline> Libraries[LIBRARY_Count];
+    // Fast linked pipelines replaced by their optimized version, frames recorded before the swap may still use them.
+    // Retired on workers with no ticket yet, then in ticket order once a frame was submitted after the swap.
+    std::vector<VkPipeline> UnsubmittedRetiredPipelines;
+    std::vector<FRetiredPipeline> RetiredPipelines;
+    std::mutex LibraryMutex;
+};
@@ -0,0 +1,1423 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include "BindlessHeap.h"
+#include "GpuProfiler.h"
+#include "Hash.h"
+#include "Renderer.h"
+
+struct FAccessState
+{
+    VkImageLayout Layout;
+    VkPipelineStageFlags Stages;
+    VkAccessFlags Access;
+    bool bWrite;
+};
+
+static bool IsWriteAccess(ERenderGraphAccess Type)
+{
+    return Type == ERenderGraphAccess::ColorAttachment || Type == ERenderGraphAccess::DepthAttachment || Type == ERenderGraphAccess::StorageWrite;
+}
+
+static bool IsAttachmentAccess(ERenderGraphAccess Type)
+{
+    return Type == ERenderGraphAccess::ColorAttachment || Type == ERenderGraphAccess::DepthAttachment || Type == ERenderGraphAccess::DepthReadOnly
+        || Type == ERenderGraphAccess::InputAttachment;
+}
+
+// Attachment writes that don't load replace the whole texture, earlier contents are dead
+static bool IsFullOverwrite(ERenderGraphAccess Type, VkAttachmentLoadOp LoadOp)
+{
+    return (Type == ERenderGraphAccess::ColorAttachment || Type == ERenderGraphAccess::DepthAttachment) && LoadOp != VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+static FAccessState GetAccessState(ERenderGraphAccess Type, VkPipelineStageFlags Stages, bool bDepthFormat)
+{
+    switch(Type)
+    {
+    case ERenderGraphAccess::ColorAttachment:
+        return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true };
+    case ERenderGraphAccess::DepthAttachment:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true };
+    case ERenderGraphAccess::DepthReadOnly:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false };
+    case ERenderGraphAccess::Sampled:
+        // Same layouts the bindless heap registers textures with
+        return { bDepthFormat ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, Stages, VK_ACCESS_SHADER_READ_BIT, false };
+    case ERenderGraphAccess::InputAttachment:
+        return { bDepthFormat ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, false };
+    case ERenderGraphAccess::StorageRead:
+        return { VK_IMAGE_LAYOUT_GENERAL, Stages, VK_ACCESS_SHADER_READ_BIT, false };
+    case ERenderGraphAccess::StorageWrite:
+    default:
+        return { VK_IMAGE_LAYOUT_GENERAL, Stages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true };
+    }
+}
+
+// Consumer of a graph output once the graph is done, present waits on a semaphore so it needs no stage
+static void GetFinalConsumer(VkImageLayout Layout, VkPipelineStageFlags& OutStages, VkAccessFlags& OutAccess)
+{
+    switch(Layout)
+    {
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        OutStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        OutAccess = VK_ACCESS_TRANSFER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        OutStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        OutAccess = VK_ACCESS_SHADER_READ_BIT;
+        break;
+    default:
+        OutStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        OutAccess = 0;
+        break;
+    }
+}
+
+// UINT32_MAX when none of the types is lazily allocated, desktop GPUs usually have no such memory
+static uint32_t FindLazilyAllocatedMemoryType(VkPhysicalDevice PhysicalDevice, uint32_t TypeBits)
+{
+    VkPhysicalDeviceMemoryProperties MemoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+    for(uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
+    {
+        if((TypeBits & (1u << i)) && (MemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+        {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+FRenderGraphPass::FRenderGraphPass(const std::string& InName)
+{
+    Name = InName;
+    bSideEffect = false;
+    bSecondaryCommandBuffers = false;
+    bAsyncCompute = false;
+    bCulled = false;
+    bAsync = false;
+    Batch = 0;
+    RenderPassIndex = 0;
+    Subpass = 0;
+    BarrierSrcStages = 0;
+    BarrierDstStages = 0;
+}
+
+FRenderGraphPass& FRenderGraphPass::AddAccess(FRenderGraphTexture Texture, ERenderGraphAccess Type, VkPipelineStageFlags Stages, VkAttachmentLoadOp LoadOp, const VkClearValue& ClearValue)
+{
+    check(Texture.IsValid());
+    FAccess Access;
+    Access.Texture = Texture.Index;
+    Access.Type = Type;
+    Access.Stages = Stages;
+    Access.LoadOp = LoadOp;
+    Access.ClearValue = ClearValue;
+    Access.bStore = true;
+    Accesses.push_back(Access);
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::WriteColor(FRenderGraphTexture Texture, VkAttachmentLoadOp LoadOp, VkClearColorValue ClearColor)
+{
+    VkClearValue ClearValue;
+    ClearValue.color = ClearColor;
+    return AddAccess(Texture, ERenderGraphAccess::ColorAttachment, 0, LoadOp, ClearValue);
+}
+
+FRenderGraphPass& FRenderGraphPass::WriteDepth(FRenderGraphTexture Texture, VkAttachmentLoadOp LoadOp, VkClearDepthStencilValue ClearDepth)
+{
+    VkClearValue ClearValue;
+    ClearValue.depthStencil = ClearDepth;
+    return AddAccess(Texture, ERenderGraphAccess::DepthAttachment, 0, LoadOp, ClearValue);
+}
+
+FRenderGraphPass& FRenderGraphPass::ReadDepth(FRenderGraphTexture Texture)
+{
+    return AddAccess(Texture, ERenderGraphAccess::DepthReadOnly, 0, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue());
+}
+
+FRenderGraphPass& FRenderGraphPass::ReadTexture(FRenderGraphTexture Texture, VkPipelineStageFlags Stages)
+{
+    return AddAccess(Texture, ERenderGraphAccess::Sampled, Stages, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue());
+}
+
+FRenderGraphPass& FRenderGraphPass::ReadStorage(FRenderGraphTexture Texture, VkPipelineStageFlags Stages)
+{
+    return AddAccess(Texture, ERenderGraphAccess::StorageRead, Stages, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue());
+}
+
+FRenderGraphPass& FRenderGraphPass::WriteStorage(FRenderGraphTexture Texture, VkPipelineStageFlags Stages)
+{
+    return AddAccess(Texture, ERenderGraphAccess::StorageWrite, Stages, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue());
+}
+
+FRenderGraphPass& FRenderGraphPass::ReadInputAttachment(FRenderGraphTexture Texture)
+{
+    return AddAccess(Texture, ERenderGraphAccess::InputAttachment, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue());
+}
+
+FRenderGraphPass& FRenderGraphPass::ReadBuffer(FRenderGraphBuffer Buffer, VkPipelineStageFlags Stages)
+{
+    check(Buffer.IsValid());
+    BufferAccesses.push_back({ Buffer.Index, Stages, false });
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::WriteBuffer(FRenderGraphBuffer Buffer, VkPipelineStageFlags Stages)
+{
+    check(Buffer.IsValid());
+    BufferAccesses.push_back({ Buffer.Index, Stages, true });
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::SetSideEffect()
+{
+    bSideEffect = true;
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::UseSecondaryCommandBuffers()
+{
+    bSecondaryCommandBuffers = true;
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::UseAsyncCompute()
+{
+    bAsyncCompute = true;
+    return *this;
+}
+
+FRenderGraphPass& FRenderGraphPass::SetExecute(FExecute InExecute)
+{
+    Execute = std::move(InExecute);
+    return *this;
+}
+
+FRenderGraph::FRenderGraph()
+{
+    Device = VK_NULL_HANDLE;
+    PhysicalDevice = VK_NULL_HANDLE;
+    RenderPassCache = nullptr;
+    BindlessHeap = nullptr;
+    FrameIndex = 0;
+    bCompiled = false;
+    GraphicsQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    ComputeQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    bComputeTimestamps = false;
+    bAsyncComputeActive = false;
+    bAsyncFallbackLogged = false;
+    FinalSrcStages = 0;
+    FinalDstStages = 0;
+    GraphicsReleaseStages = 0;
+    ComputeReleaseStages = 0;
+}
+
+void FRenderGraph::Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FRenderPassCache* InRenderPassCache, FBindlessHeap* InBindlessHeap, uint32_t FramesInFlight)
+{
+    Device = InDevice;
+    PhysicalDevice = InPhysicalDevice;
+    RenderPassCache = InRenderPassCache;
+    BindlessHeap = InBindlessHeap;
+    TransientSets.resize(FramesInFlight);
+    for(FTransientSet& Set : TransientSets)
+    {
+        Set.Signature = 0;
+    }
+}
+
+void FRenderGraph::EnableAsyncCompute(uint32_t InGraphicsQueueFamily, uint32_t InComputeQueueFamily, bool bInComputeTimestamps)
+{
+    GraphicsQueueFamily = InGraphicsQueueFamily;
+    ComputeQueueFamily = InComputeQueueFamily;
+    bComputeTimestamps = bInComputeTimestamps;
+}
+
+void FRenderGraph::Shutdown()
+{
+    for(FTransientSet& Set : TransientSets)
+    {
+        DestroyTransientSet(Set);
+    }
+    TransientSets.clear();
+    Resources.clear();
+    BufferResources.clear();
+    Passes.clear();
+}
+
+void FRenderGraph::Reset(uint32_t InFrameIndex)
+{
+    FrameIndex = InFrameIndex;
+    bCompiled = false;
+    Resources.clear();
+    BufferResources.clear();
+    Passes.clear();
+    FinalBarriers.clear();
+    FinalLayouts.clear();
+    FinalSrcStages = 0;
+    FinalDstStages = 0;
+    bAsyncComputeActive = false;
+    GraphicsReleaseBarriers.clear();
+    ComputeReleaseBarriers.clear();
+    GraphicsReleaseStages = 0;
+    ComputeReleaseStages = 0;
+}
+
+FRenderGraphTexture FRenderGraph::ImportTexture(const std::string& Name, FTexture* Texture, VkImageLayout FinalLayout)
+{
+    check(Texture);
+    FResource Resource;
+    Resource.Name = Name;
+    Resource.Imported = Texture;
+    Resource.Desc = FRenderGraphTextureDesc(Texture->SizeX, Texture->SizeY, Texture->Format);
+    Resource.FinalLayout = FinalLayout;
+    Resource.Usage = 0;
+    Resource.FirstPass = UINT32_MAX;
+    Resource.LastPass = 0;
+    Resource.TransientIndex = UINT32_MAX;
+    Resource.bAsyncCompute = false;
+    Resource.bTileOnly = false;
+    Resource.RenderPassIndex = UINT32_MAX;
+    Resources.push_back(Resource);
+    return FRenderGraphTexture(static_cast<uint32_t>(Resources.size() - 1));
+}
+
+FRenderGraphTexture FRenderGraph::CreateTexture(const std::string& Name, const FRenderGraphTextureDesc& Desc)
+{
+    FResource Resource;
+    Resource.Name = Name;
+    Resource.Imported = nullptr;
+    Resource.Desc = Desc;
+    Resource.FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    Resource.Usage = Desc.ExtraUsage;
+    Resource.FirstPass = UINT32_MAX;
+    Resource.LastPass = 0;
+    Resource.TransientIndex = UINT32_MAX;
+    Resource.bAsyncCompute = false;
+    Resource.bTileOnly = true;
+    Resource.RenderPassIndex = UINT32_MAX;
+    Resources.push_back(Resource);
+    return FRenderGraphTexture(static_cast<uint32_t>(Resources.size() - 1));
+}
+
+FRenderGraphBuffer FRenderGraph::ImportBuffer(const std::string& Name, VkBuffer Buffer, VkDeviceSize Size)
+{
+    check(Buffer != VK_NULL_HANDLE);
+    FBufferResource Resource;
+    Resource.Name = Name;
+    Resource.Buffer = Buffer;
+    Resource.Size = Size;
+    BufferResources.push_back(Resource);
+    return FRenderGraphBuffer(static_cast<uint32_t>(BufferResources.size() - 1));
+}
+
+FRenderGraphPass& FRenderGraph::AddPass(const std::string& Name)
+{
+    Passes.emplace_back(new FRenderGraphPass(Name));
+    return *Passes.back();
+}
+
+void FRenderGraph::Compile()
+{
+    CullPasses();
+    AssignQueues();
+    MergeSubpasses();
+    ComputeLifetimes();
+    AllocateTransients();
+    ComputeBarriers();
+    bCompiled = true;
+}
+
+void FRenderGraph::CullPasses()
+{
+    // Backwards liveness: a pass survives if it has side effects or writes something a surviving later pass reads
+    std::vector<bool> Live(Resources.size(), false);
+    for(size_t i = 0; i < Resources.size(); i++)
+    {
+        Live[i] = Resources[i].Imported && Resources[i].FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    std::vector<bool> LiveBuffers(BufferResources.size(), false);
+
+    for(size_t PassIndex = Passes.size(); PassIndex-- > 0;)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        bool bNeeded = Pass.bSideEffect;
+        for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            bNeeded |= IsWriteAccess(Access.Type) && Live[Access.Texture];
+        }
+        for(const FRenderGraphPass::FBufferAccess& Access : Pass.BufferAccesses)
+        {
+            bNeeded |= Access.bWrite && LiveBuffers[Access.Buffer];
+        }
+
+        Pass.bCulled = !bNeeded;
+        if(Pass.bCulled) continue;
+
+        for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            if(IsFullOverwrite(Access.Type, Access.LoadOp))
+            {
+                Live[Access.Texture] = false;
+            }
+        }
+        for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            if(!IsFullOverwrite(Access.Type, Access.LoadOp))
+            {
+                Live[Access.Texture] = true;
+            }
+        }
+        // Buffer writes may only cover part of it, earlier writers stay needed
+        for(const FRenderGraphPass::FBufferAccess& Access : Pass.BufferAccesses)
+        {
+            LiveBuffers[Access.Buffer] = true;
+        }
+    }
+}
+
+void FRenderGraph::AssignQueues()
+{
+    bAsyncComputeActive = false;
+    for(std::unique_ptr<FRenderGraphPass>& PassPtr : Passes)
+    {
+        FRenderGraphPass& Pass = *PassPtr;
+        Pass.bAsync = Pass.bAsyncCompute && !Pass.bCulled && ComputeQueueFamily != VK_QUEUE_FAMILY_IGNORED;
+        Pass.Batch = 0;
+        bAsyncComputeActive |= Pass.bAsync;
+    }
+    if(!bAsyncComputeActive) return;
+
+    // First and last async pass touching each texture and buffer
+    std::vector<uint32_t> FirstAsync(Resources.size(), UINT32_MAX);
+    std::vector<uint32_t> LastAsync(Resources.size(), 0);
+    std::vector<uint32_t> FirstAsyncBuffer(BufferResources.size(), UINT32_MAX);
+    std::vector<uint32_t> LastAsyncBuffer(BufferResources.size(), 0);
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        if(!Pass.bAsync) continue;
+
+        for(FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            checkf(!IsAttachmentAccess(Access.Type), "FRenderGraph: async compute passes can't have attachments");
+            Access.Stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            FirstAsync[Access.Texture] = std::min(FirstAsync[Access.Texture], PassIndex);
+            LastAsync[Access.Texture] = std::max(LastAsync[Access.Texture], PassIndex);
+        }
+        for(FRenderGraphPass::FBufferAccess& Access : Pass.BufferAccesses)
+        {
+            Access.Stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            FirstAsyncBuffer[Access.Buffer] = std::min(FirstAsyncBuffer[Access.Buffer], PassIndex);
+            LastAsyncBuffer[Access.Buffer] = std::max(LastAsyncBuffer[Access.Buffer], PassIndex);
+        }
+    }
+
+    // A graphics pass sharing a texture with an async pass declared after it goes in the batch the compute work waits for,
+    // one sharing a texture with an async pass declared before it goes in the batch waiting for the compute work
+    uint32_t LastProducer = 0;
+    bool bHasProducer = false;
+    uint32_t FirstConsumer = static_cast<uint32_t>(Passes.size());
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        const FRenderGraphPass& Pass = *Passes[PassIndex];
+        if(Pass.bAsync || Pass.bCulled) continue;
+
+        const auto AddShared = [&](uint32_t FirstAsyncPass, uint32_t LastAsyncPass)
+        {
+            if(FirstAsyncPass == UINT32_MAX) return;
+            if(LastAsyncPass > PassIndex)
+            {
+                LastProducer = std::max(LastProducer, PassIndex);
+                bHasProducer = true;
+            }
+            if(FirstAsyncPass < PassIndex)
+            {
+                FirstConsumer = std::min(FirstConsumer, PassIndex);
+            }
+        };
+        for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            AddShared(FirstAsync[Access.Texture], LastAsync[Access.Texture]);
+        }
+        for(const FRenderGraphPass::FBufferAccess& Access : Pass.BufferAccesses)
+        {
+            AddShared(FirstAsyncBuffer[Access.Buffer], LastAsyncBuffer[Access.Buffer]);
+        }
+    }
+
+    // The first consumer may be a subpass merged into the render pass of the passes before it, the whole render pass goes
+    // in the batch waiting for the compute work
+    while(FirstConsumer < Passes.size() && ReadsInputAttachments(*Passes[FirstConsumer]))
+    {
+        uint32_t Previous = FirstConsumer;
+        while(Previous > 0 && (Passes[Previous - 1]->bAsync || Passes[Previous - 1]->bCulled))
+        {
+            Previous--;
+        }
+        if(Previous == 0) break;
+        FirstConsumer = Previous - 1;
+    }
+
+    // One compute submit per frame can't wait for graphics work that itself waits for compute results
+    if(bHasProducer && LastProducer >= FirstConsumer)
+    {
+        if(!bAsyncFallbackLogged)
+        {
+            LOG_Warning("Render graph: async compute passes both feed and consume graphics pass %s, running them on the graphics queue",
+                Passes[FirstConsumer]->Name.c_str());
+            bAsyncFallbackLogged = true;
+        }
+        for(std::unique_ptr<FRenderGraphPass>& PassPtr : Passes)
+        {
+            PassPtr->bAsync = false;
+        }
+        bAsyncComputeActive = false;
+        return;
+    }
+
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        if(Pass.bAsync) continue;
+        Pass.Batch = (bHasProducer && PassIndex <= LastProducer) ? 0 : (PassIndex < FirstConsumer ? 1 : 2);
+    }
+}
+
+void FRenderGraph::MergeSubpasses()
+{
+    // A pass reading input attachments continues the render pass of the graphics pass before it as its next subpass.
+    // Async passes are recorded elsewhere and don't break the render pass.
+    uint32_t Previous = UINT32_MAX;
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        Pass.RenderPassIndex = PassIndex;
+        Pass.Subpass = 0;
+        Pass.ScopeName = Pass.Name;
+        if(Pass.bCulled || Pass.bAsync) continue;
+
+        if(ReadsInputAttachments(Pass))
+        {
+            checkf(Previous != UINT32_MAX, "FRenderGraph: input attachments read without a render pass before them");
+            const FRenderGraphPass& PreviousPass = *Passes[Previous];
+            FRenderGraphPass& Leader = *Passes[PreviousPass.RenderPassIndex];
+            checkf(PreviousPass.Subpass + 1 < RENDER_PASS_MAX_SUBPASSES, "FRenderGraph: too many subpasses in one render pass");
+            checkf(PreviousPass.Batch == Pass.Batch, "FRenderGraph: async compute splits a render pass between batches");
+
+            for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+            {
+                if(Access.Type != ERenderGraphAccess::InputAttachment) continue;
+
+                bool bAttachment = false;
+                for(uint32_t Other = PreviousPass.RenderPassIndex; Other < PassIndex; Other++)
+                {
+                    if(Passes[Other]->bCulled || Passes[Other]->RenderPassIndex != PreviousPass.RenderPassIndex) continue;
+                    for(const FRenderGraphPass::FAccess& OtherAccess : Passes[Other]->Accesses)
+                    {
+                        bAttachment |= OtherAccess.Texture == Access.Texture && IsAttachmentAccess(OtherAccess.Type) && OtherAccess.Type != ERenderGraphAccess::InputAttachment;
+                    }
+                }
+                if(!bAttachment)
+                {
+                    LOG_Error("Render graph: pass %s reads %s as an input attachment but the render pass before it doesn't write it",
+                        Pass.Name.c_str(), Resources[Access.Texture].Name.c_str());
+                }
+                checkf(bAttachment, "FRenderGraph: input attachment isn't an attachment of the render pass");
+            }
+
+            Pass.RenderPassIndex = PreviousPass.RenderPassIndex;
+            Pass.Subpass = PreviousPass.Subpass + 1;
+            Leader.ScopeName += "+" + Pass.Name;
+        }
+        Previous = PassIndex;
+    }
+}
+
+void FRenderGraph::ComputeLifetimes()
+{
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        if(Pass.bCulled) continue;
+
+        for(FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            FResource& Resource = Resources[Access.Texture];
+            Resource.FirstPass = std::min(Resource.FirstPass, PassIndex);
+            Resource.LastPass = std::max(Resource.LastPass, PassIndex);
+            Resource.bAsyncCompute |= Pass.bAsync;
+
+            switch(Access.Type)
+            {
+            case ERenderGraphAccess::ColorAttachment: Resource.Usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+            case ERenderGraphAccess::DepthAttachment:
+            case ERenderGraphAccess::DepthReadOnly: Resource.Usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+            case ERenderGraphAccess::Sampled: Resource.Usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+            case ERenderGraphAccess::InputAttachment: Resource.Usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT; break;
+            default: Resource.Usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+            }
+
+            // Attachments nobody reads afterwards are never written back to memory, later subpasses of the same
+            // render pass read them on tile
+            Access.bStore = Resource.Imported != nullptr;
+            for(uint32_t Later = PassIndex + 1; Later < Passes.size() && !Access.bStore; Later++)
+            {
+                if(Passes[Later]->bCulled) continue;
+                const bool bSameRenderPass = Passes[Later]->RenderPassIndex == Pass.RenderPassIndex;
+                for(const FRenderGraphPass::FAccess& LaterAccess : Passes[Later]->Accesses)
+                {
+                    if(bSameRenderPass && IsAttachmentAccess(LaterAccess.Type)) continue;
+                    Access.bStore |= LaterAccess.Texture == Access.Texture && !IsFullOverwrite(LaterAccess.Type, LaterAccess.LoadOp);
+                }
+            }
+
+            if(Resource.RenderPassIndex == UINT32_MAX)
+            {
+                Resource.RenderPassIndex = Pass.RenderPassIndex;
+            }
+            Resource.bTileOnly &= IsAttachmentAccess(Access.Type) && !Access.bStore && Resource.RenderPassIndex == Pass.RenderPassIndex;
+        }
+    }
+
+    // Transient attachments can't have any other usage
+    const VkImageUsageFlags AttachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    for(FResource& Resource : Resources)
+    {
+        Resource.bTileOnly &= Resource.FirstPass != UINT32_MAX && (Resource.Usage & ~AttachmentUsage) == 0;
+        if(Resource.bTileOnly)
+        {
+            Resource.Usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+    }
+
+    // Declaration order says nothing about when async work runs relative to graphics work, never alias its textures
+    for(FResource& Resource : Resources)
+    {
+        if(!Resource.bAsyncCompute) continue;
+        Resource.FirstPass = 0;
+        Resource.LastPass = static_cast<uint32_t>(Passes.size()) - 1;
+    }
+}
+
+void FRenderGraph::AllocateTransients()
+{
+    std::vector<uint32_t> Transients;
+    uint64_t Signature = HashValue(static_cast<uint32_t>(0));
+    for(uint32_t i = 0; i < Resources.size(); i++)
+    {
+        FResource& Resource = Resources[i];
+        if(Resource.Imported || Resource.FirstPass == UINT32_MAX) continue;
+
+        Resource.TransientIndex = static_cast<uint32_t>(Transients.size());
+        Transients.push_back(i);
+        Signature = HashCombine(Signature, HashValue(Resource.Desc.Width));
+        Signature = HashCombine(Signature, HashValue(Resource.Desc.Height));
+        Signature = HashCombine(Signature, HashValue(Resource.Desc.Format));
+        Signature = HashCombine(Signature, HashValue(Resource.Usage));
+        Signature = HashCombine(Signature, HashValue(Resource.FirstPass));
+        Signature = HashCombine(Signature, HashValue(Resource.LastPass));
+    }
+
+    FTransientSet& Set = TransientSets[FrameIndex];
+    if(Set.Signature == Signature && Set.Images.size() == Transients.size()) return;
+
+    // The frame's ticket is complete, nothing on the GPU uses this set anymore
+    DestroyTransientSet(Set);
+    Set.Images.resize(Transients.size());
+
+    std::vector<uint32_t> MemoryTypes(Transients.size());
+    std::vector<bool> LazyMemoryTypes(Transients.size(), false);
+    for(uint32_t i = 0; i < Transients.size(); i++)
+    {
+        const FResource& Resource = Resources[Transients[i]];
+        FTransientImage& Image = Set.Images[i];
+        Image.Texture.Format = Resource.Desc.Format;
+        Image.Texture.SizeX = Resource.Desc.Width;
+        Image.Texture.SizeY = Resource.Desc.Height;
+        Image.Texture.MipMaps = 1;
+
+        VkImageCreateInfo ImageCreateInfo = {};
+        ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format = Resource.Desc.Format;
+        ImageCreateInfo.extent = { Resource.Desc.Width, Resource.Desc.Height, 1 };
+        ImageCreateInfo.mipLevels = 1;
+        ImageCreateInfo.arrayLayers = 1;
+        ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage = Resource.Usage;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if(vkCreateImage(Device, &ImageCreateInfo, nullptr, &Image.Texture.Image) != VK_SUCCESS)
+        {
+            checkf(0, "FRenderGraph: unable to create transient image");
+        }
+
+        VkMemoryRequirements MemoryRequirements;
+        vkGetImageMemoryRequirements(Device, Image.Texture.Image, &MemoryRequirements);
+        Image.Size = MemoryRequirements.size;
+
+        // Only committed if the attachment ever has to leave the tile
+        const uint32_t LazyMemoryType = Resource.bTileOnly ? FindLazilyAllocatedMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits) : UINT32_MAX;
+        LazyMemoryTypes[i] = LazyMemoryType != UINT32_MAX;
+        MemoryTypes[i] = LazyMemoryTypes[i] ? LazyMemoryType : FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    // Largest first, each texture goes into the first block of its memory type where no lifetime overlaps
+    std::vector<uint32_t> Order(Transients.size());
+    for(uint32_t i = 0; i < Order.size(); i++)
+    {
+        Order[i] = i;
+    }
+    std::sort(Order.begin(), Order.end(), [&Set](uint32_t A, uint32_t B) { return Set.Images[A].Size > Set.Images[B].Size; });
+
+    std::vector<std::vector<uint32_t>> BlockUsers;
+    for(uint32_t i : Order)
+    {
+        const FResource& Resource = Resources[Transients[i]];
+        uint32_t Block = 0;
+        for(; Block < Set.Blocks.size(); Block++)
+        {
+            if(Set.Blocks[Block].MemoryTypeIndex != MemoryTypes[i]) continue;
+
+            bool bOverlaps = false;
+            for(uint32_t User : BlockUsers[Block])
+            {
+                const FResource& Other = Resources[Transients[User]];
+                bOverlaps |= Resource.FirstPass <= Other.LastPass && Other.FirstPass <= Resource.LastPass;
+            }
+            if(!bOverlaps) break;
+        }
+
+        if(Block == Set.Blocks.size())
+        {
+            FMemoryBlock NewBlock;
+            NewBlock.Memory = VK_NULL_HANDLE;
+            NewBlock.Size = 0;
+            NewBlock.MemoryTypeIndex = MemoryTypes[i];
+            NewBlock.bLazy = LazyMemoryTypes[i];
+            Set.Blocks.push_back(NewBlock);
+            BlockUsers.emplace_back();
+        }
+        Set.Blocks[Block].Size = std::max(Set.Blocks[Block].Size, Set.Images[i].Size);
+        Set.Images[i].Block = Block;
+        BlockUsers[Block].push_back(i);
+    }
+
+    for(FMemoryBlock& Block : Set.Blocks)
+    {
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = Block.Size;
+        AllocateInfo.memoryTypeIndex = Block.MemoryTypeIndex;
+        if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &Block.Memory) != VK_SUCCESS)
+        {
+            checkf(0, "FRenderGraph: unable to allocate transient memory");
+        }
+    }
+
+    for(uint32_t i = 0; i < Transients.size(); i++)
+    {
+        const FResource& Resource = Resources[Transients[i]];
+        FTexture& Texture = Set.Images[i].Texture;
+        vkBindImageMemory(Device, Texture.Image, Set.Blocks[Set.Images[i].Block].Memory, 0);
+
+        const bool bDepth = IsDepthFormat(Resource.Desc.Format);
+        VkImageViewCreateInfo ViewInfo = {};
+        ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ViewInfo.image = Texture.Image;
+        ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ViewInfo.format = Resource.Desc.Format;
+        ViewInfo.subresourceRange.aspectMask = bDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        ViewInfo.subresourceRange.levelCount = 1;
+        ViewInfo.subresourceRange.layerCount = 1;
+        if(vkCreateImageView(Device, &ViewInfo, nullptr, &Texture.ImageView) != VK_SUCCESS)
+        {
+            checkf(0, "FRenderGraph: unable to create transient image view");
+        }
+
+        if(Resource.Usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+        {
+            Texture.BindlessIndex = BindlessHeap->RegisterSampledImage(Texture.ImageView,
+                bDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+    }
+
+    VkDeviceSize LazySize = 0;
+    for(const FMemoryBlock& Block : Set.Blocks)
+    {
+        LazySize += Block.bLazy ? Block.Size : 0;
+    }
+
+    Set.Signature = Signature;
+    LOG_Info("Render graph: %u transient textures for frame %u, %.2f MB requested, %.2f MB allocated in %u blocks, %.2f MB of it lazily",
+        static_cast<uint32_t>(Transients.size()), FrameIndex, GetTransientRequestedSize() / (1024.0 * 1024.0),
+        GetTransientAllocatedSize() / (1024.0 * 1024.0), static_cast<uint32_t>(Set.Blocks.size()), LazySize / (1024.0 * 1024.0));
+}
+
+void FRenderGraph::ComputeBarriers()
+{
+    struct FTrackedState
+    {
+        VkImageLayout Layout;
+        VkPipelineStageFlags Stages;
+        VkAccessFlags Access;
+        bool bWritten;
+        bool bTouched;
+        // Owned by the async compute queue family
+        bool bCompute;
+        // Render pass of the last access
+        uint32_t RenderPassIndex;
+    };
+
+    std::vector<FTrackedState> States(Resources.size());
+    for(size_t i = 0; i < Resources.size(); i++)
+    {
+        States[i].Layout = Resources[i].Imported ? Resources[i].Imported->ImageLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+        States[i].Stages = 0;
+        States[i].Access = 0;
+        States[i].bWritten = false;
+        States[i].bTouched = false;
+        States[i].bCompute = false;
+        States[i].RenderPassIndex = UINT32_MAX;
+    }
+
+    // Last accesses to each aliased block, the next texture placed there must wait for them
+    const FTransientSet& Set = TransientSets[FrameIndex];
+    std::vector<std::pair<VkPipelineStageFlags, VkAccessFlags>> BlockStates(Set.Blocks.size(), { 0, 0 });
+
+    // The last write, what has been made visible of it, and every reader since it
+    struct FBufferState
+    {
+        VkPipelineStageFlags WriteStages;
+        VkAccessFlags WriteAccess;
+        // Barriers after the write covered every pairing of these stages and access types
+        VkPipelineStageFlags VisibleStages;
+        VkAccessFlags VisibleAccess;
+        VkPipelineStageFlags ReadStages;
+        bool bCompute;
+        uint32_t WriteRenderPassIndex;
+    };
+    const FBufferState InitialBufferState = { 0, 0, 0, 0, 0, false, UINT32_MAX };
+    std::vector<FBufferState> BufferStates(BufferResources.size(), InitialBufferState);
+
+    for(std::unique_ptr<FRenderGraphPass>& PassPtr : Passes)
+    {
+        FRenderGraphPass& Pass = *PassPtr;
+        Pass.Barriers.clear();
+        Pass.BufferBarriers.clear();
+        Pass.BarrierSrcStages = 0;
+        Pass.BarrierDstStages = 0;
+        if(Pass.bCulled) continue;
+
+        // Barriers can't be recorded inside a render pass, those of later subpasses go before it begins
+        FRenderGraphPass& BarrierPass = *Passes[Pass.RenderPassIndex];
+
+        for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+        {
+            const FResource& Resource = Resources[Access.Texture];
+            FTrackedState& State = States[Access.Texture];
+            const bool bDepthFormat = IsDepthFormat(Resource.Desc.Format);
+            const FAccessState Desired = GetAccessState(Access.Type, Access.Stages, bDepthFormat);
+
+            if(Pass.Subpass > 0 && State.RenderPassIndex == Pass.RenderPassIndex)
+            {
+                // Used by an earlier subpass, the render pass's dependencies and layout transitions take care of it
+                checkf(IsAttachmentAccess(Access.Type), "FRenderGraph: textures an earlier subpass uses can only be read as input attachments");
+                State.Layout = Desired.Layout;
+                State.Stages |= Desired.Stages;
+                State.Access |= Desired.Access;
+                State.bWritten |= Desired.bWrite;
+                if(!Resource.Imported)
+                {
+                    BlockStates[Set.Images[Resource.TransientIndex].Block] = { State.Stages, State.Access };
+                }
+                continue;
+            }
+
+            VkImageLayout OldLayout = State.Layout;
+            VkPipelineStageFlags SrcStages = State.Stages;
+            VkAccessFlags SrcAccess = State.Access;
+            bool bNeedBarrier = OldLayout != Desired.Layout || State.bWritten || Desired.bWrite;
+
+            if(!State.bTouched)
+            {
+                if(Resource.Imported)
+                {
+                    // Earlier frames are ordered by timeline semaphores, within the queue a full barrier is enough
+                    SrcStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                    SrcAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+                }
+                else
+                {
+                    const std::pair<VkPipelineStageFlags, VkAccessFlags>& BlockState = BlockStates[Set.Images[Resource.TransientIndex].Block];
+                    SrcStages = BlockState.first;
+                    SrcAccess = BlockState.second;
+                    OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    bNeedBarrier = true;
+                }
+            }
+            if(IsFullOverwrite(Access.Type, Access.LoadOp))
+            {
+                OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            // Crossing queues, the semaphore between the submits orders the accesses and stages of the other queue mean nothing here.
+            // Contents that are kept need the other queue to release them and this one to acquire them.
+            bool bOwnershipTransfer = false;
+            if(State.bCompute != Pass.bAsync)
+            {
+                bOwnershipTransfer = OldLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+                if(bOwnershipTransfer)
+                {
+                    VkImageMemoryBarrier Release = {};
+                    Release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    Release.srcAccessMask = SrcAccess;
+                    Release.oldLayout = OldLayout;
+                    Release.newLayout = Desired.Layout;
+                    Release.srcQueueFamilyIndex = State.bCompute ? ComputeQueueFamily : GraphicsQueueFamily;
+                    Release.dstQueueFamilyIndex = Pass.bAsync ? ComputeQueueFamily : GraphicsQueueFamily;
+                    Release.image = GetTextureInternal(Access.Texture).Image;
+                    Release.subresourceRange.aspectMask = GetAspectMask(Resource.Desc.Format);
+                    Release.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                    Release.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                    (State.bCompute ? ComputeReleaseBarriers : GraphicsReleaseBarriers).push_back(Release);
+                    (State.bCompute ? ComputeReleaseStages : GraphicsReleaseStages) |=
+                        SrcStages != 0 ? SrcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                }
+                SrcStages = 0;
+                SrcAccess = 0;
+                bNeedBarrier = true;
+                State.bCompute = Pass.bAsync;
+            }
+
+            if(bNeedBarrier)
+            {
+                VkImageMemoryBarrier Barrier = {};
+                Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                Barrier.srcAccessMask = SrcAccess;
+                Barrier.dstAccessMask = Desired.Access;
+                Barrier.oldLayout = OldLayout;
+                Barrier.newLayout = Desired.Layout;
+                Barrier.srcQueueFamilyIndex = bOwnershipTransfer ? (Pass.bAsync ? GraphicsQueueFamily : ComputeQueueFamily) : VK_QUEUE_FAMILY_IGNORED;
+                Barrier.dstQueueFamilyIndex = bOwnershipTransfer ? (Pass.bAsync ? ComputeQueueFamily : GraphicsQueueFamily) : VK_QUEUE_FAMILY_IGNORED;
+                Barrier.image = GetTextureInternal(Access.Texture).Image;
+                Barrier.subresourceRange.aspectMask = GetAspectMask(Resource.Desc.Format);
+                Barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                Barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                BarrierPass.Barriers.push_back(Barrier);
+                BarrierPass.BarrierSrcStages |= SrcStages != 0 ? SrcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                BarrierPass.BarrierDstStages |= Desired.Stages;
+
+                State.Stages = Desired.Stages;
+                State.Access = Desired.Access;
+                State.bWritten = Desired.bWrite;
+            }
+            else
+            {
+                // Reads in the same layout share one barrier, a later write waits for all of them
+                State.Stages |= Desired.Stages;
+                State.Access |= Desired.Access;
+            }
+            State.Layout = Desired.Layout;
+            State.bTouched = true;
+            State.RenderPassIndex = Pass.RenderPassIndex;
+
+            if(!Resource.Imported)
+            {
+                BlockStates[Set.Images[Resource.TransientIndex].Block] = { State.Stages, State.Access };
+            }
+        }
+
+        for(const FRenderGraphPass::FBufferAccess& Access : Pass.BufferAccesses)
+        {
+            FBufferState& State = BufferStates[Access.Buffer];
+            checkf(State.WriteStages == 0 || State.WriteRenderPassIndex != Pass.RenderPassIndex || Pass.Subpass == 0,
+                "FRenderGraph: buffers written inside a render pass can't be accessed by its later subpasses");
+            VkAccessFlags DesiredAccess = Access.bWrite ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+            if(Access.Stages & VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
+            {
+                DesiredAccess |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            }
+
+            if(State.bCompute != Pass.bAsync)
+            {
+                // The semaphore between the submits orders the other queue's accesses and makes its writes visible
+                State = InitialBufferState;
+                State.bCompute = Pass.bAsync;
+            }
+
+            // A write waits for the previous write and every read since it. A read waits for the write unless an earlier
+            // barrier already made it visible to the same stages and access types. The first write of the graph has
+            // nothing to wait for.
+            VkPipelineStageFlags SrcStages = 0;
+            VkAccessFlags SrcAccess = 0;
+            VkPipelineStageFlags DstStages = Access.Stages;
+            VkAccessFlags DstAccess = DesiredAccess;
+            if(Access.bWrite)
+            {
+                SrcStages = State.WriteStages | State.ReadStages;
+                SrcAccess = State.WriteAccess;
+                State.WriteStages = Access.Stages;
+                State.WriteAccess = DesiredAccess;
+                State.VisibleStages = 0;
+                State.VisibleAccess = 0;
+                State.ReadStages = 0;
+                State.WriteRenderPassIndex = Pass.RenderPassIndex;
+            }
+            else
+            {
+                if(State.WriteStages != 0 && ((Access.Stages & ~State.VisibleStages) != 0 || (DesiredAccess & ~State.VisibleAccess) != 0))
+                {
+                    // Covers the earlier readers again so every stage keeps seeing every access type made visible so far
+                    SrcStages = State.WriteStages;
+                    SrcAccess = State.WriteAccess;
+                    DstStages |= State.VisibleStages;
+                    DstAccess |= State.VisibleAccess;
+                    State.VisibleStages = DstStages;
+                    State.VisibleAccess = DstAccess;
+                }
+                State.ReadStages |= Access.Stages;
+            }
+
+            if(SrcStages != 0)
+            {
+                VkBufferMemoryBarrier Barrier = {};
+                Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                Barrier.srcAccessMask = SrcAccess;
+                Barrier.dstAccessMask = DstAccess;
+                Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.buffer = BufferResources[Access.Buffer].Buffer;
+                Barrier.size = BufferResources[Access.Buffer].Size;
+                BarrierPass.BufferBarriers.push_back(Barrier);
+                BarrierPass.BarrierSrcStages |= SrcStages;
+                BarrierPass.BarrierDstStages |= DstStages;
+            }
+        }
+    }
+
+    // Outputs end up in the layout their consumer outside the graph expects (present, sampling next frame...)
+    FinalLayouts.resize(Resources.size());
+    for(size_t i = 0; i < Resources.size(); i++)
+    {
+        const FResource& Resource = Resources[i];
+        FinalLayouts[i] = States[i].Layout;
+        if(!Resource.Imported || !States[i].bTouched) continue;
+
+        // Imported textures go back to the graphics queue family, later frames and users outside the graph expect them there
+        const bool bOwnershipTransfer = States[i].bCompute;
+        const VkImageLayout FinalLayout = Resource.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? Resource.FinalLayout : States[i].Layout;
+        if(FinalLayout == States[i].Layout && !bOwnershipTransfer) continue;
+
+        VkImageMemoryBarrier Barrier = {};
+        Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        VkPipelineStageFlags ConsumerStages = 0;
+        VkAccessFlags ConsumerAccess = 0;
+        GetFinalConsumer(FinalLayout, ConsumerStages, ConsumerAccess);
+        Barrier.srcAccessMask = States[i].Access;
+        Barrier.dstAccessMask = ConsumerAccess;
+        Barrier.oldLayout = States[i].Layout;
+        Barrier.newLayout = FinalLayout;
+        Barrier.srcQueueFamilyIndex = bOwnershipTransfer ? ComputeQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        Barrier.dstQueueFamilyIndex = bOwnershipTransfer ? GraphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        Barrier.image = Resource.Imported->Image;
+        Barrier.subresourceRange.aspectMask = GetAspectMask(Resource.Desc.Format);
+        Barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        Barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        if(bOwnershipTransfer)
+        {
+            VkImageMemoryBarrier Release = Barrier;
+            Release.dstAccessMask = 0;
+            ComputeReleaseBarriers.push_back(Release);
+            ComputeReleaseStages |= States[i].Stages;
+            Barrier.srcAccessMask = 0;
+        }
+        FinalBarriers.push_back(Barrier);
+        FinalSrcStages |= bOwnershipTransfer ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) : States[i].Stages;
+        FinalDstStages |= ConsumerStages;
+        FinalLayouts[i] = FinalLayout;
+    }
+}
+
+void FRenderGraph::Execute(const FRenderGraphCommandBuffers& CommandBuffers, FGpuProfiler* Profiler)
+{
+    check(bCompiled);
+    check(!bAsyncComputeActive || CommandBuffers.AsyncCompute != VK_NULL_HANDLE);
+
+    for(uint32_t PassIndex = 0; PassIndex < Passes.size(); PassIndex++)
+    {
+        FRenderGraphPass& Pass = *Passes[PassIndex];
+        // Later subpasses are recorded with the pass beginning their render pass
+        if(Pass.bCulled || Pass.RenderPassIndex != PassIndex) continue;
+
+        std::array<FRenderGraphPass*, RENDER_PASS_MAX_SUBPASSES> Subpasses;
+        uint32_t SubpassCount = 0;
+        bool bSecondaryCommandBuffers = false;
+        for(uint32_t Next = PassIndex; Next < Passes.size(); Next++)
+        {
+            FRenderGraphPass& Subpass = *Passes[Next];
+            if(Subpass.bCulled || Subpass.bAsync != Pass.bAsync) continue;
+            if(Subpass.RenderPassIndex != PassIndex) break;
+            Subpasses[SubpassCount++] = &Subpass;
+            bSecondaryCommandBuffers |= Subpass.bSecondaryCommandBuffers;
+        }
+
+        const VkCommandBuffer CommandBuffer = Pass.bAsync ? CommandBuffers.AsyncCompute : CommandBuffers.Graphics[Pass.Batch];
+        // Timestamps go outside the render pass, secondaries can't inherit a statistics query.
+        // The compute queue may have no timestamps, and statistics queries are graphics only.
+        FGpuProfiler* PassProfiler = Pass.bAsync && !bComputeTimestamps ? nullptr : Profiler;
+        const uint32_t ProfilerScope = PassProfiler ? PassProfiler->BeginScope(CommandBuffer, Pass.ScopeName.c_str(), !bSecondaryCommandBuffers && !Pass.bAsync) : GPU_PROFILER_INVALID_SCOPE;
+
+        if(!Pass.Barriers.empty() || !Pass.BufferBarriers.empty())
+        {
+            vkCmdPipelineBarrier(CommandBuffer, Pass.BarrierSrcStages, Pass.BarrierDstStages, 0, 0, nullptr,
+                static_cast<uint32_t>(Pass.BufferBarriers.size()), Pass.BufferBarriers.data(),
+                static_cast<uint32_t>(Pass.Barriers.size()), Pass.Barriers.data());
+        }
+
+        FRenderGraphPassContext Context = {};
+        Context.CommandBuffer = CommandBuffer;
+
+        // Attachments are in the layout the barriers put them in when the render pass begins, it only transitions them
+        // between subpasses. Colors are numbered in order of first use across the subpasses.
+        FRenderPassDesc RenderPassDesc;
+        FFramebufferDesc Targets;
+        std::array<VkClearValue, PSO_MAX_COLOR_ATTACHMENTS + 1> ClearValues = {};
+        std::array<uint32_t, PSO_MAX_COLOR_ATTACHMENTS> ColorTextures = {};
+        VkClearValue DepthClearValue = {};
+        for(uint32_t SubpassIndex = 0; SubpassIndex < SubpassCount; SubpassIndex++)
+        {
+            FSubpassDesc& SubpassDesc = RenderPassDesc.Subpasses[SubpassIndex];
+            for(const FRenderGraphPass::FAccess& Access : Subpasses[SubpassIndex]->Accesses)
+            {
+                if(!IsAttachmentAccess(Access.Type)) continue;
+
+                const FTexture& Texture = GetTextureInternal(Access.Texture);
+                const bool bDepth = IsDepthFormat(Texture.Format);
+                const FAccessState State = GetAccessState(Access.Type, Access.Stages, bDepth);
+                const bool bStore = Access.bStore || Access.Type == ERenderGraphAccess::DepthReadOnly;
+
+                uint32_t Slot = RENDER_PASS_DEPTH_ATTACHMENT;
+                if(!bDepth)
+                {
+                    Slot = 0;
+                    while(Slot < RenderPassDesc.ColorAttachmentCount && ColorTextures[Slot] != Access.Texture)
+                    {
+                        Slot++;
+                    }
+                }
+
+                FAttachmentDesc& Attachment = bDepth ? RenderPassDesc.DepthAttachment : RenderPassDesc.ColorAttachments[Slot];
+                const bool bFirstUse = bDepth ? Targets.DepthView == VK_NULL_HANDLE : Slot == RenderPassDesc.ColorAttachmentCount;
+                if(bFirstUse)
+                {
+                    check(Access.Type != ERenderGraphAccess::InputAttachment);
+                    Attachment = FAttachmentDesc(Texture.Format, Access.LoadOp, bStore ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE, State.Layout);
+                    Attachment.InitialLayout = State.Layout;
+                    Targets.Width = Texture.SizeX;
+                    Targets.Height = Texture.SizeY;
+                    if(bDepth)
+                    {
+                        DepthClearValue = Access.ClearValue;
+                        Targets.DepthView = Texture.ImageView;
+                    }
+                    else
+                    {
+                        check(Slot < PSO_MAX_COLOR_ATTACHMENTS);
+                        ColorTextures[Slot] = Access.Texture;
+                        ClearValues[Slot] = Access.ClearValue;
+                        Targets.ColorViews[Slot] = Texture.ImageView;
+                        RenderPassDesc.ColorAttachmentCount++;
+                    }
+                }
+                else
+                {
+                    // Ends in the layout of the last subpass using it, stored if any of them needs it afterwards
+                    Attachment.FinalLayout = State.Layout;
+                    if(bStore)
+                    {
+                        Attachment.StoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+                    }
+                }
+                check(Texture.SizeX == Targets.Width && Texture.SizeY == Targets.Height);
+
+                if(Access.Type == ERenderGraphAccess::InputAttachment)
+                {
+                    SubpassDesc.InputAttachments[SubpassDesc.InputAttachmentCount++] = static_cast<uint8_t>(Slot);
+                }
+                else if(bDepth)
+                {
+                    SubpassDesc.bDepth = true;
+                }
+                else
+                {
+                    SubpassDesc.ColorAttachments[SubpassDesc.ColorAttachmentCount++] = static_cast<uint8_t>(Slot);
+                }
+            }
+        }
+        // A lone subpass uses every attachment, the render pass is the same as one described without subpasses
+        RenderPassDesc.SubpassCount = SubpassCount > 1 ? SubpassCount : 0;
+
+        const uint32_t AttachmentCount = RenderPassDesc.GetAttachmentCount();
+        if(AttachmentCount > 0)
+        {
+            ClearValues[RenderPassDesc.ColorAttachmentCount] = DepthClearValue;
+            Context.RenderPass = RenderPassCache->GetRenderPass(RenderPassDesc);
+            Context.Framebuffer = RenderPassCache->GetFramebuffer(RenderPassDesc, Targets);
+            Context.Extent = { Targets.Width, Targets.Height };
+
+            VkRenderPassBeginInfo BeginInfo = {};
+            BeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            BeginInfo.renderPass = Context.RenderPass;
+            BeginInfo.framebuffer = Context.Framebuffer;
+            BeginInfo.renderArea.extent = Context.Extent;
+            BeginInfo.clearValueCount = AttachmentCount;
+            BeginInfo.pClearValues = ClearValues.data();
+            vkCmdBeginRenderPass(CommandBuffer, &BeginInfo, Pass.bSecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+        for(uint32_t SubpassIndex = 0; SubpassIndex < SubpassCount; SubpassIndex++)
+        {
+            FRenderGraphPass& Subpass = *Subpasses[SubpassIndex];
+            if(SubpassIndex > 0)
+            {
+                vkCmdNextSubpass(CommandBuffer, Subpass.bSecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+            }
+            Context.Subpass = SubpassIndex;
+            if(Subpass.Execute)
+            {
+                Subpass.Execute(Context);
+            }
+        }
+
+        if(AttachmentCount > 0)
+        {
+            vkCmdEndRenderPass(CommandBuffer);
+        }
+
+        if(PassProfiler)
+        {
+            PassProfiler->EndScope(CommandBuffer, ProfilerScope);
+        }
+    }
+
+    // Releases end the batch signaling the other queue, the acquiring passes wait for that signal
+    if(!GraphicsReleaseBarriers.empty())
+    {
+        vkCmdPipelineBarrier(CommandBuffers.Graphics[0], GraphicsReleaseStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(GraphicsReleaseBarriers.size()), GraphicsReleaseBarriers.data());
+    }
+    if(!ComputeReleaseBarriers.empty())
+    {
+        vkCmdPipelineBarrier(CommandBuffers.AsyncCompute, ComputeReleaseStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(ComputeReleaseBarriers.size()), ComputeReleaseBarriers.data());
+    }
+
+    if(!FinalBarriers.empty())
+    {
+        vkCmdPipelineBarrier(CommandBuffers.Graphics[RENDER_GRAPH_GRAPHICS_BATCHES - 1], FinalSrcStages, FinalDstStages, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(FinalBarriers.size()), FinalBarriers.data());
+    }
+
+    for(size_t i = 0; i < Resources.size(); i++)
+    {
+        if(Resources[i].Imported)
+        {
+            Resources[i].Imported->ImageLayout = FinalLayouts[i];
+        }
+    }
+}
+
+const FTexture& FRenderGraph::GetTexture(FRenderGraphTexture Handle) const
+{
+    check(bCompiled && Handle.IsValid());
+    const FResource& Resource = Resources[Handle.Index];
+    if(Resource.Imported) return *Resource.Imported;
+
+    check(Resource.TransientIndex != UINT32_MAX);
+    return TransientSets[FrameIndex].Images[Resource.TransientIndex].Texture;
+}
+
+FTexture& FRenderGraph::GetTextureInternal(uint32_t Index)
+{
+    FResource& Resource = Resources[Index];
+    if(Resource.Imported) return *Resource.Imported;
+    return TransientSets[FrameIndex].Images[Resource.TransientIndex].Texture;
+}
+
+bool FRenderGraph::IsDepthFormat(VkFormat Format)
+{
+    return Format == VK_FORMAT_D16_UNORM || Format == VK_FORMAT_X8_D24_UNORM_PACK32 || Format == VK_FORMAT_D32_SFLOAT
+        || Format == VK_FORMAT_D16_UNORM_S8_UINT || Format == VK_FORMAT_D24_UNORM_S8_UINT || Format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+bool FRenderGraph::ReadsInputAttachments(const FRenderGraphPass& Pass)
+{
+    for(const FRenderGraphPass::FAccess& Access : Pass.Accesses)
+    {
+        if(Access.Type == ERenderGraphAccess::InputAttachment) return true;
+    }
+    return false;
+}
+
+VkImageAspectFlags FRenderGraph::GetAspectMask(VkFormat Format)
+{
+    if(!IsDepthFormat(Format)) return VK_IMAGE_ASPECT_COLOR_BIT;
+    if(Format == VK_FORMAT_D16_UNORM_S8_UINT || Format == VK_FORMAT_D24_UNORM_S8_UINT || Format == VK_FORMAT_D32_SFLOAT_S8_UINT)
+    {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+void FRenderGraph::DestroyTransientSet(FTransientSet& Set)
+{
+    for(FTransientImage& Image : Set.Images)
+    {
+        if(Image.Texture.BindlessIndex != BINDLESS_INVALID_INDEX)
+        {
+            BindlessHeap->Release(BINDLESS_SampledImages, Image.Texture.BindlessIndex);
+        }
+        if(Image.Texture.ImageView != VK_NULL_HANDLE)
+        {
+            RenderPassCache->ReleaseImageView(Image.Texture.ImageView);
+            vkDestroyImageView(Device, Image.Texture.ImageView, nullptr);
+        }
+        vkDestroyImage(Device, Image.Texture.Image, nullptr);
+    }
+    for(FMemoryBlock& Block : Set.Blocks)
+    {
+        vkFreeMemory(Device, Block.Memory, nullptr);
+    }
+    Set.Images.clear();
+    Set.Blocks.clear();
+    Set.Signature = 0;
+}
+
+uint32_t FRenderGraph::GetNumAsyncPasses() const
+{
+    uint32_t NumAsync = 0;
+    for(const std::unique_ptr<FRenderGraphPass>& Pass : Passes)
+    {
+        NumAsync += Pass->bAsync ? 1 : 0;
+    }
+    return NumAsync;
+}
+
+uint32_t FRenderGraph::GetNumCulledPasses() const
+{
+    uint32_t NumCulled = 0;
+    for(const std::unique_ptr<FRenderGraphPass>& Pass : Passes)
+    {
+        NumCulled += Pass->bCulled ? 1 : 0;
+    }
+    return NumCulled;
+}
+
+VkDeviceSize FRenderGraph::GetTransientRequestedSize() const
+{
+    VkDeviceSize Size = 0;
+    for(const FTransientImage& Image : TransientSets[FrameIndex].Images)
+    {
+        Size += Image.Size;
+    }
+    return Size;
+}
+
+VkDeviceSize FRenderGraph::GetTransientAllocatedSize() const
+{
+    VkDeviceSize Size = 0;
+    for(const FMemoryBlock& Block : TransientSets[FrameIndex].Blocks)
+    {
+        Size += Block.Size;
+    }
+    return Size;
+}
+
+VkDeviceSize FRenderGraph::GetLazyCommittedSize() const
+{
+    VkDeviceSize Size = 0;
+    for(const FMemoryBlock& Block : TransientSets[FrameIndex].Blocks)
+    {
+        if(!Block.bLazy) continue;
+
+        VkDeviceSize Committed = 0;
+        vkGetDeviceMemoryCommitment(Device, Block.Memory, &Committed);
+        Size += Committed;
+    }
+    return Size;
+}
+
+bool FRenderGraph::DumpGraphviz(const std::string& FilePath) const
+{
+    std::ofstream Stream(FilePath, std::ios::trunc);
+    if(!Stream) return false;
+
+    Stream << "digraph RenderGraph {\n";
+    Stream << "    rankdir=LR;\n";
+    Stream << "    node [fontname=\"Helvetica\", style=filled];\n";
+
+    for(size_t i = 0; i < Passes.size(); i++)
+    {
+        const FRenderGraphPass& Pass = *Passes[i];
+        Stream << "    P" << i << " [shape=box, fillcolor=\"" << (Pass.bCulled ? "gray80" : (Pass.bAsync ? "khaki" : "lightblue")) << "\", label=\""
+            << Pass.Name << (Pass.bCulled ? "\\n(culled)" : "") << (Pass.bAsync ? "\\n(async compute)" : "");
+        if(Pass.Subpass > 0 && bCompiled)
+        {
+            Stream << "\\nsubpass " << Pass.Subpass << " of " << Passes[Pass.RenderPassIndex]->Name;
+        }
+        Stream << "\\nbarriers: " << Pass.Barriers.size() + Pass.BufferBarriers.size() << "\"];\n";
+    }
+
+    for(size_t i = 0; i < Resources.size(); i++)
+    {
+        const FResource& Resource = Resources[i];
+        Stream << "    R" << i << " [shape=ellipse, fillcolor=\"" << (Resource.Imported ? "orange" : "palegreen") << "\", label=\""
+            << Resource.Name << "\\n" << Resource.Desc.Width << "x" << Resource.Desc.Height << " fmt " << Resource.Desc.Format;
+        if(!Resource.Imported && Resource.TransientIndex != UINT32_MAX && bCompiled)
+        {
+            Stream << "\\nblock " << TransientSets[FrameIndex].Images[Resource.TransientIndex].Block;
+        }
+        Stream << "\"];\n";
+    }
+    for(size_t i = 0; i < BufferResources.size(); i++)
+    {
+        Stream << "    B" << i << " [shape=cylinder, fillcolor=\"orange\", label=\"" << BufferResources[i].Name << "\"];\n";
+    }
+
+    for(size_t i = 0; i < Passes.size(); i++)
+    {
+        for(const FRenderGraphPass::FAccess& Access : Passes[i]->Accesses)
+        {
+            if(IsWriteAccess(Access.Type))
+            {
+                Stream << "    P" << i << " -> R" << Access.Texture << " [color=\"red\"];\n";
+            }
+            if(!IsFullOverwrite(Access.Type, Access.LoadOp))
+            {
+                Stream << "    R" << Access.Texture << " -> P" << i << ";\n";
+            }
+        }
+        for(const FRenderGraphPass::FBufferAccess& Access : Passes[i]->BufferAccesses)
+        {
+            if(Access.bWrite)
+            {
+                Stream << "    P" << i << " -> B" << Access.Buffer << " [color=\"red\"];\n";
+            }
+            else
+            {
+                Stream << "    B" << Access.Buffer << " -> P" << i << ";\n";
+            }
+        }
+    }
+
+    Stream << "}\n";
+    return static_cast<bool>(Stream);
+}
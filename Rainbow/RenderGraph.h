@@ -0,0 +1,302 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+#include "RenderPassCache.h"
+#include "RenderResource.h"
+
+class FBindlessHeap;
+class FGpuProfiler;
+
+// Graphics work of a frame using async compute is split in batches: what the async passes depend on, what overlaps them,
+// and what consumes their results
+#define RENDER_GRAPH_GRAPHICS_BATCHES 3
+
+// Handle to a texture declared in the current frame's graph
+struct FRenderGraphTexture
+{
+    uint32_t Index;
+
+    FRenderGraphTexture() : Index(UINT32_MAX) {}
+    explicit FRenderGraphTexture(uint32_t InIndex) : Index(InIndex) {}
+    bool IsValid() const { return Index != UINT32_MAX; }
+};
+
+// Handle to a buffer imported into the current frame's graph
+struct FRenderGraphBuffer
+{
+    uint32_t Index;
+
+    FRenderGraphBuffer() : Index(UINT32_MAX) {}
+    explicit FRenderGraphBuffer(uint32_t InIndex) : Index(InIndex) {}
+    bool IsValid() const { return Index != UINT32_MAX; }
+};
+
+struct FRenderGraphTextureDesc
+{
+    uint32_t Width, Height;
+    VkFormat Format;
+    // Added to the usage derived from the passes accessing the texture
+    VkImageUsageFlags ExtraUsage;
+
+    FRenderGraphTextureDesc() : Width(0), Height(0), Format(VK_FORMAT_UNDEFINED), ExtraUsage(0) {}
+    FRenderGraphTextureDesc(uint32_t InWidth, uint32_t InHeight, VkFormat InFormat) : Width(InWidth), Height(InHeight), Format(InFormat), ExtraUsage(0) {}
+};
+
+enum class ERenderGraphAccess : uint8_t
+{
+    ColorAttachment,
+    DepthAttachment,
+    // Depth test without writes, stays bound as the depth attachment
+    DepthReadOnly,
+    Sampled,
+    StorageRead,
+    StorageWrite,
+    // Read through subpassInput at the same pixel, the pass becomes the next subpass of the render pass that wrote the texture
+    InputAttachment
+};
+
+// Where Execute records, without async compute every graphics batch is the same command buffer
+struct FRenderGraphCommandBuffers
+{
+    VkCommandBuffer Graphics[RENDER_GRAPH_GRAPHICS_BATCHES];
+    VkCommandBuffer AsyncCompute;
+
+    FRenderGraphCommandBuffers() : Graphics{}, AsyncCompute(VK_NULL_HANDLE) {}
+    explicit FRenderGraphCommandBuffers(VkCommandBuffer CommandBuffer) : Graphics{ CommandBuffer, CommandBuffer, CommandBuffer }, AsyncCompute(VK_NULL_HANDLE) {}
+};
+
+struct FRenderGraphPassContext
+{
+    VkCommandBuffer CommandBuffer;
+    // Null for passes without attachments
+    VkRenderPass RenderPass;
+    VkFramebuffer Framebuffer;
+    VkExtent2D Extent;
+    // Pipelines and secondaries of the pass must use this subpass of RenderPass
+    uint32_t Subpass;
+};
+
+class FRenderGraphPass
+{
+public:
+    typedef std::function<void(const FRenderGraphPassContext& Context)> FExecute;
+
+    // LOAD keeps the previous contents and makes the pass depend on the previous writer, CLEAR/DONT_CARE discard them
+    FRenderGraphPass& WriteColor(FRenderGraphTexture Texture, VkAttachmentLoadOp LoadOp, VkClearColorValue ClearColor = {});
+    FRenderGraphPass& WriteDepth(FRenderGraphTexture Texture, VkAttachmentLoadOp LoadOp, VkClearDepthStencilValue ClearDepth = {1.0f, 0});
+    FRenderGraphPass& ReadDepth(FRenderGraphTexture Texture);
+    FRenderGraphPass& ReadTexture(FRenderGraphTexture Texture, VkPipelineStageFlags Stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    FRenderGraphPass& ReadStorage(FRenderGraphTexture Texture, VkPipelineStageFlags Stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    FRenderGraphPass& WriteStorage(FRenderGraphTexture Texture, VkPipelineStageFlags Stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // The texture must be an attachment of the previous pass (or of the render pass it continues), both get merged
+    FRenderGraphPass& ReadInputAttachment(FRenderGraphTexture Texture);
+    // Storage buffer reads, DRAW_INDIRECT in Stages also reads it as indirect arguments
+    FRenderGraphPass& ReadBuffer(FRenderGraphBuffer Buffer, VkPipelineStageFlags Stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    FRenderGraphPass& WriteBuffer(FRenderGraphBuffer Buffer, VkPipelineStageFlags Stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Never culled, for passes whose results leave the graph some other way (readbacks, queries)
+    FRenderGraphPass& SetSideEffect();
+    // The render pass is begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    FRenderGraphPass& UseSecondaryCommandBuffers();
+    // Runs on the async compute queue when the graph has one, overlapping the graphics passes it shares no texture with.
+    // Storage and sampled accesses only, their stages become the compute shader stage.
+    FRenderGraphPass& UseAsyncCompute();
+    FRenderGraphPass& SetExecute(FExecute InExecute);
+
+    const std::string& GetName() const { return Name; }
+    bool IsCulled() const { return bCulled; }
+    bool IsAsyncCompute() const { return bAsync; }
+    uint32_t GetSubpass() const { return Subpass; }
+
+private:
+    friend class FRenderGraph;
+
+    struct FAccess
+    {
+        uint32_t Texture;
+        ERenderGraphAccess Type;
+        VkPipelineStageFlags Stages;
+        VkAttachmentLoadOp LoadOp;
+        VkClearValue ClearValue;
+        bool bStore;
+    };
+
+    struct FBufferAccess
+    {
+        uint32_t Buffer;
+        VkPipelineStageFlags Stages;
+        bool bWrite;
+    };
+
+    explicit FRenderGraphPass(const std::string& InName);
+    FRenderGraphPass& AddAccess(FRenderGraphTexture Texture, ERenderGraphAccess Type, VkPipelineStageFlags Stages, VkAttachmentLoadOp LoadOp, const VkClearValue& ClearValue);
+
+private:
+    std::string Name;
+    std::vector<FAccess> Accesses;
+    std::vector<FBufferAccess> BufferAccesses;
+    FExecute Execute;
+    bool bSideEffect;
+    bool bSecondaryCommandBuffers;
+    bool bAsyncCompute;
+    bool bCulled;
+
+    // Filled by Compile
+    bool bAsync;
+    uint32_t Batch;
+    // Pass beginning the render pass this one is a subpass of, itself when it begins one
+    uint32_t RenderPassIndex;
+    uint32_t Subpass;
+    // Merged render passes are timed as a whole, named after all their subpasses
+    std::string ScopeName;
+    std::vector<VkImageMemoryBarrier> Barriers;
+    std::vector<VkBufferMemoryBarrier> BufferBarriers;
+    VkPipelineStageFlags BarrierSrcStages;
+    VkPipelineStageFlags BarrierDstStages;
+};
+
+// Frame graph rebuilt every frame: passes declare the textures they access, Compile culls passes whose results are
+// never used, merges passes reading input attachments into the render pass before them as subpasses, derives batched
+// barriers and layout transitions (tracking FTexture::ImageLayout of imported textures) and places transient textures
+// with disjoint lifetimes in the same memory.
+// Transient attachments that never leave their render pass are created as transient attachments in lazily allocated
+// memory when the device has it, tile based GPUs then never back them with memory at all.
+// Passes execute in declaration order, a pass can only access handles declared before it so that order is already
+// a valid topological order.
+// Transient textures are kept per frame in flight and only recreated when the declared set changes (e.g. on resize).
+class FRenderGraph
+{
+public:
+    FRenderGraph();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice InPhysicalDevice, FRenderPassCache* InRenderPassCache, FBindlessHeap* InBindlessHeap, uint32_t FramesInFlight);
+    // Without it async compute passes run on the graphics queue. Textures move between the families with ownership transfers.
+    void EnableAsyncCompute(uint32_t InGraphicsQueueFamily, uint32_t InComputeQueueFamily, bool bInComputeTimestamps);
+    void Shutdown();
+
+    // Starts a new graph, the frame's ticket must be complete since its transient textures get reused
+    void Reset(uint32_t InFrameIndex);
+
+    // A FinalLayout other than UNDEFINED marks the texture as a graph output, it's transitioned after the last pass
+    FRenderGraphTexture ImportTexture(const std::string& Name, FTexture* Texture, VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    FRenderGraphTexture CreateTexture(const std::string& Name, const FRenderGraphTextureDesc& Desc);
+    // Buffers are never transient. Accesses are only ordered against other passes of the graph, the caller keeps the
+    // buffer away from earlier frames still using it (one per frame in flight) and creates it VK_SHARING_MODE_CONCURRENT
+    // when async compute passes access it.
+    FRenderGraphBuffer ImportBuffer(const std::string& Name, VkBuffer Buffer, VkDeviceSize Size = VK_WHOLE_SIZE);
+    FRenderGraphPass& AddPass(const std::string& Name);
+
+    void Compile();
+    // True when the compiled graph has work for the async compute queue, Execute then needs all its command buffers
+    bool UsesAsyncCompute() const { return bAsyncComputeActive; }
+    // With a profiler every pass gets its own GPU timing scope
+    void Execute(const FRenderGraphCommandBuffers& CommandBuffers, FGpuProfiler* Profiler = nullptr);
+
+    // Valid between Compile and the next Reset, transient textures have their bindless index set when sampled
+    const FTexture& GetTexture(FRenderGraphTexture Handle) const;
+
+    bool DumpGraphviz(const std::string& FilePath) const;
+
+    uint32_t GetNumPasses() const { return static_cast<uint32_t>(Passes.size()); }
+    uint32_t GetNumCulledPasses() const;
+    // Passes the compiled graph runs on the async compute queue
+    uint32_t GetNumAsyncPasses() const;
+    // Sum of the transient texture sizes against the memory actually allocated for them after aliasing
+    VkDeviceSize GetTransientRequestedSize() const;
+    VkDeviceSize GetTransientAllocatedSize() const;
+    // Lazily allocated memory the driver actually had to commit, 0 as long as the attachments stayed on tile
+    VkDeviceSize GetLazyCommittedSize() const;
+
+private:
+    struct FResource
+    {
+        std::string Name;
+        FTexture* Imported;
+        FRenderGraphTextureDesc Desc;
+        VkImageLayout FinalLayout;
+        VkImageUsageFlags Usage;
+        uint32_t FirstPass;
+        uint32_t LastPass;
+        uint32_t TransientIndex;
+        bool bAsyncCompute;
+        // Attachment of a single render pass that is never stored, its contents only ever live on tile
+        bool bTileOnly;
+        // Render pass of the first access, see FRenderGraphPass::RenderPassIndex
+        uint32_t RenderPassIndex;
+    };
+
+    struct FBufferResource
+    {
+        std::string Name;
+        VkBuffer Buffer;
+        VkDeviceSize Size;
+    };
+
+    struct FTransientImage
+    {
+        FTexture Texture;
+        VkDeviceSize Size;
+        uint32_t Block;
+    };
+
+    struct FMemoryBlock
+    {
+        VkDeviceMemory Memory;
+        VkDeviceSize Size;
+        uint32_t MemoryTypeIndex;
+        bool bLazy;
+    };
+
+    struct FTransientSet
+    {
+        uint64_t Signature;
+        std::vector<FTransientImage> Images;
+        std::vector<FMemoryBlock> Blocks;
+    };
+
+    void CullPasses();
+    void AssignQueues();
+    void MergeSubpasses();
+    void ComputeLifetimes();
+    void AllocateTransients();
+    void ComputeBarriers();
+    void DestroyTransientSet(FTransientSet& Set);
+    FTexture& GetTextureInternal(uint32_t Index);
+    static bool IsDepthFormat(VkFormat Format);
+    // Every aspect of the format, barriers on depth stencil images must include both
+    static VkImageAspectFlags GetAspectMask(VkFormat Format);
+    // Such a pass continues the render pass of the graphics pass before it
+    static bool ReadsInputAttachments(const FRenderGraphPass& Pass);
+
+private:
+    VkDevice Device;
+    VkPhysicalDevice PhysicalDevice;
+    FRenderPassCache* RenderPassCache;
+    FBindlessHeap* BindlessHeap;
+    uint32_t FrameIndex;
+    bool bCompiled;
+    uint32_t GraphicsQueueFamily;
+    uint32_t ComputeQueueFamily;
+    bool bComputeTimestamps;
+    bool bAsyncComputeActive;
+    bool bAsyncFallbackLogged;
+
+    std::vector<FResource> Resources;
+    std::vector<FBufferResource> BufferResources;
+    std::vector<std::unique_ptr<FRenderGraphPass>> Passes;
+    std::vector<VkImageMemoryBarrier> FinalBarriers;
+    VkPipelineStageFlags FinalSrcStages;
+    VkPipelineStageFlags FinalDstStages;
+    std::vector<VkImageLayout> FinalLayouts;
+    // Ownership releases recorded at the end of graphics batch 0 and of the async compute work
+    std::vector<VkImageMemoryBarrier> GraphicsReleaseBarriers;
+    VkPipelineStageFlags GraphicsReleaseStages;
+    std::vector<VkImageMemoryBarrier> ComputeReleaseBarriers;
+    VkPipelineStageFlags ComputeReleaseStages;
+
+    std::vector<FTransientSet> TransientSets;
+};
@@ -0,0 +1,314 @@
+#include "RenderPassCache.h"
+#include <array>
+#include "Hash.h"
+
+FAttachmentDesc::FAttachmentDesc()
+{
+    Format = VK_FORMAT_UNDEFINED;
+    Samples = VK_SAMPLE_COUNT_1_BIT;
+    LoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    StoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    StencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    StencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+FAttachmentDesc::FAttachmentDesc(VkFormat InFormat, VkAttachmentLoadOp InLoadOp, VkAttachmentStoreOp InStoreOp, VkImageLayout InFinalLayout)
+    : FAttachmentDesc()
+{
+    Format = InFormat;
+    LoadOp = InLoadOp;
+    StoreOp = InStoreOp;
+    FinalLayout = InFinalLayout;
+}
+
+FSubpassDesc::FSubpassDesc()
+{
+    ColorAttachmentCount = 0;
+    InputAttachmentCount = 0;
+    bDepth = false;
+}
+
+FRenderPassDesc::FRenderPassDesc()
+{
+    ColorAttachmentCount = 0;
+    SubpassCount = 0;
+}
+
+static uint64_t HashAttachment(uint64_t Hash, const FAttachmentDesc& Attachment)
+{
+    Hash = HashCombine(Hash, HashValue(Attachment.Format));
+    Hash = HashCombine(Hash, HashValue(Attachment.Samples));
+    Hash = HashCombine(Hash, HashValue(Attachment.LoadOp));
+    Hash = HashCombine(Hash, HashValue(Attachment.StoreOp));
+    Hash = HashCombine(Hash, HashValue(Attachment.StencilLoadOp));
+    Hash = HashCombine(Hash, HashValue(Attachment.StencilStoreOp));
+    Hash = HashCombine(Hash, HashValue(Attachment.InitialLayout));
+    Hash = HashCombine(Hash, HashValue(Attachment.FinalLayout));
+    return Hash;
+}
+
+uint64_t FRenderPassDesc::GetHash() const
+{
+    uint64_t Hash = HashValue(ColorAttachmentCount);
+    for(uint32_t i = 0; i < ColorAttachmentCount; i++)
+    {
+        Hash = HashAttachment(Hash, ColorAttachments[i]);
+    }
+    Hash = HashAttachment(Hash, DepthAttachment);
+
+    Hash = HashCombine(Hash, HashValue(SubpassCount));
+    for(uint32_t i = 0; i < SubpassCount; i++)
+    {
+        const FSubpassDesc& Subpass = Subpasses[i];
+        Hash = HashCombine(Hash, HashValue(Subpass.ColorAttachmentCount));
+        Hash = HashCombine(Hash, HashBytes(Subpass.ColorAttachments, Subpass.ColorAttachmentCount));
+        Hash = HashCombine(Hash, HashValue(Subpass.InputAttachmentCount));
+        Hash = HashCombine(Hash, HashBytes(Subpass.InputAttachments, Subpass.InputAttachmentCount));
+        Hash = HashCombine(Hash, HashValue(Subpass.bDepth));
+    }
+    return Hash;
+}
+
+FFramebufferDesc::FFramebufferDesc()
+{
+    for(VkImageView& ColorView : ColorViews)
+    {
+        ColorView = VK_NULL_HANDLE;
+    }
+    DepthView = VK_NULL_HANDLE;
+    Width = 0;
+    Height = 0;
+}
+
+FRenderPassCache::FRenderPassCache()
+{
+    Device = VK_NULL_HANDLE;
+}
+
+void FRenderPassCache::Init(VkDevice InDevice)
+{
+    Device = InDevice;
+}
+
+void FRenderPassCache::Shutdown()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for(auto& Framebuffer : Framebuffers)
+    {
+        vkDestroyFramebuffer(Device, Framebuffer.second, nullptr);
+    }
+    for(auto& RenderPass : RenderPasses)
+    {
+        vkDestroyRenderPass(Device, RenderPass.second, nullptr);
+    }
+    Framebuffers.clear();
+    ViewToFramebuffers.clear();
+    RenderPasses.clear();
+}
+
+VkRenderPass FRenderPassCache::GetRenderPass(const FRenderPassDesc& Desc)
+{
+    const uint64_t Hash = Desc.GetHash();
+    std::lock_guard<std::mutex> Lock(Mutex);
+    VkRenderPass& RenderPass = RenderPasses[Hash];
+    if(RenderPass == VK_NULL_HANDLE)
+    {
+        RenderPass = CreateRenderPass(Desc);
+    }
+    return RenderPass;
+}
+
+VkFramebuffer FRenderPassCache::GetFramebuffer(const FRenderPassDesc& Desc, const FFramebufferDesc& Targets)
+{
+    const VkRenderPass RenderPass = GetRenderPass(Desc);
+
+    std::array<VkImageView, PSO_MAX_COLOR_ATTACHMENTS + 1> Views;
+    uint32_t ViewCount = 0;
+    for(uint32_t i = 0; i < Desc.ColorAttachmentCount; i++)
+    {
+        Views[ViewCount++] = Targets.ColorViews[i];
+    }
+    if(Desc.HasDepth())
+    {
+        Views[ViewCount++] = Targets.DepthView;
+    }
+
+    uint64_t Hash = HashValue(RenderPass);
+    Hash = HashCombine(Hash, HashBytes(Views.data(), sizeof(VkImageView) * ViewCount));
+    Hash = HashCombine(Hash, HashValue(Targets.Width));
+    Hash = HashCombine(Hash, HashValue(Targets.Height));
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const auto Found = Framebuffers.find(Hash);
+    if(Found != Framebuffers.end())
+    {
+        return Found->second;
+    }
+
+    VkFramebufferCreateInfo FramebufferCreateInfo = {};
+    FramebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    FramebufferCreateInfo.renderPass = RenderPass;
+    FramebufferCreateInfo.attachmentCount = ViewCount;
+    FramebufferCreateInfo.pAttachments = Views.data();
+    FramebufferCreateInfo.width = Targets.Width;
+    FramebufferCreateInfo.height = Targets.Height;
+    FramebufferCreateInfo.layers = 1;
+
+    VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+    if(vkCreateFramebuffer(Device, &FramebufferCreateInfo, nullptr, &Framebuffer) != VK_SUCCESS)
+    {
+        checkf(0, "FRenderPassCache: unable to create framebuffer");
+    }
+
+    Framebuffers[Hash] = Framebuffer;
+    for(uint32_t i = 0; i < ViewCount; i++)
+    {
+        ViewToFramebuffers[Views[i]].push_back(Hash);
+    }
+    return Framebuffer;
+}
+
+void FRenderPassCache::ReleaseImageView(VkImageView ImageView)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const auto Found = ViewToFramebuffers.find(ImageView);
+    if(Found == ViewToFramebuffers.end()) return;
+
+    // Other views of an evicted framebuffer may keep a stale key, the lookup below just skips it later
+    for(uint64_t Hash : Found->second)
+    {
+        const auto Framebuffer = Framebuffers.find(Hash);
+        if(Framebuffer != Framebuffers.end())
+        {
+            vkDestroyFramebuffer(Device, Framebuffer->second, nullptr);
+            Framebuffers.erase(Framebuffer);
+        }
+    }
+    ViewToFramebuffers.erase(Found);
+}
+
+uint32_t FRenderPassCache::GetNumRenderPasses() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return static_cast<uint32_t>(RenderPasses.size());
+}
+
+uint32_t FRenderPassCache::GetNumFramebuffers() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return static_cast<uint32_t>(Framebuffers.size());
+}
+
+VkRenderPass FRenderPassCache::CreateRenderPass(const FRenderPassDesc& Desc) const
+{
+    std::array<VkAttachmentDescription, PSO_MAX_COLOR_ATTACHMENTS + 1> Attachments = {};
+    const uint32_t AttachmentCount = Desc.GetAttachmentCount();
+    for(uint32_t i = 0; i < AttachmentCount; i++)
+    {
+        const FAttachmentDesc& Attachment = i < Desc.ColorAttachmentCount ? Desc.ColorAttachments[i] : Desc.DepthAttachment;
+        Attachments[i].format = Attachment.Format;
+        Attachments[i].samples = Attachment.Samples;
+        Attachments[i].loadOp = Attachment.LoadOp;
+        Attachments[i].storeOp = Attachment.StoreOp;
+        Attachments[i].stencilLoadOp = Attachment.StencilLoadOp;
+        Attachments[i].stencilStoreOp = Attachment.StencilStoreOp;
+        Attachments[i].initialLayout = Attachment.InitialLayout;
+        Attachments[i].finalLayout = Attachment.FinalLayout;
+    }
+
+    // Without subpasses the only one uses every attachment
+    FSubpassDesc DefaultSubpass;
+    DefaultSubpass.ColorAttachmentCount = Desc.ColorAttachmentCount;
+    for(uint32_t i = 0; i < Desc.ColorAttachmentCount; i++)
+    {
+        DefaultSubpass.ColorAttachments[i] = static_cast<uint8_t>(i);
+    }
+    DefaultSubpass.bDepth = Desc.HasDepth();
+    const uint32_t SubpassCount = Desc.SubpassCount > 0 ? Desc.SubpassCount : 1;
+    const FSubpassDesc* SubpassDescs = Desc.SubpassCount > 0 ? Desc.Subpasses : &DefaultSubpass;
+    check(SubpassCount <= RENDER_PASS_MAX_SUBPASSES);
+
+    VkAttachmentReference DepthReference = {};
+    DepthReference.attachment = Desc.ColorAttachmentCount;
+    DepthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    std::array<std::array<VkAttachmentReference, PSO_MAX_COLOR_ATTACHMENTS>, RENDER_PASS_MAX_SUBPASSES> ColorReferences = {};
+    std::array<std::array<VkAttachmentReference, PSO_MAX_COLOR_ATTACHMENTS>, RENDER_PASS_MAX_SUBPASSES> InputReferences = {};
+    std::array<VkSubpassDescription, RENDER_PASS_MAX_SUBPASSES> Subpasses = {};
+    for(uint32_t SubpassIndex = 0; SubpassIndex < SubpassCount; SubpassIndex++)
+    {
+        const FSubpassDesc& SubpassDesc = SubpassDescs[SubpassIndex];
+        for(uint32_t i = 0; i < SubpassDesc.ColorAttachmentCount; i++)
+        {
+            ColorReferences[SubpassIndex][i] = { SubpassDesc.ColorAttachments[i], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        }
+        for(uint32_t i = 0; i < SubpassDesc.InputAttachmentCount; i++)
+        {
+            const bool bDepthInput = SubpassDesc.InputAttachments[i] == RENDER_PASS_DEPTH_ATTACHMENT;
+            InputReferences[SubpassIndex][i].attachment = bDepthInput ? Desc.ColorAttachmentCount : SubpassDesc.InputAttachments[i];
+            InputReferences[SubpassIndex][i].layout = bDepthInput ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+
+        VkSubpassDescription& Subpass = Subpasses[SubpassIndex];
+        Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        Subpass.colorAttachmentCount = SubpassDesc.ColorAttachmentCount;
+        Subpass.pColorAttachments = ColorReferences[SubpassIndex].data();
+        Subpass.inputAttachmentCount = SubpassDesc.InputAttachmentCount;
+        Subpass.pInputAttachments = InputReferences[SubpassIndex].data();
+        Subpass.pDepthStencilAttachment = SubpassDesc.bDepth ? &DepthReference : nullptr;
+    }
+
+    // Use subpass dependencies for attachment layout transitions, in and out of the pass
+    std::array<VkSubpassDependency, RENDER_PASS_MAX_SUBPASSES + 1> Dependencies;
+    Dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    Dependencies[0].dstSubpass = 0;
+    // Depth attachments are shared by the frames in flight, the previous frame's depth writes must land before this one's
+    Dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    Dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+        | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    Dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    Dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+        | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    Dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // Each subpass reads what the previous ones wrote at the same pixel, by region keeps it all on tile
+    for(uint32_t SubpassIndex = 1; SubpassIndex < SubpassCount; SubpassIndex++)
+    {
+        VkSubpassDependency& Dependency = Dependencies[SubpassIndex];
+        Dependency.srcSubpass = SubpassIndex - 1;
+        Dependency.dstSubpass = SubpassIndex;
+        Dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        Dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        Dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependency.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    }
+
+    VkSubpassDependency& OutDependency = Dependencies[SubpassCount];
+    OutDependency.srcSubpass = SubpassCount - 1;
+    OutDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    OutDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    OutDependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    OutDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    OutDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    OutDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    VkRenderPassCreateInfo RenderPassInfo = {};
+    RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    RenderPassInfo.attachmentCount = AttachmentCount;
+    RenderPassInfo.pAttachments = Attachments.data();
+    RenderPassInfo.subpassCount = SubpassCount;
+    RenderPassInfo.pSubpasses = Subpasses.data();
+    RenderPassInfo.dependencyCount = SubpassCount + 1;
+    RenderPassInfo.pDependencies = Dependencies.data();
+
+    VkRenderPass RenderPass = VK_NULL_HANDLE;
+    if(vkCreateRenderPass(Device, &RenderPassInfo, nullptr, &RenderPass) != VK_SUCCESS)
+    {
+        checkf(0, "FRenderPassCache: unable to create render pass");
+    }
+    return RenderPass;
+}
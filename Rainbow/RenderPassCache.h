@@ -0,0 +1,99 @@
+#pragma once
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+#include "PipelineStateCache.h"
+
+struct FAttachmentDesc
+{
+    VkFormat Format;
+    VkSampleCountFlagBits Samples;
+    VkAttachmentLoadOp LoadOp;
+    VkAttachmentStoreOp StoreOp;
+    VkAttachmentLoadOp StencilLoadOp;
+    VkAttachmentStoreOp StencilStoreOp;
+    VkImageLayout InitialLayout;
+    VkImageLayout FinalLayout;
+
+    FAttachmentDesc();
+    FAttachmentDesc(VkFormat InFormat, VkAttachmentLoadOp InLoadOp, VkAttachmentStoreOp InStoreOp, VkImageLayout InFinalLayout);
+};
+
+#define RENDER_PASS_MAX_SUBPASSES 4
+// Input attachment index referring to the depth attachment, whatever the number of color attachments
+#define RENDER_PASS_DEPTH_ATTACHMENT 0xFF
+
+// Attachments one subpass uses, color indices point into FRenderPassDesc::ColorAttachments
+struct FSubpassDesc
+{
+    uint32_t ColorAttachmentCount;
+    uint8_t ColorAttachments[PSO_MAX_COLOR_ATTACHMENTS];
+    // Read through subpassInput, input_attachment_index i is InputAttachments[i]
+    uint32_t InputAttachmentCount;
+    uint8_t InputAttachments[PSO_MAX_COLOR_ATTACHMENTS];
+    bool bDepth;
+
+    FSubpassDesc();
+};
+
+// Compact description of a render pass, depth is optional (Format left undefined).
+// Without subpasses it has a single one using every attachment, otherwise attachments written by a subpass can be read
+// by the next ones as input attachments, without leaving tile memory.
+// InitialLayout/FinalLayout are the layouts of the first and last subpass using the attachment.
+struct FRenderPassDesc
+{
+    uint32_t ColorAttachmentCount;
+    FAttachmentDesc ColorAttachments[PSO_MAX_COLOR_ATTACHMENTS];
+    FAttachmentDesc DepthAttachment;
+    uint32_t SubpassCount;
+    FSubpassDesc Subpasses[RENDER_PASS_MAX_SUBPASSES];
+
+    FRenderPassDesc();
+    bool HasDepth() const { return DepthAttachment.Format != VK_FORMAT_UNDEFINED; }
+    uint32_t GetAttachmentCount() const { return ColorAttachmentCount + (HasDepth() ? 1 : 0); }
+    uint64_t GetHash() const;
+};
+
+// Views bound to a render pass, in the same order as FRenderPassDesc
+struct FFramebufferDesc
+{
+    VkImageView ColorViews[PSO_MAX_COLOR_ATTACHMENTS];
+    VkImageView DepthView;
+    uint32_t Width, Height;
+
+    FFramebufferDesc();
+};
+
+// Render passes and framebuffers created on first use and reused afterwards, so passes can be declared every frame.
+// Render passes live until shutdown, framebuffers are evicted as soon as one of their views is released.
+class FRenderPassCache
+{
+public:
+    FRenderPassCache();
+
+    void Init(VkDevice InDevice);
+    void Shutdown();
+
+    VkRenderPass GetRenderPass(const FRenderPassDesc& Desc);
+    VkFramebuffer GetFramebuffer(const FRenderPassDesc& Desc, const FFramebufferDesc& Targets);
+
+    // Call before destroying an image view, every framebuffer referencing it is destroyed.
+    // Like the view itself the caller must make sure the GPU no longer uses them.
+    void ReleaseImageView(VkImageView ImageView);
+
+    uint32_t GetNumRenderPasses() const;
+    uint32_t GetNumFramebuffers() const;
+
+private:
+    VkRenderPass CreateRenderPass(const FRenderPassDesc& Desc) const;
+
+private:
+    VkDevice Device;
+    std::unordered_map<uint64_t, VkRenderPass> RenderPasses;
+    std::unordered_map<uint64_t, VkFramebuffer> Framebuffers;
+    // Reverse lookup for eviction, a view usually belongs to a handful of framebuffers
+    std::unordered_map<VkImageView, std::vector<uint64_t>> ViewToFramebuffers;
+    mutable std::mutex Mutex;
+};
@@ -2,6 +2,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <vulkan/vulkan_core.h>
+#include "BindlessHeap.h"
 
 struct FStaticVertex
 {
@@ -31,6 +32,15 @@ public:
     VkDeviceMemory IndexMemory;
     int IndexBufferSize;
 
+    // Slots in the global storage buffer array, used for vertex pulling
+    uint32_t VertexBindlessIndex;
+    uint32_t IndexBindlessIndex;
+
+    // Bounding sphere of the vertices in mesh space, what GPU culling tests, and the half size of their box around the same center
+    glm::vec3 BoundsCenter;
+    float BoundsRadius;
+    glm::vec3 BoundsExtent;
+
     FVertexBuffer()
     {
         VertexBuffer = nullptr;
@@ -40,6 +50,13 @@ public:
         IndexBuffer = nullptr;
         IndexMemory = nullptr;
         IndexBufferSize = 0;
+
+        VertexBindlessIndex = BINDLESS_INVALID_INDEX;
+        IndexBindlessIndex = BINDLESS_INVALID_INDEX;
+
+        BoundsCenter = glm::vec3(0);
+        BoundsRadius = 0.0f;
+        BoundsExtent = glm::vec3(0);
     }
 };
 
@@ -54,6 +71,8 @@ public:
     uint32_t MipMaps;
     VkSampler Sampler;
     VkImageLayout ImageLayout;
+    // Stable slot in the global sampled image array, assigned at creation
+    uint32_t BindlessIndex;
     
     FTexture()
     {
@@ -66,6 +85,7 @@ public:
         MipMaps = 0;
         Sampler = nullptr;
         ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        BindlessIndex = BINDLESS_INVALID_INDEX;
     }
 };
 
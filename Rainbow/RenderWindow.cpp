@@ -22,7 +22,7 @@ void FRenderWindow::init()
         checkf(0, "Could not initialize SDL");
     }
     pWindow= SDL_CreateWindow(WindowsName.c_str(), SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED, Width, Height, SDL_WINDOW_VULKAN);
+        SDL_WINDOWPOS_CENTERED, Width, Height, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
     if(pWindow == nullptr)
     {
         checkf(0, "Could not create SDL window.");
@@ -9,7 +9,19 @@
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_log.h>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 #include "CommandList.h"
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include "MeshActor.h"
+#include "Paths.h"
 #include "RenderWindow.h"
 #include "World.h"
 
@@ -18,89 +30,479 @@ FCommandList FRenderer::CmdList;
 FRenderer::FRenderer()
 {
     bInitialized = false;
+    bGraphicsPipelineLibrary = false;
+    bGraphicsPipelineLibraryFastLinking = false;
+    bPipelineStatisticsQuery = false;
+    bGpuDrivenDraws = false;
+    bOcclusionCulling = false;
+    bInstancing = false;
+    bInstancingOverflowLogged = false;
+    ActorBoundsRevision = 0;
+    bActorBoundsBuilt = false;
     pRenderWindow = nullptr;
     World = nullptr;
+    DefaultSampler = VK_NULL_HANDLE;
+    DefaultSamplerIndex = BINDLESS_INVALID_INDEX;
+    CurrentFrame = 0;
+    FrameNumber = 0;
+    debugCallback = VK_NULL_HANDLE;
+    SurfaceKHR = VK_NULL_HANDLE;
+    SwapChain = VK_NULL_HANDLE;
+    bSwapChainDirty = false;
+    compute_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    transfer_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    computeTimestampValidBits = 0;
+    ComputeQueue = VK_NULL_HANDLE;
+    TransferQueue = VK_NULL_HANDLE;
+    TransferCommandPool = VK_NULL_HANDLE;
+    GpuLatencyMs = 0.0;
+    FrameStatsModeName[0] = '\0';
+    PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    bRenderGraphDumped = false;
+    bTraceCapturing = false;
+    LightGrid = FLightGridConstants();
+    Shadows.BufferIndex = BINDLESS_INVALID_INDEX;
+    Shadows.Offset = 0;
 }
 
-void FRenderer::Init(FRenderWindow* RenderWindow)
+void FRenderer::Init(FRenderWindow* RenderWindow, const FRendererSettings& InSettings)
 {
+    const auto InitStart = std::chrono::steady_clock::now();
+    ZONE_THREAD_NAME("Render thread");
+    SCOPED_ZONE("Renderer::Init");
     pRenderWindow = RenderWindow;
+    Settings = InSettings;
+    FCpuProfiler::Get().SetReportInterval(Settings.FrameStatsInterval);
+    FJobSystem::Get().Init();
     CreateInstance();
     CreateDebug();
-    CreateSurface();
+    if(!IsHeadless())
+    {
+        CreateSurface();
+    }
     LOG_Info("Initializing vulkan instance");
     SelectPhysicalDevice();
     SelectQueueFamily();
     CreateDevice();
-    CreateSwapChain();
+    if(IsHeadless())
+    {
+        CreateOffscreenTargets();
+    }
+    else
+    {
+        CreateSwapChain();
+    }
     SetupDepthStencil();
     CreateRenderPass();
     CreateFrameBuffers();
     CreateCommandPool();
-    CreateCommandBuffers();
-    CreateSemaphores();
-    CreateFences();
+    CreateFrameResources();
 
     CmdList = FCommandList(this);
+    CreateBindlessHeap();
+    CreatePipelineCache();
+
+    const auto PipelinesStart = std::chrono::steady_clock::now();
     CreateGBuffer();
+    LightCulling.Init(Device, PhysicalDevice, &BindlessHeap, PipelineStateCache, GBuffer.pipelineLayout, Settings.FramesInFlight,
+        graphics_QueueFamilyIndex, compute_QueueFamilyIndex);
+    if(bGpuDrivenDraws)
+    {
+        GpuScene.Init(Device, PhysicalDevice, &BindlessHeap, PipelineStateCache, GBuffer.pipelineLayout, Settings.FramesInFlight);
+    }
+    if(bOcclusionCulling)
+    {
+        DepthPyramid.Init(Device, PhysicalDevice, &BindlessHeap, PipelineStateCache, GBuffer.pipelineLayout);
+    }
+    if(Settings.bShadows)
+    {
+        ShadowCascades.Init(Device, PhysicalDevice, &BindlessHeap, PipelineStateCache, RenderPassCache, GBuffer.pipelineLayout, Settings);
+    }
+    const auto InitEnd = std::chrono::steady_clock::now();
 
-    LOG_Info("Initializing vulkan completed");
+    const double PipelinesMs = std::chrono::duration<double, std::milli>(InitEnd - PipelinesStart).count();
+    const double InitMs = std::chrono::duration<double, std::milli>(InitEnd - InitStart).count();
+    LOG_Info("Initializing vulkan completed, %s start: pipelines %.2f ms, total %.2f ms", PipelineCache.IsWarm() ? "warm" : "cold", PipelinesMs, InitMs);
 
     World = new FWorld();
-    World->LoadWorld();
+    if(Settings.Scene.Type != EBenchmarkScene::None)
+    {
+        FBenchmarkScene::Populate(*World, Settings.Scene);
+    }
+    else
+    {
+        World->LoadWorld();
+    }
     bInitialized = true;
+
+    // Zones recorded so far are still in the thread buffers, the first frame drains them into the capture
+    if(Settings.bTraceOnStart)
+    {
+        StartTrace();
+    }
 }
 
-VkPipelineStageFlags PipelineStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
 void FRenderer::RenderLoop()
 {
-    bool stillRunning = true;
-    while(stillRunning) {
-
-        SDL_Event event;
-        while(SDL_PollEvent(&event)) {
+    while(RenderFrame())
+    {
+        if(Settings.MaxFrames > 0 && FrameNumber >= Settings.MaxFrames) break;
+    }
+}
 
-            switch(event.type) {
+bool FRenderer::RenderFrame()
+{
+    // Waiting on the frame's ticket before sampling input keeps the input as fresh as possible when the frame starts
+    BeginFrame();
 
-            case SDL_QUIT:
-                stillRunning = false;
-                break;
+    bool bQuit = false;
+    SampleInput(bQuit);
+    if(bQuit)
+    {
+        return false;
+    }
 
-            default:
-                // Do nothing.
-                break;
-            }
+    // Nothing was submitted when a frame is skipped, its ticket stays the completed one and the next BeginFrame goes straight through
+    if(bSwapChainDirty && !RecreateSwapChain())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return true;
+    }
+    {
+        SCOPED_ZONE("AcquireNextImage");
+        if(!GetCommandList().AcquireNextImage() && (!RecreateSwapChain() || !GetCommandList().AcquireNextImage()))
+        {
+            return true;
         }
-        
-        
-        GetCommandList().AcquireNextImage();
+    }
+
+    GetCommandList().BeginCommandBuffer();
+    GpuProfiler.BeginFrame(GetCommandList().GetCommandBuffer(), CurrentFrame);
+    {
+        SCOPED_ZONE("Record");
+        // Statistics are left to the passes, only one such query can be active
+        FScopedGpuMarker FrameMarker(GetCommandList(), "Frame", false);
 
-        GetCommandList().ResetCommandBuffer();
-        GetCommandList().BeginCommandBuffer();
         {
-            VkClearColorValue ClearColor = {0.2f, 1.f, 0.2f, 1.0f};
-            VkClearDepthStencilValue ClearDepthStencilValue = {1.0f, 0};
-            GetCommandList().BeginRenderPass(ClearColor, ClearDepthStencilValue);
-            {
-                World->Render();
-            }
-            GetCommandList().EndRenderPass();
+            SCOPED_ZONE("BuildRenderGraph");
+            BuildRenderGraph();
+        }
+        {
+            SCOPED_ZONE("CompileRenderGraph");
+            RenderGraph.Compile();
+        }
+        if(Settings.bDumpRenderGraph && !bRenderGraphDumped)
+        {
+            const std::string DumpPath = FPaths::GetSavedDirectory() + "/RenderGraph.dot";
+            bRenderGraphDumped = RenderGraph.DumpGraphviz(DumpPath);
+            LOG_Info("Render graph dumped to %s", DumpPath.c_str());
+        }
+        {
+            SCOPED_ZONE("ExecuteRenderGraph");
+            const FRenderGraphCommandBuffers GraphCommandBuffers = GetCommandList().BeginRenderGraphCommandBuffers(RenderGraph.UsesAsyncCompute());
+            RenderGraph.Execute(GraphCommandBuffers, &GpuProfiler);
+            // The frame marker and the readback copy end up in the last graphics batch
+            GetCommandList().EndRenderGraphCommandBuffers();
         }
-        GetCommandList().EndCommandBuffer();
+        if(IsHeadless())
+        {
+            CopyFrameToReadback();
+        }
+    }
+    GetCommandList().EndCommandBuffer();
 
+    {
+        SCOPED_ZONE("Submit");
         GetCommandList().QueueSubmit();
+    }
+    // Slots released and pipelines retired while building this frame may still be used by it and the frames before
+    BindlessHeap.SubmitReleases(Frames[CurrentFrame].Ticket);
+    PipelineStateCache.SubmitRetiredPipelines(Frames[CurrentFrame].Ticket);
+    {
+        SCOPED_ZONE("Present");
         GetCommandList().QueuePresent();
     }
+    EndFrame();
+    return true;
+}
+
+void FRenderer::BeginFrame()
+{
+    SCOPED_ZONE("BeginFrame");
+    // Blocks only when the CPU is a full FramesInFlight ahead of the GPU
+    FFrameResources& Frame = Frames[CurrentFrame];
+    const auto WaitStart = std::chrono::steady_clock::now();
+    {
+        SCOPED_ZONE("WaitForFrameTicket");
+        GpuTimeline.Wait(Frame.Ticket);
+    }
+    const auto WaitEnd = std::chrono::steady_clock::now();
+    ReleaseRetiredSwapChains(false);
+    BindlessHeap.RecycleReleases(GpuTimeline);
+    PipelineStateCache.DestroyRetiredPipelines(GpuTimeline);
+    // Polled, uploads still in flight are left for a later frame
+    GetCommandList().ReleaseCompletedUploads();
+
+    // The copy recorded FramesInFlight frames ago is done, writing it now never stalls the GPU
+    if(Frame.ReadbackFrameNumber >= 0)
+    {
+        WriteFrameDump(Frame);
+    }
+
+    FrameTiming = FFrameTiming();
+    FrameCounters = FFrameCounters();
+    FrameTiming.FenceWaitMs = std::chrono::duration<double, std::milli>(WaitEnd - WaitStart).count();
+    if(Frame.InputTime != std::chrono::steady_clock::time_point())
+    {
+        // Latency of the previous frame that used these resources, its ticket just completed
+        GpuLatencyMs = std::chrono::duration<double, std::milli>(WaitEnd - Frame.InputTime).count();
+    }
+
+    vkResetCommandPool(Device, Frame.CommandPool, 0);
+    if(Frame.ComputeCommandPool != VK_NULL_HANDLE)
+    {
+        vkResetCommandPool(Device, Frame.ComputeCommandPool, 0);
+    }
+    CommandRecorder.BeginFrame(CurrentFrame);
+    Frame.TransientBuffer.Reset();
+
+    LimitFrameRate();
+}
+
+void FRenderer::SampleInput(bool& bOutQuit)
+{
+    SCOPED_ZONE("SampleInput");
+    Frames[CurrentFrame].InputTime = std::chrono::steady_clock::now();
+
+    // No window to poll, headless runs end after Settings.MaxFrames
+    if(IsHeadless()) return;
+
+    SDL_Event event;
+    while(SDL_PollEvent(&event)) {
+
+        switch(event.type) {
+
+        case SDL_QUIT:
+            bOutQuit = true;
+            break;
+
+        case SDL_WINDOWEVENT:
+            if(event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+            {
+                bSwapChainDirty = true;
+            }
+            break;
+
+        case SDL_KEYDOWN:
+            if(event.key.keysym.sym == SDLK_F12 && !event.key.repeat)
+            {
+                StartTrace();
+            }
+            break;
+
+        default:
+            // Do nothing.
+            break;
+        }
+    }
+
+    if(Settings.ResizeStormInterval > 0 && FrameNumber > 0 && FrameNumber % Settings.ResizeStormInterval == 0)
+    {
+        const bool bLarge = (FrameNumber / Settings.ResizeStormInterval) % 2 == 0;
+        SDL_SetWindowSize(pRenderWindow->GetWindow(), bLarge ? 1920 : 1280, bLarge ? 1080 : 720);
+        bSwapChainDirty = true;
+    }
+}
+
+void FRenderer::LimitFrameRate()
+{
+    if(Settings.MaxFrameRate <= 0.0f || LastFrameStart == std::chrono::steady_clock::time_point()) return;
+
+    // Sleep most of the remaining time, the scheduler is too coarse for the last millisecond so spin that part
+    const auto Target = LastFrameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / Settings.MaxFrameRate));
+    const auto SleepUntil = Target - std::chrono::milliseconds(1);
+    if(std::chrono::steady_clock::now() < SleepUntil)
+    {
+        std::this_thread::sleep_until(SleepUntil);
+    }
+    while(std::chrono::steady_clock::now() < Target)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void FRenderer::EndFrame()
+{
+    const auto Now = std::chrono::steady_clock::now();
+    FrameTiming.InputToPresentMs = std::chrono::duration<double, std::milli>(Now - Frames[CurrentFrame].InputTime).count();
+    FrameTiming.InputToGpuDoneMs = GpuLatencyMs;
+    if(LastFrameStart != std::chrono::steady_clock::time_point())
+    {
+        FrameTiming.FrameMs = std::chrono::duration<double, std::milli>(Now - LastFrameStart).count();
+        FrameStats.AddFrame(FrameTiming);
+    }
+    LastFrameStart = Now;
+    FrameCounters.TransientBytes = Frames[CurrentFrame].TransientBuffer.GetUsedSize();
+    FrameCounters.TransientTextureBytes = RenderGraph.GetTransientAllocatedSize();
+    FrameCounters.LazyCommittedBytes = RenderGraph.GetLazyCommittedSize();
+    FrameCounters.AsyncComputePasses = RenderGraph.GetNumAsyncPasses();
+    CurrentFrame = (CurrentFrame + 1) % Settings.FramesInFlight;
+    FrameNumber++;
+
+    FCpuProfiler::Get().EndFrame();
+    WriteTraceIfComplete();
+}
+
+void FRenderer::StartTrace()
+{
+    if(bTraceCapturing) return;
+
+    FCpuProfiler::Get().StartCapture(Settings.TraceFrames);
+    GpuProfiler.StartCapture(Settings.TraceFrames);
+    bTraceCapturing = true;
+    LOG_Info("Capturing a trace of %u frames", Settings.TraceFrames);
+}
+
+void FRenderer::WriteTraceIfComplete()
+{
+    // GPU results come back FramesInFlight frames after the CPU's
+    if(!bTraceCapturing || !FCpuProfiler::Get().IsCaptureComplete()) return;
+    if(GpuProfiler.IsEnabled() && !GpuProfiler.IsCaptureComplete()) return;
+
+    std::vector<FTraceEvent> traceEvents;
+    std::vector<FTraceThread> traceThreads;
+    FCpuProfiler::Get().TakeCapturedEvents(traceEvents, traceThreads);
+    GpuProfiler.TakeCapturedEvents(traceEvents);
+    bTraceCapturing = false;
+
+    const std::string TracePath = FPaths::GetSavedDirectory() + "/Trace.json";
+    if(FChromeTrace::Write(TracePath, traceEvents, traceThreads))
+    {
+        LOG_Info("Trace of %u events written to %s", static_cast<uint32_t>(traceEvents.size()), TracePath.c_str());
+    }
+}
+
+void FRenderer::CopyFrameToReadback()
+{
+    FFrameResources& Frame = Frames[CurrentFrame];
+    if(Frame.ReadbackBuffer == VK_NULL_HANDLE || FrameNumber % Settings.DumpFrameInterval != 0) return;
+
+    // The graph leaves the target in TRANSFER_SRC_OPTIMAL when headless
+    const VkCommandBuffer CommandBuffer = GetCommandList().GetCommandBuffer();
+    const FTexture& backBuffer = SwapChainTextures[GetCommandList().GetSwapChainImageIndex()];
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { backBuffer.SizeX, backBuffer.SizeY, 1 };
+    vkCmdCopyImageToBuffer(CommandBuffer, backBuffer.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Frame.ReadbackBuffer, 1, &region);
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = Frame.ReadbackBuffer;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    Frame.ReadbackFrameNumber = static_cast<int64_t>(FrameNumber);
+}
+
+void FRenderer::WriteFrameDump(FFrameResources& Frame)
+{
+    SCOPED_ZONE("WriteFrameDump");
+    const std::string directory = FPaths::GetSavedDirectory() + "/Frames";
+    std::error_code errorCode;
+    std::filesystem::create_directories(directory, errorCode);
+
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "/Frame_%05lld.ppm", static_cast<long long>(Frame.ReadbackFrameNumber));
+    const std::string filePath = directory + fileName;
+    Frame.ReadbackFrameNumber = -1;
+
+    // Binary PPM, no dependency and every image tool opens it. Targets are BGRA, PPM wants RGB
+    std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+    stream << "P6\n" << ViewportSize.width << " " << ViewportSize.height << "\n255\n";
+    std::vector<uint8_t> row(ViewportSize.width * 3);
+    const uint8_t* pixels = static_cast<const uint8_t*>(Frame.ReadbackData);
+    for(uint32_t y = 0; y < ViewportSize.height; y++)
+    {
+        for(uint32_t x = 0; x < ViewportSize.width; x++)
+        {
+            const uint8_t* texel = pixels + (static_cast<size_t>(y) * ViewportSize.width + x) * 4;
+            row[x * 3 + 0] = texel[2];
+            row[x * 3 + 1] = texel[1];
+            row[x * 3 + 2] = texel[0];
+        }
+        stream.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if(!stream)
+    {
+        LOG_Warning("Unable to write frame dump %s", filePath.c_str());
+    }
 }
 
 void FRenderer::Shutdown()
 {
     if(!bInitialized) return;
-    
-    vkDestroySurfaceKHR(Instance, SurfaceKHR, nullptr);
+
+    // Timelines don't cover presents, which may still read the swapchain images
+    vkDeviceWaitIdle(Device);
+    GetCommandList().ReleaseCompletedUploads();
+    for(FFrameResources& Frame : Frames)
+    {
+        if(Frame.ReadbackFrameNumber >= 0)
+        {
+            WriteFrameDump(Frame);
+        }
+    }
+    DestroyFrameResources();
+    if(IsHeadless())
+    {
+        DestroyOffscreenTargets();
+    }
+    else
+    {
+        RetireSwapChain();
+    }
+    ReleaseRetiredSwapChains(true);
+    if(TransferCommandPool != VK_NULL_HANDLE)
+    {
+        vkDestroyCommandPool(Device, TransferCommandPool, nullptr);
+    }
+    GpuTimeline.Shutdown();
+    ShadowCascades.Shutdown();
+    DepthPyramid.Shutdown();
+    GpuScene.Shutdown();
+    LightCulling.Shutdown();
+    RenderGraph.Shutdown();
+    PipelineStateCache.Shutdown();
+    RenderPassCache.Shutdown();
+    FJobSystem::Get().Shutdown();
+    PipelineCache.Shutdown();
+    ShaderCache.Shutdown();
+    vkDestroySampler(Device, DefaultSampler, nullptr);
+    if(GBuffer.descriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(Device, GBuffer.descriptorPool, nullptr);
+    }
+    BindlessHeap.Shutdown();
+
+    if(SurfaceKHR != VK_NULL_HANDLE)
+    {
+        vkDestroySurfaceKHR(Instance, SurfaceKHR, nullptr);
+    }
     vkDestroyInstance(Instance, nullptr);
 }
 
+void FRenderer::DestroyImageView(VkImageView ImageView)
+{
+    RenderPassCache.ReleaseImageView(ImageView);
+    vkDestroyImageView(Device, ImageView, nullptr);
+}
+
 VkImageView FRenderer::CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags)
 {
     VkImageViewCreateInfo viewInfo = {};
@@ -220,24 +622,39 @@ VkSwapchainKHR& FRenderer::GetSwapChain()
     return SwapChain;
 }
 
-VkSemaphore& FRenderer::GetImageAvailableSemaphore()
+FFrameResources& FRenderer::GetCurrentFrame()
+{
+    return Frames[CurrentFrame];
+}
+
+uint32_t FRenderer::GetCurrentFrameIndex() const
 {
-    return ImageAvailableSemaphore;
+    return CurrentFrame;
 }
 
-VkSemaphore& FRenderer::GetRenderingFinishedSemaphore()
+VkSemaphore& FRenderer::GetRenderingFinishedSemaphore(uint32_t ImageIndex)
 {
-    return RenderingFinishedSemaphore;
+    return RenderingFinishedSemaphores[ImageIndex];
 }
 
-std::vector<VkFence>& FRenderer::GetFences()
+const FRendererSettings& FRenderer::GetSettings() const
 {
-    return Fences;
+    return Settings;
 }
 
-std::vector<VkCommandBuffer>& FRenderer::GetCommandBuffers()
+const FGBuffer& FRenderer::GetGBuffer() const
 {
-    return CommandBuffers;
+    return GBuffer;
+}
+
+void FRenderer::InvalidateSwapChain()
+{
+    bSwapChainDirty = !IsHeadless();
+}
+
+bool FRenderer::IsHeadless() const
+{
+    return Settings.bHeadless;
 }
 
 std::vector<VkImage>& FRenderer::GetSwapChainImages()
@@ -275,6 +692,121 @@ VkQueue& FRenderer::GetPresentQueue()
     return PresentQueue;
 }
 
+uint32_t FRenderer::GetGraphicsQueueFamily() const
+{
+    return graphics_QueueFamilyIndex;
+}
+
+bool FRenderer::HasAsyncCompute() const
+{
+    return compute_QueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED;
+}
+
+VkQueue& FRenderer::GetComputeQueue()
+{
+    return ComputeQueue;
+}
+
+bool FRenderer::HasTransferQueue() const
+{
+    return transfer_QueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED;
+}
+
+bool FRenderer::HasGpuDrivenDraws() const
+{
+    return bGpuDrivenDraws;
+}
+
+bool FRenderer::HasOcclusionCulling() const
+{
+    return bOcclusionCulling;
+}
+
+bool FRenderer::HasInstancing() const
+{
+    return bInstancing;
+}
+
+VkQueue& FRenderer::GetTransferQueue()
+{
+    return TransferQueue;
+}
+
+uint32_t FRenderer::GetTransferQueueFamily() const
+{
+    return transfer_QueueFamilyIndex;
+}
+
+VkCommandPool& FRenderer::GetTransferCommandPool()
+{
+    return TransferCommandPool;
+}
+
+FGpuTimeline& FRenderer::GetGpuTimeline()
+{
+    return GpuTimeline;
+}
+
+FBindlessHeap& FRenderer::GetBindlessHeap()
+{
+    return BindlessHeap;
+}
+
+VkSampler FRenderer::GetDefaultSampler() const
+{
+    return DefaultSampler;
+}
+
+FShaderCache& FRenderer::GetShaderCache()
+{
+    return ShaderCache;
+}
+
+FPipelineCache& FRenderer::GetPipelineCache()
+{
+    return PipelineCache;
+}
+
+FGpuProfiler& FRenderer::GetGpuProfiler()
+{
+    return GpuProfiler;
+}
+
+void FRenderer::SetRecordThreads(uint32_t Threads)
+{
+    CommandRecorder.SetSliceLimit(Threads);
+}
+
+uint32_t FRenderer::GetRecordThreads() const
+{
+    return CommandRecorder.GetSliceLimit();
+}
+
+uint32_t FRenderer::GetMaxRecordThreads() const
+{
+    return CommandRecorder.GetMaxSlices();
+}
+
+const FFrameTiming& FRenderer::GetLastFrameTiming() const
+{
+    return FrameTiming;
+}
+
+const FFrameCounters& FRenderer::GetLastFrameCounters() const
+{
+    return FrameCounters;
+}
+
+FRenderPassCache& FRenderer::GetRenderPassCache()
+{
+    return RenderPassCache;
+}
+
+FPipelineStateCache& FRenderer::GetPipelineStateCache()
+{
+    return PipelineStateCache;
+}
+
 FCommandList& FRenderer::GetCommandList()
 {
     return CmdList;
@@ -282,23 +814,30 @@ FCommandList& FRenderer::GetCommandList()
 
 void FRenderer::CreateInstance()
 {
-    if(!pRenderWindow)
+    SCOPED_ZONE("CreateInstance");
+    // Headless needs no surface extension, which keeps it working on software drivers without a display
+    vector<const char *> extensionNames;
+    std::string applicationName = "Rainbow";
+    if(!IsHeadless())
     {
-        checkf(0, "Failed creating vulkan instance, no window pointer");   
+        if(!pRenderWindow)
+        {
+            checkf(0, "Failed creating vulkan instance, no window pointer");   
+        }
+        unsigned int extensionCount = 0;
+        SDL_Vulkan_GetInstanceExtensions(pRenderWindow->GetWindow(), &extensionCount, nullptr);
+        extensionNames.resize(extensionCount);
+        SDL_Vulkan_GetInstanceExtensions(pRenderWindow->GetWindow(), &extensionCount, extensionNames.data());
+        applicationName = pRenderWindow->GetWindowName();
     }
-    
-    unsigned int extensionCount = 0;
-    SDL_Vulkan_GetInstanceExtensions(pRenderWindow->GetWindow(), &extensionCount, nullptr);
-    vector<const char *> extensionNames(extensionCount);
-    SDL_Vulkan_GetInstanceExtensions(pRenderWindow->GetWindow(), &extensionCount, extensionNames.data());
 
     VkApplicationInfo appInfo = {};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = pRenderWindow->GetWindowName().c_str();
+    appInfo.pApplicationName = applicationName.c_str();
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "MyEngine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo instanceCreateInfo = {};
     instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -328,16 +867,19 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
     return VK_FALSE;
 }
 
-PFN_vkCreateDebugReportCallbackEXT SDL2_vkCreateDebugReportCallbackEXT = nullptr;
 void FRenderer::CreateDebug()
 {
-    SDL2_vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)SDL_Vulkan_GetVkGetInstanceProcAddr();
+    // Only there when the debug report extension is enabled on the instance
+    const PFN_vkCreateDebugReportCallbackEXT createDebugReportCallback =
+        reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(vkGetInstanceProcAddr(Instance, "vkCreateDebugReportCallbackEXT"));
+    if(!createDebugReportCallback) return;
+
     VkDebugReportCallbackCreateInfoEXT debugCallbackCreateInfo = {};
     debugCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
     debugCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
     debugCallbackCreateInfo.pfnCallback = VulkanReportFunc;
 
-    SDL2_vkCreateDebugReportCallbackEXT(Instance, &debugCallbackCreateInfo, 0, &debugCallback);
+    createDebugReportCallback(Instance, &debugCallbackCreateInfo, 0, &debugCallback);
 }
 
 void FRenderer::CreateSurface()
@@ -392,7 +934,15 @@ void FRenderer::SelectQueueFamily()
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(PhysicalDevice, i, SurfaceKHR, &presentSupport);
+        if(IsHeadless())
+        {
+            // Nothing is presented, the present queue is the graphics one
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(PhysicalDevice, i, SurfaceKHR, &presentSupport);
+        }
         if(queueFamily.queueCount > 0 && presentSupport)
         {
             presentIndex = i;
@@ -408,15 +958,52 @@ void FRenderer::SelectQueueFamily()
 
     graphics_QueueFamilyIndex = graphicIndex;
     present_QueueFamilyIndex = presentIndex;
+
+    // Families without graphics usually map to separate hardware queues, work there overlaps the graphics queue
+    compute_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    transfer_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    computeTimestampValidBits = 0;
+    for(uint32_t family = 0; family < queueFamilyCount; family++)
+    {
+        const VkQueueFamilyProperties& queueFamily = queueFamilyProperties[family];
+        if(queueFamily.queueCount == 0 || (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) continue;
+
+        if(Settings.bAsyncCompute && compute_QueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+        {
+            compute_QueueFamilyIndex = family;
+            computeTimestampValidBits = queueFamily.timestampValidBits;
+        }
+        if(Settings.bTransferQueue && transfer_QueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED
+            && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+        {
+            transfer_QueueFamilyIndex = family;
+        }
+    }
+
+    LOG_Info("Queue families: graphics %u, present %u, async compute %s, transfer %s", graphics_QueueFamilyIndex, present_QueueFamilyIndex,
+        HasAsyncCompute() ? std::to_string(compute_QueueFamilyIndex).c_str() : "none", HasTransferQueue() ? std::to_string(transfer_QueueFamilyIndex).c_str() : "none");
 }
 
 void FRenderer::CreateDevice()
 {
-    const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    SCOPED_ZONE("CreateDevice");
+    std::vector<const char*> deviceExtensions;
+    if(!IsHeadless())
+    {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     const float queue_priority[] = { 1.0f };
 
     vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { graphics_QueueFamilyIndex, present_QueueFamilyIndex };
+    if(HasAsyncCompute())
+    {
+        uniqueQueueFamilies.insert(compute_QueueFamilyIndex);
+    }
+    if(HasTransferQueue())
+    {
+        uniqueQueueFamilies.insert(transfer_QueueFamilyIndex);
+    }
 
     float queuePriority = queue_priority[0];
     for(int queueFamily : uniqueQueueFamilies)
@@ -429,21 +1016,116 @@ void FRenderer::CreateDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkDeviceQueueCreateInfo queueCreateInfo = {};
-    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.queueFamilyIndex = graphics_QueueFamilyIndex;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
-    
-    VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // Descriptor indexing is core in 1.2, query it first since the bindless heap can't work without it
+    VkPhysicalDeviceVulkan12Features supportedFeatures12 = {};
+    supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedFeatures = {};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supportedFeatures12;
+    vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supportedFeatures);
+
+    const bool bDescriptorIndexing = supportedFeatures12.descriptorIndexing
+        && supportedFeatures12.runtimeDescriptorArray
+        && supportedFeatures12.descriptorBindingPartiallyBound
+        && supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind
+        && supportedFeatures12.descriptorBindingStorageBufferUpdateAfterBind
+        && supportedFeatures12.descriptorBindingUpdateUnusedWhilePending
+        && supportedFeatures12.shaderSampledImageArrayNonUniformIndexing
+        && supportedFeatures12.shaderStorageBufferArrayNonUniformIndexing;
+    checkf(bDescriptorIndexing, "Failed creating device, descriptor indexing is not supported");
+    // Required by 1.2, every submission signals its queue's timeline
+    checkf(supportedFeatures12.timelineSemaphore, "Failed creating device, timeline semaphores are not supported");
+
+    // Graphics pipeline library is optional, without it the pipeline state cache builds monolithic pipelines
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &extensionCount, nullptr);
+    vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    auto hasExtension = [&availableExtensions](const char* name)
+    {
+        for(const VkExtensionProperties& extension : availableExtensions)
+        {
+            if(strcmp(extension.extensionName, name) == 0) return true;
+        }
+        return false;
+    };
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supportedPipelineLibrary = {};
+    supportedPipelineLibrary.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if(hasExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) && hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 libraryFeatures = {};
+        libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        libraryFeatures.pNext = &supportedPipelineLibrary;
+        vkGetPhysicalDeviceFeatures2(PhysicalDevice, &libraryFeatures);
+    }
+    bGraphicsPipelineLibrary = supportedPipelineLibrary.graphicsPipelineLibrary == VK_TRUE;
+    if(bGraphicsPipelineLibrary)
+    {
+        // Without it linking the libraries may cost as much as a monolithic build
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties = {};
+        pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 libraryProperties = {};
+        libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        libraryProperties.pNext = &pipelineLibraryProperties;
+        vkGetPhysicalDeviceProperties2(PhysicalDevice, &libraryProperties);
+        bGraphicsPipelineLibraryFastLinking = pipelineLibraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+    }
+
+    VkPhysicalDeviceVulkan12Features deviceFeatures12 = {};
+    deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    deviceFeatures12.descriptorIndexing = VK_TRUE;
+    deviceFeatures12.runtimeDescriptorArray = VK_TRUE;
+    deviceFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+    deviceFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    deviceFeatures12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    deviceFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    deviceFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    deviceFeatures12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    deviceFeatures12.timelineSemaphore = VK_TRUE;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if(bGraphicsPipelineLibrary)
+    {
+        pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+        deviceFeatures12.pNext = &pipelineLibraryFeatures;
+        deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+
+    VkPhysicalDeviceFeatures2 deviceFeatures = {};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = &deviceFeatures12;
+    deviceFeatures.features.samplerAnisotropy = supportedFeatures.features.samplerAnisotropy;
+
+    // Only asked for by the GPU profiler, timestamps need no feature
+    bPipelineStatisticsQuery = Settings.bGpuPipelineStatistics && supportedFeatures.features.pipelineStatisticsQuery == VK_TRUE;
+    if(Settings.bGpuPipelineStatistics && !bPipelineStatisticsQuery)
+    {
+        LOG_Warning("Pipeline statistics queries are not supported");
+    }
+    deviceFeatures.features.pipelineStatisticsQuery = bPipelineStatisticsQuery ? VK_TRUE : VK_FALSE;
+
+    // Every culled instance is its own indirect command, found by the vertex shader through firstInstance
+    const bool bIndirectCount = supportedFeatures12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect
+        && supportedFeatures.features.drawIndirectFirstInstance;
+    bGpuDrivenDraws = Settings.bGpuCulling && bIndirectCount;
+    if(Settings.bGpuCulling && !bIndirectCount)
+    {
+        LOG_Warning("Indirect draws with a count are not supported, falling back to CPU recorded draws");
+    }
+    bOcclusionCulling = bGpuDrivenDraws && Settings.bOcclusionCulling;
+    bInstancing = !bGpuDrivenDraws && Settings.bInstancing;
+    deviceFeatures12.drawIndirectCount = bGpuDrivenDraws ? VK_TRUE : VK_FALSE;
+    deviceFeatures.features.multiDrawIndirect = bGpuDrivenDraws ? VK_TRUE : VK_FALSE;
+    deviceFeatures.features.drawIndirectFirstInstance = bGpuDrivenDraws ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pQueueCreateInfos = &queueCreateInfo;
+    createInfo.pNext = &deviceFeatures;
     createInfo.queueCreateInfoCount = queueCreateInfos.size();
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.enabledExtensionCount = deviceExtensions.size();
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -454,10 +1136,20 @@ void FRenderer::CreateDevice()
 
     vkGetDeviceQueue(Device, graphics_QueueFamilyIndex, 0, &GraphicsQueue);
     vkGetDeviceQueue(Device, present_QueueFamilyIndex, 0, &PresentQueue);
+    if(HasAsyncCompute())
+    {
+        vkGetDeviceQueue(Device, compute_QueueFamilyIndex, 0, &ComputeQueue);
+    }
+    if(HasTransferQueue())
+    {
+        vkGetDeviceQueue(Device, transfer_QueueFamilyIndex, 0, &TransferQueue);
+    }
+    GpuTimeline.Init(Device, GraphicsQueue, ComputeQueue, TransferQueue);
 }
 
-void FRenderer::CreateSwapChain()
+void FRenderer::CreateSwapChain(VkSwapchainKHR OldSwapChain)
 {
+    SCOPED_ZONE("CreateSwapChain");
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(PhysicalDevice, SurfaceKHR, &SurfaceCapabilitiesKHR);
    
     vector<VkSurfaceFormatKHR> surfaceFormats;
@@ -483,6 +1175,25 @@ void FRenderer::CreateSwapChain()
     ViewportSize.width = width;
     ViewportSize.height = height;
 
+    uint32_t presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(PhysicalDevice, SurfaceKHR, &presentModeCount, nullptr);
+    vector<VkPresentModeKHR> presentModes(presentModeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(PhysicalDevice, SurfaceKHR, &presentModeCount, presentModes.data());
+
+    PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    if(std::find(presentModes.begin(), presentModes.end(), Settings.PresentMode) != presentModes.end())
+    {
+        PresentMode = Settings.PresentMode;
+    }
+    else
+    {
+        LOG_Warning("Present mode %s is not supported, using fifo", FRendererSettings::GetPresentModeName(Settings.PresentMode));
+    }
+    if(OldSwapChain == VK_NULL_HANDLE)
+    {
+        LOG_Info("Present mode: %s", FRendererSettings::GetPresentModeName(PresentMode));
+    }
+
     uint32_t imageCount = SurfaceCapabilitiesKHR.minImageCount + 1;
     if (SurfaceCapabilitiesKHR.maxImageCount > 0 && imageCount > SurfaceCapabilitiesKHR.maxImageCount)
     {
@@ -492,7 +1203,7 @@ void FRenderer::CreateSwapChain()
     VkSwapchainCreateInfoKHR createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface = SurfaceKHR;
-    createInfo.minImageCount = SurfaceCapabilitiesKHR.minImageCount;
+    createInfo.minImageCount = imageCount;
     createInfo.imageFormat = SurfaceFormatKHR.format;
     createInfo.imageColorSpace = SurfaceFormatKHR.colorSpace;
     createInfo.imageExtent = ViewportSize;
@@ -513,8 +1224,10 @@ void FRenderer::CreateSwapChain()
 
     createInfo.preTransform = SurfaceCapabilitiesKHR.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    createInfo.presentMode = PresentMode;
     createInfo.clipped = VK_TRUE;
+    // Images of the old swapchain already queued for present are still shown while the new one takes over
+    createInfo.oldSwapchain = OldSwapChain;
 
     vkCreateSwapchainKHR(Device, &createInfo, nullptr, &SwapChain);
 
@@ -528,6 +1241,149 @@ void FRenderer::CreateSwapChain()
     {
         SwapChainImagesViews[i] = CreateImageView(SwapChainImages[i], SurfaceFormatKHR.format, VK_IMAGE_ASPECT_COLOR_BIT);
     }
+
+    SwapChainTextures.resize(SwapChainImages.size());
+    for(uint32_t i = 0; i < SwapChainImages.size(); i++)
+    {
+        FTexture& texture = SwapChainTextures[i];
+        texture.Image = SwapChainImages[i];
+        texture.ImageView = SwapChainImagesViews[i];
+        texture.Format = SurfaceFormatKHR.format;
+        texture.SizeX = ViewportSize.width;
+        texture.SizeY = ViewportSize.height;
+        texture.MipMaps = 1;
+        texture.ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+}
+
+bool FRenderer::RecreateSwapChain()
+{
+    SCOPED_ZONE("RecreateSwapChain");
+    // A minimized window has a zero extent, there is nothing to create until it is restored
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(PhysicalDevice, SurfaceKHR, &SurfaceCapabilitiesKHR);
+    int width = 0;
+    int height = 0;
+    SDL_Vulkan_GetDrawableSize(pRenderWindow->GetWindow(), &width, &height);
+    if(width == 0 || height == 0 || SurfaceCapabilitiesKHR.maxImageExtent.width == 0 || SurfaceCapabilitiesKHR.maxImageExtent.height == 0)
+    {
+        return false;
+    }
+
+    const auto RecreateStart = std::chrono::steady_clock::now();
+    RetireSwapChain();
+    CreateSwapChain(RetiredSwapChains.back().SwapChain);
+    SetupDepthStencil();
+    CreateFrameBuffers();
+
+    // The old ones were retired with their swapchain, nothing tells when its last presents stopped waiting on them
+    RenderingFinishedSemaphores.resize(SwapChainImageCount);
+    for(VkSemaphore& semaphore : RenderingFinishedSemaphores)
+    {
+        CreateSemaphore(&semaphore);
+    }
+
+    // Pipelines use dynamic viewports, and the graph recreates each frame's transient GBuffer targets as it reuses them
+    GBuffer.Width = ViewportSize.width;
+    GBuffer.Height = ViewportSize.height;
+    bSwapChainDirty = false;
+
+    FrameTiming.SwapChainRecreateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RecreateStart).count();
+    return true;
+}
+
+void FRenderer::RetireSwapChain()
+{
+    FRetiredSwapChain retired;
+    retired.SwapChain = SwapChain;
+    retired.ImageViews.swap(SwapChainImagesViews);
+    retired.DepthImage = DepthImage;
+    retired.DepthImageMemory = DepthImageMemory;
+    retired.DepthImageView = DepthImageView;
+    retired.RenderingFinishedSemaphores.swap(RenderingFinishedSemaphores);
+    // Frames up to the previous one may still be rendering into or presenting these
+    retired.FirstUnusedFrame = FrameNumber;
+    RetiredSwapChains.push_back(std::move(retired));
+
+    SwapChain = VK_NULL_HANDLE;
+    DepthImage = VK_NULL_HANDLE;
+    DepthImageMemory = VK_NULL_HANDLE;
+    DepthImageView = VK_NULL_HANDLE;
+}
+
+void FRenderer::ReleaseRetiredSwapChains(bool bAll)
+{
+    while(!RetiredSwapChains.empty())
+    {
+        FRetiredSwapChain& retired = RetiredSwapChains.front();
+        // Called right after frame FrameNumber - FramesInFlight's ticket was waited on
+        if(!bAll && retired.FirstUnusedFrame + Settings.FramesInFlight > FrameNumber + 1) break;
+
+        // Views go through DestroyImageView so cached framebuffers using them are evicted too
+        for(VkImageView view : retired.ImageViews)
+        {
+            DestroyImageView(view);
+        }
+        if(retired.DepthImageView != VK_NULL_HANDLE)
+        {
+            DestroyImageView(retired.DepthImageView);
+            vkDestroyImage(Device, retired.DepthImage, nullptr);
+            vkFreeMemory(Device, retired.DepthImageMemory, nullptr);
+        }
+        if(retired.SwapChain != VK_NULL_HANDLE)
+        {
+            vkDestroySwapchainKHR(Device, retired.SwapChain, nullptr);
+        }
+        for(VkSemaphore semaphore : retired.RenderingFinishedSemaphores)
+        {
+            vkDestroySemaphore(Device, semaphore, nullptr);
+        }
+        RetiredSwapChains.erase(RetiredSwapChains.begin());
+    }
+}
+
+void FRenderer::CreateOffscreenTargets()
+{
+    SCOPED_ZONE("CreateOffscreenTargets");
+    // Same format the windowed path requires from its surface, pipelines and render passes don't change
+    SurfaceFormatKHR.format = VK_FORMAT_B8G8R8A8_UNORM;
+    SurfaceFormatKHR.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    ViewportSize.width = Settings.HeadlessWidth;
+    ViewportSize.height = Settings.HeadlessHeight;
+    LOG_Info("Headless: rendering %ux%u offscreen", ViewportSize.width, ViewportSize.height);
+
+    // Frame N always renders into image N, its ticket is all the synchronization the image needs
+    SwapChainImageCount = Settings.FramesInFlight;
+    SwapChainImages.resize(SwapChainImageCount);
+    SwapChainImagesViews.resize(SwapChainImageCount);
+    SwapChainTextures.resize(SwapChainImageCount);
+    for(uint32_t i = 0; i < SwapChainImageCount; i++)
+    {
+        FTexture& texture = SwapChainTextures[i];
+        CreateImage(ViewportSize.width, ViewportSize.height, SurfaceFormatKHR.format, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            texture.Image, texture.ImageMemory);
+        texture.ImageView = CreateImageView(texture.Image, SurfaceFormatKHR.format, VK_IMAGE_ASPECT_COLOR_BIT);
+        texture.Format = SurfaceFormatKHR.format;
+        texture.SizeX = ViewportSize.width;
+        texture.SizeY = ViewportSize.height;
+        texture.MipMaps = 1;
+        texture.ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        SwapChainImages[i] = texture.Image;
+        SwapChainImagesViews[i] = texture.ImageView;
+    }
+}
+
+void FRenderer::DestroyOffscreenTargets()
+{
+    for(FTexture& texture : SwapChainTextures)
+    {
+        DestroyImageView(texture.ImageView);
+        vkDestroyImage(Device, texture.Image, nullptr);
+        vkFreeMemory(Device, texture.ImageMemory, nullptr);
+    }
+    SwapChainTextures.clear();
+    SwapChainImagesViews.clear();
+    SwapChainImages.clear();
 }
 
 VkBool32 GetSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat)
@@ -558,73 +1414,23 @@ void FRenderer::SetupDepthStencil()
 {
     VkBool32 validDepthFormat = GetSupportedDepthFormat(PhysicalDevice, &DepthFormat);
     CreateImage(ViewportSize.width, ViewportSize.height, 
-                VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_TILING_OPTIMAL, 
+                DepthFormat, VK_IMAGE_TILING_OPTIMAL, 
                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
                 DepthImage, DepthImageMemory);
-    DepthImageView = CreateImageView(DepthImage, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_ASPECT_DEPTH_BIT);
+    DepthImageView = CreateImageView(DepthImage, DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 }
 
 void FRenderer::CreateRenderPass()
 {
-    std::vector<VkAttachmentDescription> attachments(2);
-
-	attachments[0].format = SurfaceFormatKHR.format;
-	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	attachments[1].format = DepthFormat;
-	attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorReference = {};
-	colorReference.attachment = 0;
-	colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depthReference = {};
-	depthReference.attachment = 1;
-	depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpassDescription = {};
-	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassDescription.colorAttachmentCount = 1;
-	subpassDescription.pColorAttachments = &colorReference;
-	subpassDescription.pDepthStencilAttachment = &depthReference;
-	subpassDescription.inputAttachmentCount = 0;
-	subpassDescription.pInputAttachments = nullptr;
-	subpassDescription.preserveAttachmentCount = 0;
-	subpassDescription.pPreserveAttachments = nullptr;
-	subpassDescription.pResolveAttachments = nullptr;
-
-	vector<VkSubpassDependency> dependencies(1);
-
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-	renderPassInfo.pAttachments = attachments.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpassDescription;
-	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-	renderPassInfo.pDependencies = dependencies.data();
-
-	vkCreateRenderPass(Device, &renderPassInfo, nullptr, &RenderPass);
+    RenderPassCache.Init(Device);
+
+    MainPassDesc = FRenderPassDesc();
+    MainPassDesc.ColorAttachmentCount = 1;
+    MainPassDesc.ColorAttachments[0] = FAttachmentDesc(SurfaceFormatKHR.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    MainPassDesc.DepthAttachment = FAttachmentDesc(DepthFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    MainPassDesc.DepthAttachment.StencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+    RenderPass = RenderPassCache.GetRenderPass(MainPassDesc);
 }
 
 void FRenderer::CreateFrameBuffers()
@@ -633,23 +1439,12 @@ void FRenderer::CreateFrameBuffers()
 
     for (size_t i = 0; i < SwapChainImagesViews.size(); i++)
     {
-        std::vector<VkImageView> attachments(2);
-        attachments[0] = SwapChainImagesViews[i];
-        attachments[1] = DepthImageView;
-
-        VkFramebufferCreateInfo framebufferInfo = {};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = RenderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = ViewportSize.width;
-        framebufferInfo.height = ViewportSize.height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(Device, &framebufferInfo, nullptr, &SwapChainFrameBuffers[i]) != VK_SUCCESS)
-        {
-            checkf(0, "CreateFramebuffers: failed to create framebuffer");
-        }
+        FFramebufferDesc targets;
+        targets.ColorViews[0] = SwapChainImagesViews[i];
+        targets.DepthView = DepthImageView;
+        targets.Width = ViewportSize.width;
+        targets.Height = ViewportSize.height;
+        SwapChainFrameBuffers[i] = RenderPassCache.GetFramebuffer(MainPassDesc, targets);
     }
 }
 
@@ -660,165 +1455,243 @@ void FRenderer::CreateCommandPool()
     createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     createInfo.queueFamilyIndex = graphics_QueueFamilyIndex;
     vkCreateCommandPool(Device, &createInfo, nullptr, &CommandPool);
+
+    if(HasTransferQueue())
+    {
+        createInfo.queueFamilyIndex = transfer_QueueFamilyIndex;
+        vkCreateCommandPool(Device, &createInfo, nullptr, &TransferCommandPool);
+    }
 }
 
-void FRenderer::CreateCommandBuffers()
+void FRenderer::CreateFrameResources()
 {
-    VkCommandBufferAllocateInfo allocateInfo = {};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocateInfo.commandPool = CommandPool;
-    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = SwapChainImageCount;
+    SCOPED_ZONE("CreateFrameResources");
+    Frames.resize(Settings.FramesInFlight);
+    for(FFrameResources& Frame : Frames)
+    {
+        // Reset as a whole at the start of the frame, no per-buffer reset needed
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = graphics_QueueFamilyIndex;
+        vkCreateCommandPool(Device, &poolInfo, nullptr, &Frame.CommandPool);
+
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = Frame.CommandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        vkAllocateCommandBuffers(Device, &allocateInfo, &Frame.CommandBuffer);
+
+        CreateSemaphore(&Frame.ImageAvailableSemaphore);
+
+        if(HasAsyncCompute())
+        {
+            allocateInfo.commandBufferCount = RENDER_GRAPH_GRAPHICS_BATCHES - 1;
+            vkAllocateCommandBuffers(Device, &allocateInfo, Frame.BatchCommandBuffers);
+
+            poolInfo.queueFamilyIndex = compute_QueueFamilyIndex;
+            vkCreateCommandPool(Device, &poolInfo, nullptr, &Frame.ComputeCommandPool);
+            allocateInfo.commandPool = Frame.ComputeCommandPool;
+            allocateInfo.commandBufferCount = 1;
+            vkAllocateCommandBuffers(Device, &allocateInfo, &Frame.ComputeCommandBuffer);
+        }
 
-    CommandBuffers.resize(SwapChainImageCount);
-    vkAllocateCommandBuffers(Device, &allocateInfo, CommandBuffers.data());
+        Frame.TransientBuffer.Init(Device, PhysicalDevice, Settings.TransientBufferSize, graphics_QueueFamilyIndex, compute_QueueFamilyIndex);
+
+        if(IsHeadless() && Settings.DumpFrameInterval > 0)
+        {
+            VkBufferCreateInfo bufferInfo = {};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = static_cast<VkDeviceSize>(ViewportSize.width) * ViewportSize.height * 4;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            vkCreateBuffer(Device, &bufferInfo, nullptr, &Frame.ReadbackBuffer);
+
+            VkMemoryRequirements memRequirements;
+            vkGetBufferMemoryRequirements(Device, Frame.ReadbackBuffer, &memRequirements);
+
+            // Every byte is read back by the CPU, cached memory makes that a lot cheaper
+            VkBool32 bCached = VK_FALSE;
+            uint32_t memoryType = GetMemoryType(memRequirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &bCached);
+            if(!bCached)
+            {
+                memoryType = GetMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            }
+
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = memRequirements.size;
+            allocInfo.memoryTypeIndex = memoryType;
+            if(vkAllocateMemory(Device, &allocInfo, nullptr, &Frame.ReadbackMemory) != VK_SUCCESS)
+            {
+                checkf(0, "Unable to allocate frame dump readback memory");
+            }
+            vkBindBufferMemory(Device, Frame.ReadbackBuffer, Frame.ReadbackMemory, 0);
+            vkMapMemory(Device, Frame.ReadbackMemory, 0, VK_WHOLE_SIZE, 0, &Frame.ReadbackData);
+        }
+    }
+
+    // A present may still wait on the semaphore after its frame's ticket completed, so these follow the swapchain images
+    RenderingFinishedSemaphores.resize(SwapChainImageCount);
+    for(VkSemaphore& semaphore : RenderingFinishedSemaphores)
+    {
+        CreateSemaphore(&semaphore);
+    }
+
+    // Every job worker plus the render thread, which records a slice itself while it waits
+    const uint32_t recordThreads = Settings.RecordThreads > 0 ? Settings.RecordThreads : FJobSystem::Get().GetNumWorkers() + 1;
+    CommandRecorder.Init(Device, graphics_QueueFamilyIndex, Settings.FramesInFlight, recordThreads, Settings.MinDrawsPerSlice);
+
+    if(Settings.bGpuProfiler)
+    {
+        GpuProfiler.Init(Device, PhysicalDevice, graphics_QueueFamilyIndex, Settings.FramesInFlight, bPipelineStatisticsQuery, Settings.FrameStatsInterval);
+    }
+
+    CurrentFrame = 0;
+    snprintf(FrameStatsModeName, sizeof(FrameStatsModeName), "%s, %u in flight%s", IsHeadless() ? "headless" : FRendererSettings::GetPresentModeName(PresentMode),
+        Settings.FramesInFlight, Settings.bLowLatency ? ", low latency" : "");
+    FrameStats.Init(Settings.FrameStatsInterval, FrameStatsModeName);
+    LOG_Info("Frame resources: %u frames in flight, %u swapchain images, %u KB transient memory per frame",
+        Settings.FramesInFlight, SwapChainImageCount, Settings.TransientBufferSize / 1024);
 }
 
-void FRenderer::CreateSemaphores()
+void FRenderer::DestroyFrameResources()
 {
-    CreateSemaphore(&ImageAvailableSemaphore);
-    CreateSemaphore(&RenderingFinishedSemaphore);
+    GpuProfiler.Shutdown();
+    CommandRecorder.Shutdown();
+    for(FFrameResources& Frame : Frames)
+    {
+        if(Frame.TransientBindlessIndex != BINDLESS_INVALID_INDEX)
+        {
+            BindlessHeap.Release(BINDLESS_StorageBuffers, Frame.TransientBindlessIndex);
+        }
+        Frame.TransientBuffer.Shutdown();
+        if(Frame.ReadbackBuffer != VK_NULL_HANDLE)
+        {
+            vkUnmapMemory(Device, Frame.ReadbackMemory);
+            vkDestroyBuffer(Device, Frame.ReadbackBuffer, nullptr);
+            vkFreeMemory(Device, Frame.ReadbackMemory, nullptr);
+        }
+        vkDestroySemaphore(Device, Frame.ImageAvailableSemaphore, nullptr);
+        vkDestroyCommandPool(Device, Frame.CommandPool, nullptr);
+        if(Frame.ComputeCommandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(Device, Frame.ComputeCommandPool, nullptr);
+        }
+    }
+    Frames.clear();
+
+    for(VkSemaphore semaphore : RenderingFinishedSemaphores)
+    {
+        vkDestroySemaphore(Device, semaphore, nullptr);
+    }
+    RenderingFinishedSemaphores.clear();
 }
 
-void FRenderer::CreateFences()
+void FRenderer::CreateBindlessHeap()
 {
-    uint32_t i;
-    Fences.resize(SwapChainImageCount);
-    for(i = 0; i < SwapChainImageCount; i++)
+    BindlessHeap.Init(Device, PhysicalDevice);
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if(vkCreateSampler(Device, &samplerInfo, nullptr, &DefaultSampler) != VK_SUCCESS)
     {
-        VkResult result;
+        checkf(0, "Unable to create default sampler");
+    }
+    DefaultSamplerIndex = BindlessHeap.RegisterSampler(DefaultSampler);
 
-        VkFenceCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-        vkCreateFence(Device, &createInfo, nullptr, &Fences[i]);
+    // Frame resources are created first, their transient buffers get a slot now
+    for(FFrameResources& Frame : Frames)
+    {
+        Frame.TransientBindlessIndex = BindlessHeap.RegisterStorageBuffer(Frame.TransientBuffer.GetBuffer());
     }
 }
 
+void FRenderer::CreatePipelineCache()
+{
+    SCOPED_ZONE("CreatePipelineCache");
+    ShaderCache.Init(Device);
+    PipelineCache.Init(Device, PhysicalDevice, FPaths::GetSavedDirectory() + "/PipelineCache.bin");
+    PipelineStateCache.Init(Device, &ShaderCache, &PipelineCache, bGraphicsPipelineLibrary, bGraphicsPipelineLibraryFastLinking);
+}
+
 void FRenderer::CreateGBuffer()
 {
+    SCOPED_ZONE("CreateGBuffer");
     GBuffer = FGBuffer();
-    VkFormat DepthFormat;
-    const bool bSuccess = GetCommandList().GetSupportedDepthFormat(&DepthFormat);
-    checkf(bSuccess, "FRenderer::CreateGBuffer getting supported format ");
-    
-    GBuffer.BufferA = GetCommandList().CreateTexture(ViewportSize.width, ViewportSize.height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-    GBuffer.BufferB = GetCommandList().CreateTexture(ViewportSize.width, ViewportSize.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-    GBuffer.BufferC = GetCommandList().CreateTexture(ViewportSize.width, ViewportSize.height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-    GBuffer.Depth = GetCommandList().CreateTexture(ViewportSize.width, ViewportSize.height, VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-    // Set up separate renderpass with references to the color and depth attachments
-    std::array<VkAttachmentDescription, 4> attachmentDescs = {};
-
-    // Init attachment properties
-    for (uint32_t i = 0; i < 4; ++i)
-    {
-        attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
-        attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        if (i == 3)
-        {
-            attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        }
-        else
+    GBuffer.Width = ViewportSize.width;
+    GBuffer.Height = ViewportSize.height;
+    // Resizes keep the layout picked for the startup resolution, every pipeline would have to be rebuilt otherwise
+    const FGBufferLayout& layout = FGBufferLayout::Select(Settings.GBufferLayout, PhysicalDevice, GBuffer.Width, GBuffer.Height);
+    GBuffer.Layout = &layout;
+    GBuffer.BufferAFormat = layout.BufferAFormat;
+    GBuffer.BufferBFormat = layout.BufferBFormat;
+    GBuffer.BufferCFormat = layout.BufferCFormat;
+    GBuffer.DepthFormat = layout.FindDepthFormat(PhysicalDevice);
+    const uint32_t colorBytes = layout.GetColorBytesPerPixel();
+    const uint32_t depthBytes = FGBufferLayout::GetFormatSize(GBuffer.DepthFormat);
+    const double layoutMB = static_cast<double>(colorBytes + depthBytes) * GBuffer.Width * GBuffer.Height / (1024.0 * 1024.0);
+    LOG_Info("GBuffer layout %s: %u color + %u depth = %u bytes per pixel, %.2f MB at %dx%d", layout.Name, colorBytes, depthBytes,
+        colorBytes + depthBytes, layoutMB, GBuffer.Width, GBuffer.Height);
+
+    // The GBuffer textures are transient, the graph allocates and aliases them once the passes are declared
+    RenderGraph.Init(Device, PhysicalDevice, &RenderPassCache, &BindlessHeap, Settings.FramesInFlight);
+    if(HasAsyncCompute())
+    {
+        // Timestamps on the compute queue only when the family has them, the profiler's pool is shared by both queues
+        RenderGraph.EnableAsyncCompute(graphics_QueueFamilyIndex, compute_QueueFamilyIndex, Settings.bGpuProfiler && computeTimestampValidBits > 0);
+    }
+
+    FRenderPassDesc& passDesc = GBuffer.RenderPassDesc;
+    passDesc.ColorAttachmentCount = 3;
+    passDesc.ColorAttachments[0] = FAttachmentDesc(GBuffer.BufferAFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    passDesc.ColorAttachments[1] = FAttachmentDesc(GBuffer.BufferBFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    passDesc.ColorAttachments[2] = FAttachmentDesc(GBuffer.BufferCFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    passDesc.DepthAttachment = FAttachmentDesc(GBuffer.DepthFormat, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    if(Settings.bSubpassDeferred)
+    {
+        // The graph merges composition into the geometry render pass: the swapchain image is the fourth color,
+        // written by subpass 1 which reads the three GBuffer colors and depth as input attachments
+        passDesc.ColorAttachmentCount = 4;
+        passDesc.ColorAttachments[3] = FAttachmentDesc(SurfaceFormatKHR.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        passDesc.SubpassCount = 2;
+        FSubpassDesc& geometrySubpass = passDesc.Subpasses[0];
+        geometrySubpass.ColorAttachmentCount = 3;
+        geometrySubpass.bDepth = true;
+        FSubpassDesc& lightingSubpass = passDesc.Subpasses[1];
+        lightingSubpass.ColorAttachmentCount = 1;
+        lightingSubpass.ColorAttachments[0] = 3;
+        lightingSubpass.InputAttachmentCount = 4;
+        for(uint8_t i = 0; i < 3; i++)
         {
-            attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        }
-    }
-
-    // Formats
-    attachmentDescs[0].format = GBuffer.BufferA.Format;
-    attachmentDescs[1].format = GBuffer.BufferB.Format;
-    attachmentDescs[2].format = GBuffer.BufferC.Format;
-    attachmentDescs[3].format = GBuffer.Depth.Format;
-
-    std::vector<VkAttachmentReference> colorReferences;
-    colorReferences.push_back({ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-    colorReferences.push_back({ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-    colorReferences.push_back({ 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-
-    VkAttachmentReference depthReference = {};
-    depthReference.attachment = 3;
-    depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.pColorAttachments = colorReferences.data();
-    subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
-    subpass.pDepthStencilAttachment = &depthReference;
-
-    // Use subpass dependencies for attachment layout transitions
-    std::array<VkSubpassDependency, 2> dependencies;
-
-    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[0].dstSubpass = 0;
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    dependencies[1].srcSubpass = 0;
-    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.pAttachments = attachmentDescs.data();
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 2;
-    renderPassInfo.pDependencies = dependencies.data();
-
-    if(vkCreateRenderPass(Device, &renderPassInfo, nullptr, &GBuffer.RenderPass) != VK_SUCCESS)
-    {
-        checkf(0, "FRenderer::CreateGBuffer Unable to greate geometry pass");
-    }
-
-    std::array<VkImageView,4> attachments;
-    attachments[0] = GBuffer.BufferA.ImageView;
-    attachments[1] = GBuffer.BufferB.ImageView;
-    attachments[2] = GBuffer.BufferC.ImageView;
-    attachments[3] = GBuffer.Depth.ImageView;
-
-    VkFramebufferCreateInfo fbufCreateInfo = {};
-    fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fbufCreateInfo.pNext = NULL;
-    fbufCreateInfo.renderPass = GBuffer.RenderPass;
-    fbufCreateInfo.pAttachments = attachments.data();
-    fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    fbufCreateInfo.width = ViewportSize.width;
-    fbufCreateInfo.height = ViewportSize.height;
-    fbufCreateInfo.layers = 1;
-    
-    if(vkCreateFramebuffer(Device, &fbufCreateInfo, nullptr, &GBuffer.FrameBuffer) != VK_SUCCESS)
-    {
-        checkf(0, "FRenderer::CreateGBuffer Unable to create frame buffer for geomtry pass");
+            geometrySubpass.ColorAttachments[i] = i;
+            lightingSubpass.InputAttachments[i] = i;
+        }
+        lightingSubpass.InputAttachments[3] = RENDER_PASS_DEPTH_ATTACHMENT;
     }
+    GBuffer.RenderPass = RenderPassCache.GetRenderPass(passDesc);
 
     LOG_Info("Generating GBuffer, success");
 
-    // Setup descriptor layout
+    // Setup descriptor layout, input attachments can't go through the bindless set
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-        // Binding 0 : Vertex shader uniform buffer
-        GetCommandList().DescriptorSetLayoutBinding( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-        // Binding 1 : Position texture target / Scene colormap
-        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
-        // Binding 2 : Normals texture target
-        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
-        // Binding 3 : Albedo texture target
-        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
-        // Binding 4 : Fragment shader uniform buffer
-        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+        // Binding 0 : GBuffer A input attachment
+        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        // Binding 1 : GBuffer B input attachment
+        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+        // Binding 2 : GBuffer C input attachment
+        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+        // Binding 3 : GBuffer depth input attachment, positions the lights are evaluated at
+        GetCommandList().DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
     };
 
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
@@ -830,72 +1703,133 @@ void FRenderer::CreateGBuffer()
         checkf(0, "Unable to create descriptor set layout");
     }
 
-    // Shared pipeline layout used by all pipelines
+    if(Settings.bSubpassDeferred)
+    {
+        // The graph may hand out other transient images any frame, each frame rewrites its own set
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        poolSize.descriptorCount = static_cast<uint32_t>(setLayoutBindings.size()) * MAX_FRAMES_IN_FLIGHT;
+        VkDescriptorPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+        poolCreateInfo.poolSizeCount = 1;
+        poolCreateInfo.pPoolSizes = &poolSize;
+        if(vkCreateDescriptorPool(Device, &poolCreateInfo, nullptr, &GBuffer.descriptorPool) != VK_SUCCESS)
+        {
+            checkf(0, "Unable to create GBuffer descriptor pool");
+        }
+
+        std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> inputSetLayouts;
+        inputSetLayouts.fill(GBuffer.descriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = GBuffer.descriptorPool;
+        allocateInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+        allocateInfo.pSetLayouts = inputSetLayouts.data();
+        if(vkAllocateDescriptorSets(Device, &allocateInfo, GBuffer.InputAttachmentSets) != VK_SUCCESS)
+        {
+            checkf(0, "Unable to allocate GBuffer input attachment sets");
+        }
+    }
+
+    // Shared pipeline layout used by all pipelines, set 0 is always the global bindless set
+    const std::array<VkDescriptorSetLayout, 2> setLayouts = { BindlessHeap.GetDescriptorSetLayout(), GBuffer.descriptorSetLayout };
+    const VkPushConstantRange pushConstantRange = FBindlessHeap::GetPushConstantRange();
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = 1;
-    pipelineLayoutCreateInfo.pSetLayouts = &GBuffer.descriptorSetLayout;
+    pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
     if(vkCreatePipelineLayout(Device, &pipelineLayoutCreateInfo, nullptr, &GBuffer.pipelineLayout) != VK_SUCCESS)
     {
         checkf(0, "Unable to create pipeline layout");
     }
 
-    // Create pipeline
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
-    VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
-	VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
-	VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
-	VkPipelineDepthStencilStateCreateInfo depthStencilState = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
-	VkPipelineViewportStateCreateInfo viewportState = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
-	VkPipelineMultisampleStateCreateInfo multisampleState = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
-	std::vector<VkDynamicState> dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-	VkPipelineDynamicStateCreateInfo dynamicState = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
-
-    VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::pipelineCreateInfo(pipelineLayout, renderPass);
-    pipelineCI.pInputAssemblyState = &inputAssemblyState;
-    pipelineCI.pRasterizationState = &rasterizationState;
-    pipelineCI.pColorBlendState = &colorBlendState;
-    pipelineCI.pMultisampleState = &multisampleState;
-    pipelineCI.pViewportState = &viewportState;
-    pipelineCI.pDepthStencilState = &depthStencilState;
-    pipelineCI.pDynamicState = &dynamicState;
-    pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
-    pipelineCI.pStages = shaderStages.data();
-
-		// Final fullscreen composition pass pipeline
-    rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
-    shaderStages[0] = loadShader(getShadersPath() + "deferred/deferred.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-    shaderStages[1] = loadShader(getShadersPath() + "deferred/deferred.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-    // Empty vertex input state, vertices are generated by the vertex shader
-    VkPipelineVertexInputStateCreateInfo emptyInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
-    pipelineCI.pVertexInputState = &emptyInputState;
-    VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.composition));
-
-    // Vertex input state from glTF model for pipeline rendering models
-    pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::Tangent});
-    rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-
-		// Offscreen pipeline
-    shaderStages[0] = loadShader(getShadersPath() + "deferred/mrt.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-    shaderStages[1] = loadShader(getShadersPath() + "deferred/mrt.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-
-		// Separate render pass
-    pipelineCI.renderPass = offScreenFrameBuf.renderPass;
-
-		// Blend attachment states required for all color attachments
-		// This is important, as color write mask will otherwise be 0x0 and you
-		// won't see anything rendered to the attachment
-    std::array<VkPipelineColorBlendAttachmentState, 3> blendAttachmentStates = {
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE)
-		};
-
-		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
-		colorBlendState.pAttachments = blendAttachmentStates.data();
-
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreen));
+    // Geometry pass pipeline, vertices are pulled from the bindless storage buffers so there is no vertex input
+    FGraphicsPipelineDesc& geometryDesc = GBuffer.GeometryPipelineDesc;
+    // The indirect variant reads its transform and mesh from the instance buffer instead of push constants
+    geometryDesc.VertexShader = FPaths::GetShaderDirectory() + (bGpuDrivenDraws ? "/GBufferIndirect.vert.spv" : "/GBuffer.vert.spv");
+    geometryDesc.FragmentShader = FPaths::GetShaderDirectory() + "/GBuffer.frag.spv";
+    geometryDesc.ColorAttachmentCount = 3;
+    geometryDesc.ColorFormats[0] = GBuffer.BufferAFormat;
+    geometryDesc.ColorFormats[1] = GBuffer.BufferBFormat;
+    geometryDesc.ColorFormats[2] = GBuffer.BufferCFormat;
+    geometryDesc.DepthFormat = GBuffer.DepthFormat;
+    geometryDesc.RenderPass = GBuffer.RenderPass;
+    geometryDesc.PipelineLayout = GBuffer.pipelineLayout;
+    geometryDesc.FragmentConstantCount = 1;
+    geometryDesc.FragmentConstants[0] = static_cast<uint32_t>(layout.NormalEncoding);
+
+    // Cheap stand-in compiled up front, draws use it until the full pipeline is ready
+    FGraphicsPipelineDesc fallbackDesc = geometryDesc;
+    fallbackDesc.FragmentShader = FPaths::GetShaderDirectory() + "/GBufferFallback.frag.spv";
+    GBuffer.FallbackGeometryPipeline = PipelineStateCache.GetPipelineBlocking(fallbackDesc);
+    checkf(GBuffer.FallbackGeometryPipeline != VK_NULL_HANDLE, "FRenderer::CreateGBuffer Unable to create fallback geometry pipeline");
+    PipelineStateCache.Precompile(geometryDesc);
+    PipelineStateCache.LogLinkTimings(geometryDesc);
+
+    if(bInstancing)
+    {
+        // Per actor draws stay available for frames whose transforms don't fit the transient buffer
+        GBuffer.InstancedGeometryPipelineDesc = geometryDesc;
+        GBuffer.InstancedGeometryPipelineDesc.VertexShader = FPaths::GetShaderDirectory() + "/GBufferInstanced.vert.spv";
+        FGraphicsPipelineDesc instancedFallbackDesc = fallbackDesc;
+        instancedFallbackDesc.VertexShader = GBuffer.InstancedGeometryPipelineDesc.VertexShader;
+        GBuffer.FallbackInstancedGeometryPipeline = PipelineStateCache.GetPipelineBlocking(instancedFallbackDesc);
+        checkf(GBuffer.FallbackInstancedGeometryPipeline != VK_NULL_HANDLE, "FRenderer::CreateGBuffer Unable to create instanced fallback geometry pipeline");
+        PipelineStateCache.Precompile(GBuffer.InstancedGeometryPipelineDesc);
+    }
+
+    if(bOcclusionCulling)
+    {
+        // Only the geometry subpass: compatible with the render pass the graph creates for the early pass. Without
+        // the lighting subpass in the GBuffer pass this is the same pipeline.
+        FRenderPassDesc earlyPassDesc = passDesc;
+        earlyPassDesc.ColorAttachmentCount = 3;
+        earlyPassDesc.SubpassCount = 0;
+        for(FSubpassDesc& subpass : earlyPassDesc.Subpasses)
+        {
+            subpass = FSubpassDesc();
+        }
+        GBuffer.EarlyGeometryPipelineDesc = geometryDesc;
+        GBuffer.EarlyGeometryPipelineDesc.RenderPass = RenderPassCache.GetRenderPass(earlyPassDesc);
+        FGraphicsPipelineDesc earlyFallbackDesc = fallbackDesc;
+        earlyFallbackDesc.RenderPass = GBuffer.EarlyGeometryPipelineDesc.RenderPass;
+        GBuffer.FallbackEarlyGeometryPipeline = PipelineStateCache.GetPipelineBlocking(earlyFallbackDesc);
+        checkf(GBuffer.FallbackEarlyGeometryPipeline != VK_NULL_HANDLE, "FRenderer::CreateGBuffer Unable to create early fallback geometry pipeline");
+        PipelineStateCache.Precompile(GBuffer.EarlyGeometryPipelineDesc);
+    }
+
+    // Final fullscreen composition pass pipeline, the triangle is generated by the vertex shader.
+    // It only writes the swapchain image, the render pass just has to be compatible with the one the graph creates
+    FGraphicsPipelineDesc compositionDesc;
+    compositionDesc.VertexShader = FPaths::GetShaderDirectory() + "/Deferred.vert.spv";
+    compositionDesc.FragmentShader = FPaths::GetShaderDirectory() + "/Deferred.frag.spv";
+    compositionDesc.CullMode = VK_CULL_MODE_NONE;
+    compositionDesc.bDepthTest = false;
+    compositionDesc.bDepthWrite = false;
+    compositionDesc.ColorAttachmentCount = 1;
+    compositionDesc.ColorFormats[0] = SurfaceFormatKHR.format;
+    compositionDesc.DepthFormat = VK_FORMAT_UNDEFINED;
+    if(Settings.bSubpassDeferred)
+    {
+        compositionDesc.FragmentShader = FPaths::GetShaderDirectory() + "/DeferredSubpass.frag.spv";
+        compositionDesc.RenderPass = GBuffer.RenderPass;
+        compositionDesc.Subpass = 1;
+    }
+    else
+    {
+        FRenderPassDesc compositionPassDesc;
+        compositionPassDesc.ColorAttachmentCount = 1;
+        compositionPassDesc.ColorAttachments[0] = FAttachmentDesc(SurfaceFormatKHR.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        compositionDesc.RenderPass = RenderPassCache.GetRenderPass(compositionPassDesc);
+    }
+    compositionDesc.PipelineLayout = GBuffer.pipelineLayout;
+    compositionDesc.FragmentConstantCount = 1;
+    compositionDesc.FragmentConstants[0] = static_cast<uint32_t>(layout.NormalEncoding);
+    GBuffer.CompositionPipeline = PipelineStateCache.GetPipelineBlocking(compositionDesc);
+    checkf(GBuffer.CompositionPipeline != VK_NULL_HANDLE, "FRenderer::CreateGBuffer Unable to create composition pipeline");
 }
 
 void FRenderer::CreateSemaphore(VkSemaphore* Semaphore)
@@ -905,74 +1839,474 @@ void FRenderer::CreateSemaphore(VkSemaphore* Semaphore)
     vkCreateSemaphore(Device, &createInfo, nullptr, Semaphore);
 }
 
-void FRenderer::RenderGeometryPass()
+void FRenderer::BuildRenderGraph()
 {
-    if (GBuffer.GeometryPassCommand == VK_NULL_HANDLE)
+    RenderGraph.Reset(CurrentFrame);
+
+    FTexture& backBuffer = SwapChainTextures[GetCommandList().GetSwapChainImageIndex()];
+    // Headless targets are copied out for frame dumps instead of presented
+    const VkImageLayout backBufferLayout = IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    const FRenderGraphTexture swapChainTexture = RenderGraph.ImportTexture("SwapChain", &backBuffer, backBufferLayout);
+
+    GBuffer.BufferA = RenderGraph.CreateTexture("GBufferA", FRenderGraphTextureDesc(GBuffer.Width, GBuffer.Height, GBuffer.BufferAFormat));
+    GBuffer.BufferB = RenderGraph.CreateTexture("GBufferB", FRenderGraphTextureDesc(GBuffer.Width, GBuffer.Height, GBuffer.BufferBFormat));
+    GBuffer.BufferC = RenderGraph.CreateTexture("GBufferC", FRenderGraphTextureDesc(GBuffer.Width, GBuffer.Height, GBuffer.BufferCFormat));
+    GBuffer.Depth = RenderGraph.CreateTexture("GBufferDepth", FRenderGraphTextureDesc(GBuffer.Width, GBuffer.Height, GBuffer.DepthFormat));
+
+    // Culled before the geometry pass so nothing is added between it and composition, which stays mergeable
+    FFrameResources& frame = GetCurrentFrame();
+    LightGrid = LightCulling.UploadLights(World->GetLights(), frame.TransientBuffer, frame.TransientBindlessIndex);
+    FrameCounters.Lights = LightGrid.LightCount;
+    FRenderGraphBuffer lightClusters;
+    if(Settings.bClusteredLighting && LightGrid.LightCount > 0)
     {
-        GBuffer.GeometryPassCommand = GetCommandList().CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+        lightClusters = LightCulling.AddCullingPass(RenderGraph, LightGrid, CurrentFrame);
     }
 
-		// Create a semaphore used to synchronize offscreen rendering and usage
-    VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    if(vkCreateSemaphore(Device, &semaphoreCreateInfo, nullptr, &GBuffer.GeometryPassSemaphore) != VK_SUCCESS)
+    // Cascades are drawn before the geometry passes so composition still merges into the last of them. Casters are always
+    // CPU recorded, GPU driven draws only cover the main view.
+    if(Settings.bShadows)
     {
-        checkf(0, "Unable to create semaphore for geometry pass");
+        UpdateActorBounds();
+        // No camera yet, the view is the clip volume actors are placed in
+        ShadowCascades.Update(glm::mat4(1.0f), World->GetDirectionalLight(), ActorBounds, World->GetRevision());
+        const FShadowStats shadowStats = ShadowCascades.AddPasses(RenderGraph, BoundedActors);
+        FrameCounters.ShadowCascadesRendered = shadowStats.CascadesRendered;
+        FrameCounters.ShadowCascadesScrolled = shadowStats.CascadesScrolled;
+        FrameCounters.ShadowDraws = shadowStats.Draws;
     }
+    Shadows = ShadowCascades.Upload(World->GetDirectionalLight(), frame.TransientBuffer, frame.TransientBindlessIndex);
 
-    VkCommandBufferBeginInfo cmdBufInfo = {};
-    cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    FGpuSceneDrawBuffers drawBuffers;
+    if(bGpuDrivenDraws)
+    {
+        GpuScene.Update(*World, GpuTimeline, DefaultSamplerIndex);
+        // The statistics this frame in flight's previous culling copied back, its work is complete
+        const FGpuCullingStats cullingStats = GpuScene.ReadStats(CurrentFrame);
+        FrameCounters.Instances = cullingStats.Instances;
+        FrameCounters.FrustumCulled = cullingStats.Instances - std::min(cullingStats.FrustumVisible, cullingStats.Instances);
+        FrameCounters.OcclusionCulled = cullingStats.Occluded;
+        drawBuffers = GpuScene.ImportDrawBuffers(RenderGraph, CurrentFrame);
+    }
 
-    // Clear values for all attachments written in the fragment shader
-    std::array<VkClearValue,4> clearValues;
-    clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-    clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-    clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-    clearValues[3].depthStencil = { 1.0f, 0 };
+    // With occlusion culling what was visible last frame is drawn first, the depth pyramid is built from it and the
+    // geometry pass then only adds what the late culling pass found visible on top
+    EGpuCullingPhase geometryPhase = EGpuCullingPhase::All;
+    VkAttachmentLoadOp geometryLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    if(drawBuffers.Commands.IsValid() && bOcclusionCulling)
+    {
+        GpuScene.AddCullingPass(RenderGraph, drawBuffers, CurrentFrame, EGpuCullingPhase::Early);
+        RenderGraph.AddPass("GeometryEarly")
+            .ReadBuffer(drawBuffers.Commands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
+            .ReadBuffer(drawBuffers.Counts, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
+            .WriteColor(GBuffer.BufferA, VK_ATTACHMENT_LOAD_OP_CLEAR)
+            .WriteColor(GBuffer.BufferB, VK_ATTACHMENT_LOAD_OP_CLEAR)
+            .WriteColor(GBuffer.BufferC, VK_ATTACHMENT_LOAD_OP_CLEAR)
+            .WriteDepth(GBuffer.Depth, VK_ATTACHMENT_LOAD_OP_CLEAR)
+            .UseSecondaryCommandBuffers()
+            .SetExecute([this](const FRenderGraphPassContext& Context) { RenderGeometryPass(Context, EGpuCullingPhase::Early); });
+        const FDepthPyramidDesc pyramid = DepthPyramid.AddBuildPass(RenderGraph, GBuffer.Depth, static_cast<uint32_t>(GBuffer.Width),
+            static_cast<uint32_t>(GBuffer.Height), CurrentFrame, DefaultSamplerIndex);
+        GpuScene.AddCullingPass(RenderGraph, drawBuffers, CurrentFrame, EGpuCullingPhase::Late, &pyramid);
+        geometryPhase = EGpuCullingPhase::Late;
+        geometryLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    }
+    else if(drawBuffers.Commands.IsValid())
+    {
+        GpuScene.AddCullingPass(RenderGraph, drawBuffers, CurrentFrame, EGpuCullingPhase::All);
+    }
 
-    VkRenderPassBeginInfo renderPassBeginInfo = {};
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassBeginInfo.renderPass =  GBuffer.RenderPass;
-    renderPassBeginInfo.framebuffer = GBuffer.FrameBuffer;
-    renderPassBeginInfo.renderArea.extent.width = ViewportSize.width;
-    renderPassBeginInfo.renderArea.extent.height = ViewportSize.height;
-    renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassBeginInfo.pClearValues = clearValues.data();
+    FRenderGraphPass& geometryPass = RenderGraph.AddPass("Geometry");
+    if(drawBuffers.Commands.IsValid())
+    {
+        geometryPass.ReadBuffer(drawBuffers.Commands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
+            .ReadBuffer(drawBuffers.Counts, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+    }
+    geometryPass.WriteColor(GBuffer.BufferA, geometryLoadOp)
+        .WriteColor(GBuffer.BufferB, geometryLoadOp)
+        .WriteColor(GBuffer.BufferC, geometryLoadOp)
+        .WriteDepth(GBuffer.Depth, geometryLoadOp)
+        .UseSecondaryCommandBuffers()
+        .SetExecute([this, geometryPhase](const FRenderGraphPassContext& Context) { RenderGeometryPass(Context, geometryPhase); });
+
+    VkClearColorValue clearColor = {0.2f, 1.f, 0.2f, 1.0f};
+    FRenderGraphPass& compositionPass = RenderGraph.AddPass("Composition");
+    if(Settings.bSubpassDeferred)
+    {
+        // Becomes subpass 1 of the geometry render pass, the GBuffer is never stored and stays on tile
+        compositionPass.ReadInputAttachment(GBuffer.BufferA)
+            .ReadInputAttachment(GBuffer.BufferB)
+            .ReadInputAttachment(GBuffer.BufferC)
+            .ReadInputAttachment(GBuffer.Depth);
+    }
+    else
+    {
+        compositionPass.ReadTexture(GBuffer.BufferA)
+            .ReadTexture(GBuffer.BufferB)
+            .ReadTexture(GBuffer.BufferC)
+            .ReadTexture(GBuffer.Depth);
+    }
+    if(lightClusters.IsValid())
+    {
+        compositionPass.ReadBuffer(lightClusters);
+    }
+    ShadowCascades.ReadCascades(compositionPass);
+    compositionPass.WriteColor(swapChainTexture, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor)
+        .SetExecute([this](const FRenderGraphPassContext& Context)
+        {
+            RenderCompositionPass(Context);
+            // Per actor CPU work is what GPU driven draws do away with
+            if(!bGpuDrivenDraws)
+            {
+                World->Render();
+            }
+        });
+}
 
-    if(vkBeginCommandBuffer(GBuffer.GeometryPassCommand, &cmdBufInfo) != VK_SUCCESS)
+void FRenderer::UpdateActorBounds()
+{
+    if(!bActorBoundsBuilt || ActorBoundsRevision != World->GetRevision())
     {
-        checkf(0, "Unable to begin command buffer for geometry pass");
+        ActorBounds.Clear();
+        BoundedActors.clear();
+        ActorSortKeys.clear();
+        const std::vector<std::shared_ptr<FActor>> Actors = World->GetActors();
+        ActorBounds.Reserve(static_cast<uint32_t>(Actors.size()));
+        // Dense identifiers in order of first use, 0 is no material
+        std::map<const FVertexBuffer*, uint32_t> meshIds;
+        std::map<const FMaterial*, uint32_t> materialIds = { { nullptr, 0 } };
+        for(const auto& Actor : Actors)
+        {
+            const FMeshActor* MeshActor = dynamic_cast<const FMeshActor*>(Actor.get());
+            if(!MeshActor || !MeshActor->IsValid()) continue;
+            glm::vec4 Sphere;
+            glm::vec3 BoxCenter;
+            glm::vec3 BoxExtent;
+            MeshActor->GetWorldBounds(Sphere, BoxCenter, BoxExtent);
+            ActorBounds.Add(Sphere, BoxCenter, BoxExtent);
+            BoundedActors.push_back(MeshActor);
+
+            const uint32_t meshId = meshIds.emplace(MeshActor->GetVertexBuffer(), static_cast<uint32_t>(meshIds.size())).first->second;
+            const uint32_t materialId = materialIds.emplace(MeshActor->GetMaterial(), static_cast<uint32_t>(materialIds.size())).first->second;
+            // Front to back by nearest depth within a material and mesh
+            ActorSortKeys.push_back(MakeDrawSortKey(materialId, meshId, Sphere.z - Sphere.w));
+        }
+        ActorBoundsRevision = World->GetRevision();
+        bActorBoundsBuilt = true;
     }
+}
 
-    vkCmdBeginRenderPass(GBuffer.GeometryPassCommand, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    VkViewport Viewport {};
-    Viewport.width = ViewportSize.width;
-    Viewport.height = ViewportSize.height;
-    Viewport.minDepth = 0.0f;
-    Viewport.maxDepth = 1.0f;
-   
-    vkCmdSetViewport(GBuffer.GeometryPassCommand, 0, 1, &Viewport);
+void FRenderer::CullActors(std::vector<const FMeshActor*>& OutDrawList)
+{
+    SCOPED_ZONE("CullActors");
+    UpdateActorBounds();
+
+    // No camera yet, the view is the clip volume actors are placed in
+    MainView.Frustum = FFrustum::FromViewProjection(glm::mat4(1.0f));
+    CullFrustums(ActorBounds, &MainView, 1);
+    FrameCounters.Instances = ActorBounds.Count;
+    FrameCounters.FrustumCulled = ActorBounds.Count - static_cast<uint32_t>(MainView.Visible.size());
+    OutDrawList.reserve(MainView.Visible.size());
+    if(!Settings.bSortDraws)
+    {
+        for(uint32_t ActorIndex : MainView.Visible)
+        {
+            OutDrawList.push_back(BoundedActors[ActorIndex]);
+        }
+        return;
+    }
+
+    DrawSortIndices.assign(MainView.Visible.begin(), MainView.Visible.end());
+    DrawSortKeys.resize(DrawSortIndices.size());
+    for(size_t i = 0; i < DrawSortIndices.size(); i++)
+    {
+        DrawSortKeys[i] = ActorSortKeys[DrawSortIndices[i]];
+    }
+    RadixSortDrawKeys(DrawSortKeys, DrawSortIndices, DrawSortScratchKeys, DrawSortScratchIndices);
+    for(uint32_t ActorIndex : DrawSortIndices)
+    {
+        OutDrawList.push_back(BoundedActors[ActorIndex]);
+    }
+}
+
+// Viewport and scissor are dynamic states, every command buffer drawing to the full view sets both
+static void SetViewportAndScissor(VkCommandBuffer CommandBuffer, VkExtent2D Extent)
+{
+    VkViewport viewport {};
+    viewport.width = static_cast<float>(Extent.width);
+    viewport.height = static_cast<float>(Extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(CommandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor {};
-    scissor.extent.width = ViewportSize.width;
-    scissor.extent.height = ViewportSize.height;
-    scissor.offset.x = 0;
-    scissor.offset.y = 0;
-    
-    vkCmdSetScissor(GBuffer.GeometryPassCommand, 0, 1, &scissor);
+    scissor.extent = Extent;
+    vkCmdSetScissor(CommandBuffer, 0, 1, &scissor);
+}
 
-    vkCmdBindPipeline(GBuffer.GeometryPassCommand, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
+void FRenderer::RenderGeometryPass(const FRenderGraphPassContext& Context, EGpuCullingPhase Phase)
+{
+    SCOPED_ZONE("GeometryPass");
+    const auto RecordStart = std::chrono::steady_clock::now();
+    if(bGpuDrivenDraws)
+    {
+        RenderGeometryPassIndirect(Context, Phase);
+        FrameTiming.RecordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RecordStart).count();
+        return;
+    }
 
-    // Render fucking object here
-    vkCmdBindDescriptorSets(GBuffer.GeometryPassCommand, VK_PIPELINE_BIND_POINT_GRAPHICS,  GBuffer.pipelineLayout, 0, 1, &descriptorSets.model, 0, nullptr);
-    models.model.bindBuffers(offScreenCmdBuffer);
-    vkCmdDrawIndexed(GBuffer.GeometryPassCommand, models.model.indices.count, 1, 0, 0, 0);
+    std::vector<const FMeshActor*> drawList;
+    CullActors(drawList);
+    for(const FMeshActor* MeshActor : drawList)
+    {
+        FrameCounters.Triangles += MeshActor->GetVertexBuffer()->IndexBufferSize / 3;
+    }
+    if(bInstancing && BuildInstancedDraws(drawList))
+    {
+        RenderGeometryPassInstanced(Context);
+        FrameTiming.RecordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RecordStart).count();
+        return;
+    }
+    FrameCounters.Draws = static_cast<uint32_t>(drawList.size());
 
-    vkCmdEndRenderPass(GBuffer.GeometryPassCommand);
+    // Never wait for a compile here, the fallback keeps the frame going until the real pipeline lands
+    const VkPipeline geometryPipeline = PipelineStateCache.GetPipeline(GBuffer.GeometryPipelineDesc, GBuffer.FallbackGeometryPipeline);
 
-    if(vkEndCommandBuffer(GBuffer.GeometryPassCommand) != VK_SUCCESS)
+    // Secondaries inherit nothing but the render pass, each slice sets up its own state
+    std::atomic<uint32_t> pipelineBinds(0);
+    std::atomic<uint32_t> indexBufferBinds(0);
+    std::atomic<uint32_t> materialChanges(0);
+    CommandRecorder.Record(Context.CommandBuffer, Context.RenderPass, Context.Subpass, Context.Framebuffer, static_cast<uint32_t>(drawList.size()),
+        [this, &drawList, geometryPipeline, &pipelineBinds, &indexBufferBinds, &materialChanges](VkCommandBuffer SliceCommandBuffer, uint32_t FirstItem, uint32_t EndItem)
     {
-        checkf(0, "Unable to finish command buffer for geometry pass");
+        SetViewportAndScissor(SliceCommandBuffer, ViewportSize);
+
+        vkCmdBindPipeline(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline);
+        pipelineBinds++;
+        BindlessHeap.Bind(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout);
+
+        // Sorted draws share their mesh with the previous one, its index buffer stays bound
+        const FVertexBuffer* BoundVertexBuffer = nullptr;
+        const FMaterial* PreviousMaterial = nullptr;
+        uint32_t SliceIndexBufferBinds = 0;
+        uint32_t SliceMaterialChanges = 0;
+        for(uint32_t i = FirstItem; i < EndItem; i++)
+        {
+            const FMeshActor* MeshActor = drawList[i];
+            const FVertexBuffer* VertexBuffer = MeshActor->GetVertexBuffer();
+            SliceMaterialChanges += i == FirstItem || MeshActor->GetMaterial() != PreviousMaterial ? 1 : 0;
+            PreviousMaterial = MeshActor->GetMaterial();
+            FDrawConstants DrawConstants;
+            DrawConstants.Transform = MeshActor->GetTransform();
+            DrawConstants.VertexBufferIndex = VertexBuffer->VertexBindlessIndex;
+            DrawConstants.IndexBufferIndex = VertexBuffer->IndexBindlessIndex;
+            DrawConstants.TextureIndex = MeshActor->GetMaterial() ? MeshActor->GetMaterial()->GetTextureIndex() : BINDLESS_INVALID_INDEX;
+            DrawConstants.SamplerIndex = DefaultSamplerIndex;
+            vkCmdPushConstants(SliceCommandBuffer, GBuffer.pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FDrawConstants), &DrawConstants);
+            if(VertexBuffer != BoundVertexBuffer)
+            {
+                vkCmdBindIndexBuffer(SliceCommandBuffer, VertexBuffer->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                BoundVertexBuffer = VertexBuffer;
+                SliceIndexBufferBinds++;
+            }
+            vkCmdDrawIndexed(SliceCommandBuffer, VertexBuffer->IndexBufferSize, 1, 0, 0, 0);
+        }
+        indexBufferBinds += SliceIndexBufferBinds;
+        materialChanges += SliceMaterialChanges;
+    });
+    FrameCounters.PipelineBinds = pipelineBinds;
+    FrameCounters.IndexBufferBinds = indexBufferBinds;
+    FrameCounters.MaterialChanges = materialChanges;
+
+    FrameTiming.RecordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RecordStart).count();
+}
+
+void FRenderer::RenderGeometryPassIndirect(const FRenderGraphPassContext& Context, EGpuCullingPhase Phase)
+{
+    // One indirect draw per batch and phase whatever the number of actors. Both counters add up over the phases like the
+    // draws they record, triangles are counted before culling.
+    const uint32_t batchCount = GpuScene.GetBatchCount();
+    FrameCounters.Draws += batchCount;
+    FrameCounters.Triangles += GpuScene.GetTriangleCount();
+
+    const VkPipeline geometryPipeline = Phase == EGpuCullingPhase::Early
+        ? PipelineStateCache.GetPipeline(GBuffer.EarlyGeometryPipelineDesc, GBuffer.FallbackEarlyGeometryPipeline)
+        : PipelineStateCache.GetPipeline(GBuffer.GeometryPipelineDesc, GBuffer.FallbackGeometryPipeline);
+    CommandRecorder.Record(Context.CommandBuffer, Context.RenderPass, Context.Subpass, Context.Framebuffer, batchCount,
+        [this, geometryPipeline, Phase](VkCommandBuffer SliceCommandBuffer, uint32_t FirstItem, uint32_t EndItem)
+    {
+        SetViewportAndScissor(SliceCommandBuffer, ViewportSize);
+
+        vkCmdBindPipeline(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline);
+        BindlessHeap.Bind(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout);
+        GpuScene.Draw(SliceCommandBuffer, CurrentFrame, Phase, FirstItem, EndItem);
+    });
+}
+
+bool FRenderer::BuildInstancedDraws(const std::vector<const FMeshActor*>& DrawList)
+{
+    SCOPED_ZONE("BuildInstancedDraws");
+    InstancedDraws.clear();
+    InstancedDrawIndices.clear();
+    if(DrawList.empty()) return true;
+
+    FTransientBuffer& transientBuffer = Frames[CurrentFrame].TransientBuffer;
+    const VkDeviceSize transformsSize = DrawList.size() * sizeof(glm::mat4);
+    if(transientBuffer.GetUsedSize() + sizeof(glm::mat4) + transformsSize > transientBuffer.GetSize())
+    {
+        if(!bInstancingOverflowLogged)
+        {
+            LOG_Warning("%u instance transforms don't fit the transient buffer, drawing one actor at a time, raise -transient",
+                static_cast<uint32_t>(DrawList.size()));
+            bInstancingOverflowLogged = true;
+        }
+        return false;
     }
+
+    // Draws in order of their first actor, the instances of a draw keep the draw list's order
+    InstancedDrawSlots.resize(DrawList.size());
+    for(size_t i = 0; i < DrawList.size(); i++)
+    {
+        const FMeshActor* MeshActor = DrawList[i];
+        const auto Found = InstancedDrawIndices.emplace(std::make_pair(MeshActor->GetVertexBuffer(), MeshActor->GetMaterial()),
+            static_cast<uint32_t>(InstancedDraws.size()));
+        if(Found.second)
+        {
+            InstancedDraws.push_back({ MeshActor->GetVertexBuffer(), MeshActor->GetMaterial(), 0, 0 });
+        }
+        InstancedDrawSlots[i] = Found.first->second;
+        InstancedDraws[Found.first->second].InstanceCount++;
+    }
+
+    // Aligned to a whole transform so firstInstance indexes the buffer in transforms
+    const FTransientAllocation allocation = transientBuffer.Allocate(transformsSize, sizeof(glm::mat4));
+    const uint32_t baseInstance = static_cast<uint32_t>(allocation.Offset / sizeof(glm::mat4));
+    uint32_t firstInstance = baseInstance;
+    for(FInstancedDraw& draw : InstancedDraws)
+    {
+        draw.FirstInstance = firstInstance;
+        firstInstance += draw.InstanceCount;
+        // Counted again while the transforms are written
+        draw.InstanceCount = 0;
+    }
+
+    glm::mat4* transforms = static_cast<glm::mat4*>(allocation.Data);
+    for(size_t i = 0; i < DrawList.size(); i++)
+    {
+        FInstancedDraw& draw = InstancedDraws[InstancedDrawSlots[i]];
+        const glm::mat4 transform = DrawList[i]->GetTransform();
+        // Mapped memory is only ever written
+        memcpy(&transforms[draw.FirstInstance - baseInstance + draw.InstanceCount], &transform, sizeof(glm::mat4));
+        draw.InstanceCount++;
+    }
+    return true;
+}
+
+void FRenderer::RenderGeometryPassInstanced(const FRenderGraphPassContext& Context)
+{
+    FrameCounters.Draws = static_cast<uint32_t>(InstancedDraws.size());
+
+    const VkPipeline geometryPipeline = PipelineStateCache.GetPipeline(GBuffer.InstancedGeometryPipelineDesc, GBuffer.FallbackInstancedGeometryPipeline);
+    const uint32_t instanceBufferIndex = Frames[CurrentFrame].TransientBindlessIndex;
+    std::atomic<uint32_t> pipelineBinds(0);
+    std::atomic<uint32_t> indexBufferBinds(0);
+    std::atomic<uint32_t> materialChanges(0);
+    CommandRecorder.Record(Context.CommandBuffer, Context.RenderPass, Context.Subpass, Context.Framebuffer, static_cast<uint32_t>(InstancedDraws.size()),
+        [this, geometryPipeline, instanceBufferIndex, &pipelineBinds, &indexBufferBinds, &materialChanges](VkCommandBuffer SliceCommandBuffer, uint32_t FirstItem, uint32_t EndItem)
+    {
+        SetViewportAndScissor(SliceCommandBuffer, ViewportSize);
+
+        vkCmdBindPipeline(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline);
+        pipelineBinds++;
+        BindlessHeap.Bind(SliceCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout);
+
+        const FVertexBuffer* BoundVertexBuffer = nullptr;
+        uint32_t SliceIndexBufferBinds = 0;
+        uint32_t SliceMaterialChanges = 0;
+        for(uint32_t i = FirstItem; i < EndItem; i++)
+        {
+            const FInstancedDraw& Draw = InstancedDraws[i];
+            SliceMaterialChanges += i == FirstItem || Draw.Material != InstancedDraws[i - 1].Material ? 1 : 0;
+            FInstancedDrawConstants DrawConstants;
+            DrawConstants.VertexBufferIndex = Draw.VertexBuffer->VertexBindlessIndex;
+            DrawConstants.TextureIndex = Draw.Material ? Draw.Material->GetTextureIndex() : BINDLESS_INVALID_INDEX;
+            DrawConstants.SamplerIndex = DefaultSamplerIndex;
+            DrawConstants.InstanceBufferIndex = instanceBufferIndex;
+            vkCmdPushConstants(SliceCommandBuffer, GBuffer.pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FInstancedDrawConstants), &DrawConstants);
+            if(Draw.VertexBuffer != BoundVertexBuffer)
+            {
+                vkCmdBindIndexBuffer(SliceCommandBuffer, Draw.VertexBuffer->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                BoundVertexBuffer = Draw.VertexBuffer;
+                SliceIndexBufferBinds++;
+            }
+            vkCmdDrawIndexed(SliceCommandBuffer, Draw.VertexBuffer->IndexBufferSize, Draw.InstanceCount, 0, 0, Draw.FirstInstance);
+        }
+        indexBufferBinds += SliceIndexBufferBinds;
+        materialChanges += SliceMaterialChanges;
+    });
+    FrameCounters.PipelineBinds = pipelineBinds;
+    FrameCounters.IndexBufferBinds = indexBufferBinds;
+    FrameCounters.MaterialChanges = materialChanges;
 }
 
+void FRenderer::RenderCompositionPass(const FRenderGraphPassContext& Context)
+{
+    SCOPED_ZONE("CompositionPass");
+    const VkCommandBuffer CommandBuffer = Context.CommandBuffer;
+
+    SetViewportAndScissor(CommandBuffer, ViewportSize);
+
+    if(Settings.bSubpassDeferred)
+    {
+        // The frame's ticket was waited on, its set is no longer in use
+        const VkDescriptorSet inputSet = GBuffer.InputAttachmentSets[CurrentFrame];
+        const std::array<FRenderGraphTexture, 4> inputs = { GBuffer.BufferA, GBuffer.BufferB, GBuffer.BufferC, GBuffer.Depth };
+        std::array<VkDescriptorImageInfo, 4> imageInfos = {};
+        std::array<VkWriteDescriptorSet, 4> writes = {};
+        for(uint32_t i = 0; i < inputs.size(); i++)
+        {
+            imageInfos[i].imageView = RenderGraph.GetTexture(inputs[i]).ImageView;
+            // Depth is last
+            imageInfos[i].imageLayout = i == 3 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = inputSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        // Lights still come from the global set, only their constants are used
+        FCompositionConstants compositionConstants = {};
+        compositionConstants.BufferAIndex = BINDLESS_INVALID_INDEX;
+        compositionConstants.BufferBIndex = BINDLESS_INVALID_INDEX;
+        compositionConstants.BufferCIndex = BINDLESS_INVALID_INDEX;
+        compositionConstants.DepthIndex = BINDLESS_INVALID_INDEX;
+        compositionConstants.SamplerIndex = DefaultSamplerIndex;
+        compositionConstants.Lights = LightGrid;
+        compositionConstants.Shadows = Shadows;
+
+        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.CompositionPipeline);
+        BindlessHeap.Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout);
+        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout, 1, 1, &inputSet, 0, nullptr);
+        vkCmdPushConstants(CommandBuffer, GBuffer.pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FCompositionConstants), &compositionConstants);
+        vkCmdDraw(CommandBuffer, 3, 1, 0, 0);
+        return;
+    }
+
+    // Depth is fetched unfiltered, lights are evaluated at the pixel's clip space position
+    FCompositionConstants compositionConstants;
+    compositionConstants.BufferAIndex = RenderGraph.GetTexture(GBuffer.BufferA).BindlessIndex;
+    compositionConstants.BufferBIndex = RenderGraph.GetTexture(GBuffer.BufferB).BindlessIndex;
+    compositionConstants.BufferCIndex = RenderGraph.GetTexture(GBuffer.BufferC).BindlessIndex;
+    compositionConstants.DepthIndex = RenderGraph.GetTexture(GBuffer.Depth).BindlessIndex;
+    compositionConstants.SamplerIndex = DefaultSamplerIndex;
+    compositionConstants.Lights = LightGrid;
+    compositionConstants.Shadows = Shadows;
+
+    vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.CompositionPipeline);
+    BindlessHeap.Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GBuffer.pipelineLayout);
+    vkCmdPushConstants(CommandBuffer, GBuffer.pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FCompositionConstants), &compositionConstants);
+    vkCmdDraw(CommandBuffer, 3, 1, 0, 0);
+}
@@ -1,51 +1,191 @@
 ﻿#pragma once
 #include <SDL2/SDL_vulkan.h>
 #include <vulkan/vulkan_core.h>
+#include <chrono>
+#include <map>
 #include <vector>
+#include "BindlessHeap.h"
+#include "FrameStats.h"
+#include "FrustumCulling.h"
+#include "GpuProfiler.h"
+#include "GpuScene.h"
+#include "GpuTimeline.h"
+#include "LightCulling.h"
+#include "ParallelCommandRecorder.h"
+#include "PipelineCache.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
 #include "RenderResource.h"
+#include "RendererSettings.h"
 #include "MinimalCore.h"
+#include "ShaderCache.h"
+#include "ShadowMaps.h"
+#include "TransientBuffer.h"
+
+// Composition outside the GBuffer render pass samples it through the bindless set, pushed in place of FDrawConstants
+struct FCompositionConstants
+{
+    uint32_t BufferAIndex;
+    uint32_t BufferBIndex;
+    uint32_t BufferCIndex;
+    uint32_t DepthIndex;
+    uint32_t SamplerIndex;
+    FLightGridConstants Lights;
+    FShadowConstants Shadows;
+};
+static_assert(sizeof(FCompositionConstants) <= sizeof(FDrawConstants), "Composition constants must fit the shared push constant range");
+
+// Instanced draws of CPU recorded geometry, pushed in place of FDrawConstants. Must match Shaders/GBufferInstanced.vert
+struct FInstancedDrawConstants
+{
+    uint32_t VertexBufferIndex;
+    uint32_t TextureIndex;
+    uint32_t SamplerIndex;
+    // The frame's transient buffer, firstInstance is the index of the draw's first transform in it
+    uint32_t InstanceBufferIndex;
+};
+static_assert(sizeof(FInstancedDrawConstants) <= sizeof(FDrawConstants), "Instanced draw constants must fit the shared push constant range");
 
 struct FGBuffer
 {
     int32_t Width, Height;
-    VkFramebuffer FrameBuffer;
-    FTexture BufferA;
-    FTexture BufferB;
-    FTexture BufferC;
-    FTexture BufferD;
-    FTexture Depth;
+    // Chosen once at startup, pipelines are specialized for its normal encoding
+    const FGBufferLayout* Layout;
+    VkFormat BufferAFormat;
+    VkFormat BufferBFormat;
+    VkFormat BufferCFormat;
+    VkFormat DepthFormat;
+    // Transient render graph textures, handles are only valid for the graph they were declared in
+    FRenderGraphTexture BufferA;
+    FRenderGraphTexture BufferB;
+    FRenderGraphTexture BufferC;
+    FRenderGraphTexture Depth;
+    // Pipeline compatible description, the graph creates the actual pass with its own load/store ops and layouts
+    FRenderPassDesc RenderPassDesc;
     VkRenderPass RenderPass;
     VkSampler Sampler;
-    VkCommandBuffer GeometryPassCommand;
-    VkSemaphore GeometryPassSemaphore;
     VkDescriptorSetLayout descriptorSetLayout;
+    // Input attachment sets of the lighting subpass, one per frame in flight
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet InputAttachmentSets[MAX_FRAMES_IN_FLIGHT];
     VkPipelineLayout pipelineLayout;
+    FGraphicsPipelineDesc GeometryPipelineDesc;
+    VkPipeline FallbackGeometryPipeline;
+    // Occlusion culling's early geometry pass is a render pass of its own, without the lighting subpass
+    FGraphicsPipelineDesc EarlyGeometryPipelineDesc;
+    VkPipeline FallbackEarlyGeometryPipeline;
+    // CPU recorded draws of several actors at once, transforms come from the frame's transient buffer
+    FGraphicsPipelineDesc InstancedGeometryPipelineDesc;
+    VkPipeline FallbackInstancedGeometryPipeline;
+    VkPipeline CompositionPipeline;
 
     FGBuffer()
     {
         Width = 0;
         Height = 0;
-        FrameBuffer = nullptr;
+        Layout = nullptr;
+        BufferAFormat = VK_FORMAT_UNDEFINED;
+        BufferBFormat = VK_FORMAT_UNDEFINED;
+        BufferCFormat = VK_FORMAT_UNDEFINED;
+        DepthFormat = VK_FORMAT_UNDEFINED;
         RenderPass = nullptr;
         Sampler = nullptr;
-        GeometryPassCommand = VK_NULL_HANDLE;
-        GeometryPassSemaphore = VK_NULL_HANDLE;
+        descriptorPool = VK_NULL_HANDLE;
+        FallbackGeometryPipeline = VK_NULL_HANDLE;
+        FallbackEarlyGeometryPipeline = VK_NULL_HANDLE;
+        FallbackInstancedGeometryPipeline = VK_NULL_HANDLE;
+        CompositionPipeline = VK_NULL_HANDLE;
+    }
+};
+
+// Swapchain and size dependent targets replaced by a resize, destroyed once the frames using them completed
+struct FRetiredSwapChain
+{
+    VkSwapchainKHR SwapChain;
+    std::vector<VkImageView> ImageViews;
+    VkImage DepthImage;
+    VkDeviceMemory DepthImageMemory;
+    VkImageView DepthImageView;
+    // Presents of the old images may still wait on them, the new swapchain gets its own
+    std::vector<VkSemaphore> RenderingFinishedSemaphores;
+    // First frame that didn't render into or present these
+    uint64_t FirstUnusedFrame;
+};
+
+// Everything a frame in flight owns, reused once its ticket is complete
+struct FFrameResources
+{
+    VkCommandPool CommandPool;
+    VkCommandBuffer CommandBuffer;
+    VkSemaphore ImageAvailableSemaphore;
+    // Last submission of the frame on the graphics timeline, it waited for the frame's compute work
+    FGpuTicket Ticket;
+    FTransientBuffer TransientBuffer;
+    // The whole transient buffer as one storage buffer of the global set, shaders index it with allocation offsets
+    uint32_t TransientBindlessIndex;
+    // When the input this frame reacts to was sampled, compared against present and ticket completion
+    std::chrono::steady_clock::time_point InputTime;
+    // Headless frame dumps, the image is copied here and written to disk once the ticket is complete
+    VkBuffer ReadbackBuffer;
+    VkDeviceMemory ReadbackMemory;
+    void* ReadbackData;
+    // Frame number copied into the readback buffer, -1 when there is nothing to write
+    int64_t ReadbackFrameNumber;
+    // Async compute only, graphics batches after the first come from CommandPool, compute work has its own pool.
+    // The compute submit waits for the first batch's ticket, the last batch waits for the compute ticket.
+    VkCommandBuffer BatchCommandBuffers[RENDER_GRAPH_GRAPHICS_BATCHES - 1];
+    VkCommandPool ComputeCommandPool;
+    VkCommandBuffer ComputeCommandBuffer;
+
+    FFrameResources()
+    {
+        CommandPool = VK_NULL_HANDLE;
+        CommandBuffer = VK_NULL_HANDLE;
+        for(VkCommandBuffer& BatchCommandBuffer : BatchCommandBuffers)
+        {
+            BatchCommandBuffer = VK_NULL_HANDLE;
+        }
+        ComputeCommandPool = VK_NULL_HANDLE;
+        ComputeCommandBuffer = VK_NULL_HANDLE;
+        ImageAvailableSemaphore = VK_NULL_HANDLE;
+        TransientBindlessIndex = BINDLESS_INVALID_INDEX;
+        ReadbackBuffer = VK_NULL_HANDLE;
+        ReadbackMemory = VK_NULL_HANDLE;
+        ReadbackData = nullptr;
+        ReadbackFrameNumber = -1;
     }
 };
 
 class FWorld;
+class FMeshActor;
+class FMaterial;
+struct FVertexBuffer;
 class FRenderWindow;
 class FCommandList;
 
+// Visible actors sharing a mesh and a material, recorded as one instanced draw
+struct FInstancedDraw
+{
+    const FVertexBuffer* VertexBuffer;
+    const FMaterial* Material;
+    uint32_t FirstInstance;
+    uint32_t InstanceCount;
+};
+
 class FRenderer
 {
 public:
     FRenderer();
-    void Init(FRenderWindow* RenderWindow);
+    void Init(FRenderWindow* RenderWindow, const FRendererSettings& InSettings = FRendererSettings());
     void RenderLoop();
+    // Renders one frame, false once the window was closed
+    bool RenderFrame();
     void Shutdown();
 
     VkImageView CreateImageView(VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags);
+    // Evicts cached framebuffers using the view before destroying it
+    void DestroyImageView(VkImageView ImageView);
     void CreateImage(uint32_t Width, uint32_t Height, VkFormat Format, VkImageTiling Tiling, VkImageUsageFlags ImageUsageFlags, VkMemoryPropertyFlags MemoryPropertyFlags, VkImage& Image, VkDeviceMemory& ImageMemory);
     static uint32_t FindMemoryType(const VkPhysicalDevice& PhysicalDevice, uint32_t TypeFilter, VkMemoryPropertyFlags MemoryPropertyFlags);
     uint32_t GetMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *memTypeFound = nullptr) const;
@@ -54,10 +194,16 @@ public:
     VkDevice& GetDevice();
     VkPhysicalDevice& GetPhysicalDevice();
     VkSwapchainKHR& GetSwapChain();
-    VkSemaphore& GetImageAvailableSemaphore();
-    VkSemaphore& GetRenderingFinishedSemaphore();
-    std::vector<VkFence>& GetFences();
-    std::vector<VkCommandBuffer>& GetCommandBuffers();
+    FFrameResources& GetCurrentFrame();
+    uint32_t GetCurrentFrameIndex() const;
+    // Signaled by the submit that renders into the swapchain image, waited on by its present
+    VkSemaphore& GetRenderingFinishedSemaphore(uint32_t ImageIndex);
+    const FRendererSettings& GetSettings() const;
+    const FGBuffer& GetGBuffer() const;
+    // Rendering into offscreen targets, there is no surface, swapchain or present
+    bool IsHeadless() const;
+    // Recreated before the next acquire, after a resize or a suboptimal or out of date result
+    void InvalidateSwapChain();
     std::vector<VkImage>& GetSwapChainImages();
     VkCommandPool& GetCommandPool();
     VkRenderPass& GetRenderPass();
@@ -65,6 +211,37 @@ public:
     VkExtent2D& GetViewportSize();
     VkQueue& GetGraphicsQueue();
     VkQueue& GetPresentQueue();
+    uint32_t GetGraphicsQueueFamily() const;
+    // Dedicated compute family without graphics, render graph passes marked async run there
+    bool HasAsyncCompute() const;
+    VkQueue& GetComputeQueue();
+    // Dedicated transfer family without graphics or compute, uploads are copied there and acquired by the graphics queue
+    bool HasTransferQueue() const;
+    // Geometry drawn from the indirect commands of the GPU culling pass
+    bool HasGpuDrivenDraws() const;
+    // GPU driven draws also culled against a depth pyramid, in an early and a late geometry pass
+    bool HasOcclusionCulling() const;
+    // CPU recorded draws grouped into instanced draws
+    bool HasInstancing() const;
+    VkQueue& GetTransferQueue();
+    uint32_t GetTransferQueueFamily() const;
+    VkCommandPool& GetTransferCommandPool();
+    // Every submission goes through it, tickets tell when the GPU is done with what it used
+    FGpuTimeline& GetGpuTimeline();
+    FBindlessHeap& GetBindlessHeap();
+    FShaderCache& GetShaderCache();
+    FPipelineCache& GetPipelineCache();
+    FPipelineStateCache& GetPipelineStateCache();
+    FRenderPassCache& GetRenderPassCache();
+    FGpuProfiler& GetGpuProfiler();
+    // Valid from the end of a frame until the next one begins
+    const FFrameTiming& GetLastFrameTiming() const;
+    const FFrameCounters& GetLastFrameCounters() const;
+    // Threads recording the draw list from the next frame on, at most as many as Settings.RecordThreads allowed at init
+    void SetRecordThreads(uint32_t Threads);
+    uint32_t GetRecordThreads() const;
+    uint32_t GetMaxRecordThreads() const;
+    VkSampler GetDefaultSampler() const;
     static FCommandList& GetCommandList();
 
 private:
@@ -74,20 +251,51 @@ private:
     void SelectPhysicalDevice();
     void SelectQueueFamily();
     void CreateDevice();
-    void CreateSwapChain();
+    void CreateSwapChain(VkSwapchainKHR OldSwapChain = VK_NULL_HANDLE);
+    // Replaces the swapchain and size dependent targets without idling the device, false while the window is minimized
+    bool RecreateSwapChain();
+    void RetireSwapChain();
+    void ReleaseRetiredSwapChains(bool bAll);
+    // Headless stand-in for the swapchain, one image per frame in flight
+    void CreateOffscreenTargets();
+    void DestroyOffscreenTargets();
     void SetupDepthStencil();
     void CreateRenderPass();
     void CreateFrameBuffers();
     void CreateCommandPool();
-    void CreateCommandBuffers();
-    void CreateSemaphores();
-    void CreateFences();
+    void CreateFrameResources();
+    void DestroyFrameResources();
+    void CreateBindlessHeap();
+    void CreatePipelineCache();
     void CreateGBuffer();
 
     void CreateSemaphore(VkSemaphore *Semaphore);
 
     // Render
-    void RenderGeometryPass();
+    void BeginFrame();
+    void SampleInput(bool& bOutQuit);
+    void LimitFrameRate();
+    void EndFrame();
+    // Captures Settings.TraceFrames frames of CPU zones and GPU scopes into Saved/Trace.json
+    void StartTrace();
+    void WriteTraceIfComplete();
+    // Headless frame dumps, the copy is recorded after the graph and written after the frame's ticket wait
+    void CopyFrameToReadback();
+    void WriteFrameDump(FFrameResources& Frame);
+    void BuildRenderGraph();
+    // Bounds and sort keys of the world's mesh actors, gathered again whenever the world's actors change
+    void UpdateActorBounds();
+    // Mesh actors of the world inside the view, sorted by state unless disabled
+    void CullActors(std::vector<const FMeshActor*>& OutDrawList);
+    // Phase is ignored by CPU recorded draws
+    void RenderGeometryPass(const FRenderGraphPassContext& Context, EGpuCullingPhase Phase);
+    // GPU driven, draws what the instance culling pass of the phase wrote
+    void RenderGeometryPassIndirect(const FRenderGraphPassContext& Context, EGpuCullingPhase Phase);
+    // Groups the draw list into InstancedDraws and writes the transforms to the frame's transient buffer, false when
+    // they don't fit and every actor has to be drawn on its own
+    bool BuildInstancedDraws(const std::vector<const FMeshActor*>& DrawList);
+    void RenderGeometryPassInstanced(const FRenderGraphPassContext& Context);
+    void RenderCompositionPass(const FRenderGraphPassContext& Context);
 
 private:
     bool bInitialized;
@@ -101,40 +309,110 @@ private:
     VkPhysicalDevice PhysicalDevice;
     uint32_t graphics_QueueFamilyIndex;
     uint32_t present_QueueFamilyIndex;
+    // VK_QUEUE_FAMILY_IGNORED when the device has no such family or the settings disabled it
+    uint32_t compute_QueueFamilyIndex;
+    uint32_t transfer_QueueFamilyIndex;
+    uint32_t computeTimestampValidBits;
+    bool bGraphicsPipelineLibrary;
+    bool bGraphicsPipelineLibraryFastLinking;
+    bool bPipelineStatisticsQuery;
+    // Settings.bGpuCulling and the device supports indirect draws with a count
+    bool bGpuDrivenDraws;
+    bool bOcclusionCulling;
+    // Settings.bInstancing without GPU driven draws, which already draw one batch per mesh
+    bool bInstancing;
     
     VkDevice Device;
     VkQueue GraphicsQueue;
     VkQueue PresentQueue;
+    VkQueue ComputeQueue;
+    VkQueue TransferQueue;
+    FGpuTimeline GpuTimeline;
 
     VkSwapchainKHR SwapChain;
     VkExtent2D ViewportSize;
     uint32_t SwapChainImageCount;
     std::vector<VkImage> SwapChainImages;
     std::vector<VkImageView> SwapChainImagesViews;
+    // Imported into the render graph, which tracks their layout between frames
+    std::vector<FTexture> SwapChainTextures;
+    bool bSwapChainDirty;
+    std::vector<FRetiredSwapChain> RetiredSwapChains;
     VkFormat DepthFormat;
     VkImage DepthImage;
     VkDeviceMemory DepthImageMemory;
     VkImageView DepthImageView;
 
+    FRenderPassCache RenderPassCache;
+    FRenderPassDesc MainPassDesc;
     VkRenderPass RenderPass;
     std::vector<VkFramebuffer> SwapChainFrameBuffers;
     
+    // One-off uploads, frames record into their own pools
     VkCommandPool CommandPool;
-    std::vector<VkCommandBuffer> CommandBuffers;
+    VkCommandPool TransferCommandPool;
 
-    VkSemaphore ImageAvailableSemaphore;
-    VkSemaphore RenderingFinishedSemaphore;
+    FRendererSettings Settings;
+    std::vector<FFrameResources> Frames;
+    uint32_t CurrentFrame;
+    uint64_t FrameNumber;
+    std::vector<VkSemaphore> RenderingFinishedSemaphores;
+    FParallelCommandRecorder CommandRecorder;
+    FFrameStats FrameStats;
+    std::chrono::steady_clock::time_point LastFrameStart;
+    FFrameTiming FrameTiming;
+    FFrameCounters FrameCounters;
+    double GpuLatencyMs;
+    char FrameStatsModeName[64];
+    VkPresentModeKHR PresentMode;
 
-    std::vector<VkFence> Fences;
     std::vector<const char*> validationLayers;
 
+    FBindlessHeap BindlessHeap;
+    VkSampler DefaultSampler;
+    uint32_t DefaultSamplerIndex;
+
+    FShaderCache ShaderCache;
+    FPipelineCache PipelineCache;
+    FPipelineStateCache PipelineStateCache;
+
+    FRenderGraph RenderGraph;
+    bool bRenderGraphDumped;
+    FGpuProfiler GpuProfiler;
+    bool bTraceCapturing;
+
+    FGpuScene GpuScene;
+    FDepthPyramid DepthPyramid;
+    // CPU recorded draws and shadow casters, world space bounds of every valid mesh actor, index for index with BoundedActors
+    FCullingBounds ActorBounds;
+    std::vector<const FMeshActor*> BoundedActors;
+    uint32_t ActorBoundsRevision;
+    bool bActorBoundsBuilt;
+    FCullingView MainView;
+    // Material, mesh and depth of each bounded actor packed by MakeDrawSortKey, the visible ones are sorted
+    // into the draw list with their indices
+    std::vector<uint64_t> ActorSortKeys;
+    std::vector<uint64_t> DrawSortKeys;
+    std::vector<uint32_t> DrawSortIndices;
+    std::vector<uint64_t> DrawSortScratchKeys;
+    std::vector<uint32_t> DrawSortScratchIndices;
+    // Instanced draws of the frame being recorded and the draw each pair of mesh and material goes to
+    std::vector<FInstancedDraw> InstancedDraws;
+    std::map<std::pair<const FVertexBuffer*, const FMaterial*>, uint32_t> InstancedDrawIndices;
+    // Per actor of the draw list, the index of its draw in InstancedDraws
+    std::vector<uint32_t> InstancedDrawSlots;
+    bool bInstancingOverflowLogged;
+    FLightCulling LightCulling;
+    // Lights of the frame being built, composition pushes them with the cluster buffer the culling pass fills
+    FLightGridConstants LightGrid;
+    FShadowCascades ShadowCascades;
+    // Light direction and cascades of the frame being built, in its transient buffer
+    FShadowConstants Shadows;
+
 
     FWorld* World;
     
     static FCommandList CmdList;
 
-    uint32_t FrameIndex;
-    VkCommandBuffer CommandBuffer;
-
     FGBuffer GBuffer;
 };
@@ -0,0 +1,228 @@
+#include "RendererSettings.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+FRendererSettings::FRendererSettings()
+{
+    FramesInFlight = 2;
+    TransientBufferSize = 4 * 1024 * 1024;
+    FrameStatsInterval = 5.0f;
+    PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    bLowLatency = false;
+    MaxFrameRate = 0.0f;
+    RecordThreads = 0;
+    MinDrawsPerSlice = 64;
+    bDumpRenderGraph = false;
+    bAsyncCompute = true;
+    bTransferQueue = true;
+    bSubpassDeferred = true;
+    GBufferLayout = EGBufferLayout::Auto;
+    bClusteredLighting = true;
+    bGpuCulling = true;
+    bOcclusionCulling = true;
+    bInstancing = true;
+    bSortDraws = true;
+    bShadows = true;
+    ShadowCascadeCount = 4;
+    ShadowMapSize = 2048;
+    ShadowCachedCascades = 2;
+    ShadowCascadeBudget = 1;
+    bGpuProfiler = true;
+    bGpuPipelineStatistics = false;
+    TraceFrames = 120;
+    bTraceOnStart = false;
+    bHeadless = false;
+    HeadlessWidth = 1920;
+    HeadlessHeight = 1080;
+    MaxFrames = 0;
+    DumpFrameInterval = 0;
+    ResizeStormInterval = 0;
+}
+
+static const struct
+{
+    const char* Name;
+    VkPresentModeKHR Mode;
+} PresentModeNames[] = {
+    { "fifo", VK_PRESENT_MODE_FIFO_KHR },
+    { "relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR },
+    { "mailbox", VK_PRESENT_MODE_MAILBOX_KHR },
+    { "immediate", VK_PRESENT_MODE_IMMEDIATE_KHR }
+};
+
+const char* FRendererSettings::GetPresentModeName(VkPresentModeKHR Mode)
+{
+    for(const auto& Entry : PresentModeNames)
+    {
+        if(Entry.Mode == Mode) return Entry.Name;
+    }
+    return "unknown";
+}
+
+static const char* GetOptionValue(const char* Argument, const char* Option)
+{
+    const size_t Length = strlen(Option);
+    return strncmp(Argument, Option, Length) == 0 ? Argument + Length : nullptr;
+}
+
+FRendererSettings FRendererSettings::FromCommandLine(int Argc, char* Argv[])
+{
+    FRendererSettings Settings;
+    for(int i = 1; i < Argc; i++)
+    {
+        if(const char* Value = GetOptionValue(Argv[i], "-frames="))
+        {
+            Settings.FramesInFlight = static_cast<uint32_t>(std::clamp(atoi(Value), 1, MAX_FRAMES_IN_FLIGHT));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-transient="))
+        {
+            Settings.TransientBufferSize = static_cast<uint32_t>(std::max(atoi(Value), 1)) * 1024 * 1024;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-stats="))
+        {
+            Settings.FrameStatsInterval = std::max(static_cast<float>(atof(Value)), 0.0f);
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-present="))
+        {
+            for(const auto& Entry : PresentModeNames)
+            {
+                if(strcmp(Value, Entry.Name) == 0) Settings.PresentMode = Entry.Mode;
+            }
+        }
+        else if(strcmp(Argv[i], "-lowlatency") == 0)
+        {
+            Settings.bLowLatency = true;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-fpslimit="))
+        {
+            Settings.MaxFrameRate = std::max(static_cast<float>(atof(Value)), 0.0f);
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-recordthreads="))
+        {
+            Settings.RecordThreads = static_cast<uint32_t>(std::max(atoi(Value), 0));
+        }
+        else if(strcmp(Argv[i], "-dumpgraph") == 0)
+        {
+            Settings.bDumpRenderGraph = true;
+        }
+        else if(strcmp(Argv[i], "-noasynccompute") == 0)
+        {
+            Settings.bAsyncCompute = false;
+        }
+        else if(strcmp(Argv[i], "-notransferqueue") == 0)
+        {
+            Settings.bTransferQueue = false;
+        }
+        else if(strcmp(Argv[i], "-nosubpasses") == 0)
+        {
+            Settings.bSubpassDeferred = false;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-gbuffer="))
+        {
+            FGBufferLayout::Parse(Value, Settings.GBufferLayout);
+        }
+        else if(strcmp(Argv[i], "-noclusters") == 0)
+        {
+            Settings.bClusteredLighting = false;
+        }
+        else if(strcmp(Argv[i], "-nogpuculling") == 0)
+        {
+            Settings.bGpuCulling = false;
+        }
+        else if(strcmp(Argv[i], "-noocclusion") == 0)
+        {
+            Settings.bOcclusionCulling = false;
+        }
+        else if(strcmp(Argv[i], "-noinstancing") == 0)
+        {
+            Settings.bInstancing = false;
+        }
+        else if(strcmp(Argv[i], "-nodrawsort") == 0)
+        {
+            Settings.bSortDraws = false;
+        }
+        else if(strcmp(Argv[i], "-noshadows") == 0)
+        {
+            Settings.bShadows = false;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-cascades="))
+        {
+            Settings.ShadowCascadeCount = static_cast<uint32_t>(std::max(atoi(Value), 1));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-shadowsize="))
+        {
+            Settings.ShadowMapSize = static_cast<uint32_t>(std::clamp(atoi(Value), 256, 8192));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-cachedcascades="))
+        {
+            Settings.ShadowCachedCascades = static_cast<uint32_t>(std::max(atoi(Value), 0));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-shadowbudget="))
+        {
+            Settings.ShadowCascadeBudget = static_cast<uint32_t>(std::max(atoi(Value), 1));
+        }
+        else if(strcmp(Argv[i], "-nogpuprofiler") == 0)
+        {
+            Settings.bGpuProfiler = false;
+        }
+        else if(strcmp(Argv[i], "-gpustats") == 0)
+        {
+            Settings.bGpuPipelineStatistics = true;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-trace="))
+        {
+            Settings.TraceFrames = static_cast<uint32_t>(std::max(atoi(Value), 1));
+            Settings.bTraceOnStart = true;
+        }
+        else if(strcmp(Argv[i], "-trace") == 0)
+        {
+            Settings.bTraceOnStart = true;
+        }
+        else if(strcmp(Argv[i], "-headless") == 0)
+        {
+            Settings.bHeadless = true;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-resolution="))
+        {
+            int Width = 0;
+            int Height = 0;
+            if(sscanf(Value, "%dx%d", &Width, &Height) == 2 && Width > 0 && Height > 0)
+            {
+                Settings.HeadlessWidth = static_cast<uint32_t>(Width);
+                Settings.HeadlessHeight = static_cast<uint32_t>(Height);
+            }
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-framecount="))
+        {
+            Settings.MaxFrames = static_cast<uint32_t>(std::max(atoi(Value), 0));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-dumpframes="))
+        {
+            Settings.DumpFrameInterval = static_cast<uint32_t>(std::max(atoi(Value), 1));
+        }
+        else if(strcmp(Argv[i], "-dumpframes") == 0)
+        {
+            Settings.DumpFrameInterval = 1;
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-resizestorm="))
+        {
+            Settings.ResizeStormInterval = static_cast<uint32_t>(std::max(atoi(Value), 1));
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-scene="))
+        {
+            FBenchmarkScene::Parse(Value, Settings.Scene);
+        }
+        else if(const char* Value = GetOptionValue(Argv[i], "-seed="))
+        {
+            Settings.Scene.Seed = static_cast<uint32_t>(strtoul(Value, nullptr, 10));
+        }
+    }
+
+    if(Settings.bLowLatency)
+    {
+        Settings.FramesInFlight = 1;
+    }
+    return Settings;
+}
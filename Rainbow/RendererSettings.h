@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "BenchmarkScene.h"
+#include "GBufferLayout.h"
+
+#define MAX_FRAMES_IN_FLIGHT 4
+
+// Startup options of the renderer, filled from the command line by main
+struct FRendererSettings
+{
+    // Frames the CPU may record ahead of the GPU, each one owns its command pool, sync objects and transient buffer
+    uint32_t FramesInFlight;
+    uint32_t TransientBufferSize;
+    // Seconds between frame time reports in the log, 0 disables them
+    float FrameStatsInterval;
+
+    // Falls back to FIFO, the only mode every surface supports, when the requested one isn't available
+    VkPresentModeKHR PresentMode;
+    // One frame in flight and the frame wait moved right before input sampling, trades throughput for latency. FromCommandLine
+    // sets FramesInFlight to 1 with it
+    bool bLowLatency;
+    // CPU side frame limiter in frames per second, 0 disables it
+    float MaxFrameRate;
+
+    // Threads recording the draw list in parallel (job workers plus the render thread), 0 uses all of them
+    uint32_t RecordThreads;
+    // Smaller draw lists are recorded by fewer threads, a slice below this isn't worth a secondary buffer
+    uint32_t MinDrawsPerSlice;
+
+    // Writes the first frame's render graph to Saved/RenderGraph.dot
+    bool bDumpRenderGraph;
+
+    // Render graph passes marked async, light culling, run on a compute only queue family when the device has one
+    bool bAsyncCompute;
+    // Uploads go through a transfer only queue family when the device has one
+    bool bTransferQueue;
+    // Lighting is a subpass of the GBuffer render pass reading it through input attachments, the GBuffer never has to
+    // leave tile memory. Off it's sampled by a separate pass, to compare frame times.
+    bool bSubpassDeferred;
+    // GBuffer formats and normal encoding, Auto picks from the device and the resolution at startup
+    EGBufferLayout GBufferLayout;
+    // Lights are binned into clusters by a compute pass and lighting only evaluates the pixel's cluster. Off every pixel
+    // loops over every light, to compare frame times.
+    bool bClusteredLighting;
+    // Instances are frustum culled by a compute pass that writes the geometry pass's indirect draws. Off, or when the device
+    // can't draw indirect with a count, the CPU records one draw per actor.
+    bool bGpuCulling;
+    // With GPU culling, instances are also tested against a depth pyramid in two phases: what was visible last frame is
+    // drawn first, the pyramid is built from its depth, then the rest is tested against it
+    bool bOcclusionCulling;
+    // CPU recorded draws group the visible actors sharing a mesh and a material into one instanced draw, their transforms
+    // written to the frame's transient buffer. Off it's one draw per actor, to compare draw counts and CPU time.
+    bool bInstancing;
+    // CPU recorded draws are sorted on a 64 bit key of pipeline, material, mesh and depth so consecutive draws share
+    // state. Off they're recorded in the world's actor order, to compare state changes and CPU time.
+    bool bSortDraws;
+    // Directional light shadows from cascaded shadow maps, cascades split the view's depth range near to far
+    bool bShadows;
+    // Clamped to SHADOW_MAX_CASCADES
+    uint32_t ShadowCascadeCount;
+    // Width and height of every cascade's depth map
+    uint32_t ShadowMapSize;
+    // The farthest cascades are kept from frame to frame and only re-rendered when the world or the light changes,
+    // scrolling with the view renders just the texels it uncovers. The nearer ones are re-rendered every frame.
+    uint32_t ShadowCachedCascades;
+    // Cached cascades fully re-rendered in one frame at most, the others keep their previous contents a while longer
+    uint32_t ShadowCascadeBudget;
+
+    // Timestamp queries around every render graph pass, reported with the frame stats
+    bool bGpuProfiler;
+    // Adds pipeline statistics queries when the device supports them
+    bool bGpuPipelineStatistics;
+    // Frames of CPU zones and GPU scopes written to Saved/Trace.json per capture, F12 starts one
+    uint32_t TraceFrames;
+    // Captures from startup, init and load zones included
+    bool bTraceOnStart;
+
+    // No window, surface or swapchain, frames are rendered into offscreen targets of HeadlessWidth x HeadlessHeight
+    bool bHeadless;
+    uint32_t HeadlessWidth;
+    uint32_t HeadlessHeight;
+    // Quits after this many frames, 0 runs until the window is closed
+    uint32_t MaxFrames;
+    // Headless only, writes every Nth frame to Saved/Frames as PPM, 0 disables it
+    uint32_t DumpFrameInterval;
+    // Windowed only, resizes the window every N frames to measure swapchain recreation hitches, 0 disables it
+    uint32_t ResizeStormInterval;
+
+    // Generated scene loaded in place of the regular world
+    FBenchmarkSceneDesc Scene;
+
+    FRendererSettings();
+
+    // -frames=N, -transient=MB, -stats=Seconds, -present=fifo|relaxed|mailbox|immediate, -lowlatency, -fpslimit=N,
+    // -recordthreads=N, -dumpgraph, -nogpuprofiler, -gpustats, -trace[=Frames], -headless, -resolution=WxH, -framecount=N,
+    // -dumpframes[=Interval], -scene=instances|unique|materials|lights|mixed[:Count], -seed=N, -resizestorm=N, -noasynccompute, -notransferqueue,
+    // -nosubpasses, -gbuffer=auto|wide|compact|pairs|small, -noclusters, -nogpuculling,
+    // -noocclusion, -noinstancing, -nodrawsort, -noshadows, -cascades=N, -shadowsize=N, -cachedcascades=N, -shadowbudget=N
+    static FRendererSettings FromCommandLine(int Argc, char* Argv[]);
+    static const char* GetPresentModeName(VkPresentModeKHR Mode);
+};
@@ -0,0 +1,81 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+FShaderCache::FShaderCache()
+{
+    Device = VK_NULL_HANDLE;
+}
+
+void FShaderCache::Init(VkDevice InDevice)
+{
+    Device = InDevice;
+}
+
+void FShaderCache::Shutdown()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for(auto& Module : Modules)
+    {
+        vkDestroyShaderModule(Device, Module.second, nullptr);
+    }
+    Modules.clear();
+    PathToHash.clear();
+}
+
+VkShaderModule FShaderCache::LoadShader(const std::string& FilePath)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    const auto CachedPath = PathToHash.find(FilePath);
+    if(CachedPath != PathToHash.end())
+    {
+        return Modules[CachedPath->second];
+    }
+
+    FMappedFile File;
+    if(!File.Open(FilePath) || File.GetSize() % sizeof(uint32_t) != 0)
+    {
+        LOG_Error("FShaderCache: unable to load SPIR-V %s", FilePath.c_str());
+        checkf(0, "FShaderCache: unable to load SPIR-V");
+    }
+
+    const uint64_t Hash = HashBytes(File.GetData(), File.GetSize());
+    PathToHash[FilePath] = Hash;
+
+    const auto CachedModule = Modules.find(Hash);
+    if(CachedModule != Modules.end())
+    {
+        return CachedModule->second;
+    }
+
+    VkShaderModuleCreateInfo CreateInfo = {};
+    CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    CreateInfo.codeSize = File.GetSize();
+    CreateInfo.pCode = reinterpret_cast<const uint32_t*>(File.GetData());
+
+    VkShaderModule Module = VK_NULL_HANDLE;
+    if(vkCreateShaderModule(Device, &CreateInfo, nullptr, &Module) != VK_SUCCESS)
+    {
+        checkf(0, "FShaderCache: unable to create shader module");
+    }
+    Modules[Hash] = Module;
+    return Module;
+}
+
+VkPipelineShaderStageCreateInfo FShaderCache::LoadShaderStage(const std::string& FilePath, VkShaderStageFlagBits Stage)
+{
+    VkPipelineShaderStageCreateInfo ShaderStage = {};
+    ShaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    ShaderStage.stage = Stage;
+    ShaderStage.module = LoadShader(FilePath);
+    ShaderStage.pName = "main";
+    return ShaderStage;
+}
+
+uint64_t FShaderCache::GetShaderHash(const std::string& FilePath)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const auto CachedPath = PathToHash.find(FilePath);
+    return CachedPath != PathToHash.end() ? CachedPath->second : 0;
+}
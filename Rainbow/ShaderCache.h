@@ -0,0 +1,29 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+
+// Shader modules keyed by a hash of their SPIR-V, files are memory mapped so loading never copies the bytecode.
+// Two paths with identical bytecode share one module.
+class FShaderCache
+{
+public:
+    FShaderCache();
+
+    void Init(VkDevice InDevice);
+    void Shutdown();
+
+    VkShaderModule LoadShader(const std::string& FilePath);
+    VkPipelineShaderStageCreateInfo LoadShaderStage(const std::string& FilePath, VkShaderStageFlagBits Stage);
+
+    // Content hash of an already loaded file, 0 when unknown
+    uint64_t GetShaderHash(const std::string& FilePath);
+
+private:
+    VkDevice Device;
+    std::unordered_map<std::string, uint64_t> PathToHash;
+    std::unordered_map<uint64_t, VkShaderModule> Modules;
+    std::mutex Mutex;
+};
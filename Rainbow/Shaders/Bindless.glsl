@@ -0,0 +1,24 @@
+// Global bindless set, must match EBindlessBinding in BindlessHeap.h
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFFu
+
+layout(set = 0, binding = 0) uniform texture2D GlobalTextures[];
+layout(set = 0, binding = 1) uniform sampler GlobalSamplers[];
+layout(set = 0, binding = 2, std430) readonly buffer FGlobalFloatBuffer { float Data[]; } GlobalFloatBuffers[];
+layout(set = 0, binding = 2, std430) readonly buffer FGlobalUintBuffer { uint Data[]; } GlobalUintBuffers[];
+#ifdef BINDLESS_WRITABLE_BUFFERS
+// Compute passes writing their output through the global set
+layout(set = 0, binding = 2, std430) buffer FGlobalRWUintBuffer { uint Data[]; } GlobalRWUintBuffers[];
+#endif
+
+vec4 SampleBindless(uint TextureIndex, uint SamplerIndex, vec2 UV)
+{
+    return texture(sampler2D(GlobalTextures[nonuniformEXT(TextureIndex)], GlobalSamplers[nonuniformEXT(SamplerIndex)]), UV);
+}
+
+// Unfiltered, for formats like depth that can't always be sampled linearly
+vec4 FetchBindless(uint TextureIndex, uint SamplerIndex, ivec2 Texel)
+{
+    return texelFetch(sampler2D(GlobalTextures[nonuniformEXT(TextureIndex)], GlobalSamplers[nonuniformEXT(SamplerIndex)]), Texel, 0);
+}
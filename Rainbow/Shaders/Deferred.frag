@@ -0,0 +1,35 @@
+#version 460
+#include "Bindless.glsl"
+#include "GBufferEncoding.glsl"
+#include "Lights.glsl"
+#include "Shadows.glsl"
+
+// Must match FCompositionConstants in Renderer.h
+layout(push_constant) uniform FCompositionConstants
+{
+    uint BufferAIndex;
+    uint BufferBIndex;
+    uint BufferCIndex;
+    uint DepthIndex;
+    uint SamplerIndex;
+    FLightGrid Lights;
+    FShadows Shadows;
+} Composition;
+
+layout(location = 0) in vec2 InUV;
+layout(location = 0) out vec4 OutColor;
+
+void main()
+{
+    const vec3 Albedo = SampleBindless(Composition.BufferAIndex, Composition.SamplerIndex, InUV).rgb;
+    const vec3 Normal = DecodeGBufferNormal(SampleBindless(Composition.BufferBIndex, Composition.SamplerIndex, InUV));
+    const FGBufferMaterial Material = DecodeGBufferMaterial(SampleBindless(Composition.BufferCIndex, Composition.SamplerIndex, InUV));
+
+    const float Depth = FetchBindless(Composition.DepthIndex, Composition.SamplerIndex, ivec2(gl_FragCoord.xy)).r;
+
+    const vec3 LightDirection = LoadLightDirection(Composition.Shadows);
+    // The cleared background has nothing to shadow
+    const float Shadow = Depth < 1.0 ? GetShadow(Composition.Shadows, vec3(InUV * 2.0 - 1.0, Depth), Depth) : 1.0;
+    const vec3 Diffuse = vec3(max(dot(Normal, LightDirection), 0.0) * Shadow) + AccumulateLights(Composition.Lights, InUV, Depth, Normal);
+    OutColor = vec4(Albedo * (0.1 * Material.Occlusion + Diffuse), 1.0);
+}
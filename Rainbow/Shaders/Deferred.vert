@@ -0,0 +1,10 @@
+#version 460
+
+layout(location = 0) out vec2 OutUV;
+
+void main()
+{
+    // Fullscreen triangle, no vertex buffer needed
+    OutUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(OutUV * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 460
+#include "Bindless.glsl"
+#include "GBufferEncoding.glsl"
+#include "Lights.glsl"
+#include "Shadows.glsl"
+
+// Subpass 1 of the GBuffer render pass, must match the input attachments FRenderer::CreateGBuffer declares
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput GBufferA;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput GBufferB;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput GBufferC;
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput GBufferDepth;
+
+// Same layout as FCompositionConstants in Renderer.h, only the lights and shadows are used here
+layout(push_constant) uniform FCompositionConstants
+{
+    uint BufferAIndex;
+    uint BufferBIndex;
+    uint BufferCIndex;
+    uint DepthIndex;
+    uint SamplerIndex;
+    FLightGrid Lights;
+    FShadows Shadows;
+} Composition;
+
+layout(location = 0) in vec2 InUV;
+layout(location = 0) out vec4 OutColor;
+
+void main()
+{
+    const vec3 Albedo = subpassLoad(GBufferA).rgb;
+    const vec3 Normal = DecodeGBufferNormal(subpassLoad(GBufferB));
+    const FGBufferMaterial Material = DecodeGBufferMaterial(subpassLoad(GBufferC));
+
+    const float Depth = subpassLoad(GBufferDepth).r;
+
+    const vec3 LightDirection = LoadLightDirection(Composition.Shadows);
+    // The cleared background has nothing to shadow
+    const float Shadow = Depth < 1.0 ? GetShadow(Composition.Shadows, vec3(InUV * 2.0 - 1.0, Depth), Depth) : 1.0;
+    const vec3 Diffuse = vec3(max(dot(Normal, LightDirection), 0.0) * Shadow) + AccumulateLights(Composition.Lights, InUV, Depth, Normal);
+    OutColor = vec4(Albedo * (0.1 * Material.Occlusion + Diffuse), 1.0);
+}
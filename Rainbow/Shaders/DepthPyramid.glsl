@@ -0,0 +1,58 @@
+// Min/max depth pyramid packed level after level in a storage buffer, must match DepthPyramid.h. Needs Bindless.glsl.
+// Level 0 is half the depth buffer rounded up, each texel of level L covers 2^(L+1) depth pixels on each axis.
+// Texels are two floats: the nearest and the farthest depth under them.
+
+uvec2 GetPyramidLevelSize(uvec2 Size, uint Level)
+{
+    return (Size + (1u << Level) - 1u) >> Level;
+}
+
+// In texels from the start of the buffer
+uint GetPyramidLevelOffset(uvec2 Size, uint Level)
+{
+    uint Offset = 0u;
+    for(uint i = 0u; i < Level; i++)
+    {
+        const uvec2 LevelSize = GetPyramidLevelSize(Size, i);
+        Offset += LevelSize.x * LevelSize.y;
+    }
+    return Offset;
+}
+
+float LoadPyramidMaxDepth(uint BufferIndex, uvec2 Size, uint Level, uint LevelOffset, uvec2 Texel)
+{
+    const uvec2 LevelSize = GetPyramidLevelSize(Size, Level);
+    const uint Index = LevelOffset + min(Texel.y, LevelSize.y - 1u) * LevelSize.x + min(Texel.x, LevelSize.x - 1u);
+    return GlobalFloatBuffers[BufferIndex].Data[Index * 2u + 1u];
+}
+
+// Clip space sphere entirely behind what the pyramid covers. Picks the finest level where the sphere's rectangle spans at
+// most 2x2 texels and compares the sphere's nearest depth with the farthest depth under them.
+bool IsSphereOccluded(vec4 Sphere, uint BufferIndex, uvec2 Size, uint LevelCount, uvec2 DepthSize)
+{
+    const float NearestDepth = Sphere.z - Sphere.w;
+    if(NearestDepth <= 0.0)
+    {
+        return false;
+    }
+
+    const vec2 UVMin = clamp((Sphere.xy - Sphere.w) * 0.5 + 0.5, 0.0, 1.0);
+    const vec2 UVMax = clamp((Sphere.xy + Sphere.w) * 0.5 + 0.5, 0.0, 1.0);
+    const uvec2 PixelMin = min(uvec2(UVMin * vec2(DepthSize)), DepthSize - 1u);
+    const uvec2 PixelMax = min(uvec2(UVMax * vec2(DepthSize)), DepthSize - 1u);
+
+    uint Level = 0u;
+    while(Level + 1u < LevelCount && any(greaterThan((PixelMax >> (Level + 1u)) - (PixelMin >> (Level + 1u)), uvec2(1u))))
+    {
+        Level++;
+    }
+
+    const uint LevelOffset = GetPyramidLevelOffset(Size, Level);
+    const uvec2 TexelMin = PixelMin >> (Level + 1u);
+    const uvec2 TexelMax = PixelMax >> (Level + 1u);
+    const float MaxDepth = max(max(LoadPyramidMaxDepth(BufferIndex, Size, Level, LevelOffset, TexelMin),
+        LoadPyramidMaxDepth(BufferIndex, Size, Level, LevelOffset, uvec2(TexelMax.x, TexelMin.y))),
+        max(LoadPyramidMaxDepth(BufferIndex, Size, Level, LevelOffset, uvec2(TexelMin.x, TexelMax.y)),
+        LoadPyramidMaxDepth(BufferIndex, Size, Level, LevelOffset, TexelMax)));
+    return NearestDepth > MaxDepth;
+}
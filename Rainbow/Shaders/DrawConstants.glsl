@@ -0,0 +1,9 @@
+// Must match FDrawConstants in BindlessHeap.h
+layout(push_constant) uniform FDrawConstants
+{
+    mat4 Transform;
+    uint VertexBufferIndex;
+    uint IndexBufferIndex;
+    uint TextureIndex;
+    uint SamplerIndex;
+} Draw;
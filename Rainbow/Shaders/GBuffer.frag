@@ -0,0 +1,26 @@
+#version 460
+#include "Bindless.glsl"
+#include "GBufferEncoding.glsl"
+
+layout(location = 0) in vec3 InNormal;
+layout(location = 1) in vec2 InUV;
+layout(location = 2) in vec3 InColor;
+// Texture and sampler indices, from GBuffer.vert or GBufferIndirect.vert
+layout(location = 3) flat in uvec2 InMaterial;
+
+layout(location = 0) out vec4 OutBufferA;
+layout(location = 1) out vec4 OutBufferB;
+layout(location = 2) out vec4 OutBufferC;
+
+void main()
+{
+    vec3 Albedo = InColor;
+    if(InMaterial.x != BINDLESS_INVALID_INDEX)
+    {
+        Albedo *= SampleBindless(InMaterial.x, InMaterial.y, InUV).rgb;
+    }
+
+    OutBufferA = vec4(Albedo, 1.0);
+    OutBufferB = EncodeGBufferNormal(InNormal);
+    OutBufferC = EncodeGBufferMaterial(GetDefaultGBufferMaterial());
+}
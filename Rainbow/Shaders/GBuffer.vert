@@ -0,0 +1,22 @@
+#version 460
+#include "Bindless.glsl"
+#include "DrawConstants.glsl"
+#include "StaticVertex.glsl"
+
+layout(location = 0) out vec3 OutNormal;
+layout(location = 1) out vec2 OutUV;
+layout(location = 2) out vec3 OutColor;
+// Texture and sampler, per draw here and per instance for indirect draws
+layout(location = 3) flat out uvec2 OutMaterial;
+
+void main()
+{
+    // No vertex input state, the vertex is pulled from the global storage buffer array
+    const FStaticVertex Vertex = LoadStaticVertex(Draw.VertexBufferIndex, gl_VertexIndex);
+
+    OutNormal = Vertex.Normal;
+    OutUV = Vertex.UV0;
+    OutColor = Vertex.Color;
+    OutMaterial = uvec2(Draw.TextureIndex, Draw.SamplerIndex);
+    gl_Position = Draw.Transform * vec4(Vertex.Position, 1.0);
+}
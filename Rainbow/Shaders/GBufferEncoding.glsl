@@ -0,0 +1,106 @@
+// GBuffer normal and material encodings, must match EGBufferNormalEncoding in GBufferLayout.h
+#define GBUFFER_NORMAL_FLOAT3 0u
+#define GBUFFER_NORMAL_OCTAHEDRAL 1u
+#define GBUFFER_NORMAL_OCTAHEDRAL_PAIRS 2u
+
+// Set by FRenderer::CreateGBuffer from the active layout, dead branches are removed when the pipeline is compiled
+layout(constant_id = 0) const uint GBufferNormalEncoding = GBUFFER_NORMAL_FLOAT3;
+
+// Unit vector to [-1, 1]^2, the lower hemisphere is folded over the diagonals
+vec2 EncodeOctahedral(vec3 Normal)
+{
+    Normal /= abs(Normal.x) + abs(Normal.y) + abs(Normal.z);
+    vec2 Encoded = Normal.xy;
+    if(Normal.z < 0.0)
+    {
+        Encoded = (1.0 - abs(Normal.yx)) * vec2(Normal.x >= 0.0 ? 1.0 : -1.0, Normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return Encoded;
+}
+
+vec3 DecodeOctahedral(vec2 Encoded)
+{
+    vec3 Normal = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+    const float Fold = clamp(-Normal.z, 0.0, 1.0);
+    Normal.x += Normal.x >= 0.0 ? -Fold : Fold;
+    Normal.y += Normal.y >= 0.0 ? -Fold : Fold;
+    return normalize(Normal);
+}
+
+// [0, 1] value at 16 bit precision as the high and low bytes of two UNORM8 channels
+vec2 PackUnorm16ToPair(float Value)
+{
+    const uint Quantized = uint(round(clamp(Value, 0.0, 1.0) * 65535.0));
+    return vec2(float(Quantized >> 8), float(Quantized & 0xFFu)) / 255.0;
+}
+
+float UnpackUnorm16FromPair(vec2 Pair)
+{
+    const uvec2 Bytes = uvec2(round(Pair * 255.0));
+    return float((Bytes.x << 8) | Bytes.y) / 65535.0;
+}
+
+vec4 EncodeGBufferNormal(vec3 Normal)
+{
+    Normal = normalize(Normal);
+    if(GBufferNormalEncoding == GBUFFER_NORMAL_FLOAT3)
+    {
+        return vec4(Normal, 0.0);
+    }
+
+    const vec2 Encoded = EncodeOctahedral(Normal) * 0.5 + 0.5;
+    if(GBufferNormalEncoding == GBUFFER_NORMAL_OCTAHEDRAL_PAIRS)
+    {
+        return vec4(PackUnorm16ToPair(Encoded.x), PackUnorm16ToPair(Encoded.y));
+    }
+    // Two channel targets drop BA
+    return vec4(Encoded, 0.0, 0.0);
+}
+
+vec3 DecodeGBufferNormal(vec4 Encoded)
+{
+    if(GBufferNormalEncoding == GBUFFER_NORMAL_FLOAT3)
+    {
+        return normalize(Encoded.xyz);
+    }
+    if(GBufferNormalEncoding == GBUFFER_NORMAL_OCTAHEDRAL_PAIRS)
+    {
+        return DecodeOctahedral(vec2(UnpackUnorm16FromPair(Encoded.xy), UnpackUnorm16FromPair(Encoded.zw)) * 2.0 - 1.0);
+    }
+    return DecodeOctahedral(Encoded.xy * 2.0 - 1.0);
+}
+
+// Material parameters sized for RGB10A2, the shading model gets the 2 bit alpha channel
+struct FGBufferMaterial
+{
+    float Roughness;
+    float Metalness;
+    float Occlusion;
+    uint ShadingModel;
+};
+
+vec4 EncodeGBufferMaterial(FGBufferMaterial Material)
+{
+    return vec4(Material.Roughness, Material.Metalness, Material.Occlusion, float(min(Material.ShadingModel, 3u)) / 3.0);
+}
+
+FGBufferMaterial DecodeGBufferMaterial(vec4 Encoded)
+{
+    FGBufferMaterial Material;
+    Material.Roughness = Encoded.r;
+    Material.Metalness = Encoded.g;
+    Material.Occlusion = Encoded.b;
+    Material.ShadingModel = uint(round(Encoded.a * 3.0));
+    return Material;
+}
+
+// Until materials carry these parameters
+FGBufferMaterial GetDefaultGBufferMaterial()
+{
+    FGBufferMaterial Material;
+    Material.Roughness = 1.0;
+    Material.Metalness = 0.0;
+    Material.Occlusion = 1.0;
+    Material.ShadingModel = 0u;
+    return Material;
+}
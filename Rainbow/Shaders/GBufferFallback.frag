@@ -0,0 +1,18 @@
+#version 460
+#include "GBufferEncoding.glsl"
+
+// Minimal GBuffer output drawn while the full material pipeline is still compiling
+layout(location = 0) in vec3 InNormal;
+layout(location = 1) in vec2 InUV;
+layout(location = 2) in vec3 InColor;
+
+layout(location = 0) out vec4 OutBufferA;
+layout(location = 1) out vec4 OutBufferB;
+layout(location = 2) out vec4 OutBufferC;
+
+void main()
+{
+    OutBufferA = vec4(0.5, 0.5, 0.5, 1.0);
+    OutBufferB = EncodeGBufferNormal(InNormal);
+    OutBufferC = EncodeGBufferMaterial(GetDefaultGBufferMaterial());
+}
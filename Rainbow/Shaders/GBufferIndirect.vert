@@ -0,0 +1,28 @@
+#version 460
+#include "Bindless.glsl"
+#include "Instances.glsl"
+#include "StaticVertex.glsl"
+
+// Same layout as FGpuSceneConstants in GpuScene.h
+layout(push_constant) uniform FIndirectDrawConstants
+{
+    FGpuSceneConstants Scene;
+} Draw;
+
+layout(location = 0) out vec3 OutNormal;
+layout(location = 1) out vec2 OutUV;
+layout(location = 2) out vec3 OutColor;
+layout(location = 3) flat out uvec2 OutMaterial;
+
+void main()
+{
+    // Every indirect command draws one instance, its firstInstance is the instance index
+    const uint InstanceIndex = gl_InstanceIndex;
+    const FStaticVertex Vertex = LoadStaticVertex(LoadInstanceVertexBuffer(Draw.Scene, InstanceIndex), gl_VertexIndex);
+
+    OutNormal = Vertex.Normal;
+    OutUV = Vertex.UV0;
+    OutColor = Vertex.Color;
+    OutMaterial = uvec2(LoadInstanceTexture(Draw.Scene, InstanceIndex), Draw.Scene.SamplerIndex);
+    gl_Position = LoadInstanceTransform(Draw.Scene, InstanceIndex) * vec4(Vertex.Position, 1.0);
+}
@@ -0,0 +1,43 @@
+#version 460
+#include "Bindless.glsl"
+#include "StaticVertex.glsl"
+
+// Must match FInstancedDrawConstants in Renderer.h
+layout(push_constant) uniform FInstancedDrawConstants
+{
+    uint VertexBufferIndex;
+    uint TextureIndex;
+    uint SamplerIndex;
+    uint InstanceBufferIndex;
+} Draw;
+
+layout(location = 0) out vec3 OutNormal;
+layout(location = 1) out vec2 OutUV;
+layout(location = 2) out vec3 OutColor;
+layout(location = 3) flat out uvec2 OutMaterial;
+
+// Column major, one transform after the other
+mat4 LoadInstanceTransform(uint InstanceIndex)
+{
+    const uint Base = InstanceIndex * 16u;
+    mat4 Transform;
+    for(uint Column = 0u; Column < 4u; Column++)
+    {
+        const uint ColumnBase = Base + Column * 4u;
+        Transform[Column] = vec4(GlobalFloatBuffers[Draw.InstanceBufferIndex].Data[ColumnBase + 0u], GlobalFloatBuffers[Draw.InstanceBufferIndex].Data[ColumnBase + 1u],
+            GlobalFloatBuffers[Draw.InstanceBufferIndex].Data[ColumnBase + 2u], GlobalFloatBuffers[Draw.InstanceBufferIndex].Data[ColumnBase + 3u]);
+    }
+    return Transform;
+}
+
+void main()
+{
+    // gl_InstanceIndex includes the draw's firstInstance, the index of its first transform in the transient buffer
+    const FStaticVertex Vertex = LoadStaticVertex(Draw.VertexBufferIndex, gl_VertexIndex);
+
+    OutNormal = Vertex.Normal;
+    OutUV = Vertex.UV0;
+    OutColor = Vertex.Color;
+    OutMaterial = uvec2(Draw.TextureIndex, Draw.SamplerIndex);
+    gl_Position = LoadInstanceTransform(gl_InstanceIndex) * vec4(Vertex.Position, 1.0);
+}
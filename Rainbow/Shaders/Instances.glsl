@@ -0,0 +1,71 @@
+// GPU scene instances and batches, must match GpuScene.h and FGpuInstance, FGpuBatch in GpuScene.cpp. Needs Bindless.glsl.
+#define INSTANCE_STRIDE 24u
+#define BATCH_STRIDE 2u
+// Words per VkDrawIndexedIndirectCommand
+#define DRAW_COMMAND_STRIDE 5u
+
+// EGpuCullingPhase
+#define CULLING_PHASE_ALL 0u
+#define CULLING_PHASE_EARLY 1u
+#define CULLING_PHASE_LATE 2u
+
+// Statistics after the counts of both phases, must match GPU_SCENE_STATS_COUNT and FGpuScene::ReadStats
+#define CULLING_STATS_FRUSTUM_VISIBLE 0u
+#define CULLING_STATS_OCCLUDED 1u
+#define CULLING_STATS_DRAWN_EARLY 2u
+#define CULLING_STATS_DRAWN_LATE 3u
+
+struct FGpuSceneConstants
+{
+    uint InstanceBufferIndex;
+    uint BatchBufferIndex;
+    uint InstanceCount;
+    uint CommandBufferIndex;
+    uint CountBufferIndex;
+    uint SamplerIndex;
+    uint BatchCount;
+    uint Phase;
+    uint VisibilityBufferIndex;
+    uint PyramidBufferIndex;
+    uint PyramidWidth;
+    uint PyramidHeight;
+    uint PyramidLevelCount;
+    uint DepthWidth;
+    uint DepthHeight;
+};
+
+mat4 LoadInstanceTransform(FGpuSceneConstants Scene, uint InstanceIndex)
+{
+    const uint Base = InstanceIndex * INSTANCE_STRIDE;
+    mat4 Transform;
+    for(uint Column = 0u; Column < 4u; Column++)
+    {
+        const uint ColumnBase = Base + Column * 4u;
+        Transform[Column] = vec4(GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[ColumnBase + 0u], GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[ColumnBase + 1u],
+            GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[ColumnBase + 2u], GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[ColumnBase + 3u]);
+    }
+    return Transform;
+}
+
+// Clip space center and radius
+vec4 LoadInstanceBounds(FGpuSceneConstants Scene, uint InstanceIndex)
+{
+    const uint Base = InstanceIndex * INSTANCE_STRIDE + 16u;
+    return vec4(GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[Base + 0u], GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[Base + 1u],
+        GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[Base + 2u], GlobalFloatBuffers[Scene.InstanceBufferIndex].Data[Base + 3u]);
+}
+
+uint LoadInstanceVertexBuffer(FGpuSceneConstants Scene, uint InstanceIndex)
+{
+    return GlobalUintBuffers[Scene.InstanceBufferIndex].Data[InstanceIndex * INSTANCE_STRIDE + 20u];
+}
+
+uint LoadInstanceTexture(FGpuSceneConstants Scene, uint InstanceIndex)
+{
+    return GlobalUintBuffers[Scene.InstanceBufferIndex].Data[InstanceIndex * INSTANCE_STRIDE + 21u];
+}
+
+uint LoadInstanceBatch(FGpuSceneConstants Scene, uint InstanceIndex)
+{
+    return GlobalUintBuffers[Scene.InstanceBufferIndex].Data[InstanceIndex * INSTANCE_STRIDE + 22u];
+}
@@ -0,0 +1,150 @@
+// Lights and their cluster grid, must match LightCulling.h and FGpuLight in LightCulling.cpp. Needs Bindless.glsl.
+// There is no camera, lights and pixels are both in clip space: xy in [-1, 1] and depth in [0, 1].
+#define LIGHT_GRID_X 16u
+#define LIGHT_GRID_Y 9u
+#define LIGHT_GRID_Z 24u
+#define LIGHT_CLUSTER_COUNT (LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z)
+// Floats per light
+#define LIGHT_STRIDE 16u
+
+#define LIGHT_TYPE_POINT 0u
+#define LIGHT_TYPE_SPOT 1u
+
+struct FLightGrid
+{
+    uint LightBufferIndex;
+    uint LightOffset;
+    uint LightCount;
+    uint ClusterBufferIndex;
+    uint MaxLightsPerCluster;
+    float NearDepth;
+    float FarDepth;
+};
+
+struct FLight
+{
+    vec3 Position;
+    float Radius;
+    vec3 Color;
+    float Intensity;
+    vec3 Direction;
+    uint Type;
+    float CosInnerAngle;
+    float CosOuterAngle;
+};
+
+// Position and radius, all culling needs
+vec4 LoadLightBounds(FLightGrid Grid, uint LightIndex)
+{
+    const uint Base = Grid.LightOffset + LightIndex * LIGHT_STRIDE;
+    return vec4(GlobalFloatBuffers[Grid.LightBufferIndex].Data[Base + 0u], GlobalFloatBuffers[Grid.LightBufferIndex].Data[Base + 1u],
+        GlobalFloatBuffers[Grid.LightBufferIndex].Data[Base + 2u], GlobalFloatBuffers[Grid.LightBufferIndex].Data[Base + 3u]);
+}
+
+FLight LoadLight(FLightGrid Grid, uint LightIndex)
+{
+    const uint Base = Grid.LightOffset + LightIndex * LIGHT_STRIDE;
+    float Data[14];
+    for(uint i = 0u; i < 14u; i++)
+    {
+        Data[i] = GlobalFloatBuffers[Grid.LightBufferIndex].Data[Base + i];
+    }
+
+    FLight Light;
+    Light.Position = vec3(Data[0], Data[1], Data[2]);
+    Light.Radius = Data[3];
+    Light.Color = vec3(Data[4], Data[5], Data[6]);
+    Light.Intensity = Data[7];
+    Light.Direction = vec3(Data[8], Data[9], Data[10]);
+    Light.Type = uint(Data[11]);
+    Light.CosInnerAngle = Data[12];
+    Light.CosOuterAngle = Data[13];
+    return Light;
+}
+
+// Slices are spaced logarithmically so near ones stay thin, everything past FarDepth is in the last one
+uint GetClusterSlice(FLightGrid Grid, float Depth)
+{
+    if(Depth <= Grid.NearDepth)
+    {
+        return 0u;
+    }
+    const float Slice = log(Depth / Grid.NearDepth) / log(Grid.FarDepth / Grid.NearDepth) * float(LIGHT_GRID_Z);
+    return min(uint(Slice), LIGHT_GRID_Z - 1u);
+}
+
+// Depth the slice starts at, the first one reaches down to 0
+float GetSliceDepth(FLightGrid Grid, uint Slice)
+{
+    return Slice == 0u ? 0.0 : Grid.NearDepth * pow(Grid.FarDepth / Grid.NearDepth, float(Slice) / float(LIGHT_GRID_Z));
+}
+
+uint GetClusterIndex(FLightGrid Grid, vec2 UV, float Depth)
+{
+    const uvec2 Tile = min(uvec2(UV * vec2(LIGHT_GRID_X, LIGHT_GRID_Y)), uvec2(LIGHT_GRID_X - 1u, LIGHT_GRID_Y - 1u));
+    return (GetClusterSlice(Grid, Depth) * LIGHT_GRID_Y + Tile.y) * LIGHT_GRID_X + Tile.x;
+}
+
+void GetClusterBounds(FLightGrid Grid, uint ClusterIndex, out vec3 OutMin, out vec3 OutMax)
+{
+    const uvec3 Cell = uvec3(ClusterIndex % LIGHT_GRID_X, (ClusterIndex / LIGHT_GRID_X) % LIGHT_GRID_Y, ClusterIndex / (LIGHT_GRID_X * LIGHT_GRID_Y));
+    const vec2 TileSize = 2.0 / vec2(LIGHT_GRID_X, LIGHT_GRID_Y);
+    OutMin = vec3(vec2(Cell.xy) * TileSize - 1.0, GetSliceDepth(Grid, Cell.z));
+    OutMax = vec3(vec2(Cell.xy + 1u) * TileSize - 1.0, GetSliceDepth(Grid, Cell.z + 1u));
+    if(Cell.z == LIGHT_GRID_Z - 1u)
+    {
+        OutMax.z = max(OutMax.z, 1.0);
+    }
+}
+
+// Spot lights are culled by their bounding sphere, the cone only matters when shading
+bool LightIntersectsCluster(vec4 Bounds, vec3 ClusterMin, vec3 ClusterMax)
+{
+    const vec3 Offset = clamp(Bounds.xyz, ClusterMin, ClusterMax) - Bounds.xyz;
+    return dot(Offset, Offset) <= Bounds.w * Bounds.w;
+}
+
+vec3 EvaluateLight(FLight Light, vec3 Position, vec3 Normal)
+{
+    const vec3 ToLight = Light.Position - Position;
+    const float DistanceSquared = dot(ToLight, ToLight);
+    const float RadiusSquared = Light.Radius * Light.Radius;
+    if(DistanceSquared >= RadiusSquared)
+    {
+        return vec3(0.0);
+    }
+
+    const vec3 L = ToLight * inversesqrt(max(DistanceSquared, 1e-8));
+    // Smooth window reaching 0 at the radius, so culling by the radius never shows
+    float Falloff = 1.0 - DistanceSquared / RadiusSquared;
+    Falloff *= Falloff;
+    if(Light.Type == LIGHT_TYPE_SPOT)
+    {
+        Falloff *= smoothstep(Light.CosOuterAngle, Light.CosInnerAngle, dot(-L, Light.Direction));
+    }
+    return Light.Color * (Light.Intensity * Falloff * max(dot(Normal, L), 0.0));
+}
+
+// Diffuse lighting of every light reaching the pixel, from its cluster's list or from all lights without culling
+vec3 AccumulateLights(FLightGrid Grid, vec2 UV, float Depth, vec3 Normal)
+{
+    const vec3 Position = vec3(UV * 2.0 - 1.0, Depth);
+    vec3 Lighting = vec3(0.0);
+    if(Grid.ClusterBufferIndex == BINDLESS_INVALID_INDEX)
+    {
+        for(uint i = 0u; i < Grid.LightCount; i++)
+        {
+            Lighting += EvaluateLight(LoadLight(Grid, i), Position, Normal);
+        }
+        return Lighting;
+    }
+
+    const uint Base = GetClusterIndex(Grid, UV, Depth) * (Grid.MaxLightsPerCluster + 1u);
+    const uint Count = GlobalUintBuffers[Grid.ClusterBufferIndex].Data[Base];
+    for(uint i = 0u; i < Count; i++)
+    {
+        const uint LightIndex = GlobalUintBuffers[Grid.ClusterBufferIndex].Data[Base + 1u + i];
+        Lighting += EvaluateLight(LoadLight(Grid, LightIndex), Position, Normal);
+    }
+    return Lighting;
+}
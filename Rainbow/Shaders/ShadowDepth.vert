@@ -0,0 +1,12 @@
+#version 460
+#include "Bindless.glsl"
+#include "DrawConstants.glsl"
+#include "StaticVertex.glsl"
+
+// Shadow casters, depth only: there is no fragment shader. Transform takes the actor to the clip space of the cascade's
+// piece being drawn.
+void main()
+{
+    const FStaticVertex Vertex = LoadStaticVertex(Draw.VertexBufferIndex, gl_VertexIndex);
+    gl_Position = Draw.Transform * vec4(Vertex.Position, 1.0);
+}
@@ -0,0 +1,64 @@
+// Directional light and its shadow cascades, must match ShadowMaps.h. Needs Bindless.glsl.
+// Positions are in the clip space actors are placed in, the one lighting evaluates pixels at.
+#define SHADOW_MAX_CASCADES 4u
+// Floats before the first cascade and per cascade
+#define SHADOW_HEADER_STRIDE 8u
+#define SHADOW_CASCADE_STRIDE 24u
+
+struct FShadows
+{
+    uint BufferIndex;
+    uint Offset;
+};
+
+// Points towards the light
+vec3 LoadLightDirection(FShadows Shadows)
+{
+    return vec3(GlobalFloatBuffers[Shadows.BufferIndex].Data[Shadows.Offset + 0u], GlobalFloatBuffers[Shadows.BufferIndex].Data[Shadows.Offset + 1u],
+        GlobalFloatBuffers[Shadows.BufferIndex].Data[Shadows.Offset + 2u]);
+}
+
+mat4 LoadShadowMatrix(FShadows Shadows, uint Base)
+{
+    mat4 ShadowMatrix;
+    for(uint Column = 0u; Column < 4u; Column++)
+    {
+        const uint ColumnBase = Base + Column * 4u;
+        ShadowMatrix[Column] = vec4(GlobalFloatBuffers[Shadows.BufferIndex].Data[ColumnBase + 0u], GlobalFloatBuffers[Shadows.BufferIndex].Data[ColumnBase + 1u],
+            GlobalFloatBuffers[Shadows.BufferIndex].Data[ColumnBase + 2u], GlobalFloatBuffers[Shadows.BufferIndex].Data[ColumnBase + 3u]);
+    }
+    return ShadowMatrix;
+}
+
+// Fraction of the directional light reaching Position, 1 outside every cascade. The cascade is picked by depth, one that
+// is stale or no longer covers the position hands over to the next one further out.
+float GetShadow(FShadows Shadows, vec3 Position, float Depth)
+{
+    const uint CascadeCount = min(GlobalUintBuffers[Shadows.BufferIndex].Data[Shadows.Offset + 3u], SHADOW_MAX_CASCADES);
+    const uint SamplerIndex = GlobalUintBuffers[Shadows.BufferIndex].Data[Shadows.Offset + 4u];
+    const vec3 LightDirection = LoadLightDirection(Shadows);
+    for(uint Cascade = 0u; Cascade < CascadeCount; Cascade++)
+    {
+        const uint Base = Shadows.Offset + SHADOW_HEADER_STRIDE + Cascade * SHADOW_CASCADE_STRIDE;
+        const float SplitFar = GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 20u];
+        if(GlobalUintBuffers[Shadows.BufferIndex].Data[Base + 23u] == 0u || Depth > SplitFar)
+        {
+            continue;
+        }
+
+        // A texel towards the light keeps surfaces from shadowing themselves where the bias of the casters isn't enough
+        const float TexelSize = GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 21u];
+        const vec3 MapPosition = (LoadShadowMatrix(Shadows, Base) * vec4(Position + LightDirection * TexelSize, 1.0)).xyz;
+        const vec4 Bounds = vec4(GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 16u], GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 17u],
+            GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 18u], GlobalFloatBuffers[Shadows.BufferIndex].Data[Base + 19u]);
+        if(any(lessThan(MapPosition.xy, Bounds.xy)) || any(greaterThan(MapPosition.xy, Bounds.zw)))
+        {
+            continue;
+        }
+
+        // Coordinates keep counting past the map's edges, the REPEAT sampler wraps them onto the torus
+        const uint TextureIndex = GlobalUintBuffers[Shadows.BufferIndex].Data[Base + 22u];
+        return texture(sampler2DShadow(GlobalTextures[nonuniformEXT(TextureIndex)], GlobalSamplers[nonuniformEXT(SamplerIndex)]), MapPosition);
+    }
+    return 1.0;
+}
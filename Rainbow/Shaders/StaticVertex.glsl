@@ -0,0 +1,21 @@
+// Vertex pulling for FStaticVertex, 11 tightly packed floats: Position, Normal, UV0, Color
+#define STATIC_VERTEX_STRIDE 11
+
+struct FStaticVertex
+{
+    vec3 Position;
+    vec3 Normal;
+    vec2 UV0;
+    vec3 Color;
+};
+
+FStaticVertex LoadStaticVertex(uint BufferIndex, uint VertexIndex)
+{
+    const uint Base = VertexIndex * STATIC_VERTEX_STRIDE;
+    FStaticVertex Vertex;
+    Vertex.Position = vec3(GlobalFloatBuffers[BufferIndex].Data[Base + 0], GlobalFloatBuffers[BufferIndex].Data[Base + 1], GlobalFloatBuffers[BufferIndex].Data[Base + 2]);
+    Vertex.Normal = vec3(GlobalFloatBuffers[BufferIndex].Data[Base + 3], GlobalFloatBuffers[BufferIndex].Data[Base + 4], GlobalFloatBuffers[BufferIndex].Data[Base + 5]);
+    Vertex.UV0 = vec2(GlobalFloatBuffers[BufferIndex].Data[Base + 6], GlobalFloatBuffers[BufferIndex].Data[Base + 7]);
+    Vertex.Color = vec3(GlobalFloatBuffers[BufferIndex].Data[Base + 8], GlobalFloatBuffers[BufferIndex].Data[Base + 9], GlobalFloatBuffers[BufferIndex].Data[Base + 10]);
+    return Vertex;
+}
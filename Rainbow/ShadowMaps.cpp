@@ -0,0 +1,512 @@
+#include "ShadowMaps.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <glm/glm.hpp>
+#include "BindlessHeap.h"
+#include "MeshActor.h"
+#include "Paths.h"
+#include "RenderPassCache.h"
+#include "Renderer.h"
+#include "TransientBuffer.h"
+
+// D16 is the only depth format every device can both render to and sample
+#define SHADOW_MAP_FORMAT VK_FORMAT_D16_UNORM
+// Splits sit halfway between uniform and logarithmic ones from this depth, the near cascades stay small
+#define SHADOW_SPLIT_NEAR 0.05f
+#define SHADOW_SPLIT_LAMBDA 0.5f
+// Rasterization bias of the casters, in units of the depth format's resolution and of the polygon's depth slope
+#define SHADOW_DEPTH_BIAS_CONSTANT 1.25f
+#define SHADOW_DEPTH_BIAS_SLOPE 1.75f
+
+static int32_t WrapTexel(int32_t Texel, int32_t Size)
+{
+    return ((Texel % Size) + Size) % Size;
+}
+
+// Indices share the buffer with floats, the shader reads them back through GlobalUintBuffers
+static float AsFloat(uint32_t Value)
+{
+    float Result;
+    memcpy(&Result, &Value, sizeof(float));
+    return Result;
+}
+
+FShadowCascades::FShadowCascades()
+{
+    Device = VK_NULL_HANDLE;
+    BindlessHeap = nullptr;
+    PipelineLayout = VK_NULL_HANDLE;
+    Pipeline = VK_NULL_HANDLE;
+    Sampler = VK_NULL_HANDLE;
+    SamplerIndex = BINDLESS_INVALID_INDEX;
+    CascadeCount = 0;
+    CachedCascadeCount = 0;
+    CascadeBudget = 0;
+    MapSize = 0;
+    for(FCascade& Cascade : Cascades)
+    {
+        Cascade.Origin = glm::ivec2(0);
+        Cascade.TexelSize = 0.0f;
+        Cascade.SplitFar = 0.0f;
+        Cascade.bValid = false;
+        Cascade.bCached = false;
+        Cascade.bFullRender = false;
+    }
+    LightView = glm::mat4(1.0f);
+    LightDirection = glm::vec3(0.0f);
+    MinLightDepth = 0.0f;
+    MaxLightDepth = 1.0f;
+    WorldRevision = 0;
+    bLightValid = false;
+}
+
+void FShadowCascades::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+    FRenderPassCache& RenderPassCache, VkPipelineLayout InPipelineLayout, const FRendererSettings& Settings)
+{
+    SCOPED_ZONE("FShadowCascades::Init");
+    Device = InDevice;
+    BindlessHeap = InBindlessHeap;
+    PipelineLayout = InPipelineLayout;
+    CascadeCount = std::min<uint32_t>(Settings.ShadowCascadeCount, SHADOW_MAX_CASCADES);
+    CachedCascadeCount = std::min(Settings.ShadowCachedCascades, CascadeCount);
+    CascadeBudget = Settings.ShadowCascadeBudget;
+    MapSize = Settings.ShadowMapSize;
+
+    // Hardware PCF: the comparison is filtered over the 2x2 texels around the lookup when the format allows it
+    VkFormatProperties FormatProperties;
+    vkGetPhysicalDeviceFormatProperties(PhysicalDevice, SHADOW_MAP_FORMAT, &FormatProperties);
+    const VkFilter Filter = (FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    VkSamplerCreateInfo SamplerInfo = {};
+    SamplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    SamplerInfo.magFilter = Filter;
+    SamplerInfo.minFilter = Filter;
+    SamplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    // Maps are addressed as a torus
+    SamplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    SamplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    SamplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    SamplerInfo.compareEnable = VK_TRUE;
+    SamplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    if(vkCreateSampler(Device, &SamplerInfo, nullptr, &Sampler) != VK_SUCCESS)
+    {
+        checkf(0, "FShadowCascades: unable to create shadow sampler");
+    }
+    SamplerIndex = BindlessHeap->RegisterSampler(Sampler);
+
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        FCascade& Cascade = Cascades[i];
+        Cascade.bCached = i >= CascadeCount - CachedCascadeCount;
+
+        FTexture& Texture = Cascade.Texture;
+        VkImageCreateInfo ImageCreateInfo = {};
+        ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format = SHADOW_MAP_FORMAT;
+        ImageCreateInfo.extent = { MapSize, MapSize, 1 };
+        ImageCreateInfo.mipLevels = 1;
+        ImageCreateInfo.arrayLayers = 1;
+        ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if(vkCreateImage(Device, &ImageCreateInfo, nullptr, &Texture.Image) != VK_SUCCESS)
+        {
+            checkf(0, "FShadowCascades: unable to create cascade image");
+        }
+
+        VkMemoryRequirements MemoryRequirements;
+        vkGetImageMemoryRequirements(Device, Texture.Image, &MemoryRequirements);
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = MemoryRequirements.size;
+        AllocateInfo.memoryTypeIndex = FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &Texture.ImageMemory) != VK_SUCCESS)
+        {
+            checkf(0, "FShadowCascades: unable to allocate cascade memory");
+        }
+        vkBindImageMemory(Device, Texture.Image, Texture.ImageMemory, 0);
+
+        VkImageViewCreateInfo ViewInfo = {};
+        ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ViewInfo.image = Texture.Image;
+        ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ViewInfo.format = SHADOW_MAP_FORMAT;
+        ViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        ViewInfo.subresourceRange.levelCount = 1;
+        ViewInfo.subresourceRange.layerCount = 1;
+        if(vkCreateImageView(Device, &ViewInfo, nullptr, &Texture.ImageView) != VK_SUCCESS)
+        {
+            checkf(0, "FShadowCascades: unable to create cascade image view");
+        }
+
+        Texture.Format = SHADOW_MAP_FORMAT;
+        Texture.SizeX = MapSize;
+        Texture.SizeY = MapSize;
+        Texture.MipMaps = 1;
+        // The layout the graph leaves it in after lighting sampled it
+        Texture.BindlessIndex = BindlessHeap->RegisterSampledImage(Texture.ImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    }
+
+    // Depth only, the render pass just has to be compatible with the one the graph creates for a cascade pass
+    FRenderPassDesc PassDesc;
+    PassDesc.DepthAttachment = FAttachmentDesc(SHADOW_MAP_FORMAT, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    FGraphicsPipelineDesc Desc;
+    Desc.VertexShader = FPaths::GetShaderDirectory() + "/ShadowDepth.vert.spv";
+    // Casters can be open meshes, both faces are drawn and the bias keeps them from shadowing themselves
+    Desc.CullMode = VK_CULL_MODE_NONE;
+    Desc.DepthBiasConstant = SHADOW_DEPTH_BIAS_CONSTANT;
+    Desc.DepthBiasSlope = SHADOW_DEPTH_BIAS_SLOPE;
+    Desc.DepthFormat = SHADOW_MAP_FORMAT;
+    Desc.RenderPass = RenderPassCache.GetRenderPass(PassDesc);
+    Desc.PipelineLayout = PipelineLayout;
+    Pipeline = PipelineStateCache.GetPipelineBlocking(Desc);
+    checkf(Pipeline != VK_NULL_HANDLE, "FShadowCascades::Init Unable to create shadow depth pipeline");
+
+    LOG_Info("Shadows: %u cascades of %ux%u, %u cached, %u cached re-rendered per frame at most", CascadeCount, MapSize, MapSize,
+        CachedCascadeCount, CascadeBudget);
+}
+
+void FShadowCascades::Shutdown()
+{
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        FTexture& Texture = Cascades[i].Texture;
+        BindlessHeap->Release(BINDLESS_SampledImages, Texture.BindlessIndex);
+        vkDestroyImageView(Device, Texture.ImageView, nullptr);
+        vkDestroyImage(Device, Texture.Image, nullptr);
+        vkFreeMemory(Device, Texture.ImageMemory, nullptr);
+        Texture = FTexture();
+    }
+    if(Sampler != VK_NULL_HANDLE)
+    {
+        BindlessHeap->Release(BINDLESS_Samplers, SamplerIndex);
+        vkDestroySampler(Device, Sampler, nullptr);
+        Sampler = VK_NULL_HANDLE;
+    }
+    CascadeCount = 0;
+}
+
+void FShadowCascades::Update(const glm::mat4& ViewProjection, const glm::vec3& InLightDirection, const FCullingBounds& Bounds, uint32_t InWorldRevision)
+{
+    SCOPED_ZONE("FShadowCascades::Update");
+    FrameStats = FShadowStats();
+    if(!bLightValid || InLightDirection != LightDirection || InWorldRevision != WorldRevision)
+    {
+        // Light space looks along the light, z grows away from it
+        const glm::vec3 AxisZ = -glm::normalize(InLightDirection);
+        const glm::vec3 Up = std::abs(AxisZ.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::vec3 AxisX = glm::normalize(glm::cross(Up, AxisZ));
+        const glm::vec3 AxisY = glm::cross(AxisZ, AxisX);
+        LightView = glm::transpose(glm::mat4(glm::vec4(AxisX, 0.0f), glm::vec4(AxisY, 0.0f), glm::vec4(AxisZ, 0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+
+        // Whatever the cascade, depth covers every actor: casters can't be clipped and receivers are actors too
+        MinLightDepth = -1.0f;
+        MaxLightDepth = 1.0f;
+        if(Bounds.Count > 0)
+        {
+            MinLightDepth = FLT_MAX;
+            MaxLightDepth = -FLT_MAX;
+            for(uint32_t i = 0; i < Bounds.Count; i++)
+            {
+                const float Depth = glm::dot(AxisZ, glm::vec3(Bounds.SphereX[i], Bounds.SphereY[i], Bounds.SphereZ[i]));
+                MinLightDepth = std::min(MinLightDepth, Depth - Bounds.SphereRadius[i]);
+                MaxLightDepth = std::max(MaxLightDepth, Depth + Bounds.SphereRadius[i]);
+            }
+            const float Margin = std::max((MaxLightDepth - MinLightDepth) * 0.01f, 1e-3f);
+            MinLightDepth -= Margin;
+            MaxLightDepth += Margin;
+        }
+
+        for(FCascade& Cascade : Cascades)
+        {
+            Cascade.bValid = false;
+        }
+        LightDirection = InLightDirection;
+        WorldRevision = InWorldRevision;
+        bLightValid = true;
+    }
+
+    const glm::mat4 InverseViewProjection = glm::inverse(ViewProjection);
+    const int32_t Size = static_cast<int32_t>(MapSize);
+    uint32_t Budget = CascadeBudget;
+    float SplitNear = 0.0f;
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        FCascade& Cascade = Cascades[i];
+        Cascade.Pieces.clear();
+        Cascade.bFullRender = false;
+
+        const float Fraction = static_cast<float>(i + 1) / static_cast<float>(CascadeCount);
+        const float LogSplit = SHADOW_SPLIT_NEAR * std::pow(1.0f / SHADOW_SPLIT_NEAR, Fraction);
+        const float SplitFar = i + 1 == CascadeCount ? 1.0f : glm::mix(Fraction, LogSplit, SHADOW_SPLIT_LAMBDA);
+
+        // Bounding sphere of the slice, the same whatever the view's orientation so the texel size doesn't change as it turns
+        glm::vec3 Corners[8];
+        glm::vec3 Center(0.0f);
+        for(uint32_t Corner = 0; Corner < 8; Corner++)
+        {
+            const glm::vec4 Clip((Corner & 1) ? 1.0f : -1.0f, (Corner & 2) ? 1.0f : -1.0f, (Corner & 4) ? SplitFar : SplitNear, 1.0f);
+            const glm::vec4 World = InverseViewProjection * Clip;
+            Corners[Corner] = glm::vec3(World) / World.w;
+            Center += Corners[Corner] / 8.0f;
+        }
+        float Radius = 0.0f;
+        for(const glm::vec3& Corner : Corners)
+        {
+            Radius = std::max(Radius, glm::distance(Center, Corner));
+        }
+        // Rounded up so float noise never changes the texel size, which would throw the cache away
+        Radius = std::ceil(Radius * 16.0f) / 16.0f;
+        SplitNear = SplitFar;
+        Cascade.SplitFar = SplitFar;
+
+        // Snapped to whole texels, the map spans two texels more than the sphere so it still covers it once floored
+        const float TexelSize = 2.0f * Radius / static_cast<float>(Size - 2);
+        const glm::vec2 LightCenter = glm::vec2(LightView * glm::vec4(Center, 1.0f));
+        const glm::ivec2 Origin = glm::ivec2(glm::floor(LightCenter / TexelSize)) - glm::ivec2(Size / 2);
+
+        const glm::ivec2 Shift = Origin - Cascade.Origin;
+        const bool bScrollable = Cascade.bCached && Cascade.bValid && Cascade.TexelSize == TexelSize && std::abs(Shift.x) < Size && std::abs(Shift.y) < Size;
+        if(bScrollable)
+        {
+            if(Shift == glm::ivec2(0)) continue;
+
+            // The texels the new placement doesn't share with the old one: whole columns on one side, then whole rows
+            // over the shared columns
+            const glm::ivec2 OldOrigin = Cascade.Origin;
+            Cascade.Origin = Origin;
+            if(Shift.x != 0)
+            {
+                const int32_t MinX = Shift.x > 0 ? OldOrigin.x + Size : Origin.x;
+                const int32_t MaxX = Shift.x > 0 ? Origin.x + Size : OldOrigin.x;
+                AddPieces(Cascade, glm::ivec2(MinX, Origin.y), glm::ivec2(MaxX, Origin.y + Size));
+            }
+            if(Shift.y != 0)
+            {
+                const int32_t MinX = std::max(Origin.x, OldOrigin.x);
+                const int32_t MaxX = std::min(Origin.x, OldOrigin.x) + Size;
+                const int32_t MinY = Shift.y > 0 ? OldOrigin.y + Size : Origin.y;
+                const int32_t MaxY = Shift.y > 0 ? Origin.y + Size : OldOrigin.y;
+                AddPieces(Cascade, glm::ivec2(MinX, MinY), glm::ivec2(MaxX, MaxY));
+            }
+            FrameStats.CascadesScrolled++;
+            continue;
+        }
+
+        if(Cascade.bCached)
+        {
+            if(Budget == 0)
+            {
+                // Keeps its old placement, lighting falls back to the next cascade where it no longer covers the slice
+                FrameStats.CascadesDeferred++;
+                continue;
+            }
+            Budget--;
+        }
+        Cascade.Origin = Origin;
+        Cascade.TexelSize = TexelSize;
+        Cascade.bValid = true;
+        Cascade.bFullRender = true;
+        AddPieces(Cascade, Origin, Origin + glm::ivec2(Size));
+        FrameStats.CascadesRendered++;
+    }
+
+    // Casters of every piece, as many pieces per pass over the bounds as the culling takes
+    std::vector<FShadowPiece*> Pieces;
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        for(FShadowPiece& Piece : Cascades[i].Pieces)
+        {
+            Pieces.push_back(&Piece);
+        }
+    }
+    FCullingView Views[FRUSTUM_CULLING_MAX_VIEWS];
+    for(size_t First = 0; First < Pieces.size(); First += FRUSTUM_CULLING_MAX_VIEWS)
+    {
+        const uint32_t ViewCount = static_cast<uint32_t>(std::min<size_t>(Pieces.size() - First, FRUSTUM_CULLING_MAX_VIEWS));
+        for(uint32_t View = 0; View < ViewCount; View++)
+        {
+            Views[View].Frustum = FFrustum::FromViewProjection(Pieces[First + View]->ViewProjection);
+        }
+        CullFrustums(Bounds, Views, ViewCount);
+        for(uint32_t View = 0; View < ViewCount; View++)
+        {
+            Pieces[First + View]->Visible.swap(Views[View].Visible);
+        }
+    }
+}
+
+void FShadowCascades::AddPieces(FCascade& Cascade, glm::ivec2 Min, glm::ivec2 Max)
+{
+    const int32_t Size = static_cast<int32_t>(MapSize);
+    for(int32_t Y = Min.y; Y < Max.y;)
+    {
+        const int32_t MapY = WrapTexel(Y, Size);
+        const int32_t EndY = std::min(Max.y, Y + Size - MapY);
+        for(int32_t X = Min.x; X < Max.x;)
+        {
+            const int32_t MapX = WrapTexel(X, Size);
+            const int32_t EndX = std::min(Max.x, X + Size - MapX);
+            FShadowPiece Piece;
+            Piece.Rect.offset = { MapX, MapY };
+            Piece.Rect.extent = { static_cast<uint32_t>(EndX - X), static_cast<uint32_t>(EndY - Y) };
+            Piece.ViewProjection = GetPieceViewProjection(Cascade, glm::ivec2(X, Y), glm::ivec2(EndX, EndY));
+            Cascade.Pieces.push_back(std::move(Piece));
+            X = EndX;
+        }
+        Y = EndY;
+    }
+}
+
+glm::mat4 FShadowCascades::GetPieceViewProjection(const FCascade& Cascade, glm::ivec2 Min, glm::ivec2 Max) const
+{
+    // Orthographic over the piece's light space rectangle, drawn with the piece's rectangle of the map as viewport
+    const glm::vec2 LightMin = glm::vec2(Min) * Cascade.TexelSize;
+    const glm::vec2 LightMax = glm::vec2(Max) * Cascade.TexelSize;
+    glm::mat4 Projection(1.0f);
+    Projection[0][0] = 2.0f / (LightMax.x - LightMin.x);
+    Projection[1][1] = 2.0f / (LightMax.y - LightMin.y);
+    Projection[2][2] = 1.0f / (MaxLightDepth - MinLightDepth);
+    Projection[3][0] = -(LightMax.x + LightMin.x) / (LightMax.x - LightMin.x);
+    Projection[3][1] = -(LightMax.y + LightMin.y) / (LightMax.y - LightMin.y);
+    Projection[3][2] = -MinLightDepth / (MaxLightDepth - MinLightDepth);
+    return Projection * LightView;
+}
+
+FShadowStats FShadowCascades::AddPasses(FRenderGraph& RenderGraph, const std::vector<const FMeshActor*>& Actors)
+{
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        FCascade& Cascade = Cascades[i];
+        Cascade.GraphTexture = FRenderGraphTexture();
+        // Over the budget before it was ever rendered
+        if(!Cascade.bValid) continue;
+
+        const std::string Name = "ShadowCascade" + std::to_string(i);
+        Cascade.GraphTexture = RenderGraph.ImportTexture(Name, &Cascade.Texture);
+        if(Cascade.Pieces.empty()) continue;
+
+        for(const FShadowPiece& Piece : Cascade.Pieces)
+        {
+            FrameStats.Draws += static_cast<uint32_t>(Piece.Visible.size());
+        }
+        // Scrolled maps keep what they already hold, each piece clears its own rectangle
+        const FCascade* PassCascade = &Cascade;
+        const std::vector<const FMeshActor*>* PassActors = &Actors;
+        RenderGraph.AddPass(Name)
+            .WriteDepth(Cascade.GraphTexture, Cascade.bFullRender ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD)
+            .SetExecute([this, PassCascade, PassActors](const FRenderGraphPassContext& Context) { RenderCascade(Context, *PassCascade, *PassActors); });
+    }
+    return FrameStats;
+}
+
+void FShadowCascades::ReadCascades(FRenderGraphPass& Pass) const
+{
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        if(Cascades[i].GraphTexture.IsValid())
+        {
+            Pass.ReadTexture(Cascades[i].GraphTexture);
+        }
+    }
+}
+
+void FShadowCascades::RenderCascade(const FRenderGraphPassContext& Context, const FCascade& Cascade, const std::vector<const FMeshActor*>& Actors) const
+{
+    SCOPED_ZONE("ShadowCascade");
+    const VkCommandBuffer CommandBuffer = Context.CommandBuffer;
+    vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
+    BindlessHeap->Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout);
+
+    const FVertexBuffer* BoundVertexBuffer = nullptr;
+    for(const FShadowPiece& Piece : Cascade.Pieces)
+    {
+        VkViewport Viewport {};
+        Viewport.x = static_cast<float>(Piece.Rect.offset.x);
+        Viewport.y = static_cast<float>(Piece.Rect.offset.y);
+        Viewport.width = static_cast<float>(Piece.Rect.extent.width);
+        Viewport.height = static_cast<float>(Piece.Rect.extent.height);
+        Viewport.minDepth = 0.0f;
+        Viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
+        vkCmdSetScissor(CommandBuffer, 0, 1, &Piece.Rect);
+
+        if(!Cascade.bFullRender)
+        {
+            VkClearAttachment ClearAttachment = {};
+            ClearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            ClearAttachment.clearValue.depthStencil = { 1.0f, 0 };
+            VkClearRect ClearRect = {};
+            ClearRect.rect = Piece.Rect;
+            ClearRect.layerCount = 1;
+            vkCmdClearAttachments(CommandBuffer, 1, &ClearAttachment, 1, &ClearRect);
+        }
+
+        for(uint32_t ActorIndex : Piece.Visible)
+        {
+            const FMeshActor* MeshActor = Actors[ActorIndex];
+            const FVertexBuffer* VertexBuffer = MeshActor->GetVertexBuffer();
+            FDrawConstants DrawConstants;
+            DrawConstants.Transform = Piece.ViewProjection * MeshActor->GetTransform();
+            DrawConstants.VertexBufferIndex = VertexBuffer->VertexBindlessIndex;
+            DrawConstants.IndexBufferIndex = VertexBuffer->IndexBindlessIndex;
+            vkCmdPushConstants(CommandBuffer, PipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(FDrawConstants), &DrawConstants);
+            if(VertexBuffer != BoundVertexBuffer)
+            {
+                vkCmdBindIndexBuffer(CommandBuffer, VertexBuffer->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                BoundVertexBuffer = VertexBuffer;
+            }
+            vkCmdDrawIndexed(CommandBuffer, VertexBuffer->IndexBufferSize, 1, 0, 0, 0);
+        }
+    }
+}
+
+FShadowConstants FShadowCascades::Upload(const glm::vec3& InLightDirection, FTransientBuffer& TransientBuffer, uint32_t TransientBindlessIndex) const
+{
+    SCOPED_ZONE("FShadowCascades::Upload");
+    float Data[SHADOW_HEADER_STRIDE + SHADOW_MAX_CASCADES * SHADOW_CASCADE_STRIDE] = {};
+    Data[0] = InLightDirection.x;
+    Data[1] = InLightDirection.y;
+    Data[2] = InLightDirection.z;
+    Data[3] = AsFloat(CascadeCount);
+    Data[4] = AsFloat(SamplerIndex);
+    for(uint32_t i = 0; i < CascadeCount; i++)
+    {
+        const FCascade& Cascade = Cascades[i];
+        float* CascadeData = &Data[SHADOW_HEADER_STRIDE + i * SHADOW_CASCADE_STRIDE];
+        CascadeData[23] = AsFloat(Cascade.bValid ? 1u : 0u);
+        if(!Cascade.bValid) continue;
+
+        // Light space to map coordinates: texels over the whole map, the sampler wraps them, and the depth the passes wrote
+        const float MapWorldSize = Cascade.TexelSize * static_cast<float>(MapSize);
+        glm::mat4 ToMap(1.0f);
+        ToMap[0][0] = 1.0f / MapWorldSize;
+        ToMap[1][1] = 1.0f / MapWorldSize;
+        ToMap[2][2] = 1.0f / (MaxLightDepth - MinLightDepth);
+        ToMap[3][2] = -MinLightDepth / (MaxLightDepth - MinLightDepth);
+        const glm::mat4 ShadowMatrix = ToMap * LightView;
+        memcpy(CascadeData, &ShadowMatrix[0][0], sizeof(glm::mat4));
+        // What the map holds, a texel in from its edges so filtering never reaches the texels of the opposite side
+        const float Texel = 1.0f / static_cast<float>(MapSize);
+        CascadeData[16] = (static_cast<float>(Cascade.Origin.x) + 1.0f) * Texel;
+        CascadeData[17] = (static_cast<float>(Cascade.Origin.y) + 1.0f) * Texel;
+        CascadeData[18] = (static_cast<float>(Cascade.Origin.x) + static_cast<float>(MapSize) - 1.0f) * Texel;
+        CascadeData[19] = (static_cast<float>(Cascade.Origin.y) + static_cast<float>(MapSize) - 1.0f) * Texel;
+        CascadeData[20] = Cascade.SplitFar;
+        CascadeData[21] = Cascade.TexelSize;
+        CascadeData[22] = AsFloat(Cascade.Texture.BindlessIndex);
+    }
+
+    const size_t DataSize = (SHADOW_HEADER_STRIDE + CascadeCount * SHADOW_CASCADE_STRIDE) * sizeof(float);
+    const FTransientAllocation Allocation = TransientBuffer.Allocate(DataSize, 16);
+    // Mapped memory is only ever written
+    memcpy(Allocation.Data, Data, DataSize);
+    FShadowConstants Constants;
+    Constants.BufferIndex = TransientBindlessIndex;
+    Constants.Offset = static_cast<uint32_t>(Allocation.Offset / sizeof(float));
+    return Constants;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <vulkan/vulkan_core.h>
+#include "FrustumCulling.h"
+#include "MinimalCore.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "RenderResource.h"
+#include "RendererSettings.h"
+
+class FBindlessHeap;
+class FMeshActor;
+class FRenderPassCache;
+class FTransientBuffer;
+
+// Must match SHADOW_MAX_CASCADES in Shaders/Shadows.glsl
+#define SHADOW_MAX_CASCADES 4
+// Floats before the first cascade and per cascade in the shadow buffer, must match Shaders/Shadows.glsl
+#define SHADOW_HEADER_STRIDE 8
+#define SHADOW_CASCADE_STRIDE 24
+
+// Must match FShadows in Shaders/Shadows.glsl, part of the lighting pass's constants
+struct FShadowConstants
+{
+    uint32_t BufferIndex;
+    // In floats from the start of the buffer
+    uint32_t Offset;
+};
+
+// What the shadow passes did this frame, for the frame counters
+struct FShadowStats
+{
+    // Cascades rendered whole, cached ones included
+    uint32_t CascadesRendered;
+    // Cached cascades that only rendered the texels the view scrolled onto
+    uint32_t CascadesScrolled;
+    // Over the budget, they kept last frame's placement
+    uint32_t CascadesDeferred;
+    uint32_t Draws;
+
+    FShadowStats() : CascadesRendered(0), CascadesScrolled(0), CascadesDeferred(0), Draws(0) {}
+};
+
+// Directional light cascaded shadow maps. The view's depth range is split into cascades, each one a depth map of a
+// bounding sphere of its slice seen along the light. Cascades are placed on a grid of whole texels in light space so
+// their texels don't swim as the view moves.
+// A cascade's map is addressed as a torus: light space texel (x, y) always lands on texel (x mod Size, y mod Size), the
+// lookup wraps with a REPEAT sampler. Moving the cascade by less than its size then leaves every texel the old and new
+// placement share where it was, only the strips it uncovers are cleared and drawn. The farthest cascades are cached that
+// way from frame to frame, fully re-rendered only when the world, the light or their texel size changes, at most
+// ShadowCascadeBudget of them per frame. The nearer ones are re-rendered every frame.
+// Casters are drawn depth only, every actor being treated as static: the world's revision is what invalidates caches.
+class FShadowCascades
+{
+public:
+    FShadowCascades();
+
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, FBindlessHeap* InBindlessHeap, FPipelineStateCache& PipelineStateCache,
+        FRenderPassCache& RenderPassCache, VkPipelineLayout InPipelineLayout, const FRendererSettings& Settings);
+    void Shutdown();
+
+    // Places the cascades over the view, picks what each one renders this frame and culls the casters of every piece of
+    // map to draw. Bounds are the world's actors, in the same order as the actors AddPasses draws.
+    void Update(const glm::mat4& ViewProjection, const glm::vec3& InLightDirection, const FCullingBounds& Bounds, uint32_t InWorldRevision);
+    // One depth pass per cascade with something to render, the actors must stay alive until the graph has executed
+    FShadowStats AddPasses(FRenderGraph& RenderGraph, const std::vector<const FMeshActor*>& Actors);
+    // Sampled depth of every cascade the lighting pass can use
+    void ReadCascades(FRenderGraphPass& Pass) const;
+    // Light direction and cascades written to the frame's transient buffer, registered in the global set as
+    // TransientBindlessIndex. Without cascades lighting still gets the light direction.
+    FShadowConstants Upload(const glm::vec3& LightDirection, FTransientBuffer& TransientBuffer, uint32_t TransientBindlessIndex) const;
+
+private:
+    // Part of a cascade's map drawn this frame, a rectangle of light space texels that doesn't wrap around the map
+    struct FShadowPiece
+    {
+        VkRect2D Rect;
+        glm::mat4 ViewProjection;
+        std::vector<uint32_t> Visible;
+    };
+
+    struct FCascade
+    {
+        FTexture Texture;
+        FRenderGraphTexture GraphTexture;
+        // Placement of the contents: light space texel of the map's first texel, and texel size in world units
+        glm::ivec2 Origin;
+        float TexelSize;
+        float SplitFar;
+        bool bValid;
+        bool bCached;
+        // This frame
+        bool bFullRender;
+        std::vector<FShadowPiece> Pieces;
+    };
+
+    // Splits the texel rectangle where it wraps around the map, up to 4 pieces
+    void AddPieces(FCascade& Cascade, glm::ivec2 Min, glm::ivec2 Max);
+    glm::mat4 GetPieceViewProjection(const FCascade& Cascade, glm::ivec2 Min, glm::ivec2 Max) const;
+    void RenderCascade(const FRenderGraphPassContext& Context, const FCascade& Cascade, const std::vector<const FMeshActor*>& Actors) const;
+
+private:
+    VkDevice Device;
+    FBindlessHeap* BindlessHeap;
+    VkPipelineLayout PipelineLayout;
+    VkPipeline Pipeline;
+    VkSampler Sampler;
+    uint32_t SamplerIndex;
+    uint32_t CascadeCount;
+    uint32_t CachedCascadeCount;
+    uint32_t CascadeBudget;
+    uint32_t MapSize;
+    FCascade Cascades[SHADOW_MAX_CASCADES];
+    FShadowStats FrameStats;
+
+    // Light space basis and the depth range of the world along the light, every cached map depends on them
+    glm::mat4 LightView;
+    glm::vec3 LightDirection;
+    float MinLightDepth;
+    float MaxLightDepth;
+    uint32_t WorldRevision;
+    bool bLightValid;
+};
@@ -0,0 +1,81 @@
+#include "TransientBuffer.h"
+#include "Renderer.h"
+
+FTransientBuffer::FTransientBuffer()
+{
+    Device = VK_NULL_HANDLE;
+    Buffer = VK_NULL_HANDLE;
+    Memory = VK_NULL_HANDLE;
+    MappedData = nullptr;
+    Size = 0;
+    Head = 0;
+}
+
+void FTransientBuffer::Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, VkDeviceSize InSize, uint32_t GraphicsQueueFamily, uint32_t AsyncComputeQueueFamily)
+{
+    Device = InDevice;
+    Size = InSize;
+    Head = 0;
+
+    VkBufferCreateInfo BufferInfo = {};
+    BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    BufferInfo.size = Size;
+    BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+        | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    const uint32_t QueueFamilies[] = { GraphicsQueueFamily, AsyncComputeQueueFamily };
+    const bool bShared = AsyncComputeQueueFamily != VK_QUEUE_FAMILY_IGNORED;
+    BufferInfo.sharingMode = bShared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    BufferInfo.queueFamilyIndexCount = bShared ? 2 : 0;
+    BufferInfo.pQueueFamilyIndices = bShared ? QueueFamilies : nullptr;
+    if(vkCreateBuffer(Device, &BufferInfo, nullptr, &Buffer) != VK_SUCCESS)
+    {
+        checkf(0, "FTransientBuffer: unable to create buffer");
+    }
+
+    VkMemoryRequirements MemoryRequirements;
+    vkGetBufferMemoryRequirements(Device, Buffer, &MemoryRequirements);
+
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = MemoryRequirements.size;
+    AllocateInfo.memoryTypeIndex = FRenderer::FindMemoryType(PhysicalDevice, MemoryRequirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if(vkAllocateMemory(Device, &AllocateInfo, nullptr, &Memory) != VK_SUCCESS)
+    {
+        checkf(0, "FTransientBuffer: unable to allocate memory");
+    }
+
+    vkBindBufferMemory(Device, Buffer, Memory, 0);
+    vkMapMemory(Device, Memory, 0, Size, 0, reinterpret_cast<void**>(&MappedData));
+}
+
+void FTransientBuffer::Shutdown()
+{
+    if(Device == VK_NULL_HANDLE) return;
+
+    vkUnmapMemory(Device, Memory);
+    vkDestroyBuffer(Device, Buffer, nullptr);
+    vkFreeMemory(Device, Memory, nullptr);
+    Buffer = VK_NULL_HANDLE;
+    Memory = VK_NULL_HANDLE;
+    MappedData = nullptr;
+    Device = VK_NULL_HANDLE;
+}
+
+void FTransientBuffer::Reset()
+{
+    Head = 0;
+}
+
+FTransientAllocation FTransientBuffer::Allocate(VkDeviceSize AllocationSize, VkDeviceSize Alignment)
+{
+    const VkDeviceSize Offset = (Head + Alignment - 1) & ~(Alignment - 1);
+    checkf(Offset + AllocationSize <= Size, "FTransientBuffer: out of transient memory, raise -transient");
+    Head = Offset + AllocationSize;
+
+    FTransientAllocation Allocation;
+    Allocation.Buffer = Buffer;
+    Allocation.Offset = Offset;
+    Allocation.Data = MappedData + Offset;
+    return Allocation;
+}
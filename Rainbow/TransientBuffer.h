@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include "MinimalCore.h"
+
+struct FTransientAllocation
+{
+    VkBuffer Buffer;
+    VkDeviceSize Offset;
+    void* Data;
+};
+
+// Persistently mapped linear allocator for data that only lives for one frame (constants, instance data, uploads).
+// One per frame in flight, reset once the frame's ticket is complete so the GPU is done reading it.
+class FTransientBuffer
+{
+public:
+    FTransientBuffer();
+
+    // Shared with the async compute family when there is one, its passes read what the frame uploaded
+    void Init(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, VkDeviceSize InSize, uint32_t GraphicsQueueFamily, uint32_t AsyncComputeQueueFamily);
+    void Shutdown();
+    void Reset();
+
+    FTransientAllocation Allocate(VkDeviceSize AllocationSize, VkDeviceSize Alignment = 256);
+
+    VkBuffer GetBuffer() const { return Buffer; }
+    VkDeviceSize GetSize() const { return Size; }
+    VkDeviceSize GetUsedSize() const { return Head; }
+
+private:
+    VkDevice Device;
+    VkBuffer Buffer;
+    VkDeviceMemory Memory;
+    uint8_t* MappedData;
+    VkDeviceSize Size;
+    VkDeviceSize Head;
+};
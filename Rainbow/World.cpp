@@ -3,17 +3,27 @@
 #include "Actor.h"
 #include "MeshActor.h"
 #include "Paths.h"
+#include <glm/geometric.hpp>
+
+FWorld::FWorld()
+{
+    Revision = 0;
+    DirectionalLight = glm::normalize(glm::vec3(0.5f, 1.0f, 0.3f));
+}
 
 void FWorld::LoadWorld()
 {
+    SCOPED_ZONE("FWorld::LoadWorld");
     const std::shared_ptr<FActor> NewMesh = CreateActor<FMeshActor>(glm::vec3(0), glm::vec3(0));
     NewMesh->SetWorld(this);
     NewMesh->LoadActor(FPaths::GetContentDirectory() + "/suzan.fbx");
     Actors.push_back(NewMesh);
+    Revision++;
 }
 
 void FWorld::Render()
 {
+    SCOPED_ZONE("FWorld::Render");
     for(auto& Actor : Actors)
     {
         if(Actor->IsValid())
@@ -28,6 +38,45 @@ std::vector<std::shared_ptr<FActor>> FWorld::GetActors()
     return Actors;
 }
 
+void FWorld::AddActor(const std::shared_ptr<FActor>& Actor)
+{
+    Actor->SetWorld(this);
+    Actors.push_back(Actor);
+    Revision++;
+}
+
+FMaterial* FWorld::CreateMaterial()
+{
+    Materials.emplace_back(new FMaterial());
+    return Materials.back().get();
+}
+
+FVertexBuffer* FWorld::FindMesh(const std::string& FilePath) const
+{
+    const auto Found = Meshes.find(FilePath);
+    return Found != Meshes.end() ? Found->second : nullptr;
+}
+
+void FWorld::AddMesh(const std::string& FilePath, FVertexBuffer* VertexBuffer)
+{
+    Meshes[FilePath] = VertexBuffer;
+}
+
+void FWorld::AddLight(const FLight& Light)
+{
+    Lights.push_back(Light);
+}
+
+const std::vector<FLight>& FWorld::GetLights() const
+{
+    return Lights;
+}
+
+void FWorld::SetDirectionalLight(const glm::vec3& Direction)
+{
+    DirectionalLight = glm::normalize(Direction);
+}
+
 template <class ActorClass>
 std::shared_ptr<FActor> FWorld::CreateActor(glm::vec3 Location, glm::vec3 Rotation, glm::vec3 Scale)
 {
@@ -1,22 +1,47 @@
 ﻿#pragma once
 #include "MinimalCore.h"
+#include "Light.h"
+#include "Material.h"
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <glm/vec3.hpp>
 
 class FActor;
+struct FVertexBuffer;
 
 class FWorld
 {
 public:
+    FWorld();
+
     void LoadWorld();
     void Render();
 
     template<class ActorClass>
     std::shared_ptr<FActor> CreateActor(glm::vec3 Location, glm::vec3 Rotation, glm::vec3 Scale = glm::vec3(1));
     std::vector<std::shared_ptr<FActor>> GetActors();
+    void AddActor(const std::shared_ptr<FActor>& Actor);
+    // Changes whenever actors are added, for renderer side copies of the scene to know when to rebuild
+    uint32_t GetRevision() const { return Revision; }
+    // Owned by the world, actors only point at them
+    FMaterial* CreateMaterial();
+    // Meshes loaded from a file, actors loading the same file share one vertex buffer and can be drawn instanced
+    FVertexBuffer* FindMesh(const std::string& FilePath) const;
+    void AddMesh(const std::string& FilePath, FVertexBuffer* VertexBuffer);
+    void AddLight(const FLight& Light);
+    const std::vector<FLight>& GetLights() const;
+    // Direction pointing towards the sun, the light every pixel gets and the one casting shadows
+    void SetDirectionalLight(const glm::vec3& Direction);
+    const glm::vec3& GetDirectionalLight() const { return DirectionalLight; }
 
 private:
     std::vector<std::shared_ptr<FActor>> Actors;
+    std::vector<std::unique_ptr<FMaterial>> Materials;
+    std::unordered_map<std::string, FVertexBuffer*> Meshes;
+    std::vector<FLight> Lights;
+    glm::vec3 DirectionalLight;
+    uint32_t Revision;
 };
 
@@ -1,17 +1,28 @@
 #pragma once
 #define SDL_MAIN_HANDLED
+#include <memory>
 #include "RenderWindow.h"
 #include "Renderer.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-    FRenderWindow RenderWindow("Rainbow", 1920, 1080);
+    const FRendererSettings Settings = FRendererSettings::FromCommandLine(argc, argv);
+
+    // Headless runs never open a window, SDL is only used for logging then
+    std::unique_ptr<FRenderWindow> RenderWindow;
+    if(!Settings.bHeadless)
+    {
+        RenderWindow.reset(new FRenderWindow("Rainbow", 1920, 1080));
+    }
 	
     FRenderer Renderer;
-    Renderer.Init(&RenderWindow);
+    Renderer.Init(RenderWindow.get(), Settings);
     Renderer.RenderLoop();
 
     Renderer.Shutdown();
-    RenderWindow.Shutdown();
+    if(RenderWindow)
+    {
+        RenderWindow->Shutdown();
+    }
     return 0;
 }